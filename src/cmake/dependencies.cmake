@@ -112,6 +112,7 @@ set(BUILD_SHARED_LIBS OFF)
 include(GNUInstallDirs)
 add_subdirectory("${DEPS_DIR}/recastnavigation/Recast")
 add_subdirectory("${DEPS_DIR}/recastnavigation/Detour")
+add_subdirectory("${DEPS_DIR}/recastnavigation/DetourTileCache")
 set(BUILD_SHARED_LIBS ${_PREV_BUILD_SHARED_LIBS})
 # Needed so that Detour doesn't hide the implementation of the method on dtQueryFilter
 target_compile_definitions(Detour PUBLIC DT_VIRTUAL_QUERYFILTER)
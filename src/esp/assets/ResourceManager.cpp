@@ -38,6 +38,8 @@
 #include <Magnum/Trade/TextureData.h>
 #include <Magnum/VertexFormat.h>
 
+#include <algorithm>
+
 #include "esp/geo/geo.h"
 #include "esp/gfx/GenericDrawable.h"
 #include "esp/gfx/MaterialUtil.h"
@@ -508,6 +510,42 @@ scene::SceneNode* ResourceManager::loadAndCreateRenderAssetInstance(
   return createRenderAssetInstance(creation, &rootNode, &drawables);
 }  // ResourceManager::loadAndCreateRenderAssetInstance
 
+bool ResourceManager::prefetchRenderAssetFile(const AssetInfo& assetInfo) {
+  const std::string& filename = assetInfo.filepath;
+  if (resourceDict_.count(filename) > 0) {
+    return true;
+  }
+  auto it = prefetchedFiles_.find(filename);
+  if (it != prefetchedFiles_.end()) {
+    return it->second->readGroup.isDone();
+  }
+  if (!isRenderAssetGeneral(assetInfo.type)) {
+    return false;
+  }
+
+  if (!prefetchScheduler_) {
+    prefetchScheduler_ = core::TaskScheduler::create_unique();
+  }
+  auto file = std::make_unique<PrefetchedFile>();
+  file->filename = filename;
+  PrefetchedFile* filePtr = file.get();
+  prefetchScheduler_->submit(filePtr->readGroup, [filePtr]() {
+    if (Cr::Utility::Directory::exists(filePtr->filename)) {
+      filePtr->data = Cr::Utility::Directory::read(filePtr->filename);
+    }
+  });
+  prefetchedFiles_.emplace(filename, std::move(file));
+  return false;
+}  // ResourceManager::prefetchRenderAssetFile
+
+void ResourceManager::clearPrefetchedFiles() {
+  // reads in progress still write to their entries
+  for (auto& file : prefetchedFiles_) {
+    prefetchScheduler_->wait(file.second->readGroup);
+  }
+  prefetchedFiles_.clear();
+}  // ResourceManager::clearPrefetchedFiles
+
 bool ResourceManager::loadRenderAsset(const AssetInfo& info) {
   bool meshSuccess = false;
   if (info.type == AssetType::FRL_PTEX_MESH) {
@@ -531,6 +569,21 @@ scene::SceneNode* ResourceManager::createRenderAssetInstance(
     scene::SceneNode* parent,
     DrawableGroup* drawables,
     std::vector<scene::SceneNode*>* visNodeCache) {
+  scene::SceneNode* newNode = createUnrecordedRenderAssetInstance(
+      creation, parent, drawables, visNodeCache);
+
+  if (gfxReplayRecorder_ && newNode) {
+    gfxReplayRecorder_->onCreateRenderAssetInstance(newNode, creation);
+  }
+
+  return newNode;
+}  // ResourceManager::createRenderAssetInstance
+
+scene::SceneNode* ResourceManager::createUnrecordedRenderAssetInstance(
+    const RenderAssetInstanceCreationInfo& creation,
+    scene::SceneNode* parent,
+    DrawableGroup* drawables,
+    std::vector<scene::SceneNode*>* visNodeCache) {
   CORRADE_ASSERT(resourceDict_.count(creation.filepath), "asset is not loaded",
                  nullptr);
 
@@ -564,12 +617,8 @@ scene::SceneNode* ResourceManager::createRenderAssetInstance(
     CORRADE_INTERNAL_ASSERT_UNREACHABLE();
   }
 
-  if (gfxReplayRecorder_ && newNode) {
-    gfxReplayRecorder_->onCreateRenderAssetInstance(newNode, creation);
-  }
-
   return newNode;
-}  // ResourceManager::createRenderAssetInstance
+}  // ResourceManager::createUnrecordedRenderAssetInstance
 
 bool ResourceManager::loadStageInternal(
     const AssetInfo& info,
@@ -1186,6 +1235,24 @@ bool ResourceManager::loadRenderAssetGeneral(const AssetInfo& info) {
 #endif
   }
 
+  // Serve the file from memory if it was prefetched. The importer keeps
+  // referencing the data, so it's closed before the data goes away.
+  std::unique_ptr<PrefetchedFile> prefetchedFile = takePrefetchedFile(filename);
+  struct PrefetchedFileCloser {
+    Importer* importer;
+    ~PrefetchedFileCloser() {
+      if (importer) {
+        importer->close();
+        importer->setFileCallback(nullptr);
+      }
+    }
+  } prefetchedFileCloser{nullptr};
+  if (prefetchedFile && !prefetchedFile->data.empty()) {
+    fileImporter_->close();
+    fileImporter_->setFileCallback(&servePrefetchedFile, *prefetchedFile);
+    prefetchedFileCloser.importer = fileImporter_.get();
+  }
+
   if (!fileImporter_->openFile(filename)) {
     LOG(ERROR) << "Cannot open file " << filename;
     return false;
@@ -1232,6 +1299,47 @@ bool ResourceManager::loadRenderAssetGeneral(const AssetInfo& info) {
   return true;
 }  // ResourceManager::loadRenderAssetGeneral
 
+std::unique_ptr<ResourceManager::PrefetchedFile>
+ResourceManager::takePrefetchedFile(const std::string& filename) {
+  auto it = prefetchedFiles_.find(filename);
+  if (it == prefetchedFiles_.end()) {
+    return nullptr;
+  }
+  std::unique_ptr<PrefetchedFile> file = std::move(it->second);
+  prefetchedFiles_.erase(it);
+  // helps with queued reads while waiting
+  prefetchScheduler_->wait(file->readGroup);
+  return file;
+}  // ResourceManager::takePrefetchedFile
+
+Cr::Containers::Optional<Cr::Containers::ArrayView<const char>>
+ResourceManager::servePrefetchedFile(const std::string& filename,
+                                     Mn::InputFileCallbackPolicy policy,
+                                     PrefetchedFile& file) {
+  if (filename == file.filename) {
+    if (policy == Mn::InputFileCallbackPolicy::Close) {
+      return Cr::Containers::NullOpt;
+    }
+    return Cr::Containers::ArrayView<const char>{file.data};
+  }
+
+  // files referenced by the prefetched one are read on demand
+  if (policy == Mn::InputFileCallbackPolicy::Close) {
+    file.otherFiles.erase(filename);
+    return Cr::Containers::NullOpt;
+  }
+  auto it = file.otherFiles.find(filename);
+  if (it == file.otherFiles.end()) {
+    if (!Cr::Utility::Directory::exists(filename)) {
+      return Cr::Containers::NullOpt;
+    }
+    it = file.otherFiles
+             .emplace(filename, Cr::Utility::Directory::read(filename))
+             .first;
+  }
+  return Cr::Containers::ArrayView<const char>{it->second};
+}  // ResourceManager::servePrefetchedFile
+
 scene::SceneNode* ResourceManager::createRenderAssetInstanceGeneralPrimitive(
     const RenderAssetInstanceCreationInfo& creation,
     scene::SceneNode* parent,
@@ -1885,7 +1993,7 @@ bool ResourceManager::instantiateAssetsOnDemand(
   return true;
 }  // ResourceManager::instantiateAssetsOnDemand
 
-void ResourceManager::addObjectToDrawables(
+scene::SceneNode* ResourceManager::addObjectToDrawables(
     const ObjectAttributes::ptr& ObjectAttributes,
     scene::SceneNode* parent,
     DrawableGroup* drawables,
@@ -1903,11 +2011,57 @@ void ResourceManager::addObjectToDrawables(
     RenderAssetInstanceCreationInfo creation(
         renderObjectName, ObjectAttributes->getScale(), flags, lightSetupKey);
 
-    createRenderAssetInstance(creation, parent, drawables, &visNodeCache);
+    return createRenderAssetInstance(creation, parent, drawables,
+                                     &visNodeCache);
 
   }  // should always be specified, otherwise won't do anything
+  return nullptr;
 }  // addObjectToDrawables
 
+scene::SceneNode* ResourceManager::swapObjectDrawables(
+    scene::SceneNode* instanceRoot,
+    const ObjectAttributes::ptr& ObjectAttributes,
+    DrawableGroup* drawables,
+    std::vector<scene::SceneNode*>& visNodeCache,
+    const std::string& lightSetupKey) {
+  CORRADE_ASSERT(instanceRoot && instanceRoot->parent(),
+                 "ResourceManager::swapObjectDrawables : instance has no "
+                 "parent",
+                 nullptr);
+  auto* parent = static_cast<scene::SceneNode*>(instanceRoot->parent());
+
+  // drop the cached nodes of the old instance, which are all in its subtree
+  auto isInOldInstance = [instanceRoot](const scene::SceneNode* node) {
+    for (auto* n = node; n; n = static_cast<const scene::SceneNode*>(
+                                n->parent())) {
+      if (n == instanceRoot) {
+        return true;
+      }
+    }
+    return false;
+  };
+  visNodeCache.erase(std::remove_if(visNodeCache.begin(), visNodeCache.end(),
+                                    isInOldInstance),
+                     visNodeCache.end());
+
+  RenderAssetInstanceCreationInfo::Flags flags;
+  flags |= RenderAssetInstanceCreationInfo::Flag::IsRGBD;
+  flags |= RenderAssetInstanceCreationInfo::Flag::IsSemantic;
+  RenderAssetInstanceCreationInfo creation(
+      ObjectAttributes->getRenderAssetHandle(), ObjectAttributes->getScale(),
+      flags, lightSetupKey);
+
+  scene::SceneNode* newNode = createUnrecordedRenderAssetInstance(
+      creation, parent, drawables, &visNodeCache);
+  if (gfxReplayRecorder_) {
+    gfxReplayRecorder_->onChangeRenderAssetInstance(instanceRoot, newNode,
+                                                    creation);
+  }
+  delete instanceRoot;
+
+  return newNode;
+}  // swapObjectDrawables
+
 //! Add component to rendering stack, based on importer loading
 void ResourceManager::addComponent(
     const MeshMetaData& metaData,
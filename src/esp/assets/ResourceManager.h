@@ -13,12 +13,15 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include <Corrade/Containers/Array.h>
 #include <Corrade/Containers/EnumSet.h>
 #include <Corrade/Containers/Optional.h>
 #include <Magnum/EigenIntegration/Integration.h>
+#include <Magnum/FileCallback.h>
 #include <Magnum/GL/TextureFormat.h>
 #include <Magnum/MeshTools/Compile.h>
 #include <Magnum/MeshTools/Transform.h>
@@ -32,6 +35,7 @@
 #include "MeshData.h"
 #include "MeshMetaData.h"
 #include "RenderAssetInstanceCreationInfo.h"
+#include "esp/core/TaskScheduler.h"
 #include "esp/geo/VoxelGrid.h"
 #include "esp/gfx/Drawable.h"
 #include "esp/gfx/DrawableGroup.h"
@@ -443,14 +447,44 @@ class ResourceManager {
    * for the added component.
    * @param[out] visNodeCache Cache for pointers to all nodes created as the
    * result of this process.
+   * @return The root node of the created render asset instance, or nullptr
+   * if nothing was added.
    */
-  void addObjectToDrawables(
+  scene::SceneNode* addObjectToDrawables(
       const metadata::attributes::ObjectAttributes::ptr& ObjectAttributes,
       scene::SceneNode* parent,
       DrawableGroup* drawables,
       std::vector<scene::SceneNode*>& visNodeCache,
       const std::string& lightSetupKey = DEFAULT_LIGHTING_KEY);
 
+  /**
+   * @brief Replace a render asset instance created by @ref
+   * addObjectToDrawables with an instance of another object template's render
+   * asset, under the same parent. Only the visual nodes and drawables are
+   * rebuilt. A gfx replay recording sees this as a change of the existing
+   * instance rather than a deletion and a creation.
+   *
+   * The render asset of @p ObjectAttributes must already be loaded, e.g.
+   * with @ref instantiateAssetsOnDemand.
+   * @param instanceRoot The instance to replace, as returned by @ref
+   * addObjectToDrawables. It is deleted.
+   * @param ObjectAttributes The attributes whose render asset and scale to
+   * use.
+   * @param drawables The @ref DrawableGroup with which the new instance will
+   * be rendered.
+   * @param[in,out] visNodeCache Cache holding the nodes of the old instance,
+   * which are replaced by those of the new one.
+   * @param lightSetupKey The @ref LightSetup key that will be used
+   * for the new instance.
+   * @return The root node of the new instance.
+   */
+  scene::SceneNode* swapObjectDrawables(
+      scene::SceneNode* instanceRoot,
+      const metadata::attributes::ObjectAttributes::ptr& ObjectAttributes,
+      DrawableGroup* drawables,
+      std::vector<scene::SceneNode*>& visNodeCache,
+      const std::string& lightSetupKey = DEFAULT_LIGHTING_KEY);
+
   /**
    * @brief Create a new drawable primitive attached to the desired @ref
    * scene::SceneNode.
@@ -599,6 +633,31 @@ class ResourceManager {
       esp::scene::SceneManager* sceneManagerPtr,
       const std::vector<int>& activeSceneIDs);
 
+  /**
+   * @brief Start reading the file of a render asset on a worker thread, so a
+   * later load of the asset, e.g. by @ref loadAndCreateRenderAssetInstance,
+   * doesn't wait for disk I/O. Only assets loaded through the general
+   * importer are prefetched.
+   *
+   * This only prefetches I/O. Importing and uploading the asset still happen
+   * on the thread which loads it, since the importer plugins and the GL
+   * context can't be used from other threads. Files the asset references,
+   * e.g. glTF buffers and images, are read when it's loaded.
+   *
+   * @param assetInfo the render asset to prefetch
+   * @return Whether the asset can be loaded without waiting, i.e. it's
+   * loaded already or its prefetch has finished.
+   */
+  bool prefetchRenderAssetFile(const AssetInfo& assetInfo);
+
+  /**
+   * @brief Drop the prefetched files which haven't been loaded yet, waiting
+   * for reads in progress. Loading an asset consumes its prefetched file, so
+   * this only frees prefetches nothing asked for, e.g. when the scene is
+   * reset.
+   */
+  void clearPrefetchedFiles();
+
  private:
   /**
    * @brief Load the requested mesh info into @ref meshInfo corresponding to
@@ -867,6 +926,37 @@ class ResourceManager {
    */
   bool loadRenderAssetGeneral(const AssetInfo& info);
 
+  /**
+   * @brief File contents read ahead by @ref prefetchRenderAssetFile
+   */
+  struct PrefetchedFile {
+    std::string filename;
+    //! Done once data has been read
+    core::TaskScheduler::TaskGroup readGroup;
+    //! Empty if the file couldn't be read
+    Corrade::Containers::Array<char> data;
+    //! Other files the importer opens while loading this one, e.g. glTF
+    //! buffers and images
+    std::unordered_map<std::string, Corrade::Containers::Array<char>>
+        otherFiles;
+  };
+
+  /**
+   * @brief Remove the prefetched contents of @p filename, waiting for the
+   * read to finish if needed. Returns nullptr if the file wasn't prefetched.
+   */
+  std::unique_ptr<PrefetchedFile> takePrefetchedFile(
+      const std::string& filename);
+
+  /**
+   * @brief Importer file callback serving @p file from memory
+   */
+  static Corrade::Containers::Optional<
+      Corrade::Containers::ArrayView<const char>>
+  servePrefetchedFile(const std::string& filename,
+                      Mn::InputFileCallbackPolicy policy,
+                      PrefetchedFile& file);
+
   /**
    * @brief Create a render asset instance.
    *
@@ -884,6 +974,16 @@ class ResourceManager {
       DrawableGroup* drawables,
       std::vector<scene::SceneNode*>* visNodeCache = nullptr);
 
+  /**
+   * @brief Backend for @ref createRenderAssetInstance which doesn't inform
+   * the gfx replay recorder.
+   */
+  scene::SceneNode* createUnrecordedRenderAssetInstance(
+      const RenderAssetInstanceCreationInfo& creation,
+      scene::SceneNode* parent,
+      DrawableGroup* drawables,
+      std::vector<scene::SceneNode*>* visNodeCache);
+
   /**
    * @brief PTex Mesh backend for createRenderAssetInstance
    */
@@ -1096,6 +1196,20 @@ class ResourceManager {
    * @brief See @ref setRecorder.
    */
   std::shared_ptr<esp::gfx::replay::Recorder> gfxReplayRecorder_;
+
+  /**
+   * @brief Files being or already read by @ref prefetchRenderAssetFile,
+   * keyed by filename
+   */
+  std::unordered_map<std::string, std::unique_ptr<PrefetchedFile>>
+      prefetchedFiles_;
+
+  /**
+   * @brief Runs the reads for @ref prefetchRenderAssetFile, created on first
+   * use. Declared after @ref prefetchedFiles_, so it finishes running reads
+   * before their destinations are destroyed.
+   */
+  core::TaskScheduler::uptr prefetchScheduler_;
 };  // class ResourceManager
 
 CORRADE_ENUMSET_OPERATORS(ResourceManager::Flags)
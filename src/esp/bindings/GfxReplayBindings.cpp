@@ -26,6 +26,10 @@ void initGfxReplayBindings(py::module& m) {
           "set_keyframe_index", &Player::setKeyframeIndex,
           R"(Set a keyframe by index, or pass -1 to clear the currently-set keyframe.)")
 
+      .def(
+          "set_keyframe_time", &Player::setKeyframeTime,
+          R"(Set a fractional keyframe time, interpolating instance and user transforms between the surrounding keyframes.)")
+
       .def("get_keyframe_index", &Player::getKeyframeIndex,
            R"(Get the number of keyframes read from file.)")
 
@@ -41,6 +45,18 @@ void initGfxReplayBindings(py::module& m) {
           },
           R"(Get a previously-added user transform. See also ReplayManager.add_user_transform_to_keyframe.)")
 
+      .def(
+          "get_prefetch_stats",
+          [](Player& self) {
+            const auto& stats = self.getPrefetchStats();
+            return py::dict("hits"_a = stats.hits, "misses"_a = stats.misses);
+          },
+          R"(Get how many render asset files were or weren't read ahead by the time they were first needed.)")
+
+      .def(
+          "get_physics_object_ids", &Player::getPhysicsObjectIDs,
+          R"(Get the IDs of the kinematic physics objects driven by the set keyframe, for a player created with drive_physics. Use them with contact tests and raycasts at the recorded poses.)")
+
       .def(
           "close", &Player::close,
           R"(Unload all keyframes. The Player is unusable after it is closed.)");
@@ -83,10 +99,59 @@ void initGfxReplayBindings(py::module& m) {
             }
             self.getRecorder()->writeSavedKeyframesToFile(filepath);
           },
-          R"(Write all saved keyframes to a file, then discard the keyframes.)")
+          R"(Write all saved keyframes to a file, then discard the keyframes. Files ending in .bin use the compact binary format, other files use JSON.)")
+
+      .def(
+          "start_streaming_to_file",
+          [](ReplayManager& self, const std::string& filepath,
+             int keyframesPerChunk, int maxPendingChunks) {
+            if (!self.getRecorder()) {
+              throw std::runtime_error(
+                  "replay save not enabled. See "
+                  "SimulatorConfiguration.enable_gfx_replay_save.");
+            }
+            self.getRecorder()->startStreamingToFile(
+                filepath, keyframesPerChunk, maxPendingChunks);
+          },
+          R"(Write saved keyframes to a binary replay file in chunks, on a background thread, instead of keeping them in memory. The file can be read up to the last written chunk while recording.)",
+          "filepath"_a, "keyframes_per_chunk"_a = 64,
+          "max_pending_chunks"_a = 4)
 
-      .def("read_keyframes_from_file", &ReplayManager::readKeyframesFromFile,
-           R"(Create a Player object from a replay file.)");
+      .def(
+          "stop_streaming",
+          [](ReplayManager& self) {
+            if (!self.getRecorder()) {
+              throw std::runtime_error(
+                  "replay save not enabled. See "
+                  "SimulatorConfiguration.enable_gfx_replay_save.");
+            }
+            self.getRecorder()->stopStreaming();
+          },
+          R"(Write the remaining keyframes and close the file started with start_streaming_to_file.)")
+
+      .def(
+          "set_checkpoint_interval",
+          [](ReplayManager& self, int interval) {
+            if (!self.getRecorder()) {
+              throw std::runtime_error(
+                  "replay save not enabled. See "
+                  "SimulatorConfiguration.enable_gfx_replay_save.");
+            }
+            self.getRecorder()->setCheckpointInterval(interval);
+          },
+          R"(Save a checkpoint with the full scene state every interval keyframes, so players can seek without applying all earlier keyframes. 0 disables checkpoints.)",
+          "interval"_a)
+
+      .def(
+          "set_player_prefetch_keyframes_ahead",
+          &ReplayManager::setPlayerPrefetchKeyframesAhead,
+          R"(Set how many keyframes ahead players created by read_keyframes_from_file load render assets in the background.)",
+          "num_keyframes_ahead"_a)
+
+      .def(
+          "read_keyframes_from_file", &ReplayManager::readKeyframesFromFile,
+          R"(Create a Player object from a replay file. With drive_physics, the player adds a kinematic physics object for each instance instead of a render asset instance and sets the objects' states as keyframes are set, so contact tests and raycasts can be evaluated at recorded poses without stepping physics.)",
+          "filepath"_a, "drive_physics"_a = false);
 }
 
 }  // namespace replay
@@ -6,6 +6,7 @@
 
 #include <pybind11/eigen.h>
 #include <pybind11/functional.h>
+#include <pybind11/numpy.h>
 #include <pybind11/stl.h>
 
 #include <Magnum/Math/Vector3.h>
@@ -24,6 +25,32 @@ using py::literals::operator""_a;
 namespace esp {
 namespace nav {
 
+namespace {
+
+// batched points are exchanged with numpy as (N, 3) arrays, which is the
+// memory layout of an array of vec3f
+static_assert(sizeof(vec3f) == 3 * sizeof(float),
+              "vec3f is expected to be tightly packed");
+
+using PointArray =
+    py::array_t<float, py::array::c_style | py::array::forcecast>;
+
+Corrade::Containers::ArrayView<const vec3f> pointsView(const PointArray& points,
+                                                       const char* name) {
+  if (points.ndim() != 2 || points.shape(1) != 3) {
+    throw std::runtime_error(std::string(name) + " must be an (N, 3) array");
+  }
+  return {reinterpret_cast<const vec3f*>(points.data()),
+          std::size_t(points.shape(0))};
+}
+
+Corrade::Containers::ArrayView<vec3f> resultsView(PointArray& results) {
+  return {reinterpret_cast<vec3f*>(results.mutable_data()),
+          std::size_t(results.shape(0))};
+}
+
+}  // namespace
+
 void initShortestPathBindings(py::module& m) {
   py::class_<HitRecord>(m, "HitRecord")
       .def(py::init())
@@ -48,6 +75,19 @@ void initShortestPathBindings(py::module& m) {
       .def_readwrite("geodesic_distance",
                      &MultiGoalShortestPath::geodesicDistance);
 
+  py::class_<GeodesicDistanceField, GeodesicDistanceField::ptr>(
+      m, "GeodesicDistanceField")
+      .def_property_readonly("goals", &GeodesicDistanceField::getGoals)
+      .def_property_readonly(
+          "is_up_to_date", &GeodesicDistanceField::isUpToDate,
+          R"(False once update_obstacles changed the navmesh the field was built on, it then has to be built again.)")
+      .def("geodesic_distance", &GeodesicDistanceField::geodesicDistance,
+           R"(Returns the geodesic distance from pt to the closest goal, inf if no goal can be reached.)",
+           "pt"_a)
+      .def("next_waypoint", &GeodesicDistanceField::nextWaypoint,
+           R"(Returns the next point on the shortest path from pt to the closest goal.)",
+           "pt"_a);
+
   py::class_<NavMeshSettings, NavMeshSettings::ptr>(m, "NavMeshSettings")
       .def(py::init(&NavMeshSettings::create<>))
       .def_readwrite("cell_size", &NavMeshSettings::cellSize)
@@ -69,6 +109,8 @@ void initShortestPathBindings(py::module& m) {
       .def_readwrite("filter_ledge_spans", &NavMeshSettings::filterLedgeSpans)
       .def_readwrite("filter_walkable_low_height_spans",
                      &NavMeshSettings::filterWalkableLowHeightSpans)
+      .def_readwrite("tile_size", &NavMeshSettings::tileSize,
+                     R"(Tile size in cells. If positive, the navmesh is built in tiles and supports obstacles, see PathFinder.set_obstacle.)")
       .def("set_defaults", &NavMeshSettings::setDefaults);
 
   py::class_<PathFinder, PathFinder::ptr>(m, "PathFinder")
@@ -78,6 +120,9 @@ void initShortestPathBindings(py::module& m) {
       .def("get_topdown_view", &PathFinder::getTopDownView,
            R"(Returns the topdown view of the PathFinder's navmesh.)",
            "meters_per_pixel"_a, "height"_a)
+      .def("get_topdown_island_view", &PathFinder::getTopDownIslandView,
+           R"(Returns the topdown view of the PathFinder's navmesh with 1 + the island index of each navigable pixel, 0 elsewhere.)",
+           "meters_per_pixel"_a, "height"_a)
       .def("get_random_navigable_point", &PathFinder::getRandomNavigablePoint,
            "max_tries"_a = 10)
       .def("find_path", py::overload_cast<ShortestPath&>(&PathFinder::findPath),
@@ -85,6 +130,67 @@ void initShortestPathBindings(py::module& m) {
       .def("find_path",
            py::overload_cast<MultiGoalShortestPath&>(&PathFinder::findPath),
            "path"_a)
+      .def(
+          "find_paths",
+          [](PathFinder& self, const std::vector<ShortestPath::ptr>& paths) {
+            std::vector<ShortestPath> batch(paths.size());
+            for (std::size_t i = 0; i < paths.size(); ++i) {
+              batch[i].requestedStart = paths[i]->requestedStart;
+              batch[i].requestedEnd = paths[i]->requestedEnd;
+            }
+            {
+              py::gil_scoped_release release;
+              self.findPaths(Corrade::Containers::arrayView(batch.data(),
+                                                            batch.size()));
+            }
+            for (std::size_t i = 0; i < paths.size(); ++i) {
+              paths[i]->points = std::move(batch[i].points);
+              paths[i]->geodesicDistance = batch[i].geodesicDistance;
+            }
+          },
+          R"(Find many shortest paths in parallel, same as calling find_path on each.)",
+          "paths"_a)
+      .def(
+          "snap_points",
+          [](PathFinder& self, const PointArray& points) {
+            const auto input = pointsView(points, "points");
+            PointArray result({py::ssize_t(input.size()), py::ssize_t(3)});
+            auto output = resultsView(result);
+            {
+              py::gil_scoped_release release;
+              self.snapPoints(input, output);
+            }
+            return result;
+          },
+          R"(Snap an (N, 3) array of points to the navmesh in parallel, same as calling snap_point on each.)",
+          "points"_a)
+      .def(
+          "try_steps",
+          [](PathFinder& self, const PointArray& starts, const PointArray& ends,
+             bool allowSliding) {
+            const auto startsView = pointsView(starts, "starts");
+            const auto endsView = pointsView(ends, "ends");
+            if (startsView.size() != endsView.size()) {
+              throw std::runtime_error(
+                  "starts and ends must have the same shape");
+            }
+            PointArray result({py::ssize_t(startsView.size()), py::ssize_t(3)});
+            auto output = resultsView(result);
+            {
+              py::gil_scoped_release release;
+              if (allowSliding) {
+                self.trySteps(startsView, endsView, output);
+              } else {
+                self.tryStepsNoSliding(startsView, endsView, output);
+              }
+            }
+            return result;
+          },
+          R"(Take a step from each of an (N, 3) array of starts towards the matching end in parallel, same as calling try_step, or try_step_no_sliding without allow_sliding, on each.)",
+          "starts"_a, "ends"_a, "allow_sliding"_a = true)
+      .def("build_distance_field", &PathFinder::buildDistanceField,
+           R"(Precompute the geodesic distances to goals over the whole navmesh, for many distance queries to the same goals.)",
+           "goals"_a, py::call_guard<py::gil_scoped_release>())
       .def("try_step", &PathFinder::tryStep<Magnum::Vector3>, "start"_a,
            "end"_a)
       .def("try_step", &PathFinder::tryStep<vec3f>, "start"_a, "end"_a)
@@ -101,6 +207,18 @@ void initShortestPathBindings(py::module& m) {
            [](PathFinder& self) { return self.getNavMeshData()->vbo; })
       .def("build_navmesh_vertex_indices",
            [](PathFinder& self) { return self.getNavMeshData()->ibo; })
+      .def_property_readonly("supports_obstacles",
+                             &PathFinder::supportsObstacles)
+      .def("set_obstacle", &PathFinder::setObstacle,
+           R"(Add or move an obstacle, a box rotated by y_rotation radians around +y which cuts the navmesh under it. Takes effect on update_obstacles.)",
+           "obstacle_id"_a, "center"_a, "half_extents"_a, "y_rotation"_a = 0.0f)
+      .def("remove_obstacle", &PathFinder::removeObstacle,
+           R"(Remove an obstacle. Takes effect on update_obstacles.)",
+           "obstacle_id"_a)
+      .def("get_obstacle_ids", &PathFinder::getObstacleIDs)
+      .def("update_obstacles", &PathFinder::updateObstacles,
+           R"(Rebuild the navmesh tiles changed obstacles overlap. Distance fields built before are invalid afterwards.)",
+           py::call_guard<py::gil_scoped_release>())
       .def("load_nav_mesh", &PathFinder::loadNavMesh)
       .def("save_nav_mesh", &PathFinder::saveNavMesh, "path"_a)
       .def("distance_to_closest_obstacle",
@@ -153,6 +271,9 @@ void initShortestPathBindings(py::module& m) {
            py::overload_cast<const core::RigidState&, const Mn::Vector3&>(
                &GreedyGeodesicFollowerImpl::findPath),
            py::return_value_policy::move)
+      .def("set_distance_field", &GreedyGeodesicFollowerImpl::setDistanceField,
+           R"(Use a distance field built for the goal instead of finding paths, or None to find paths again.)",
+           "distance_field"_a)
       .def("reset", &GreedyGeodesicFollowerImpl::reset);
 }
 
@@ -10,11 +10,14 @@
 
 #include <Magnum/PythonBindings.h>
 #include <Magnum/SceneGraph/PythonBindings.h>
+#include <pybind11/functional.h>
+#include <pybind11/numpy.h>
 
 #include "esp/gfx/RenderCamera.h"
 #include "esp/gfx/Renderer.h"
 #include "esp/gfx/replay/ReplayManager.h"
 #include "esp/scene/SemanticScene.h"
+#include "esp/sim/BatchReplayRenderer.h"
 #include "esp/sim/Simulator.h"
 #include "esp/sim/SimulatorConfiguration.h"
 
@@ -24,6 +27,26 @@ using py::literals::operator""_a;
 namespace esp {
 namespace sim {
 
+namespace {
+
+// bulk rigid states are exchanged with numpy as rows of
+// [qx, qy, qz, qw, tx, ty, tz], which is the memory layout of RigidState
+static_assert(sizeof(core::RigidState) == 7 * sizeof(float),
+              "RigidState is expected to be tightly packed");
+
+using IdArray = py::array_t<int, py::array::c_style | py::array::forcecast>;
+using FloatArray =
+    py::array_t<float, py::array::c_style | py::array::forcecast>;
+
+Corrade::Containers::ArrayView<const int> idsView(const IdArray& objectIds) {
+  if (objectIds.ndim() != 1) {
+    throw std::runtime_error("object_ids must be a 1D array");
+  }
+  return {objectIds.data(), std::size_t(objectIds.shape(0))};
+}
+
+}  // namespace
+
 void initSimBindings(py::module& m) {
   // ==== SimulatorConfiguration ====
   py::class_<SimulatorConfiguration, SimulatorConfiguration::ptr>(
@@ -162,6 +185,11 @@ void initSimBindings(py::module& m) {
           "object_lib_handle"_a, "attachment_node"_a = nullptr,
           "light_setup_key"_a = DEFAULT_LIGHTING_KEY, "scene_id"_a = 0,
           R"(Instance an object into the scene via a template referenced by its handle. Optionally attach the object to an existing SceneNode and assign its initial LightSetup key.)")
+      .def(
+          "swap_object_render_asset", &Simulator::swapObjectRenderAsset,
+          "object_id"_a, "object_lib_handle"_a,
+          "light_setup_key"_a = DEFAULT_LIGHTING_KEY, "scene_id"_a = 0,
+          R"(Replace the render asset of an object with the one of the template referenced by handle, keeping the object's id and physical body. Only the object's drawables are rebuilt.)")
       .def("remove_object", &Simulator::removeObject, "object_id"_a,
            "delete_object_node"_a = true, "delete_visual_node"_a = true,
            "scene_id"_a = 0, R"(
@@ -231,6 +259,75 @@ void initSimBindings(py::module& m) {
           "get_rigid_state", &Simulator::getRigidState, "object_id"_a,
           "scene_id"_a = 0,
           R"(Get an object's transformation as a RigidState (i.e. vector, quaternion).)")
+      .def(
+          "get_transformations",
+          [](const Simulator& self, const IdArray& objectIds, int sceneId) {
+            const auto ids = idsView(objectIds);
+            // column-major strides, so result[i] indexes as [row, col] while
+            // the simulator writes Matrix4s straight into the numpy buffer
+            py::array_t<float> result(
+                {py::ssize_t(ids.size()), py::ssize_t(4), py::ssize_t(4)},
+                {py::ssize_t(sizeof(Magnum::Matrix4)),
+                 py::ssize_t(sizeof(float)), py::ssize_t(4 * sizeof(float))});
+            self.getTransformations(
+                ids, {reinterpret_cast<Magnum::Matrix4*>(result.mutable_data()),
+                      ids.size()},
+                sceneId);
+            return result;
+          },
+          "object_ids"_a, "scene_id"_a = 0,
+          R"(Get the transformation matrices of many objects at once as an (N, 4, 4) numpy array.)")
+      .def(
+          "get_rigid_states",
+          [](const Simulator& self, const IdArray& objectIds, int sceneId) {
+            const auto ids = idsView(objectIds);
+            py::array_t<float> result(
+                {py::ssize_t(ids.size()), py::ssize_t(7)});
+            self.getRigidStates(
+                ids,
+                {reinterpret_cast<core::RigidState*>(result.mutable_data()),
+                 ids.size()},
+                sceneId);
+            return result;
+          },
+          "object_ids"_a, "scene_id"_a = 0,
+          R"(Get the RigidStates of many objects at once as an (N, 7) numpy array with rows [qx, qy, qz, qw, tx, ty, tz].)")
+      .def(
+          "set_rigid_states",
+          [](Simulator& self, const IdArray& objectIds,
+             const FloatArray& rigidStates, int sceneId) {
+            const auto ids = idsView(objectIds);
+            if (rigidStates.ndim() != 2 ||
+                std::size_t(rigidStates.shape(0)) != ids.size() ||
+                rigidStates.shape(1) != 7) {
+              throw std::runtime_error(
+                  "rigid_states must be an (N, 7) array matching object_ids");
+            }
+            self.setRigidStates(
+                ids,
+                {reinterpret_cast<const core::RigidState*>(rigidStates.data()),
+                 ids.size()},
+                sceneId);
+          },
+          "object_ids"_a, "rigid_states"_a, "scene_id"_a = 0,
+          R"(Set the RigidStates of many objects at once from an (N, 7) array with rows [qx, qy, qz, qw, tx, ty, tz] and update their simulation state.)")
+      .def(
+          "save_snapshot",
+          [](Simulator& self, int sceneId) {
+            std::vector<char> buffer;
+            self.saveSnapshot(buffer, sceneId);
+            return py::bytes(buffer.data(), buffer.size());
+          },
+          "scene_id"_a = 0,
+          R"(Save the physics state and the state of all registered snapshot participants to a bytes object.)")
+      .def(
+          "restore_snapshot",
+          [](Simulator& self, const py::bytes& snapshot, int sceneId) {
+            const std::string data = snapshot;
+            self.restoreSnapshot({data.begin(), data.end()}, sceneId);
+          },
+          "snapshot"_a, "scene_id"_a = 0,
+          R"(Restore a snapshot taken with save_snapshot. The world must hold the same objects as when the snapshot was taken.)")
       .def("set_translation", &Simulator::setTranslation, "translation"_a,
            "object_id"_a, "scene_id"_a = 0,
            R"(Set an object's translation and update its simulation state.)")
@@ -309,6 +406,10 @@ void initSimBindings(py::module& m) {
           "recompute_navmesh", &Simulator::recomputeNavMesh, "pathfinder"_a,
           "navmesh_settings"_a, "include_static_objects"_a = false,
           R"(Recompute the NavMesh for a given PathFinder instance using configured NavMeshSettings. Optionally include all MotionType::STATIC objects in the navigability constraints.)")
+      .def(
+          "update_navmesh_obstacles", &Simulator::updateNavMeshObstacles,
+          "pathfinder"_a,
+          R"(Make the bounding boxes of all MotionType::STATIC objects the obstacles of a PathFinder's navmesh, recomputed with a positive NavMeshSettings.tile_size, and rebuild only the tiles whose obstacles changed.)")
 #ifdef ESP_BUILD_WITH_VHACD
       .def(
           "apply_convex_hull_decomposition",
@@ -487,6 +588,70 @@ void initSimBindings(py::module& m) {
           "get_physics_step_collision_summary",
           &Simulator::getPhysicsStepCollisionSummary,
           R"(Get a summary of collision-processing from the last physics step.)");
+
+  // ==== BatchReplayRenderer ====
+  py::class_<BatchReplayView>(m, "BatchReplayView")
+      .def(py::init<>())
+      .def_readwrite("keyframe_index", &BatchReplayView::keyframeIndex)
+      .def_readwrite("translation", &BatchReplayView::translation)
+      .def_readwrite("rotation", &BatchReplayView::rotation)
+      .def_readwrite(
+          "user_transform_name", &BatchReplayView::userTransformName,
+          R"(If set, the camera pose is taken from this user transform of the keyframe instead of translation and rotation.)");
+
+  py::class_<BatchReplayJob>(m, "BatchReplayJob")
+      .def(py::init<>())
+      .def_readwrite("filepath", &BatchReplayJob::filepath)
+      .def_readwrite("views", &BatchReplayJob::views);
+
+  py::class_<BatchReplayRendererConfiguration,
+             BatchReplayRendererConfiguration::ptr>(
+      m, "BatchReplayRendererConfiguration")
+      .def(py::init(&BatchReplayRendererConfiguration::create<>))
+      .def_readwrite("gpu_device_id",
+                     &BatchReplayRendererConfiguration::gpuDeviceId)
+      .def_readwrite("resolution",
+                     &BatchReplayRendererConfiguration::resolution)
+      .def_readwrite("hfov", &BatchReplayRendererConfiguration::hfov)
+      .def_readwrite("znear", &BatchReplayRendererConfiguration::znear)
+      .def_readwrite("zfar", &BatchReplayRendererConfiguration::zfar)
+      .def_readwrite("requires_textures",
+                     &BatchReplayRendererConfiguration::requiresTextures)
+      .def_readwrite("frustum_culling",
+                     &BatchReplayRendererConfiguration::frustumCulling)
+      .def_readwrite("prefetch_keyframes_ahead",
+                     &BatchReplayRendererConfiguration::prefetchKeyframesAhead);
+
+  py::class_<BatchReplayRenderer, BatchReplayRenderer::ptr>(
+      m, "BatchReplayRenderer")
+      .def(py::init(&BatchReplayRenderer::create<
+                    const BatchReplayRendererConfiguration&>))
+      .def(
+          "render",
+          [](BatchReplayRenderer& self, const std::vector<BatchReplayJob>& jobs,
+             const std::function<void(int, int, py::array_t<uint8_t>)>&
+                 callback) {
+            self.render(jobs, [&](int jobIndex, int viewIndex,
+                                  const Magnum::ImageView2D& rgba) {
+              // the image is only valid during the call, so pass a copy
+              const auto size = rgba.size();
+              py::array_t<uint8_t> image(
+                  {py::ssize_t(size.y()), py::ssize_t(size.x()),
+                   py::ssize_t(4)});
+              std::copy(rgba.data().begin(), rgba.data().end(),
+                        reinterpret_cast<char*>(image.mutable_data()));
+              callback(jobIndex, viewIndex, std::move(image));
+            });
+          },
+          "jobs"_a, "callback"_a,
+          R"(Render all views of all jobs. callback(job_index, view_index, rgba) is called with each observation as an (H, W, 4) uint8 numpy array.)")
+      .def(
+          "get_prefetch_stats",
+          [](BatchReplayRenderer& self) {
+            const auto& stats = self.getPrefetchStats();
+            return py::dict("hits"_a = stats.hits, "misses"_a = stats.misses);
+          },
+          R"(Get how many render asset files of all rendered replays were or weren't read ahead by the time they were first needed.)");
 }
 
 }  // namespace sim
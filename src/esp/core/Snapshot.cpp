@@ -0,0 +1,83 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "Snapshot.h"
+#include "Check.h"
+
+#include <cstring>
+
+namespace esp {
+namespace core {
+
+void SnapshotWriter::writeBytes(const void* data, std::size_t size) {
+  if (size == 0) {
+    return;
+  }
+  const std::size_t offset = buffer_.size();
+  buffer_.resize(offset + size);
+  std::memcpy(buffer_.data() + offset, data, size);
+}
+
+void SnapshotWriter::writeString(const std::string& value) {
+  write(uint32_t(value.size()));
+  writeBytes(value.data(), value.size());
+}
+
+void SnapshotWriter::patchBytes(std::size_t offset,
+                                const void* data,
+                                std::size_t size) {
+  CORRADE_INTERNAL_ASSERT(offset + size <= buffer_.size());
+  std::memcpy(buffer_.data() + offset, data, size);
+}
+
+bool SnapshotReader::canRead(std::size_t size) {
+  if (failed_) {
+    return false;
+  }
+  if (size > getRemaining()) {
+    ESP_CHECK(!failOnError_, "SnapshotReader: snapshot is truncated, can't read"
+                                 << size << "bytes with" << getRemaining()
+                                 << "left");
+    setFailed();
+    return false;
+  }
+  return true;
+}
+
+void SnapshotReader::readBytes(void* data, std::size_t size) {
+  if (size == 0) {
+    return;
+  }
+  if (!canRead(size)) {
+    std::memset(data, 0, size);
+    return;
+  }
+  std::memcpy(data, data_ + offset_, size);
+  offset_ += size;
+}
+
+std::string SnapshotReader::readString() {
+  const uint32_t size = read<uint32_t>();
+  // checked before allocating, a malformed size can be huge
+  if (!canRead(size)) {
+    return {};
+  }
+  std::string value(size, '\0');
+  readBytes(&value[0], value.size());
+  return value;
+}
+
+SnapshotReader SnapshotReader::readSection(std::size_t size) {
+  if (!canRead(size)) {
+    SnapshotReader section{nullptr, 0, failOnError_};
+    section.setFailed();
+    return section;
+  }
+  SnapshotReader section{data_ + offset_, size, failOnError_};
+  offset_ += size;
+  return section;
+}
+
+}  // namespace core
+}  // namespace esp
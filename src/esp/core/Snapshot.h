@@ -0,0 +1,165 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#ifndef ESP_CORE_SNAPSHOT_H_
+#define ESP_CORE_SNAPSHOT_H_
+
+/** @file
+ * @brief Class @ref esp::core::SnapshotWriter, @ref esp::core::SnapshotReader
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace esp {
+namespace core {
+
+/**
+ * @brief Appends plain values to a flat binary snapshot buffer.
+ *
+ * Values are stored as raw bytes in host byte order, so snapshots are meant
+ * to be restored in the same build they were taken with, e.g. to branch an
+ * episode.
+ */
+class SnapshotWriter {
+ public:
+  /**
+   * @brief Constructor. Values are appended to @p buffer, which keeps its
+   * capacity so repeated snapshots into the same buffer don't allocate.
+   */
+  explicit SnapshotWriter(std::vector<char>& buffer) : buffer_(buffer) {}
+
+  void writeBytes(const void* data, std::size_t size);
+
+  template <typename T>
+  void write(const T& value) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "only trivially copyable types can be written directly");
+    writeBytes(&value, sizeof(T));
+  }
+
+  //! Write the size of @p values, followed by the values
+  template <typename T>
+  void writeVector(const std::vector<T>& values) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "only trivially copyable types can be written directly");
+    write(uint32_t(values.size()));
+    writeBytes(values.data(), values.size() * sizeof(T));
+  }
+
+  void writeString(const std::string& value);
+
+  /**
+   * @brief Reserve space for a value to be filled in later with
+   * @ref patch, e.g. the size of a section. Returns its offset.
+   */
+  template <typename T>
+  std::size_t reserve() {
+    const std::size_t offset = buffer_.size();
+    buffer_.resize(offset + sizeof(T));
+    return offset;
+  }
+
+  template <typename T>
+  void patch(std::size_t offset, const T& value) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "only trivially copyable types can be written directly");
+    patchBytes(offset, &value, sizeof(T));
+  }
+
+  //! Current size of the buffer in bytes
+  std::size_t getSize() const { return buffer_.size(); }
+
+ private:
+  void patchBytes(std::size_t offset, const void* data, std::size_t size);
+
+  std::vector<char>& buffer_;
+};
+
+/**
+ * @brief Reads values written by a @ref SnapshotWriter, in the same order.
+ * Fails if reading past the end of the data.
+ */
+class SnapshotReader {
+ public:
+  /**
+   * @brief Constructor. @p data must stay valid while reading.
+   *
+   * Reading past the end of the data is a fatal error, unless @p failOnError
+   * is false, e.g. for a file which may be corrupt. The reader is then marked
+   * as failed instead, see @ref hasFailed, and reads return zeros and empty
+   * strings from then on.
+   */
+  SnapshotReader(const char* data, std::size_t size, bool failOnError = true)
+      : data_(data), size_(size), failOnError_(failOnError) {}
+
+  void readBytes(void* data, std::size_t size);
+
+  template <typename T>
+  T read() {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "only trivially copyable types can be read directly");
+    T value;
+    readBytes(&value, sizeof(T));
+    return value;
+  }
+
+  template <typename T>
+  void readVector(std::vector<T>& values) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "only trivially copyable types can be read directly");
+    const uint32_t count = read<uint32_t>();
+    // checked before allocating, a malformed count can be huge
+    if (!canRead(count * sizeof(T))) {
+      values.clear();
+      return;
+    }
+    values.resize(count);
+    readBytes(values.data(), values.size() * sizeof(T));
+  }
+
+  std::string readString();
+
+  /**
+   * @brief Get a reader for the next @p size bytes and skip past them.
+   */
+  SnapshotReader readSection(std::size_t size);
+
+  std::size_t getRemaining() const { return size_ - offset_; }
+
+  //! Whether errors are fatal, see @ref SnapshotReader()
+  bool failsOnError() const { return failOnError_; }
+
+  /**
+   * @brief Whether a read went past the end of the data or @ref setFailed
+   * was called. Only possible if errors aren't fatal.
+   */
+  bool hasFailed() const { return failed_; }
+
+  /**
+   * @brief Mark the data as malformed, e.g. because a value read from it is
+   * out of range. Nothing is left to read afterwards.
+   */
+  void setFailed() {
+    failed_ = true;
+    offset_ = size_;
+  }
+
+ private:
+  bool canRead(std::size_t size);
+
+  const char* data_;
+  std::size_t size_;
+  std::size_t offset_ = 0;
+  bool failOnError_;
+  bool failed_ = false;
+};
+
+}  // namespace core
+}  // namespace esp
+
+#endif  // ESP_CORE_SNAPSHOT_H_
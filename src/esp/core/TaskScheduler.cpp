@@ -0,0 +1,164 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "TaskScheduler.h"
+
+#include <algorithm>
+
+namespace esp {
+namespace core {
+
+namespace {
+// identifies the scheduler (if any) that owns the current thread
+thread_local const TaskScheduler* tlsScheduler = nullptr;
+thread_local std::size_t tlsQueueIndex = 0;
+}  // namespace
+
+TaskScheduler::TaskScheduler(int numWorkers) {
+  if (numWorkers < 0) {
+    numWorkers =
+        std::max(0, static_cast<int>(std::thread::hardware_concurrency()) - 1);
+  }
+  for (int i = 0; i <= numWorkers; ++i) {
+    queues_.emplace_back(std::make_unique<Queue>());
+  }
+  workers_.reserve(numWorkers);
+  for (int i = 0; i < numWorkers; ++i) {
+    workers_.emplace_back(&TaskScheduler::workerLoop, this, std::size_t(i));
+  }
+}
+
+TaskScheduler::~TaskScheduler() {
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex_);
+    shutdown_ = true;
+  }
+  sleepCondition_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+std::size_t TaskScheduler::currentQueueIndex() const {
+  return tlsScheduler == this ? tlsQueueIndex : workers_.size();
+}
+
+void TaskScheduler::submit(TaskGroup& group, std::function<void()> task) {
+  group.pending_.fetch_add(1, std::memory_order_relaxed);
+  {
+    Queue& queue = *queues_[currentQueueIndex()];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.push_back({std::move(task), &group});
+  }
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex_);
+    numQueued_.fetch_add(1, std::memory_order_relaxed);
+  }
+  sleepCondition_.notify_one();
+  doneCondition_.notify_one();
+}
+
+bool TaskScheduler::tryPop(std::size_t queueIndex, Task& task) {
+  Queue& queue = *queues_[queueIndex];
+  std::lock_guard<std::mutex> lock(queue.mutex);
+  if (queue.tasks.empty()) {
+    return false;
+  }
+  // newest first: best cache locality for the owner
+  task = std::move(queue.tasks.back());
+  queue.tasks.pop_back();
+  return true;
+}
+
+bool TaskScheduler::trySteal(std::size_t thiefIndex, Task& task) {
+  const std::size_t numQueues = queues_.size();
+  for (std::size_t offset = 1; offset < numQueues; ++offset) {
+    Queue& queue = *queues_[(thiefIndex + offset) % numQueues];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (!queue.tasks.empty()) {
+      // oldest first: typically the largest remaining chunk of work
+      task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+bool TaskScheduler::tryRunOne(std::size_t queueIndex) {
+  Task task;
+  if (!tryPop(queueIndex, task) && !trySteal(queueIndex, task)) {
+    return false;
+  }
+  numQueued_.fetch_sub(1, std::memory_order_relaxed);
+  task.fn();
+  if (task.group->pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    // the group may be destroyed as soon as its waiter sees it done, so only
+    // scheduler state is touched from here on
+    std::lock_guard<std::mutex> lock(sleepMutex_);
+    doneCondition_.notify_all();
+  }
+  return true;
+}
+
+void TaskScheduler::wait(TaskGroup& group) {
+  const std::size_t queueIndex = currentQueueIndex();
+  while (!group.isDone()) {
+    if (tryRunOne(queueIndex)) {
+      continue;
+    }
+    // remaining tasks of the group are running on other threads
+    std::unique_lock<std::mutex> lock(sleepMutex_);
+    doneCondition_.wait(lock, [this, &group]() {
+      return group.isDone() || numQueued_.load(std::memory_order_relaxed) > 0;
+    });
+  }
+}
+
+void TaskScheduler::parallelFor(
+    std::size_t count,
+    const std::function<void(std::size_t, std::size_t)>& fn,
+    std::size_t grainSize) {
+  if (count == 0) {
+    return;
+  }
+  grainSize = std::max<std::size_t>(grainSize, 1);
+  // a few chunks per thread so stealing can even out uneven work
+  const std::size_t targetChunks = std::size_t(getNumThreads()) * 4;
+  const std::size_t chunkSize =
+      std::max(grainSize, (count + targetChunks - 1) / targetChunks);
+  if (chunkSize >= count) {
+    fn(0, count);
+    return;
+  }
+
+  TaskGroup group;
+  for (std::size_t begin = chunkSize; begin < count; begin += chunkSize) {
+    const std::size_t end = std::min(count, begin + chunkSize);
+    submit(group, [&fn, begin, end]() { fn(begin, end); });
+  }
+  // run the first chunk here rather than waiting idle
+  fn(0, chunkSize);
+  wait(group);
+}
+
+void TaskScheduler::workerLoop(std::size_t queueIndex) {
+  tlsScheduler = this;
+  tlsQueueIndex = queueIndex;
+  for (;;) {
+    if (tryRunOne(queueIndex)) {
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(sleepMutex_);
+    sleepCondition_.wait(lock, [this]() {
+      return shutdown_ || numQueued_.load(std::memory_order_relaxed) > 0;
+    });
+    if (shutdown_) {
+      return;
+    }
+  }
+}
+
+}  // namespace core
+}  // namespace esp
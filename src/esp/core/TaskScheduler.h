@@ -0,0 +1,137 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#ifndef ESP_CORE_TASKSCHEDULER_H_
+#define ESP_CORE_TASKSCHEDULER_H_
+
+/** @file
+ * @brief Class @ref esp::core::TaskScheduler
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "esp/core/esp.h"
+
+namespace esp {
+namespace core {
+
+/**
+ * @brief Small work-stealing thread pool.
+ *
+ * Each worker owns a task deque; it pops its own tasks LIFO and steals from
+ * the front of other workers' deques when it runs dry. Threads that wait on a
+ * @ref TaskGroup help execute queued tasks and only block once nothing is left
+ * to run, so tasks may themselves submit and wait on nested groups (e.g. a
+ * per-system task that calls @ref parallelFor over its entities).
+ *
+ * With zero workers, all tasks run on the thread that calls @ref wait, which
+ * is useful for deterministic debugging.
+ */
+class TaskScheduler {
+ public:
+  /**
+   * @brief Tracks completion of a set of submitted tasks. Must outlive the
+   * tasks submitted to it.
+   */
+  class TaskGroup {
+   public:
+    TaskGroup() = default;
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    bool isDone() const {
+      return pending_.load(std::memory_order_acquire) == 0;
+    }
+
+   private:
+    std::atomic<int> pending_{0};
+    friend class TaskScheduler;
+  };
+
+  /**
+   * @brief Constructor.
+   * @param numWorkers Number of worker threads to spawn, in addition to the
+   * threads calling @ref wait. A negative value picks one less than the
+   * hardware concurrency.
+   */
+  explicit TaskScheduler(int numWorkers = -1);
+
+  ~TaskScheduler();
+
+  TaskScheduler(const TaskScheduler&) = delete;
+  TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+  /**
+   * @brief Number of threads that execute tasks, counting the waiting thread.
+   */
+  int getNumThreads() const { return static_cast<int>(workers_.size()) + 1; }
+
+  /**
+   * @brief Queue @p task as part of @p group. Returns immediately.
+   */
+  void submit(TaskGroup& group, std::function<void()> task);
+
+  /**
+   * @brief Execute queued tasks until all tasks of @p group have finished.
+   */
+  void wait(TaskGroup& group);
+
+  /**
+   * @brief Run @p fn over [0, count) split into chunks of at least
+   * @p grainSize indices, and wait for completion.
+   * @param count Number of indices.
+   * @param fn Called as fn(begin, end) for each chunk.
+   * @param grainSize Minimum chunk size; use larger values for cheap bodies.
+   */
+  void parallelFor(std::size_t count,
+                   const std::function<void(std::size_t, std::size_t)>& fn,
+                   std::size_t grainSize = 1);
+
+ private:
+  struct Task {
+    std::function<void()> fn;
+    TaskGroup* group = nullptr;
+  };
+
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  // queue owned by the calling thread: its worker queue, or the shared
+  // external queue for threads that don't belong to this scheduler
+  std::size_t currentQueueIndex() const;
+
+  bool tryPop(std::size_t queueIndex, Task& task);
+  bool trySteal(std::size_t thiefIndex, Task& task);
+  bool tryRunOne(std::size_t queueIndex);
+  void workerLoop(std::size_t queueIndex);
+
+  // workers_.size() + 1 queues; the last one is the external queue
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> workers_;
+
+  std::mutex sleepMutex_;
+  // idle workers sleep here until a task is queued
+  std::condition_variable sleepCondition_;
+  // waiters sleep here until a group finishes or a task is queued
+  std::condition_variable doneCondition_;
+  std::atomic<int> numQueued_{0};
+  bool shutdown_ = false;
+
+  ESP_SMART_POINTERS(TaskScheduler)
+};
+
+}  // namespace core
+}  // namespace esp
+
+#endif  // ESP_CORE_TASKSCHEDULER_H_
@@ -0,0 +1,830 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "BinaryFormat.h"
+
+#include "esp/core/Check.h"
+
+#include <Corrade/Utility/String.h>
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <utility>
+
+namespace Mn = Magnum;
+
+/* A check of decoded data. Malformed data is a fatal error if the reader
+   fails on errors, see core::SnapshotReader. Otherwise the error is logged,
+   the reader is marked as failed and returnValue returned, and the caller
+   checks core::SnapshotReader::hasFailed() at the end. */
+#define DECODER_CHECK(reader, condition, message, returnValue)   \
+  do {                                                            \
+    if (!(condition)) {                                           \
+      ESP_CHECK(!(reader).failsOnError(), message);               \
+      std::ostringstream out;                                     \
+      Corrade::Utility::Debug{                                    \
+          &out, Corrade::Utility::Debug::Flag::NoNewlineAtTheEnd} \
+          << message;                                             \
+      LOG(ERROR) << out.str();                                    \
+      (reader).setFailed();                                       \
+      return returnValue;                                         \
+    }                                                             \
+  } while (false)
+
+namespace esp {
+namespace gfx {
+namespace replay {
+
+namespace {
+
+// which fields of an instance state changed since its previous state update
+enum StateUpdateField : uint8_t {
+  TranslationField = 1 << 0,
+  RotationField = 1 << 1,
+  SemanticIdField = 1 << 2,
+};
+
+constexpr std::size_t FileHeaderSize = 2 * sizeof(uint32_t) + sizeof(float);
+// type, codec, keyframe count, payload size
+constexpr std::size_t ChunkHeaderSize =
+    sizeof(ChunkType) + sizeof(ChunkCodec) + 2 * sizeof(uint32_t);
+// offset of the payload size in the chunk header
+constexpr std::size_t ChunkSizeOffset =
+    sizeof(ChunkType) + sizeof(ChunkCodec) + sizeof(uint32_t);
+// offset of the index chunk, then the index magic
+constexpr std::size_t IndexTrailerSize = sizeof(uint64_t) + sizeof(uint32_t);
+
+// the three smallest quaternion components are in [-1/sqrt(2), 1/sqrt(2)]
+constexpr float RotationScale = 32767.0f * 1.41421356f;
+
+void writeVarUint(core::SnapshotWriter& writer, uint64_t value) {
+  while (value >= 0x80) {
+    writer.write(uint8_t(value | 0x80));
+    value >>= 7;
+  }
+  writer.write(uint8_t(value));
+}
+
+uint64_t readVarUint(core::SnapshotReader& reader) {
+  uint64_t value = 0;
+  for (int shift = 0;; shift += 7) {
+    DECODER_CHECK(reader, shift < 64,
+                  "KeyframeDecoder: malformed variable-length integer", 0);
+    const uint8_t byte = reader.read<uint8_t>();
+    value |= uint64_t(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return value;
+    }
+  }
+}
+
+void writeVarInt(core::SnapshotWriter& writer, int64_t value) {
+  // zigzag encoding, so small negative values stay small
+  writeVarUint(writer, (uint64_t(value) << 1) ^ uint64_t(value >> 63));
+}
+
+// A count of elements which take at least a byte each, so malformed data
+// can't make the decoder allocate huge arrays
+uint64_t readCount(core::SnapshotReader& reader) {
+  const uint64_t count = readVarUint(reader);
+  DECODER_CHECK(reader, count <= reader.getRemaining(),
+                "KeyframeDecoder: element count" << count
+                                                  << "is out of range",
+                0);
+  return count;
+}
+
+int64_t readVarInt(core::SnapshotReader& reader) {
+  const uint64_t value = readVarUint(reader);
+  return int64_t(value >> 1) ^ -int64_t(value & 1);
+}
+
+int32_t quantize(float value, float step) {
+  return int32_t(std::lround(value / step));
+}
+
+/*
+ * Pack a rotation as the index of its largest component followed by the
+ * other three components, quantized to 16 bits each. The largest component
+ * is made positive, which doesn't change the rotation, and is recovered from
+ * the unit length on decoding.
+ */
+uint64_t packRotation(const Mn::Quaternion& rotation) {
+  const Mn::Quaternion normalized = rotation.normalized();
+  const float components[4] = {normalized.vector().x(),
+                               normalized.vector().y(),
+                               normalized.vector().z(), normalized.scalar()};
+  int largest = 0;
+  for (int i = 1; i < 4; ++i) {
+    if (std::abs(components[i]) > std::abs(components[largest])) {
+      largest = i;
+    }
+  }
+  const float sign = components[largest] < 0.0f ? -1.0f : 1.0f;
+  uint64_t packed = uint64_t(largest);
+  int shift = 8;
+  for (int i = 0; i < 4; ++i) {
+    if (i == largest) {
+      continue;
+    }
+    const float value = std::max(
+        -32767.0f, std::min(32767.0f, sign * components[i] * RotationScale));
+    packed |= uint64_t(uint16_t(int16_t(std::lround(value)))) << shift;
+    shift += 16;
+  }
+  return packed;
+}
+
+void writeRotation(core::SnapshotWriter& writer, uint64_t packed) {
+  writer.write(uint8_t(packed & 0xff));
+  for (int i = 0; i < 3; ++i) {
+    writer.write(int16_t(uint16_t(packed >> (8 + 16 * i))));
+  }
+}
+
+Mn::Quaternion readRotation(core::SnapshotReader& reader) {
+  const uint8_t largest = reader.read<uint8_t>();
+  DECODER_CHECK(reader, largest < 4, "KeyframeDecoder: malformed rotation",
+                Mn::Quaternion{});
+  float components[4];
+  float sumOfSquares = 0.0f;
+  for (int i = 0; i < 4; ++i) {
+    if (i == largest) {
+      continue;
+    }
+    components[i] = reader.read<int16_t>() / RotationScale;
+    sumOfSquares += components[i] * components[i];
+  }
+  components[largest] = std::sqrt(std::max(0.0f, 1.0f - sumOfSquares));
+  return Mn::Quaternion{{components[0], components[1], components[2]},
+                        components[3]}
+      .normalized();
+}
+
+void writeVector3(core::SnapshotWriter& writer, const Mn::Vector3& value) {
+  writer.write(value.x());
+  writer.write(value.y());
+  writer.write(value.z());
+}
+
+Mn::Vector3 readVector3(core::SnapshotReader& reader) {
+  const float x = reader.read<float>();
+  const float y = reader.read<float>();
+  const float z = reader.read<float>();
+  return {x, y, z};
+}
+
+void writeVec3f(core::SnapshotWriter& writer, const esp::vec3f& value) {
+  writer.write(value.x());
+  writer.write(value.y());
+  writer.write(value.z());
+}
+
+esp::vec3f readVec3f(core::SnapshotReader& reader) {
+  esp::vec3f value;
+  value.x() = reader.read<float>();
+  value.y() = reader.read<float>();
+  value.z() = reader.read<float>();
+  return value;
+}
+
+void writeAssetInfo(core::SnapshotWriter& writer,
+                    const esp::assets::AssetInfo& info) {
+  writer.write(uint8_t(info.type));
+  writer.writeString(info.filepath);
+  writeVec3f(writer, info.frame.up());
+  writeVec3f(writer, info.frame.front());
+  writeVec3f(writer, info.frame.origin());
+  writer.write(info.virtualUnitToMeters);
+  writer.write(uint8_t(info.requiresLighting));
+  writer.write(uint8_t(info.splitInstanceMesh));
+}
+
+esp::assets::AssetInfo readAssetInfo(core::SnapshotReader& reader) {
+  esp::assets::AssetInfo info;
+  info.type = esp::assets::AssetType(reader.read<uint8_t>());
+  info.filepath = reader.readString();
+  const esp::vec3f up = readVec3f(reader);
+  const esp::vec3f front = readVec3f(reader);
+  const esp::vec3f origin = readVec3f(reader);
+  info.frame = esp::geo::CoordinateFrame(up, front, origin);
+  info.virtualUnitToMeters = reader.read<float>();
+  info.requiresLighting = reader.read<uint8_t>();
+  info.splitInstanceMesh = reader.read<uint8_t>();
+  return info;
+}
+
+std::string serializeCreation(
+    const esp::assets::RenderAssetInstanceCreationInfo& creation) {
+  std::vector<char> buffer;
+  core::SnapshotWriter writer{buffer};
+  writer.writeString(creation.filepath);
+  writer.write(uint8_t(bool(creation.scale)));
+  if (creation.scale) {
+    writeVector3(writer, *creation.scale);
+  }
+  writeVarUint(writer, static_cast<unsigned int>(creation.flags));
+  writer.writeString(creation.lightSetupKey);
+  return std::string(buffer.data(), buffer.size());
+}
+
+}  // namespace
+
+bool isBinaryReplay(const char* data, std::size_t size) {
+  if (size < sizeof(BinaryReplayMagic)) {
+    return false;
+  }
+  return core::SnapshotReader{data, size}.read<uint32_t>() ==
+         BinaryReplayMagic;
+}
+
+bool isBinaryReplayFilepath(const std::string& filepath) {
+  return Corrade::Utility::String::endsWith(filepath, ".bin");
+}
+
+KeyframeEncoder::KeyframeEncoder(float translationStep)
+    : translationStep_(translationStep) {
+  CORRADE_ASSERT(translationStep_ > 0.0f,
+                 "KeyframeEncoder: translation step must be positive", );
+}
+
+void KeyframeEncoder::writeHeader(std::vector<char>& buffer) {
+  core::SnapshotWriter writer{buffer};
+  writer.write(BinaryReplayMagic);
+  writer.write(BinaryReplayVersion);
+  writer.write(translationStep_);
+  fileOffset_ += FileHeaderSize;
+}
+
+std::size_t KeyframeEncoder::beginChunk(core::SnapshotWriter& writer,
+                                        ChunkType type,
+                                        uint32_t keyframeIndex,
+                                        uint32_t numKeyframes) {
+  if (type != ChunkType::Index) {
+    index_.push_back(
+        ChunkIndexEntry{type, keyframeIndex, numKeyframes, fileOffset_});
+  }
+  writer.write(type);
+  writer.write(ChunkCodec::None);
+  writer.write(numKeyframes);
+  return writer.reserve<uint32_t>();
+}
+
+void KeyframeEncoder::endChunk(core::SnapshotWriter& writer,
+                               std::size_t sizeOffset) {
+  const std::size_t payloadBegin = sizeOffset + sizeof(uint32_t);
+  writer.patch(sizeOffset, uint32_t(writer.getSize() - payloadBegin));
+  fileOffset_ += writer.getSize() - (sizeOffset - ChunkSizeOffset);
+}
+
+void KeyframeEncoder::writeChunk(const Keyframe* keyframes,
+                                 std::size_t count,
+                                 std::vector<char>& buffer) {
+  core::SnapshotWriter writer{buffer};
+  const std::size_t sizeOffset =
+      beginChunk(writer, ChunkType::Keyframes, numKeyframes_, uint32_t(count));
+  for (std::size_t i = 0; i < count; ++i) {
+    writeKeyframe(writer, keyframes[i]);
+  }
+  endChunk(writer, sizeOffset);
+  numKeyframes_ += count;
+}
+
+void KeyframeEncoder::writeCheckpoint(const Checkpoint& checkpoint,
+                                      std::vector<char>& buffer) {
+  CORRADE_ASSERT(checkpoint.keyframeIndex == numKeyframes_ - 1,
+                 "KeyframeEncoder::writeCheckpoint: checkpoint of keyframe"
+                     << checkpoint.keyframeIndex << "must follow it", );
+  // the checkpoint doesn't depend on earlier chunks, and later chunks only
+  // depend on the checkpoint
+  creationTable_.clear();
+  instanceStates_.clear();
+
+  core::SnapshotWriter writer{buffer};
+  const std::size_t sizeOffset =
+      beginChunk(writer, ChunkType::Checkpoint, checkpoint.keyframeIndex, 0);
+  writer.write(uint32_t(checkpoint.keyframeIndex));
+  writeKeyframe(writer, checkpoint.state);
+  endChunk(writer, sizeOffset);
+}
+
+void KeyframeEncoder::writeKeyframes(const Keyframe* keyframes,
+                                     std::size_t count,
+                                     const Checkpoint* checkpoints,
+                                     std::size_t numCheckpoints,
+                                     int keyframesPerChunk,
+                                     std::vector<char>& buffer) {
+  CORRADE_ASSERT(keyframesPerChunk > 0,
+                 "KeyframeEncoder::writeKeyframes: keyframesPerChunk must be "
+                 "positive", );
+  const int firstKeyframeIndex = numKeyframes_;
+  std::size_t nextCheckpoint = 0;
+  std::size_t begin = 0;
+  while (begin < count) {
+    std::size_t end = std::min(count, begin + keyframesPerChunk);
+    std::size_t checkpointEnd = 0;
+    if (nextCheckpoint < numCheckpoints) {
+      checkpointEnd =
+          checkpoints[nextCheckpoint].keyframeIndex - firstKeyframeIndex + 1;
+      CORRADE_ASSERT(checkpointEnd > begin && checkpointEnd <= count,
+                     "KeyframeEncoder::writeKeyframes: checkpoints must be "
+                     "sorted and belong to the written keyframes", );
+      end = std::min(end, checkpointEnd);
+    }
+    writeChunk(keyframes + begin, end - begin, buffer);
+    if (end == checkpointEnd) {
+      writeCheckpoint(checkpoints[nextCheckpoint++], buffer);
+    }
+    begin = end;
+  }
+  CORRADE_ASSERT(nextCheckpoint == numCheckpoints,
+                 "KeyframeEncoder::writeKeyframes: checkpoints must belong to "
+                 "the written keyframes", );
+}
+
+void KeyframeEncoder::writeIndex(std::vector<char>& buffer) {
+  const uint64_t indexOffset = fileOffset_;
+  core::SnapshotWriter writer{buffer};
+  const std::size_t sizeOffset =
+      beginChunk(writer, ChunkType::Index, 0, numKeyframes_);
+  writer.write(uint32_t(index_.size()));
+  for (const auto& entry : index_) {
+    writer.write(entry.type);
+    writer.write(entry.keyframeIndex);
+    writer.write(entry.numKeyframes);
+    writer.write(entry.offset);
+  }
+  writer.write(indexOffset);
+  writer.write(BinaryReplayIndexMagic);
+  endChunk(writer, sizeOffset);
+}
+
+void KeyframeEncoder::writeCreation(
+    core::SnapshotWriter& writer,
+    const esp::assets::RenderAssetInstanceCreationInfo& creation) {
+  std::string serialized = serializeCreation(creation);
+  auto it = creationTable_.find(serialized);
+  if (it != creationTable_.end()) {
+    writeVarUint(writer, it->second);
+    return;
+  }
+  // a new table entry, stored inline where it is first used
+  const uint32_t index = creationTable_.size();
+  writeVarUint(writer, index);
+  writer.writeBytes(serialized.data(), serialized.size());
+  creationTable_.emplace(std::move(serialized), index);
+}
+
+void KeyframeEncoder::writeKeyframe(core::SnapshotWriter& writer,
+                                    const Keyframe& keyframe) {
+  writeVarUint(writer, keyframe.loads.size());
+  for (const auto& info : keyframe.loads) {
+    writeAssetInfo(writer, info);
+  }
+
+  writeVarUint(writer, keyframe.creations.size());
+  for (const auto& pair : keyframe.creations) {
+    writeVarInt(writer, pair.first);
+    writeCreation(writer, pair.second);
+  }
+
+  writeVarUint(writer, keyframe.renderAssetChanges.size());
+  for (const auto& pair : keyframe.renderAssetChanges) {
+    writeVarInt(writer, pair.first);
+    writeCreation(writer, pair.second);
+  }
+
+  writeVarUint(writer, keyframe.deletions.size());
+  for (const auto instanceKey : keyframe.deletions) {
+    writeVarInt(writer, instanceKey);
+    instanceStates_.erase(instanceKey);
+  }
+
+  // keys of consecutive updates are usually close, so store their deltas
+  writeVarUint(writer, keyframe.stateUpdates.size());
+  RenderAssetInstanceKey prevKey = 0;
+  for (const auto& pair : keyframe.stateUpdates) {
+    writeVarInt(writer, int64_t(pair.first) - prevKey);
+    prevKey = pair.first;
+
+    const Transform& transform = pair.second.absTransform;
+    InstanceState& prev = instanceStates_[pair.first];
+    InstanceState curr;
+    for (int i = 0; i < 3; ++i) {
+      curr.translation[i] =
+          quantize(transform.translation[i], translationStep_);
+    }
+    curr.rotation = packRotation(transform.rotation);
+    curr.semanticId = pair.second.semanticId;
+
+    uint8_t fields = 0;
+    if (!std::equal(curr.translation, curr.translation + 3, prev.translation)) {
+      fields |= TranslationField;
+    }
+    if (curr.rotation != prev.rotation) {
+      fields |= RotationField;
+    }
+    if (curr.semanticId != prev.semanticId) {
+      fields |= SemanticIdField;
+    }
+    writer.write(fields);
+    if (fields & TranslationField) {
+      for (int i = 0; i < 3; ++i) {
+        writeVarInt(writer,
+                    int64_t(curr.translation[i]) - prev.translation[i]);
+      }
+    }
+    if (fields & RotationField) {
+      writeRotation(writer, curr.rotation);
+    }
+    if (fields & SemanticIdField) {
+      writeVarInt(writer, curr.semanticId);
+    }
+    prev = curr;
+  }
+
+  writeVarUint(writer, keyframe.userTransforms.size());
+  for (const auto& pair : keyframe.userTransforms) {
+    writer.writeString(pair.first);
+    writeVector3(writer, pair.second.translation);
+    writeVector3(writer, pair.second.rotation.vector());
+    writer.write(pair.second.rotation.scalar());
+  }
+}
+
+void KeyframeDecoder::readHeader(core::SnapshotReader& reader) {
+  DECODER_CHECK(reader, reader.read<uint32_t>() == BinaryReplayMagic,
+                "KeyframeDecoder::readHeader(): not a binary replay", );
+  const uint32_t version = reader.read<uint32_t>();
+  DECODER_CHECK(
+      reader, version == BinaryReplayVersion,
+      "KeyframeDecoder::readHeader(): unsupported version" << version, );
+  translationStep_ = reader.read<float>();
+  DECODER_CHECK(reader, translationStep_ > 0.0f,
+                "KeyframeDecoder::readHeader(): invalid translation step"
+                    << translationStep_, );
+}
+
+void KeyframeDecoder::readChunk(core::SnapshotReader& reader,
+                                std::vector<Keyframe>& keyframes,
+                                std::vector<Checkpoint>* checkpoints) {
+  ChunkView chunk = readChunkHeader(reader);
+  switch (chunk.type) {
+    case ChunkType::Keyframes:
+      keyframes.reserve(keyframes.size() + chunk.numKeyframes);
+      for (uint32_t i = 0; i < chunk.numKeyframes; ++i) {
+        keyframes.emplace_back();
+        readKeyframe(chunk.payload, keyframes.back());
+      }
+      break;
+    case ChunkType::Checkpoint: {
+      Checkpoint checkpoint;
+      readCheckpoint(chunk.payload, checkpoint);
+      if (checkpoints) {
+        checkpoints->push_back(std::move(checkpoint));
+      }
+      break;
+    }
+    case ChunkType::Index:
+      return;
+  }
+  if (chunk.payload.hasFailed()) {
+    reader.setFailed();
+    return;
+  }
+  DECODER_CHECK(reader, chunk.payload.getRemaining() == 0,
+                "KeyframeDecoder::readChunk(): chunk has"
+                    << chunk.payload.getRemaining() << "unread bytes", );
+}
+
+KeyframeDecoder::ChunkView KeyframeDecoder::readChunkHeader(
+    core::SnapshotReader& reader) {
+  // what a malformed chunk is read as, nothing is decoded from an index
+  const ChunkView invalid{ChunkType::Index, 0, {nullptr, 0}};
+  const ChunkType type = reader.read<ChunkType>();
+  DECODER_CHECK(reader,
+                type == ChunkType::Keyframes ||
+                    type == ChunkType::Checkpoint || type == ChunkType::Index,
+                "KeyframeDecoder::readChunkHeader(): unknown chunk type"
+                    << int(type),
+                invalid);
+  const ChunkCodec codec = reader.read<ChunkCodec>();
+  DECODER_CHECK(reader, codec == ChunkCodec::None,
+                "KeyframeDecoder::readChunkHeader(): unsupported chunk codec"
+                    << int(codec),
+                invalid);
+  const uint32_t numKeyframes = reader.read<uint32_t>();
+  const uint32_t size = reader.read<uint32_t>();
+  ChunkView chunk{type, numKeyframes, reader.readSection(size)};
+  // keyframes take at least a byte each, checked before reserving them. The
+  // index holds the keyframe count of the whole file instead.
+  DECODER_CHECK(reader,
+                type != ChunkType::Keyframes ||
+                    numKeyframes <= chunk.payload.getRemaining(),
+                "KeyframeDecoder::readChunkHeader():" << numKeyframes
+                    << "keyframes don't fit a chunk of" << size << "bytes",
+                invalid);
+  return chunk;
+}
+
+void KeyframeDecoder::readCheckpoint(core::SnapshotReader& reader,
+                                     Checkpoint& checkpoint) {
+  // see KeyframeEncoder::writeCheckpoint
+  creationTable_.clear();
+  instanceStates_.clear();
+  checkpoint.keyframeIndex = reader.read<uint32_t>();
+  readKeyframe(reader, checkpoint.state);
+}
+
+bool KeyframeDecoder::hasCompleteChunk(const core::SnapshotReader& reader) {
+  if (reader.getRemaining() < ChunkHeaderSize) {
+    return false;
+  }
+  core::SnapshotReader peek = reader;
+  peek.readSection(ChunkSizeOffset);
+  return peek.read<uint32_t>() <= peek.getRemaining();
+}
+
+bool KeyframeDecoder::readIndex(const char* data,
+                                std::size_t size,
+                                std::vector<ChunkIndexEntry>& index) {
+  if (size < FileHeaderSize + ChunkHeaderSize + IndexTrailerSize) {
+    return false;
+  }
+  core::SnapshotReader trailer{data + size - IndexTrailerSize,
+                               IndexTrailerSize};
+  const uint64_t indexOffset = trailer.read<uint64_t>();
+  if (trailer.read<uint32_t>() != BinaryReplayIndexMagic) {
+    return false;
+  }
+  ESP_CHECK(indexOffset >= FileHeaderSize &&
+                indexOffset + ChunkHeaderSize + IndexTrailerSize <= size,
+            "KeyframeDecoder::readIndex(): index offset" << indexOffset
+                                                         << "is out of range");
+  core::SnapshotReader reader{data + indexOffset, size - indexOffset};
+  ESP_CHECK(reader.read<ChunkType>() == ChunkType::Index,
+            "KeyframeDecoder::readIndex(): no index chunk at offset"
+                << indexOffset);
+  reader.readSection(ChunkHeaderSize - sizeof(ChunkType));
+  index.resize(reader.read<uint32_t>());
+  for (auto& entry : index) {
+    entry.type = reader.read<ChunkType>();
+    entry.keyframeIndex = reader.read<uint32_t>();
+    entry.numKeyframes = reader.read<uint32_t>();
+    entry.offset = reader.read<uint64_t>();
+    ESP_CHECK(entry.offset + ChunkHeaderSize <= indexOffset,
+              "KeyframeDecoder::readIndex(): chunk offset"
+                  << entry.offset << "is out of range");
+  }
+  return true;
+}
+
+esp::assets::RenderAssetInstanceCreationInfo KeyframeDecoder::readCreation(
+    core::SnapshotReader& reader) {
+  const uint64_t index = readVarUint(reader);
+  if (index < creationTable_.size()) {
+    return creationTable_[index];
+  }
+  DECODER_CHECK(reader, index == creationTable_.size(),
+                "KeyframeDecoder: creation table index" << index
+                                                        << "is out of range",
+                {});
+  esp::assets::RenderAssetInstanceCreationInfo creation;
+  creation.filepath = reader.readString();
+  if (reader.read<uint8_t>()) {
+    creation.scale = readVector3(reader);
+  }
+  creation.flags = esp::assets::RenderAssetInstanceCreationInfo::Flags{
+      esp::assets::RenderAssetInstanceCreationInfo::Flag(
+          readVarUint(reader))};
+  creation.lightSetupKey = reader.readString();
+  creationTable_.push_back(creation);
+  return creation;
+}
+
+void KeyframeDecoder::readKeyframe(core::SnapshotReader& reader,
+                                   Keyframe& keyframe) {
+  keyframe.loads.resize(readCount(reader));
+  for (auto& info : keyframe.loads) {
+    info = readAssetInfo(reader);
+  }
+
+  const uint64_t numCreations = readCount(reader);
+  keyframe.creations.clear();
+  for (uint64_t i = 0; i < numCreations; ++i) {
+    const auto instanceKey = RenderAssetInstanceKey(readVarInt(reader));
+    keyframe.creations.emplace_back(instanceKey, readCreation(reader));
+  }
+
+  const uint64_t numChanges = readCount(reader);
+  keyframe.renderAssetChanges.clear();
+  for (uint64_t i = 0; i < numChanges; ++i) {
+    const auto instanceKey = RenderAssetInstanceKey(readVarInt(reader));
+    keyframe.renderAssetChanges.emplace_back(instanceKey,
+                                             readCreation(reader));
+  }
+
+  keyframe.deletions.resize(readCount(reader));
+  for (auto& instanceKey : keyframe.deletions) {
+    instanceKey = RenderAssetInstanceKey(readVarInt(reader));
+    instanceStates_.erase(instanceKey);
+  }
+
+  keyframe.stateUpdates.resize(readCount(reader));
+  RenderAssetInstanceKey prevKey = 0;
+  for (auto& pair : keyframe.stateUpdates) {
+    pair.first = RenderAssetInstanceKey(prevKey + readVarInt(reader));
+    prevKey = pair.first;
+
+    InstanceState& state = instanceStates_[pair.first];
+    const uint8_t fields = reader.read<uint8_t>();
+    if (fields & TranslationField) {
+      for (int i = 0; i < 3; ++i) {
+        state.translation[i] += int32_t(readVarInt(reader));
+      }
+    }
+    if (fields & RotationField) {
+      state.rotation = readRotation(reader);
+    }
+    if (fields & SemanticIdField) {
+      state.semanticId = int(readVarInt(reader));
+    }
+
+    for (int i = 0; i < 3; ++i) {
+      pair.second.absTransform.translation[i] =
+          state.translation[i] * translationStep_;
+    }
+    pair.second.absTransform.rotation = state.rotation;
+    pair.second.semanticId = state.semanticId;
+  }
+
+  // user transforms are updated in place, so decoding into the same keyframe
+  // doesn't reallocate the ones that are set in every keyframe
+  const uint64_t numUserTransforms = readCount(reader);
+  const core::SnapshotReader userTransformsReader = reader;
+  auto readUserTransforms = [&]() {
+    for (uint64_t i = 0; i < numUserTransforms; ++i) {
+      std::string name = reader.readString();
+      Transform transform;
+      transform.translation = readVector3(reader);
+      const Mn::Vector3 vector = readVector3(reader);
+      transform.rotation = Mn::Quaternion{vector, reader.read<float>()};
+      keyframe.userTransforms[std::move(name)] = transform;
+    }
+  };
+  readUserTransforms();
+  if (keyframe.userTransforms.size() != numUserTransforms) {
+    // some are left over from an earlier keyframe, start from scratch
+    keyframe.userTransforms.clear();
+    reader = userTransformsReader;
+    readUserTransforms();
+  }
+}
+
+bool BinaryKeyframeReader::open(const char* data, std::size_t size) {
+  std::vector<ChunkIndexEntry> index;
+  if (!KeyframeDecoder::readIndex(data, size, index)) {
+    return false;
+  }
+  data_ = data;
+  size_ = size;
+  numKeyframes_ = 0;
+  checkpointKeyframeIndices_.clear();
+  checkpointOffsets_.clear();
+  for (const auto& entry : index) {
+    if (entry.type == ChunkType::Keyframes) {
+      numKeyframes_ += entry.numKeyframes;
+    } else if (entry.type == ChunkType::Checkpoint) {
+      checkpointKeyframeIndices_.push_back(entry.keyframeIndex);
+      checkpointOffsets_.push_back(entry.offset);
+    }
+  }
+  rewind();
+  return true;
+}
+
+void BinaryKeyframeReader::rewind() {
+  reader_ = core::SnapshotReader{data_, size_};
+  decoder_ = KeyframeDecoder{};
+  decoder_.readHeader(reader_);
+  numKeyframesLeftInChunk_ = 0;
+  hasPeekedKeyframe_ = false;
+  nextKeyframeIndex_ = 0;
+}
+
+const Keyframe& BinaryKeyframeReader::seekToCheckpoint(
+    std::size_t checkpoint) {
+  CORRADE_ASSERT(checkpoint < checkpointOffsets_.size(),
+                 "BinaryKeyframeReader::seekToCheckpoint: checkpoint"
+                     << checkpoint << "out of range",
+                 checkpoint_.state);
+  const uint64_t offset = checkpointOffsets_[checkpoint];
+  reader_ = core::SnapshotReader{data_ + offset, size_ - offset};
+  KeyframeDecoder::ChunkView chunk = KeyframeDecoder::readChunkHeader(reader_);
+  ESP_CHECK(chunk.type == ChunkType::Checkpoint,
+            "BinaryKeyframeReader::seekToCheckpoint(): no checkpoint chunk at "
+            "offset"
+                << offset);
+  decoder_.readCheckpoint(chunk.payload, checkpoint_);
+  numKeyframesLeftInChunk_ = 0;
+  hasPeekedKeyframe_ = false;
+  nextKeyframeIndex_ = checkpoint_.keyframeIndex + 1;
+  currentKeyframe_ = &checkpoint_.state;
+  return checkpoint_.state;
+}
+
+const Keyframe& BinaryKeyframeReader::readNextKeyframe() {
+  CORRADE_ASSERT(nextKeyframeIndex_ < numKeyframes_,
+                 "BinaryKeyframeReader::readNextKeyframe: no keyframes left",
+                 keyframe_);
+  if (hasPeekedKeyframe_) {
+    // swapping only exchanges buffers, no keyframe data is copied
+    std::swap(keyframe_, peekedKeyframe_);
+    hasPeekedKeyframe_ = false;
+  } else {
+    decodeNextKeyframe(keyframe_);
+  }
+  ++nextKeyframeIndex_;
+  currentKeyframe_ = &keyframe_;
+  return keyframe_;
+}
+
+const Keyframe& BinaryKeyframeReader::peekNextKeyframe() {
+  CORRADE_ASSERT(nextKeyframeIndex_ < numKeyframes_,
+                 "BinaryKeyframeReader::peekNextKeyframe: no keyframes left",
+                 peekedKeyframe_);
+  if (!hasPeekedKeyframe_) {
+    decodeNextKeyframe(peekedKeyframe_);
+    hasPeekedKeyframe_ = true;
+  }
+  return peekedKeyframe_;
+}
+
+void BinaryKeyframeReader::decodeNextKeyframe(Keyframe& keyframe) {
+  while (!numKeyframesLeftInChunk_) {
+    KeyframeDecoder::ChunkView chunk =
+        KeyframeDecoder::readChunkHeader(reader_);
+    ESP_CHECK(chunk.type != ChunkType::Index,
+              "BinaryKeyframeReader: index reached before keyframe"
+                  << nextKeyframeIndex_);
+    if (chunk.type == ChunkType::Checkpoint) {
+      // later keyframes are encoded relative to the checkpoint
+      decoder_.readCheckpoint(chunk.payload, checkpoint_);
+    } else {
+      chunkReader_ = chunk.payload;
+      numKeyframesLeftInChunk_ = chunk.numKeyframes;
+    }
+  }
+  decoder_.readKeyframe(chunkReader_, keyframe);
+  --numKeyframesLeftInChunk_;
+  ESP_CHECK(numKeyframesLeftInChunk_ || chunkReader_.getRemaining() == 0,
+            "BinaryKeyframeReader: chunk has" << chunkReader_.getRemaining()
+                                              << "unread bytes");
+}
+
+void writeKeyframesToBinary(const std::vector<Keyframe>& keyframes,
+                            std::vector<char>& buffer,
+                            int keyframesPerChunk,
+                            const std::vector<Checkpoint>& checkpoints) {
+  KeyframeEncoder encoder;
+  encoder.writeHeader(buffer);
+  encoder.writeKeyframes(keyframes.data(), keyframes.size(),
+                         checkpoints.data(), checkpoints.size(),
+                         keyframesPerChunk, buffer);
+  encoder.writeIndex(buffer);
+}
+
+Corrade::Containers::Optional<std::vector<Keyframe>> readKeyframesFromBinary(
+    const char* data,
+    std::size_t size,
+    std::vector<Checkpoint>* checkpoints) {
+  core::SnapshotReader reader{data, size, false};
+  KeyframeDecoder decoder;
+  decoder.readHeader(reader);
+  std::vector<Keyframe> keyframes;
+  while (reader.getRemaining()) {
+    if (!KeyframeDecoder::hasCompleteChunk(reader)) {
+      // e.g. a replay that is still being streamed, or was cut short
+      LOG(WARNING) << "readKeyframesFromBinary: ignoring incomplete last "
+                      "chunk of "
+                   << reader.getRemaining() << " bytes";
+      break;
+    }
+    decoder.readChunk(reader, keyframes, checkpoints);
+  }
+  if (reader.hasFailed()) {
+    LOG(ERROR) << "readKeyframesFromBinary: malformed replay, failed after "
+               << keyframes.size() << " keyframes";
+    if (checkpoints) {
+      checkpoints->clear();
+    }
+    return Corrade::Containers::NullOpt;
+  }
+  return Corrade::Containers::optional(std::move(keyframes));
+}
+
+}  // namespace replay
+}  // namespace gfx
+}  // namespace esp
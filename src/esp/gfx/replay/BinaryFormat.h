@@ -0,0 +1,384 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#ifndef ESP_GFX_REPLAY_BINARYFORMAT_H_
+#define ESP_GFX_REPLAY_BINARYFORMAT_H_
+
+/** @file
+ * @brief Class @ref esp::gfx::replay::KeyframeEncoder, @ref
+ * esp::gfx::replay::KeyframeDecoder, @ref
+ * esp::gfx::replay::BinaryKeyframeReader
+ *
+ * A compact binary alternative to the JSON replay format. A file starts with
+ * a header (magic, version, translation quantization step), followed by
+ * chunks:
+ *
+ *  - Keyframes chunks hold consecutive keyframes. Render asset instance
+ *    creations reference a creation table which is built up as the file is
+ *    written; each distinct creation is stored once, the first time it is
+ *    used. State updates are delta-encoded against the previous state of the
+ *    same instance. Translations are quantized to integer steps and stored as
+ *    variable-length deltas, rotations are stored with the "smallest three"
+ *    quaternion encoding, and unchanged fields are skipped. User transforms
+ *    are stored at full precision.
+ *  - A checkpoint chunk follows the keyframe it belongs to and holds a
+ *    @ref Checkpoint. Encoder and decoder reset the creation table and the
+ *    instance states before it, so decoding can start at any checkpoint.
+ *  - An index chunk ends a finished file. It lists the offset of every
+ *    chunk and ends with its own offset, so readers can seek directly to a
+ *    keyframe or checkpoint.
+ *
+ * Chunks are framed with their type, codec, keyframe count and size, so
+ * readers can skip over them. Only uncompressed chunks are supported for now.
+ * Values are stored in host byte order (little-endian on all supported
+ * platforms).
+ */
+
+#include "Keyframe.h"
+
+#include "esp/core/Snapshot.h"
+#include "esp/core/esp.h"
+
+#include <Corrade/Containers/Optional.h>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace esp {
+namespace gfx {
+namespace replay {
+
+//! "HRPB"
+constexpr uint32_t BinaryReplayMagic = 0x42505248;
+constexpr uint32_t BinaryReplayVersion = 2;
+//! "HRPI", the last four bytes of a file with an index
+constexpr uint32_t BinaryReplayIndexMagic = 0x49505248;
+
+//! Default maximum number of keyframes per chunk
+constexpr int DefaultKeyframesPerChunk = 64;
+
+//! Default translation quantization step, in meters
+constexpr float DefaultTranslationQuantizationStep = 1.0f / 8192.0f;
+
+enum class ChunkType : uint8_t {
+  Keyframes = 0,
+  Checkpoint = 1,
+  Index = 2,
+};
+
+/**
+ * @brief Compression codec of a chunk.
+ */
+enum class ChunkCodec : uint8_t {
+  None = 0,
+};
+
+/**
+ * @brief Entry of the chunk index at the end of a binary replay.
+ */
+struct ChunkIndexEntry {
+  ChunkType type = ChunkType::Keyframes;
+  //! Index of the first keyframe of a keyframes chunk, or of the keyframe a
+  //! checkpoint belongs to
+  uint32_t keyframeIndex = 0;
+  uint32_t numKeyframes = 0;
+  //! Offset of the chunk from the start of the file
+  uint64_t offset = 0;
+};
+
+/**
+ * @brief Whether @p data starts with a binary replay header.
+ */
+bool isBinaryReplay(const char* data, std::size_t size);
+
+/**
+ * @brief Whether keyframes written to @p filepath should use the binary
+ * format, i.e. whether it ends with ".bin".
+ */
+bool isBinaryReplayFilepath(const std::string& filepath);
+
+/**
+ * @brief Encodes keyframes into the binary replay format.
+ *
+ * The encoder keeps the creation table and the most recent state of each
+ * instance, so consecutive chunks must be written with the same encoder, in
+ * order, after the header. It also keeps track of the offset of each chunk,
+ * assuming everything it writes ends up in one file, for @ref writeIndex.
+ */
+class KeyframeEncoder {
+ public:
+  explicit KeyframeEncoder(
+      float translationStep = DefaultTranslationQuantizationStep);
+
+  /**
+   * @brief Append the file header to @p buffer.
+   */
+  void writeHeader(std::vector<char>& buffer);
+
+  /**
+   * @brief Append @p count keyframes as one chunk to @p buffer.
+   */
+  void writeChunk(const Keyframe* keyframes,
+                  std::size_t count,
+                  std::vector<char>& buffer);
+
+  /**
+   * @brief Append a checkpoint chunk to @p buffer. The checkpoint must belong
+   * to the last written keyframe.
+   */
+  void writeCheckpoint(const Checkpoint& checkpoint, std::vector<char>& buffer);
+
+  /**
+   * @brief Append @p count keyframes to @p buffer in chunks of at most
+   * @p keyframesPerChunk keyframes. Each of the @p numCheckpoints checkpoints,
+   * sorted by keyframe, is written right after its keyframe, which ends the
+   * chunk there.
+   */
+  void writeKeyframes(const Keyframe* keyframes,
+                      std::size_t count,
+                      const Checkpoint* checkpoints,
+                      std::size_t numCheckpoints,
+                      int keyframesPerChunk,
+                      std::vector<char>& buffer);
+
+  /**
+   * @brief Append the index of all chunks written so far. Nothing should be
+   * written after it.
+   */
+  void writeIndex(std::vector<char>& buffer);
+
+  //! Number of keyframes written so far
+  int getNumKeyframes() const { return numKeyframes_; }
+
+ private:
+  // quantized state as last written for an instance
+  struct InstanceState {
+    int32_t translation[3] = {0, 0, 0};
+    // not a valid packed rotation, so the first rotation is always written
+    uint64_t rotation = ~uint64_t(0);
+    int semanticId = ID_UNDEFINED;
+  };
+
+  std::size_t beginChunk(core::SnapshotWriter& writer,
+                         ChunkType type,
+                         uint32_t keyframeIndex,
+                         uint32_t numKeyframes);
+  void endChunk(core::SnapshotWriter& writer, std::size_t sizeOffset);
+  void writeKeyframe(core::SnapshotWriter& writer, const Keyframe& keyframe);
+  void writeCreation(
+      core::SnapshotWriter& writer,
+      const esp::assets::RenderAssetInstanceCreationInfo& creation);
+
+  float translationStep_;
+  // serialized creation -> index in the creation table
+  std::unordered_map<std::string, uint32_t> creationTable_;
+  std::unordered_map<RenderAssetInstanceKey, InstanceState> instanceStates_;
+  int numKeyframes_ = 0;
+  // bytes written so far, i.e. the file offset of the next chunk
+  uint64_t fileOffset_ = 0;
+  std::vector<ChunkIndexEntry> index_;
+};
+
+/**
+ * @brief Decodes keyframes written by a @ref KeyframeEncoder. Malformed data
+ * is a fatal error, unless the reader doesn't fail on errors, see
+ * @ref core::SnapshotReader::SnapshotReader(). The error is then logged and
+ * the reader marked as failed.
+ */
+class KeyframeDecoder {
+ public:
+  /**
+   * @brief Read and check the file header, including the quantization step
+   * used for the following chunks.
+   */
+  void readHeader(core::SnapshotReader& reader);
+
+  /**
+   * @brief Read the next chunk. Keyframes are appended to @p keyframes and a
+   * checkpoint to @p checkpoints, unless it's nullptr. Index chunks are
+   * skipped.
+   *
+   * Decoding may start at any checkpoint chunk instead of the first chunk
+   * after the header.
+   */
+  void readChunk(core::SnapshotReader& reader,
+                 std::vector<Keyframe>& keyframes,
+                 std::vector<Checkpoint>* checkpoints = nullptr);
+
+  /**
+   * @brief Header and payload of a chunk, see @ref readChunkHeader.
+   */
+  struct ChunkView {
+    ChunkType type;
+    //! Number of keyframes in a keyframes chunk
+    uint32_t numKeyframes;
+    core::SnapshotReader payload;
+  };
+
+  /**
+   * @brief Read the header of the next chunk and skip @p reader past it.
+   * The chunk payload can then be decoded incrementally with
+   * @ref readKeyframe or @ref readCheckpoint.
+   */
+  static ChunkView readChunkHeader(core::SnapshotReader& reader);
+
+  /**
+   * @brief Decode the next keyframe of a keyframes chunk payload into
+   * @p keyframe, replacing its contents. The memory of @p keyframe is reused,
+   * so decoding keyframes which only update instance states into the same
+   * keyframe over and over doesn't allocate.
+   */
+  void readKeyframe(core::SnapshotReader& reader, Keyframe& keyframe);
+
+  /**
+   * @brief Decode the payload of a checkpoint chunk into @p checkpoint,
+   * replacing its contents. Resets the decoder state, see @ref readChunk.
+   */
+  void readCheckpoint(core::SnapshotReader& reader, Checkpoint& checkpoint);
+
+  /**
+   * @brief Whether @p reader holds at least one more complete chunk. The last
+   * chunk of a file that is still being written may be incomplete.
+   */
+  static bool hasCompleteChunk(const core::SnapshotReader& reader);
+
+  /**
+   * @brief Read the chunk index of a complete binary replay in @p data.
+   * Returns false if the file has no index, e.g. because it's still being
+   * written.
+   */
+  static bool readIndex(const char* data,
+                        std::size_t size,
+                        std::vector<ChunkIndexEntry>& index);
+
+ private:
+  struct InstanceState {
+    int32_t translation[3] = {0, 0, 0};
+    Magnum::Quaternion rotation;
+    int semanticId = ID_UNDEFINED;
+  };
+
+  esp::assets::RenderAssetInstanceCreationInfo readCreation(
+      core::SnapshotReader& reader);
+
+  float translationStep_ = DefaultTranslationQuantizationStep;
+  std::vector<esp::assets::RenderAssetInstanceCreationInfo> creationTable_;
+  std::unordered_map<RenderAssetInstanceKey, InstanceState> instanceStates_;
+};
+
+/**
+ * @brief Decodes the keyframes of a complete binary replay one at a time.
+ *
+ * Only the header and chunk index are read upfront, so opening a replay takes
+ * constant time no matter its length. Keyframes are then decoded on demand
+ * straight from the data, which is meant to be a memory-mapped file, into one
+ * reused @ref Keyframe. Decoding continues from the previous keyframe or
+ * starts over at a checkpoint.
+ */
+class BinaryKeyframeReader {
+ public:
+  /**
+   * @brief Read the header and chunk index of the replay in @p data, which
+   * must stay valid while the reader is used. Returns false if the replay has
+   * no index, e.g. because it's still being written.
+   */
+  bool open(const char* data, std::size_t size);
+
+  int getNumKeyframes() const { return numKeyframes_; }
+
+  /**
+   * @brief Keyframe indices of the checkpoints, in increasing order.
+   */
+  const std::vector<int>& getCheckpointKeyframeIndices() const {
+    return checkpointKeyframeIndices_;
+  }
+
+  /**
+   * @brief Index of the keyframe @ref readNextKeyframe decodes.
+   */
+  int getNextKeyframeIndex() const { return nextKeyframeIndex_; }
+
+  /**
+   * @brief Continue decoding at the first keyframe.
+   */
+  void rewind();
+
+  /**
+   * @brief Decode the state of checkpoint @p checkpoint (see
+   * @ref getCheckpointKeyframeIndices) and continue decoding at the keyframe
+   * after it. The returned state is valid until the next call.
+   */
+  const Keyframe& seekToCheckpoint(std::size_t checkpoint);
+
+  /**
+   * @brief Decode the next keyframe. The returned keyframe is valid until
+   * the next call.
+   */
+  const Keyframe& readNextKeyframe();
+
+  /**
+   * @brief Decode the next keyframe without moving past it, so the
+   * following @ref readNextKeyframe returns it without decoding it again. The
+   * returned keyframe is valid until the reader moves on.
+   */
+  const Keyframe& peekNextKeyframe();
+
+  /**
+   * @brief The keyframe or checkpoint state decoded last.
+   */
+  const Keyframe& getCurrentKeyframe() const { return *currentKeyframe_; }
+
+ private:
+  const char* data_ = nullptr;
+  std::size_t size_ = 0;
+  int numKeyframes_ = 0;
+  std::vector<int> checkpointKeyframeIndices_;
+  std::vector<uint64_t> checkpointOffsets_;
+
+  KeyframeDecoder decoder_;
+  // positioned at the next chunk
+  core::SnapshotReader reader_{nullptr, 0};
+  // the rest of the current keyframes chunk
+  core::SnapshotReader chunkReader_{nullptr, 0};
+  uint32_t numKeyframesLeftInChunk_ = 0;
+  int nextKeyframeIndex_ = 0;
+
+  Keyframe keyframe_;
+  Keyframe peekedKeyframe_;
+  bool hasPeekedKeyframe_ = false;
+  Checkpoint checkpoint_;
+  const Keyframe* currentKeyframe_ = &keyframe_;
+
+  void decodeNextKeyframe(Keyframe& keyframe);
+};
+
+/**
+ * @brief Encode @p keyframes and @p checkpoints as a complete binary replay
+ * into @p buffer, in chunks of at most @p keyframesPerChunk keyframes.
+ */
+void writeKeyframesToBinary(const std::vector<Keyframe>& keyframes,
+                            std::vector<char>& buffer,
+                            int keyframesPerChunk = DefaultKeyframesPerChunk,
+                            const std::vector<Checkpoint>& checkpoints = {});
+
+/**
+ * @brief Decode a binary replay, including its checkpoints if
+ * @p checkpoints isn't nullptr. An incomplete last chunk is skipped with a
+ * warning, so a replay can be read while it is being streamed.
+ *
+ * Returns @ref Corrade::Containers::NullOpt and logs an error if the data is
+ * malformed, e.g. a corrupt file.
+ */
+Corrade::Containers::Optional<std::vector<Keyframe>> readKeyframesFromBinary(
+    const char* data,
+    std::size_t size,
+    std::vector<Checkpoint>* checkpoints = nullptr);
+
+}  // namespace replay
+}  // namespace gfx
+}  // namespace esp
+
+#endif  // ESP_GFX_REPLAY_BINARYFORMAT_H_
@@ -55,6 +55,23 @@ struct Keyframe {
   std::vector<std::pair<RenderAssetInstanceKey, RenderAssetInstanceState>>
       stateUpdates;
   std::unordered_map<std::string, Transform> userTransforms;
+  // existing instances which were switched to another render asset
+  std::vector<std::pair<RenderAssetInstanceKey,
+                        esp::assets::RenderAssetInstanceCreationInfo>>
+      renderAssetChanges;
+};
+
+/**
+ * @brief The full state of a scene after a given keyframe. Applying the state
+ * to an empty scene is equivalent to applying all keyframes up to and
+ * including that keyframe, so playback can start from a checkpoint instead of
+ * from the first keyframe. See @ref Recorder::setCheckpointInterval.
+ */
+struct Checkpoint {
+  int keyframeIndex = ID_UNDEFINED;
+  // loads, creations, and state updates of all instances, plus the user
+  // transforms of the keyframe
+  Keyframe state;
 };
 
 }  // namespace replay
@@ -0,0 +1,99 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "KeyframeStreamWriter.h"
+
+namespace esp {
+namespace gfx {
+namespace replay {
+
+KeyframeStreamWriter::KeyframeStreamWriter(const std::string& filepath,
+                                           int maxPendingChunks)
+    : filepath_(filepath),
+      file_(filepath, std::ios::binary | std::ios::trunc),
+      maxPendingChunks_(maxPendingChunks) {
+  CORRADE_ASSERT(maxPendingChunks_ > 0,
+                 "KeyframeStreamWriter: maxPendingChunks must be positive", );
+  if (!file_) {
+    LOG(ERROR) << "KeyframeStreamWriter: unable to open " << filepath_
+               << " for writing";
+    return;
+  }
+  encoder_.writeHeader(buffer_);
+  writeBuffer();
+  isOpen_ = true;
+  thread_ = std::thread(&KeyframeStreamWriter::run, this);
+}
+
+KeyframeStreamWriter::~KeyframeStreamWriter() {
+  if (!thread_.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  workCondition_.notify_one();
+  thread_.join();
+  encoder_.writeIndex(buffer_);
+  writeBuffer();
+}
+
+void KeyframeStreamWriter::pushChunk(std::vector<Keyframe>&& keyframes,
+                                     std::vector<Checkpoint>&& checkpoints) {
+  if (!isOpen_ || keyframes.empty()) {
+    return;
+  }
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    writtenCondition_.wait(lock, [&] {
+      return int(pendingChunks_.size()) < maxPendingChunks_;
+    });
+    pendingChunks_.emplace_back(
+        PendingChunk{std::move(keyframes), std::move(checkpoints)});
+  }
+  workCondition_.notify_one();
+}
+
+void KeyframeStreamWriter::waitUntilWritten() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  writtenCondition_.wait(lock, [&] { return pendingChunks_.empty(); });
+}
+
+void KeyframeStreamWriter::run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    workCondition_.wait(
+        lock, [&] { return stopping_ || !pendingChunks_.empty(); });
+    if (pendingChunks_.empty()) {
+      // stopping, and everything is written
+      return;
+    }
+    // the producer only appends, so the front chunk can be encoded without
+    // holding the lock
+    const PendingChunk& chunk = pendingChunks_.front();
+    lock.unlock();
+    encoder_.writeKeyframes(chunk.keyframes.data(), chunk.keyframes.size(),
+                            chunk.checkpoints.data(), chunk.checkpoints.size(),
+                            chunk.keyframes.size(), buffer_);
+    writeBuffer();
+    lock.lock();
+    pendingChunks_.pop_front();
+    writtenCondition_.notify_all();
+  }
+}
+
+void KeyframeStreamWriter::writeBuffer() {
+  if (file_) {
+    file_.write(buffer_.data(), buffer_.size());
+    file_.flush();
+    LOG_IF(ERROR, !file_) << "KeyframeStreamWriter: failed to write to "
+                          << filepath_ << ", dropping further keyframes";
+  }
+  buffer_.clear();
+}
+
+}  // namespace replay
+}  // namespace gfx
+}  // namespace esp
@@ -0,0 +1,100 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#ifndef ESP_GFX_REPLAY_KEYFRAMESTREAMWRITER_H_
+#define ESP_GFX_REPLAY_KEYFRAMESTREAMWRITER_H_
+
+#include "BinaryFormat.h"
+#include "Keyframe.h"
+
+#include "esp/core/esp.h"
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace esp {
+namespace gfx {
+namespace replay {
+
+/**
+ * @brief Writes chunks of keyframes to a binary replay file on a background
+ * thread.
+ *
+ * Each chunk is encoded and flushed to the file as a whole, so the file is a
+ * valid replay up to the last flushed chunk while it is still being written.
+ * The chunk index is written when the file is closed.
+ * At most maxPendingChunks chunks wait to be written; @ref pushChunk blocks
+ * until there is room, which bounds memory use if the disk can't keep up.
+ */
+class KeyframeStreamWriter {
+ public:
+  /**
+   * @brief Create @p filepath, write the replay header and start the writer
+   * thread. Check @ref isOpen for failure.
+   */
+  KeyframeStreamWriter(const std::string& filepath, int maxPendingChunks);
+
+  /**
+   * @brief Write all pending chunks and the chunk index, and close the file.
+   */
+  ~KeyframeStreamWriter();
+
+  bool isOpen() const { return isOpen_; }
+
+  const std::string& getFilepath() const { return filepath_; }
+
+  /**
+   * @brief Queue @p keyframes to be written as one chunk, along with the
+   * @p checkpoints of these keyframes. A chunk is split after each
+   * checkpoint. Blocks while the queue is full.
+   */
+  void pushChunk(std::vector<Keyframe>&& keyframes,
+                 std::vector<Checkpoint>&& checkpoints = {});
+
+  /**
+   * @brief Block until all queued chunks are written and flushed.
+   */
+  void waitUntilWritten();
+
+ private:
+  struct PendingChunk {
+    std::vector<Keyframe> keyframes;
+    std::vector<Checkpoint> checkpoints;
+  };
+
+  void run();
+  void writeBuffer();
+
+  std::string filepath_;
+  std::ofstream file_;
+  bool isOpen_ = false;
+  int maxPendingChunks_;
+
+  // only accessed by the writer thread
+  KeyframeEncoder encoder_;
+  std::vector<char> buffer_;
+
+  std::mutex mutex_;
+  // signaled when a chunk is queued or the writer should stop
+  std::condition_variable workCondition_;
+  // signaled when a chunk has been written
+  std::condition_variable writtenCondition_;
+  // the front chunk stays queued until it's written
+  std::deque<PendingChunk> pendingChunks_;
+  bool stopping_ = false;
+  std::thread thread_;
+
+  ESP_SMART_POINTERS(KeyframeStreamWriter)
+};
+
+}  // namespace replay
+}  // namespace gfx
+}  // namespace esp
+
+#endif  // ESP_GFX_REPLAY_KEYFRAMESTREAMWRITER_H_
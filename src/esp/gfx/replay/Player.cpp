@@ -4,12 +4,20 @@
 
 #include "Player.h"
 
+#include "BinaryFormat.h"
 #include "esp/assets/ResourceManager.h"
 #include "esp/core/esp.h"
 #include "esp/io/JsonAllTypes.h"
 
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Utility/Directory.h>
+#include <Magnum/Math/Functions.h>
+#include <Magnum/Math/Quaternion.h>
 #include <rapidjson/document.h>
 
+#include <algorithm>
+#include <memory>
+
 namespace esp {
 namespace gfx {
 namespace replay {
@@ -17,6 +25,7 @@ namespace replay {
 void Player::readKeyframesFromJsonDocument(const rapidjson::Document& d) {
   ASSERT(keyframes_.empty());
   esp::io::readMember(d, "keyframes", keyframes_);
+  esp::io::readMember(d, "checkpoints", checkpoints_);
 }
 
 Player::Player(const LoadAndCreateRenderAssetInstanceCallback& callback)
@@ -31,8 +40,30 @@ void Player::readKeyframesFromFile(const std::string& filepath) {
     return;
   }
   try {
-    auto newDoc = esp::io::parseJsonFile(filepath);
-    readKeyframesFromJsonDocument(newDoc);
+    auto data = Corrade::Utility::Directory::mapRead(filepath);
+    if (!data) {
+      LOG(ERROR) << "Player::readKeyframesFromFile: unable to map " << filepath
+                 << ".";
+      return;
+    }
+    if (isBinaryReplay(data.data(), data.size())) {
+      auto reader = std::make_unique<BinaryKeyframeReader>();
+      if (reader->open(data.data(), data.size())) {
+        // the reader points into the mapping, which doesn't move with it
+        binaryReader_ = std::move(reader);
+        mappedFile_ = std::move(data);
+      } else if (auto decoded = readKeyframesFromBinary(
+                     data.data(), data.size(), &checkpoints_)) {
+        keyframes_ = std::move(*decoded);
+      } else {
+        LOG(ERROR) << "Player::readKeyframesFromFile: " << filepath
+                   << " is malformed.";
+      }
+    } else {
+      auto newDoc =
+          esp::io::parseJsonString(std::string(data.data(), data.size()));
+      readKeyframesFromJsonDocument(newDoc);
+    }
   } catch (...) {
     LOG(ERROR)
         << "Player::readKeyframesFromFile: failed to parse keyframes from "
@@ -49,20 +80,138 @@ int Player::getKeyframeIndex() const {
 }
 
 int Player::getNumKeyframes() const {
-  return keyframes_.size();
+  return binaryReader_ ? binaryReader_->getNumKeyframes() : keyframes_.size();
 }
 
 void Player::setKeyframeIndex(int frameIndex) {
   ASSERT(frameIndex == -1 ||
          (frameIndex >= 0 && frameIndex < getNumKeyframes()));
+  restoreInterpolatedInstances();
+
+  // request the assets needed now too, so they are read in parallel
+  prefetchAssets(frameIndex);
 
-  if (frameIndex < frameIndex_) {
+  // start over from a checkpoint if it saves applying keyframes
+  const int checkpoint = findCheckpoint(frameIndex);
+  if (checkpoint != -1 &&
+      (frameIndex < frameIndex_ ||
+       getCheckpointKeyframeIndex(checkpoint) > frameIndex_)) {
+    clearFrame();
+    applyCheckpoint(checkpoint);
+  } else if (frameIndex < frameIndex_) {
     clearFrame();
   }
 
   while (frameIndex_ < frameIndex) {
-    applyKeyframe(keyframes_[++frameIndex_]);
+    applyNextKeyframe();
+  }
+  flushPhysicsStates();
+}
+
+void Player::setKeyframeTime(float time) {
+  ASSERT(time >= 0.0f && time <= getNumKeyframes() - 1);
+  const int frameIndex = int(time);
+  setKeyframeIndex(frameIndex);
+  const float factor = time - frameIndex;
+  if (factor == 0.0f) {
+    return;
+  }
+
+  nextKeyframe_ = &peekNextKeyframe();
+  interpolationFactor_ = factor;
+  for (const auto& pair : nextKeyframe_->stateUpdates) {
+    const auto& it = createdInstances_.find(pair.first);
+    if (it == createdInstances_.end()) {
+      // created in the next keyframe, or a failed instance creation
+      continue;
+    }
+    auto node = it->second;
+    const auto& target = pair.second.absTransform;
+    interpolatedInstances_.emplace_back(
+        node, Transform{node->translation(), node->rotation()});
+    node->setTranslation(
+        Magnum::Math::lerp(node->translation(), target.translation, factor));
+    // q and -q are the same rotation, interpolate the short way
+    node->setRotation(Magnum::Math::slerpShortestPath(
+        node->rotation(), target.rotation, factor));
   }
+  interpolatePhysicsInstances(*nextKeyframe_, factor);
+}
+
+void Player::setPrefetchCallback(const PrefetchRenderAssetCallback& callback,
+                                 int numKeyframesAhead) {
+  CORRADE_ASSERT(numKeyframesAhead >= 0,
+                 "Player::setPrefetchCallback: numKeyframesAhead must not be "
+                 "negative", );
+  prefetchCallback_ = callback;
+  prefetchKeyframesAhead_ = numKeyframesAhead;
+}
+
+void Player::setPhysicsCallbacks(const PhysicsCallbacks& callbacks) {
+  CORRADE_ASSERT(frameIndex_ == -1,
+                 "Player::setPhysicsCallbacks: must be called before a "
+                 "keyframe is set", );
+  CORRADE_ASSERT(!callbacks.createObject ||
+                     (callbacks.removeObject && callbacks.setRigidStates),
+                 "Player::setPhysicsCallbacks: removeObject and "
+                 "setRigidStates are required with createObject", );
+  physicsCallbacks_ = callbacks;
+}
+
+void Player::detachPhysics() {
+  physicsCallbacks_ = PhysicsCallbacks{};
+  physicsInstances_.clear();
+  dirtyPhysicsInstances_.clear();
+  pendingPhysicsStates_.clear();
+}
+
+std::vector<int> Player::getPhysicsObjectIDs() const {
+  std::vector<int> objectIDs;
+  objectIDs.reserve(physicsInstances_.size());
+  for (const auto& pair : physicsInstances_) {
+    objectIDs.push_back(pair.second.objectID);
+  }
+  return objectIDs;
+}
+
+void Player::prefetchAssets(int frameIndex) {
+  if (!prefetchCallback_ || frameIndex < 0) {
+    return;
+  }
+  const int lastFrameIndex =
+      std::min(frameIndex + prefetchKeyframesAhead_, getNumKeyframes() - 1);
+  if (lastFrameIndex <= lastPrefetchedFrameIndex_) {
+    return;
+  }
+  if (binaryReader_ && !prefetchReader_) {
+    prefetchReader_ = std::make_unique<BinaryKeyframeReader>();
+    prefetchReader_->open(mappedFile_.data(), mappedFile_.size());
+  }
+  auto prefetchLoads = [this](const Keyframe& keyframe) {
+    for (const auto& assetInfo : keyframe.loads) {
+      if (prefetchedFilepaths_.insert(assetInfo.filepath).second) {
+        prefetchCallback_(assetInfo);
+      }
+    }
+  };
+
+  // all loads up to frameIndex are needed even when seeking via a
+  // checkpoint. A checkpoint's state holds the loads of all keyframes up to
+  // it, so a seek far ahead skips decoding them.
+  const int checkpoint = findCheckpoint(frameIndex);
+  if (checkpoint != -1 &&
+      getCheckpointKeyframeIndex(checkpoint) > lastPrefetchedFrameIndex_) {
+    prefetchLoads(prefetchReader_
+                      ? prefetchReader_->seekToCheckpoint(checkpoint)
+                      : checkpoints_[checkpoint].state);
+    lastPrefetchedFrameIndex_ = getCheckpointKeyframeIndex(checkpoint);
+  }
+  for (int i = lastPrefetchedFrameIndex_ + 1; i <= lastFrameIndex; ++i) {
+    // the prefetch reader only moves forward, along with i
+    prefetchLoads(prefetchReader_ ? prefetchReader_->readNextKeyframe()
+                                  : keyframes_[i]);
+  }
+  lastPrefetchedFrameIndex_ = lastFrameIndex;
 }
 
 bool Player::getUserTransform(const std::string& name,
@@ -71,23 +220,41 @@ bool Player::getUserTransform(const std::string& name,
   ASSERT(frameIndex_ >= 0 && frameIndex_ < getNumKeyframes());
   ASSERT(translation);
   ASSERT(rotation);
-  const auto& keyframe = keyframes_[frameIndex_];
+  const auto& keyframe = getCurrentKeyframe();
   const auto& it = keyframe.userTransforms.find(name);
-  if (it != keyframe.userTransforms.end()) {
-    *translation = it->second.translation;
-    *rotation = it->second.rotation;
-    return true;
-  } else {
+  if (it == keyframe.userTransforms.end()) {
     return false;
   }
+  *translation = it->second.translation;
+  *rotation = it->second.rotation;
+  if (nextKeyframe_) {
+    const auto& nextIt = nextKeyframe_->userTransforms.find(name);
+    if (nextIt != nextKeyframe_->userTransforms.end()) {
+      *translation = Magnum::Math::lerp(
+          *translation, nextIt->second.translation, interpolationFactor_);
+      *rotation = Magnum::Math::slerpShortestPath(
+          *rotation, nextIt->second.rotation, interpolationFactor_);
+    }
+  }
+  return true;
 }
 
 void Player::close() {
   clearFrame();
   keyframes_.clear();
+  checkpoints_.clear();
+  prefetchReader_ = nullptr;
+  binaryReader_ = nullptr;
+  mappedFile_ = nullptr;
+  lastPrefetchedFrameIndex_ = -1;
+  prefetchedFilepaths_.clear();
+  instancedFilepaths_.clear();
+  prefetchStats_ = PrefetchStats{};
 }
 
 void Player::clearFrame() {
+  interpolatedInstances_.clear();
+  nextKeyframe_ = nullptr;
   for (const auto& pair : createdInstances_) {
     // TODO: use NodeDeletionHelper to safely delete nodes owned by the Player.
     // the deletion here is unsafe because a Player may persist beyond the
@@ -95,10 +262,88 @@ void Player::clearFrame() {
     delete pair.second;
   }
   createdInstances_.clear();
+  for (const auto& pair : physicsInstances_) {
+    physicsCallbacks_.removeObject(pair.second.objectID);
+  }
+  physicsInstances_.clear();
+  dirtyPhysicsInstances_.clear();
   assetInfos_.clear();
   frameIndex_ = -1;
 }
 
+int Player::getNumCheckpoints() const {
+  return binaryReader_ ? binaryReader_->getCheckpointKeyframeIndices().size()
+                       : checkpoints_.size();
+}
+
+int Player::getCheckpointKeyframeIndex(int checkpoint) const {
+  return binaryReader_
+             ? binaryReader_->getCheckpointKeyframeIndices()[checkpoint]
+             : checkpoints_[checkpoint].keyframeIndex;
+}
+
+int Player::findCheckpoint(int frameIndex) const {
+  // the last checkpoint at or before frameIndex, or -1
+  int first = 0;
+  int last = getNumCheckpoints();
+  while (first < last) {
+    const int middle = (first + last) / 2;
+    if (getCheckpointKeyframeIndex(middle) <= frameIndex) {
+      first = middle + 1;
+    } else {
+      last = middle;
+    }
+  }
+  return first - 1;
+}
+
+void Player::applyCheckpoint(int checkpoint) {
+  ASSERT(frameIndex_ == -1);
+  if (binaryReader_) {
+    applyKeyframe(binaryReader_->seekToCheckpoint(checkpoint));
+  } else {
+    applyKeyframe(checkpoints_[checkpoint].state);
+  }
+  frameIndex_ = getCheckpointKeyframeIndex(checkpoint);
+}
+
+void Player::applyNextKeyframe() {
+  ++frameIndex_;
+  if (!binaryReader_) {
+    applyKeyframe(keyframes_[frameIndex_]);
+    return;
+  }
+  if (binaryReader_->getNextKeyframeIndex() != frameIndex_) {
+    // the frame was cleared, decode from the start again
+    ASSERT(frameIndex_ == 0);
+    binaryReader_->rewind();
+  }
+  applyKeyframe(binaryReader_->readNextKeyframe());
+}
+
+const Keyframe& Player::getCurrentKeyframe() const {
+  return binaryReader_ ? binaryReader_->getCurrentKeyframe()
+                       : keyframes_[frameIndex_];
+}
+
+const Keyframe& Player::peekNextKeyframe() {
+  if (!binaryReader_) {
+    return keyframes_[frameIndex_ + 1];
+  }
+  ASSERT(binaryReader_->getNextKeyframeIndex() == frameIndex_ + 1);
+  return binaryReader_->peekNextKeyframe();
+}
+
+void Player::restoreInterpolatedInstances() {
+  for (const auto& pair : interpolatedInstances_) {
+    pair.first->setTranslation(pair.second.translation);
+    pair.first->setRotation(pair.second.rotation);
+  }
+  // keeps the capacity, so interpolating every frame doesn't allocate
+  interpolatedInstances_.clear();
+  nextKeyframe_ = nullptr;
+}
+
 void Player::applyKeyframe(const Keyframe& keyframe) {
   for (const auto& assetInfo : keyframe.loads) {
     ASSERT(assetInfos_.count(assetInfo.filepath) == 0);
@@ -109,33 +354,72 @@ void Player::applyKeyframe(const Keyframe& keyframe) {
   }
 
   for (const auto& pair : keyframe.creations) {
-    const auto& creation = pair.second;
-    if (!assetInfos_.count(creation.filepath)) {
-      if (!failedFilepaths_.count(creation.filepath)) {
-        LOG(WARNING) << "Player: missing asset info for [" << creation.filepath
-                     << "]";
-        failedFilepaths_.insert(creation.filepath);
+    const auto& instanceKey = pair.first;
+    if (physicsCallbacks_.createObject) {
+      const int objectID = tryCreatePhysicsObject(pair.second);
+      if (objectID != ID_UNDEFINED) {
+        ASSERT(physicsInstances_.count(instanceKey) == 0);
+        physicsInstances_[instanceKey] = PhysicsInstance{objectID, {}};
       }
+    }
+    if (!loadAndCreateRenderAssetInstanceCallback) {
       continue;
     }
-    ASSERT(assetInfos_.count(creation.filepath));
-    auto node = loadAndCreateRenderAssetInstanceCallback(
-        assetInfos_[creation.filepath], creation);
+    auto node = tryLoadAndCreateRenderAssetInstance(pair.second);
     if (!node) {
-      if (!failedFilepaths_.count(creation.filepath)) {
-        LOG(WARNING) << "Player: load failed for asset [" << creation.filepath
-                     << "]";
-        failedFilepaths_.insert(creation.filepath);
-      }
       continue;
     }
 
-    const auto& instanceKey = pair.first;
     ASSERT(createdInstances_.count(instanceKey) == 0);
     createdInstances_[instanceKey] = node;
   }
 
+  for (const auto& pair : keyframe.renderAssetChanges) {
+    const auto& physicsIt = physicsInstances_.find(pair.first);
+    if (physicsIt == physicsInstances_.end()) {
+      continue;
+    }
+    const int objectID = tryCreatePhysicsObject(pair.second);
+    if (objectID == ID_UNDEFINED) {
+      // keep the old object
+      continue;
+    }
+    // the new object takes over the state of the old one
+    physicsCallbacks_.removeObject(physicsIt->second.objectID);
+    physicsIt->second.objectID = objectID;
+    setPhysicsInstanceState(pair.first, physicsIt->second.state);
+  }
+
+  for (const auto& pair : keyframe.renderAssetChanges) {
+    const auto& it = createdInstances_.find(pair.first);
+    if (it == createdInstances_.end()) {
+      // missing instance for this key, probably due to a failed instance
+      // creation
+      continue;
+    }
+    const auto& creation = pair.second;
+    auto node = tryLoadAndCreateRenderAssetInstance(creation);
+    if (!node) {
+      // keep showing the old asset
+      continue;
+    }
+
+    // the new instance takes over the pose and semantic id of the old one
+    auto oldNode = it->second;
+    node->setTranslation(oldNode->translation());
+    node->setRotation(oldNode->rotation());
+    setSemanticIdForSubtree(node, oldNode->getSemanticId());
+    delete oldNode;
+    it->second = node;
+  }
+
   for (const auto& deletionInstanceKey : keyframe.deletions) {
+    const auto& physicsIt = physicsInstances_.find(deletionInstanceKey);
+    if (physicsIt != physicsInstances_.end()) {
+      physicsCallbacks_.removeObject(physicsIt->second.objectID);
+      physicsInstances_.erase(physicsIt);
+    }
+
     const auto& it = createdInstances_.find(deletionInstanceKey);
     if (it == createdInstances_.end()) {
       // missing instance for this key, probably due to a failed instance
@@ -149,6 +433,11 @@ void Player::applyKeyframe(const Keyframe& keyframe) {
   }
 
   for (const auto& pair : keyframe.stateUpdates) {
+    const auto& transform = pair.second.absTransform;
+    setPhysicsInstanceState(
+        pair.first,
+        esp::core::RigidState{transform.rotation, transform.translation});
+
     const auto& it = createdInstances_.find(pair.first);
     if (it == createdInstances_.end()) {
       // missing instance for this key, probably due to a failed instance
@@ -163,6 +452,135 @@ void Player::applyKeyframe(const Keyframe& keyframe) {
   }
 }
 
+const esp::assets::AssetInfo* Player::findAssetInfo(
+    const esp::assets::RenderAssetInstanceCreationInfo& creation) {
+  const auto& it = assetInfos_.find(creation.filepath);
+  if (it == assetInfos_.end()) {
+    if (!failedFilepaths_.count(creation.filepath)) {
+      LOG(WARNING) << "Player: missing asset info for [" << creation.filepath
+                   << "]";
+      failedFilepaths_.insert(creation.filepath);
+    }
+    return nullptr;
+  }
+  return &it->second;
+}
+
+esp::scene::SceneNode* Player::tryLoadAndCreateRenderAssetInstance(
+    const esp::assets::RenderAssetInstanceCreationInfo& creation) {
+  const auto* assetInfoPtr = findAssetInfo(creation);
+  if (!assetInfoPtr) {
+    return nullptr;
+  }
+  const auto& assetInfo = *assetInfoPtr;
+  if (prefetchCallback_ &&
+      instancedFilepaths_.insert(creation.filepath).second) {
+    // a hit if the asset doesn't need to be waited for
+    if (prefetchCallback_(assetInfo)) {
+      ++prefetchStats_.hits;
+    } else {
+      ++prefetchStats_.misses;
+    }
+  }
+  auto node = loadAndCreateRenderAssetInstanceCallback(assetInfo, creation);
+  if (!node) {
+    if (!failedFilepaths_.count(creation.filepath)) {
+      LOG(WARNING) << "Player: load failed for asset [" << creation.filepath
+                   << "]";
+      failedFilepaths_.insert(creation.filepath);
+    }
+  }
+  return node;
+}
+
+int Player::tryCreatePhysicsObject(
+    const esp::assets::RenderAssetInstanceCreationInfo& creation) {
+  const auto* assetInfo = findAssetInfo(creation);
+  if (!assetInfo) {
+    return ID_UNDEFINED;
+  }
+  // the callback logs why an instance doesn't get an object, if it matters
+  return physicsCallbacks_.createObject(*assetInfo, creation);
+}
+
+void Player::setPhysicsInstanceState(RenderAssetInstanceKey instanceKey,
+                                     const esp::core::RigidState& state) {
+  const auto& it = physicsInstances_.find(instanceKey);
+  if (it == physicsInstances_.end()) {
+    return;
+  }
+  auto& instance = it->second;
+  instance.state = state;
+  if (!instance.isDirty) {
+    instance.isDirty = true;
+    dirtyPhysicsInstances_.push_back(instanceKey);
+  }
+}
+
+void Player::interpolatePhysicsInstances(const Keyframe& nextKeyframe,
+                                         float factor) {
+  for (const auto& pair : nextKeyframe.stateUpdates) {
+    const auto& it = physicsInstances_.find(pair.first);
+    if (it == physicsInstances_.end()) {
+      continue;
+    }
+    auto& instance = it->second;
+    const auto& target = pair.second.absTransform;
+    pendingPhysicsStates_.emplace_back(
+        instance.objectID,
+        esp::core::RigidState{
+            Magnum::Math::slerpShortestPath(instance.state.rotation,
+                                            target.rotation, factor),
+            Magnum::Math::lerp(instance.state.translation, target.translation,
+                               factor)});
+    // the next flushPhysicsStates sets the keyframe state again
+    if (!instance.isDirty) {
+      instance.isDirty = true;
+      dirtyPhysicsInstances_.push_back(it->first);
+    }
+  }
+  setPendingPhysicsStates();
+}
+
+void Player::flushPhysicsStates() {
+  for (const auto& instanceKey : dirtyPhysicsInstances_) {
+    const auto& it = physicsInstances_.find(instanceKey);
+    // the instance may have been deleted, or listed twice if it was deleted
+    // and created again
+    if (it == physicsInstances_.end() || !it->second.isDirty) {
+      continue;
+    }
+    it->second.isDirty = false;
+    pendingPhysicsStates_.emplace_back(it->second.objectID, it->second.state);
+  }
+  dirtyPhysicsInstances_.clear();
+  setPendingPhysicsStates();
+}
+
+void Player::setPendingPhysicsStates() {
+  if (pendingPhysicsStates_.empty()) {
+    return;
+  }
+  // PhysicsManager::setRigidStates looks up ascending IDs fastest
+  std::sort(pendingPhysicsStates_.begin(), pendingPhysicsStates_.end(),
+            [](const std::pair<int, esp::core::RigidState>& a,
+               const std::pair<int, esp::core::RigidState>& b) {
+              return a.first < b.first;
+            });
+  physicsObjectIDs_.clear();
+  physicsStates_.clear();
+  for (const auto& pair : pendingPhysicsStates_) {
+    physicsObjectIDs_.push_back(pair.first);
+    physicsStates_.push_back(pair.second);
+  }
+  pendingPhysicsStates_.clear();
+  physicsCallbacks_.setRigidStates(
+      Corrade::Containers::arrayView(physicsObjectIDs_.data(),
+                                     physicsObjectIDs_.size()),
+      Corrade::Containers::arrayView(physicsStates_.data(),
+                                     physicsStates_.size()));
+}
+
 void Player::setSemanticIdForSubtree(esp::scene::SceneNode* rootNode,
                                      int semanticId) {
   if (rootNode->getSemanticId() == semanticId) {
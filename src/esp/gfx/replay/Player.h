@@ -9,10 +9,16 @@
 
 #include "esp/assets/Asset.h"
 #include "esp/assets/RenderAssetInstanceCreationInfo.h"
+#include "esp/core/RigidState.h"
 
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Containers/ArrayView.h>
+#include <Corrade/Utility/Directory.h>
 #include <rapidjson/document.h>
 
+#include <functional>
 #include <map>
+#include <memory>
 #include <set>
 #include <string>
 #include <vector>
@@ -24,6 +30,8 @@ class SceneNode;
 namespace gfx {
 namespace replay {
 
+class BinaryKeyframeReader;
+
 /**
  * @brief Playback for "render replay".
  *
@@ -45,9 +53,49 @@ class Player {
           const esp::assets::AssetInfo&,
           const esp::assets::RenderAssetInstanceCreationInfo&)>;
 
+  /**
+   * @brief A function to start reading the file of a render asset in the
+   * background. Returns whether the asset can be instanced without waiting
+   * for its file to be read.
+   */
+  using PrefetchRenderAssetCallback =
+      std::function<bool(const esp::assets::AssetInfo&)>;
+
+  /**
+   * @brief Counts of assets whose files were or weren't read by the time
+   * they were first instanced.
+   * See @ref setPrefetchCallback.
+   */
+  struct PrefetchStats {
+    int hits = 0;
+    int misses = 0;
+  };
+
+  /**
+   * @brief Functions to drive physics objects from keyframes. See
+   * @ref setPhysicsCallbacks.
+   */
+  struct PhysicsCallbacks {
+    //! Create a physics object for a render asset instance and return its
+    //! ID, or return @ref esp::ID_UNDEFINED to not drive an object for it
+    std::function<int(const esp::assets::AssetInfo&,
+                      const esp::assets::RenderAssetInstanceCreationInfo&)>
+        createObject;
+    //! Remove an object returned by createObject
+    std::function<void(int objectID)> removeObject;
+    //! Set the states of many objects kinematically, e.g.
+    //! @ref esp::physics::PhysicsManager::setRigidStates
+    std::function<void(
+        Corrade::Containers::ArrayView<const int> objectIDs,
+        Corrade::Containers::ArrayView<const esp::core::RigidState> states)>
+        setRigidStates;
+  };
+
   /**
    * @brief Construct a Player.
    * @param callback A function to load and create a render asset instance.
+   * May be null if the Player only drives physics objects, see
+   * @ref setPhysicsCallbacks.
    */
   explicit Player(const LoadAndCreateRenderAssetInstanceCallback& callback);
 
@@ -55,7 +103,14 @@ class Player {
 
   /**
    * @brief Read keyframes. See also @ref Recorder::writeSavedKeyframesToFile.
-   * After calling this, use @ref setKeyframeIndex to set a keyframe.
+   * Binary and JSON files are both supported; the format is detected from the
+   * file contents. After calling this, use @ref setKeyframeIndex to set a
+   * keyframe.
+   *
+   * A complete binary replay is memory-mapped and its keyframes are decoded
+   * lazily as they are applied, so reading it takes constant time and only
+   * the mapped pages in use stay resident. JSON replays and binary replays
+   * that are still being written are decoded upfront.
    * @param filepath
    */
   void readKeyframesFromFile(const std::string& filepath);
@@ -73,12 +128,86 @@ class Player {
   /**
    * @brief Set a keyframe by index, or pass -1 to clear the currently-set
    * keyframe.
+   *
+   * Keyframes are applied incrementally from the currently-set keyframe, or
+   * from the closest earlier checkpoint (see
+   * @ref Recorder::setCheckpointInterval) if that's closer, so seeking costs
+   * at most one checkpoint interval of keyframes.
    */
   void setKeyframeIndex(int frameIndex);
 
+  /**
+   * @brief Set the scene to a time between keyframes, e.g. to render a replay
+   * at a higher frame rate than it was recorded at.
+   *
+   * Keyframe floor(@p time) is set, then each instance with a state update
+   * in the next keyframe is moved towards it, with translations interpolated
+   * linearly and rotations spherically. User transforms are interpolated the
+   * same way. Other instances stay as they are in keyframe floor(@p time).
+   * @param time Keyframe time, from 0 to the index of the last keyframe
+   */
+  void setKeyframeTime(float time);
+
+  /**
+   * @brief Start reading the asset files of upcoming keyframes in the
+   * background, so applying a keyframe doesn't stall on disk I/O. Assets are
+   * still imported and uploaded when the keyframe is applied. Each call to
+   * @ref setKeyframeIndex passes the assets loaded in the keyframes up to
+   * @p numKeyframesAhead keyframes after the set keyframe to @p callback.
+   * Pass a null callback to disable prefetching.
+   * @param callback
+   * @param numKeyframesAhead
+   */
+  void setPrefetchCallback(const PrefetchRenderAssetCallback& callback,
+                           int numKeyframesAhead);
+
+  /**
+   * @brief Pass the not yet prefetched assets loaded in keyframes up to
+   * @p numKeyframesAhead keyframes (see @ref setPrefetchCallback) after
+   * @p frameIndex to the prefetch callback. Called by @ref setKeyframeIndex;
+   * call it to start prefetching before setting a keyframe. Seeking past a
+   * checkpoint takes the loads of earlier keyframes from the checkpoint
+   * instead of scanning them.
+   */
+  void prefetchAssets(int frameIndex);
+
+  /**
+   * @brief Drive physics objects from keyframes, e.g. to evaluate raycasts or
+   * contact tests at recorded poses without simulating dynamics.
+   *
+   * Each created render asset instance gets a physics object from
+   * @p callbacks, which is removed along with the instance. The states of all
+   * objects whose instance moved are set with one
+   * @ref PhysicsCallbacks::setRigidStates call at the end of
+   * @ref setKeyframeIndex, however many keyframes it applies, and
+   * @ref setKeyframeTime sets interpolated states the same way. Must be
+   * called before a keyframe is set.
+   */
+  void setPhysicsCallbacks(const PhysicsCallbacks& callbacks);
+
+  /**
+   * @brief Stop driving physics objects and forget the ones created so far
+   * without removing them. Call it before the physics world the objects
+   * belong to or the owner of the callbacks goes away; the Player keeps
+   * playing without physics afterwards.
+   */
+  void detachPhysics();
+
+  /**
+   * @brief Get the IDs of the physics objects driven by the set keyframe,
+   * in the order of their instances' creation. See @ref setPhysicsCallbacks.
+   */
+  std::vector<int> getPhysicsObjectIDs() const;
+
+  /**
+   * @brief Get the prefetch hits and misses since the keyframes were read.
+   */
+  const PrefetchStats& getPrefetchStats() const { return prefetchStats_; }
+
   /**
    * @brief Get a user transform. See @ref Recorder::addUserTransformToKeyframe
-   * for usage tips.
+   * for usage tips. After @ref setKeyframeTime, the transform is
+   * interpolated if the next keyframe has it too.
    */
   bool getUserTransform(const std::string& name,
                         Magnum::Vector3* translation,
@@ -96,10 +225,37 @@ class Player {
     keyframes_ = std::move(keyframes);
   }
 
+  /**
+   * @brief Reserved for unit-testing.
+   */
+  void debugSetCheckpoints(std::vector<Checkpoint>&& checkpoints) {
+    checkpoints_ = std::move(checkpoints);
+  }
+
  private:
   void readKeyframesFromJsonDocument(const rapidjson::Document& d);
   void clearFrame();
+  int getNumCheckpoints() const;
+  int getCheckpointKeyframeIndex(int checkpoint) const;
+  int findCheckpoint(int frameIndex) const;
+  void applyCheckpoint(int checkpoint);
+  void applyNextKeyframe();
+  const Keyframe& getCurrentKeyframe() const;
+  const Keyframe& peekNextKeyframe();
+  void restoreInterpolatedInstances();
   void applyKeyframe(const Keyframe& keyframe);
+  const esp::assets::AssetInfo* findAssetInfo(
+      const esp::assets::RenderAssetInstanceCreationInfo& creation);
+  esp::scene::SceneNode* tryLoadAndCreateRenderAssetInstance(
+      const esp::assets::RenderAssetInstanceCreationInfo& creation);
+  int tryCreatePhysicsObject(
+      const esp::assets::RenderAssetInstanceCreationInfo& creation);
+  void setPhysicsInstanceState(RenderAssetInstanceKey instanceKey,
+                               const esp::core::RigidState& state);
+  void interpolatePhysicsInstances(const Keyframe& nextKeyframe,
+                                   float factor);
+  void flushPhysicsStates();
+  void setPendingPhysicsStates();
   static void setSemanticIdForSubtree(esp::scene::SceneNode* rootNode,
                                       int semanticId);
 
@@ -107,10 +263,49 @@ class Player {
       loadAndCreateRenderAssetInstanceCallback;
   int frameIndex_ = -1;
   std::vector<Keyframe> keyframes_;
+  // sorted by keyframe index
+  std::vector<Checkpoint> checkpoints_;
+  // set instead of keyframes_ and checkpoints_ if keyframes are decoded
+  // lazily from mappedFile_
+  Corrade::Containers::Array<const char,
+                             Corrade::Utility::Directory::MapDeleter>
+      mappedFile_;
+  std::unique_ptr<BinaryKeyframeReader> binaryReader_;
+  // decodes the keyframes ahead of binaryReader_ for prefetching
+  std::unique_ptr<BinaryKeyframeReader> prefetchReader_;
   std::map<std::string, esp::assets::AssetInfo> assetInfos_;
   std::map<RenderAssetInstanceKey, scene::SceneNode*> createdInstances_;
+  // set by setKeyframeTime: the keyframe interpolated towards, how far, and
+  // the keyframe poses of the interpolated instances
+  const Keyframe* nextKeyframe_ = nullptr;
+  float interpolationFactor_ = 0.0f;
+  std::vector<std::pair<scene::SceneNode*, Transform>> interpolatedInstances_;
   std::set<std::string> failedFilepaths_;
 
+  struct PhysicsInstance {
+    int objectID;
+    // as of the last applied keyframe
+    esp::core::RigidState state;
+    // whether the object needs state, see flushPhysicsStates
+    bool isDirty = false;
+  };
+  PhysicsCallbacks physicsCallbacks_;
+  std::map<RenderAssetInstanceKey, PhysicsInstance> physicsInstances_;
+  std::vector<RenderAssetInstanceKey> dirtyPhysicsInstances_;
+  // reused for each setRigidStates call, so playback doesn't allocate
+  std::vector<std::pair<int, esp::core::RigidState>> pendingPhysicsStates_;
+  std::vector<int> physicsObjectIDs_;
+  std::vector<esp::core::RigidState> physicsStates_;
+
+  PrefetchRenderAssetCallback prefetchCallback_;
+  int prefetchKeyframesAhead_ = 0;
+  // keyframes up to this one had their loads prefetched
+  int lastPrefetchedFrameIndex_ = -1;
+  std::set<std::string> prefetchedFilepaths_;
+  // assets which were counted in prefetchStats_
+  std::set<std::string> instancedFilepaths_;
+  PrefetchStats prefetchStats_;
+
   ESP_SMART_POINTERS(Player)
 };
 
@@ -4,18 +4,21 @@
 
 #include "Recorder.h"
 
+#include "ReplayFile.h"
 #include "esp/assets/RenderAssetInstanceCreationInfo.h"
 #include "esp/io/JsonAllTypes.h"
 #include "esp/io/json.h"
 #include "esp/scene/SceneNode.h"
 
+#include <algorithm>
+
 namespace esp {
 namespace gfx {
 namespace replay {
 
 /**
  * @brief Helper class to get notified when a SceneNode is about to be
- * destroyed.
+ * destroyed, or when its state may have changed.
  */
 class NodeDeletionHelper : public Magnum::SceneGraph::AbstractFeature3D {
  public:
@@ -25,15 +28,46 @@ class NodeDeletionHelper : public Magnum::SceneGraph::AbstractFeature3D {
         recorder_(writer) {}
 
   ~NodeDeletionHelper() override {
-    recorder_->onDeleteRenderAssetInstance(node);
+    if (recorder_) {
+      recorder_->onDeleteRenderAssetInstance(node);
+    }
   }
 
+  /**
+   * @brief Stop notifying the recorder, e.g. because the instance was handed
+   * over to another node.
+   */
+  void detach() { recorder_ = nullptr; }
+
+  /**
+   * @brief Called by the scene graph when the node goes from clean to dirty,
+   * i.e. when the transformation of the node or one of its ancestors, or the
+   * node's semanticId, changes. The recorder cleans the node when it captures
+   * its state, so each later change is reported again.
+   */
+  void markDirty() override {
+    if (!isDirty_) {
+      isDirty_ = true;
+      if (recorder_) {
+        recorder_->onInstanceDirty(node);
+      }
+    }
+  }
+
+  bool isDirty() const { return isDirty_; }
+
+  void clearDirty() { isDirty_ = false; }
+
  private:
   Recorder* recorder_ = nullptr;
   const scene::SceneNode* node = nullptr;
+  // new instances start out dirty, so their first state gets captured
+  bool isDirty_ = true;
 };
 
 Recorder::~Recorder() {
+  stopStreaming();
+
   // Delete NodeDeletionHelpers. This is important because they hold raw
   // pointers to this Recorder and these pointers would become dangling
   // (invalid) after this Recorder is destroyed.
@@ -61,13 +95,91 @@ void Recorder::onCreateRenderAssetInstance(
   // manually later if necessary.
   NodeDeletionHelper* deletionHelper = new NodeDeletionHelper{*node, this};
 
+  instanceIndexByNode_[node] = instanceRecords_.size();
   instanceRecords_.emplace_back(InstanceRecord{
       node, instanceKey, Corrade::Containers::NullOpt, deletionHelper});
+  dirtyInstanceNodes_.push_back(node);
+}
+
+void Recorder::onChangeRenderAssetInstance(
+    const scene::SceneNode* oldNode,
+    scene::SceneNode* newNode,
+    const esp::assets::RenderAssetInstanceCreationInfo& creation) {
+  ASSERT(newNode);
+  ASSERT(findInstance(newNode) == ID_UNDEFINED);
+  int index = findInstance(oldNode);
+  ASSERT(index != ID_UNDEFINED);
+  auto& instanceRecord = instanceRecords_[index];
+
+  checkAndAddRenderAssetChange(&getKeyframe(), instanceRecord.instanceKey,
+                               creation);
+
+  // move the record over to the new node; the old node may be deleted later
+  // without registering a deletion
+  instanceRecord.deletionHelper->detach();
+  delete instanceRecord.deletionHelper;
+  instanceRecord.node = newNode;
+  instanceRecord.deletionHelper = new NodeDeletionHelper{*newNode, this};
+  instanceIndexByNode_.erase(oldNode);
+  instanceIndexByNode_[newNode] = index;
+  dirtyInstanceNodes_.push_back(newNode);
 }
 
 void Recorder::saveKeyframe() {
   updateInstanceStates();
   advanceKeyframe();
+  // the first keyframe of a file is a checkpoint already
+  const int keyframeIndex = numKeyframesSinceWrite_ - 1;
+  if (checkpointInterval_ > 0 && keyframeIndex > 0 &&
+      keyframeIndex % checkpointInterval_ == 0) {
+    saveCheckpoint();
+  }
+  if (streamWriter_ &&
+      savedKeyframes_.size() >= std::size_t(streamKeyframesPerChunk_)) {
+    streamSavedKeyframes();
+  }
+}
+
+void Recorder::startStreamingToFile(const std::string& filepath,
+                                    int keyframesPerChunk,
+                                    int maxPendingChunks) {
+  CORRADE_ASSERT(keyframesPerChunk > 0,
+                 "Recorder::startStreamingToFile: keyframesPerChunk must be "
+                 "positive", );
+  stopStreaming();
+  auto writer =
+      KeyframeStreamWriter::create_unique(filepath, maxPendingChunks);
+  if (!writer->isOpen()) {
+    return;
+  }
+  streamWriter_ = std::move(writer);
+  streamKeyframesPerChunk_ = keyframesPerChunk;
+  if (savedKeyframes_.size() >= std::size_t(streamKeyframesPerChunk_)) {
+    streamSavedKeyframes();
+  }
+}
+
+void Recorder::stopStreaming() {
+  if (!streamWriter_) {
+    return;
+  }
+  streamSavedKeyframes();
+  // destroying the writer writes all pending chunks
+  streamWriter_ = nullptr;
+
+  // like after writeSavedKeyframesToFile, the next file should start with
+  // everything that exists at this point
+  consolidateSavedKeyframes();
+}
+
+void Recorder::streamSavedKeyframes() {
+  if (savedKeyframes_.empty()) {
+    return;
+  }
+  streamWriter_->pushChunk(std::move(savedKeyframes_),
+                           std::move(savedCheckpoints_));
+  savedKeyframes_.clear();
+  savedCheckpoints_.clear();
 }
 
 void Recorder::addUserTransformToKeyframe(const std::string& name,
@@ -76,20 +188,68 @@ void Recorder::addUserTransformToKeyframe(const std::string& name,
   getKeyframe().userTransforms[name] = Transform{translation, rotation};
 }
 
-void Recorder::addLoadsCreationsDeletions(KeyframeIterator begin,
-                                          KeyframeIterator end,
+void Recorder::setCheckpointInterval(int interval) {
+  CORRADE_ASSERT(interval >= 0,
+                 "Recorder::setCheckpointInterval: interval must not be "
+                 "negative", );
+  checkpointInterval_ = interval;
+}
+
+void Recorder::addLoadsCreationsDeletions(const Keyframe& keyframe,
                                           Keyframe* dest) {
   ASSERT(dest);
-  for (KeyframeIterator curr = begin; curr != end; curr++) {
-    const auto& keyframe = *curr;
-    dest->loads.insert(dest->loads.end(), keyframe.loads.begin(),
-                       keyframe.loads.end());
-    dest->creations.insert(dest->creations.end(), keyframe.creations.begin(),
-                           keyframe.creations.end());
-    for (const auto& deletionInstanceKey : keyframe.deletions) {
-      checkAndAddDeletion(dest, deletionInstanceKey);
+  dest->loads.insert(dest->loads.end(), keyframe.loads.begin(),
+                     keyframe.loads.end());
+  dest->creations.insert(dest->creations.end(), keyframe.creations.begin(),
+                         keyframe.creations.end());
+  for (const auto& pair : keyframe.renderAssetChanges) {
+    checkAndAddRenderAssetChange(dest, pair.first, pair.second);
+  }
+  for (const auto& deletionInstanceKey : keyframe.deletions) {
+    checkAndAddDeletion(dest, deletionInstanceKey);
+  }
+}
+
+void Recorder::saveCheckpoint() {
+  // the summary holds the loads and creations needed for all current
+  // instances, and their states are up to date after updateInstanceStates
+  Checkpoint checkpoint;
+  checkpoint.keyframeIndex = numKeyframesSinceWrite_ - 1;
+  Keyframe& state = checkpoint.state;
+  state.loads = savedKeyframesSummary_.loads;
+  state.creations = savedKeyframesSummary_.creations;
+  state.stateUpdates.reserve(instanceRecords_.size());
+  for (const auto& instanceRecord : instanceRecords_) {
+    if (instanceRecord.recentState) {
+      state.stateUpdates.emplace_back(instanceRecord.instanceKey,
+                                      *instanceRecord.recentState);
     }
   }
+  state.userTransforms = savedKeyframes_.back().userTransforms;
+  savedCheckpoints_.emplace_back(std::move(checkpoint));
+}
+
+void Recorder::checkAndAddRenderAssetChange(
+    Keyframe* keyframe,
+    RenderAssetInstanceKey instanceKey,
+    const esp::assets::RenderAssetInstanceCreationInfo& creation) {
+  auto findKey = [&](const auto& pair) { return pair.first == instanceKey; };
+  auto creationIt = std::find_if(keyframe->creations.begin(),
+                                 keyframe->creations.end(), findKey);
+  if (creationIt != keyframe->creations.end()) {
+    // the instance is created in this keyframe, so create it as the new asset
+    creationIt->second = creation;
+    return;
+  }
+  auto changeIt =
+      std::find_if(keyframe->renderAssetChanges.begin(),
+                   keyframe->renderAssetChanges.end(), findKey);
+  if (changeIt != keyframe->renderAssetChanges.end()) {
+    // only the latest change matters
+    changeIt->second = creation;
+  } else {
+    keyframe->renderAssetChanges.emplace_back(instanceKey, creation);
+  }
 }
 
 void Recorder::checkAndAddDeletion(Keyframe* keyframe,
@@ -97,6 +257,14 @@ void Recorder::checkAndAddDeletion(Keyframe* keyframe,
   auto it =
       std::find_if(keyframe->creations.begin(), keyframe->creations.end(),
                    [&](const auto& pair) { return pair.first == instanceKey; });
+  // a pending render asset change of a deleted instance is moot
+  keyframe->renderAssetChanges.erase(
+      std::remove_if(
+          keyframe->renderAssetChanges.begin(),
+          keyframe->renderAssetChanges.end(),
+          [&](const auto& pair) { return pair.first == instanceKey; }),
+      keyframe->renderAssetChanges.end());
+
   if (it != keyframe->creations.end()) {
     // this deletion just cancels out with an earlier creation
     keyframe->creations.erase(it);
@@ -115,7 +283,17 @@ void Recorder::onDeleteRenderAssetInstance(const scene::SceneNode* node) {
 
   checkAndAddDeletion(&getKeyframe(), instanceKey);
 
-  instanceRecords_.erase(instanceRecords_.begin() + index);
+  // swap with the last record, so only one index changes
+  instanceIndexByNode_.erase(node);
+  if (index != int(instanceRecords_.size()) - 1) {
+    instanceRecords_[index] = std::move(instanceRecords_.back());
+    instanceIndexByNode_[instanceRecords_[index].node] = index;
+  }
+  instanceRecords_.pop_back();
+}
+
+void Recorder::onInstanceDirty(const scene::SceneNode* node) {
+  dirtyInstanceNodes_.push_back(node);
 }
 
 Keyframe& Recorder::getKeyframe() {
@@ -127,18 +305,13 @@ RenderAssetInstanceKey Recorder::getNewInstanceKey() {
 }
 
 int Recorder::findInstance(const scene::SceneNode* queryNode) {
-  auto it = std::find_if(instanceRecords_.begin(), instanceRecords_.end(),
-                         [&queryNode](const InstanceRecord& record) {
-                           return record.node == queryNode;
-                         });
-
-  return it == instanceRecords_.end() ? ID_UNDEFINED
-                                      : int(it - instanceRecords_.begin());
+  auto it = instanceIndexByNode_.find(queryNode);
+  return it == instanceIndexByNode_.end() ? ID_UNDEFINED : it->second;
 }
 
-RenderAssetInstanceState Recorder::getInstanceState(
-    const scene::SceneNode* node) {
-  const auto absTransformMat = node->absoluteTransformation();
+RenderAssetInstanceState Recorder::getInstanceState(scene::SceneNode* node) {
+  // cleaning the node makes the scene graph report its next change
+  const auto& absTransformMat = node->cleanAbsoluteTransformation();
   Transform absTransform{
       absTransformMat.translation(),
       Magnum::Quaternion::fromMatrix(absTransformMat.rotationShear())};
@@ -147,7 +320,21 @@ RenderAssetInstanceState Recorder::getInstanceState(
 }
 
 void Recorder::updateInstanceStates() {
-  for (auto& instanceRecord : instanceRecords_) {
+  // only instances which were marked dirty since the last keyframe can have
+  // changed
+  for (const auto* dirtyNode : dirtyInstanceNodes_) {
+    int index = findInstance(dirtyNode);
+    if (index == ID_UNDEFINED) {
+      // deleted after it was marked dirty
+      continue;
+    }
+    auto& instanceRecord = instanceRecords_[index];
+    if (!instanceRecord.deletionHelper->isDirty()) {
+      // already handled, e.g. a node was deleted and another one created at
+      // the same address
+      continue;
+    }
+    instanceRecord.deletionHelper->clearDirty();
     auto state = getInstanceState(instanceRecord.node);
     if (!instanceRecord.recentState || state != instanceRecord.recentState) {
       getKeyframe().stateUpdates.push_back(
@@ -155,21 +342,39 @@ void Recorder::updateInstanceStates() {
       instanceRecord.recentState = state;
     }
   }
+  dirtyInstanceNodes_.clear();
 }
 
 void Recorder::advanceKeyframe() {
+  addLoadsCreationsDeletions(currKeyframe_, &savedKeyframesSummary_);
+  ++numKeyframesSinceWrite_;
   savedKeyframes_.emplace_back(std::move(currKeyframe_));
   currKeyframe_ = Keyframe{};
 }
 
 void Recorder::writeSavedKeyframesToFile(const std::string& filepath) {
-  auto document = writeKeyframesToJsonDocument();
-  esp::io::writeJsonToFile(document, filepath);
+  if (streamWriter_) {
+    LOG(ERROR) << "Recorder::writeSavedKeyframesToFile: keyframes are being "
+                  "streamed to "
+               << streamWriter_->getFilepath() << ", ignoring " << filepath;
+    return;
+  }
+  if (savedKeyframes_.empty()) {
+    LOG(WARNING) << "Recorder::writeSavedKeyframesToFile: no saved keyframes "
+                    "to write";
+  }
+  writeKeyframesToFile(filepath, savedKeyframes_, savedCheckpoints_);
 
   consolidateSavedKeyframes();
 }
 
 std::string Recorder::writeSavedKeyframesToString() {
+  if (streamWriter_) {
+    LOG(ERROR) << "Recorder::writeSavedKeyframesToString: keyframes are "
+                  "being streamed to "
+               << streamWriter_->getFilepath();
+    return "";
+  }
   auto document = writeKeyframesToJsonDocument();
 
   consolidateSavedKeyframes();
@@ -179,14 +384,17 @@ std::string Recorder::writeSavedKeyframesToString() {
 
 void Recorder::consolidateSavedKeyframes() {
   // consolidate saved keyframes into current keyframe
-  addLoadsCreationsDeletions(savedKeyframes_.begin(), savedKeyframes_.end(),
-                             &getKeyframe());
+  addLoadsCreationsDeletions(savedKeyframesSummary_, &getKeyframe());
+  savedKeyframesSummary_ = Keyframe{};
+  numKeyframesSinceWrite_ = 0;
   // clear instanceRecord.recentState to ensure updates get included in the next
   // saved keyframe.
   for (auto& instanceRecord : instanceRecords_) {
     instanceRecord.recentState = Corrade::Containers::NullOpt;
+    instanceRecord.deletionHelper->markDirty();
   }
   savedKeyframes_.clear();
+  savedCheckpoints_.clear();
 }
 
 rapidjson::Document Recorder::writeKeyframesToJsonDocument() {
@@ -196,10 +404,7 @@ rapidjson::Document Recorder::writeKeyframesToJsonDocument() {
     return rapidjson::Document();
   }
 
-  rapidjson::Document d(rapidjson::kObjectType);
-  rapidjson::Document::AllocatorType& allocator = d.GetAllocator();
-  esp::io::addMember(d, "keyframes", savedKeyframes_, allocator);
-  return d;
+  return keyframesToJsonDocument(savedKeyframes_, savedCheckpoints_);
 }
 
 }  // namespace replay
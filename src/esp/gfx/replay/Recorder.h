@@ -6,10 +6,13 @@
 #define ESP_GFX_REPLAY_RECORDER_H_
 
 #include "Keyframe.h"
+#include "KeyframeStreamWriter.h"
 
 #include <rapidjson/document.h>
 
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace esp {
 namespace assets {
@@ -54,6 +57,21 @@ class Recorder {
       scene::SceneNode* node,
       const esp::assets::RenderAssetInstanceCreationInfo& creation);
 
+  /**
+   * @brief User code should call this when a tracked render asset instance is
+   * replaced by an instance of another render asset which takes over its
+   * role, e.g. an object switching to another visual variant. The instance
+   * keeps its key and the change is recorded as such, instead of as a
+   * deletion and a creation. Call this before deleting @p oldNode.
+   * @param oldNode The root node of the tracked instance being replaced
+   * @param newNode The root node of the replacement instance
+   * @param creation How the replacement instance was created.
+   */
+  void onChangeRenderAssetInstance(
+      const scene::SceneNode* oldNode,
+      scene::SceneNode* newNode,
+      const esp::assets::RenderAssetInstanceCreationInfo& creation);
+
   /**
    * @brief User code should call this upon loading a render asset to inform
    * Recorder about the asset.
@@ -89,12 +107,55 @@ class Recorder {
                                   const Magnum::Vector3& translation,
                                   const Magnum::Quaternion& rotation);
 
+  /**
+   * @brief Save a @ref Checkpoint every @p interval keyframes, so a player
+   * can seek to a keyframe by applying the closest earlier checkpoint and the
+   * keyframes after it, instead of all keyframes from the start. Checkpoints
+   * are written along with the keyframes. Pass 0 to disable checkpoints (the
+   * default).
+   * @param interval
+   */
+  void setCheckpointInterval(int interval);
+
   /**
    * @brief write saved keyframes to file.
+   *
+   * Keyframes are written in the compact binary format (see
+   * BinaryFormat.h) if @p filepath ends with ".bin", and as JSON otherwise.
+   * JSON is larger and slower to read but handy for debugging.
    * @param filepath
    */
   void writeSavedKeyframesToFile(const std::string& filepath);
 
+  /**
+   * @brief Stream keyframes to a binary replay file as they are saved,
+   * instead of keeping them in memory until writeSavedKeyframesToFile.
+   *
+   * Saved keyframes are grouped into chunks of @p keyframesPerChunk, which
+   * are encoded and written on a background thread. The file can be read up
+   * to the last written chunk while recording is in progress. Keyframes that
+   * were saved but not yet written go first. At most @p maxPendingChunks
+   * chunks wait to be written; beyond that, saveKeyframe blocks, so memory
+   * use stays bounded even if the disk is slow.
+   * @param filepath
+   * @param keyframesPerChunk
+   * @param maxPendingChunks
+   */
+  void startStreamingToFile(const std::string& filepath,
+                            int keyframesPerChunk = 64,
+                            int maxPendingChunks = 4);
+
+  /**
+   * @brief Write the remaining saved keyframes and close the stream file.
+   * Recording continues in memory, as before startStreamingToFile.
+   */
+  void stopStreaming();
+
+  /**
+   * @brief Whether keyframes are being streamed to a file.
+   */
+  bool isStreaming() const { return bool(streamWriter_); }
+
   /**
    * @brief write saved keyframes to string.
    */
@@ -107,8 +168,15 @@ class Recorder {
     return savedKeyframes_;
   }
 
+  /**
+   * @brief Reserved for unit-testing.
+   */
+  const std::vector<Checkpoint>& debugGetSavedCheckpoints() const {
+    return savedCheckpoints_;
+  }
+
  private:
-  // NodeDeletionHelper calls onDeleteRenderAssetInstance
+  // NodeDeletionHelper calls onDeleteRenderAssetInstance and onInstanceDirty
   friend class NodeDeletionHelper;
 
   // Helper for tracking render asset instances
@@ -119,27 +187,45 @@ class Recorder {
     NodeDeletionHelper* deletionHelper = nullptr;
   };
 
-  using KeyframeIterator = std::vector<Keyframe>::const_iterator;
-
   rapidjson::Document writeKeyframesToJsonDocument();
   void onDeleteRenderAssetInstance(const scene::SceneNode* node);
   Keyframe& getKeyframe();
   void advanceKeyframe();
   RenderAssetInstanceKey getNewInstanceKey();
+  void onInstanceDirty(const scene::SceneNode* node);
   int findInstance(const scene::SceneNode* queryNode);
-  RenderAssetInstanceState getInstanceState(const scene::SceneNode* node);
+  RenderAssetInstanceState getInstanceState(scene::SceneNode* node);
   void updateInstanceStates();
   void checkAndAddDeletion(Keyframe* keyframe,
                            RenderAssetInstanceKey instanceKey);
-  void addLoadsCreationsDeletions(KeyframeIterator begin,
-                                  KeyframeIterator end,
-                                  Keyframe* dest);
+  void checkAndAddRenderAssetChange(
+      Keyframe* keyframe,
+      RenderAssetInstanceKey instanceKey,
+      const esp::assets::RenderAssetInstanceCreationInfo& creation);
+  void addLoadsCreationsDeletions(const Keyframe& keyframe, Keyframe* dest);
+  void saveCheckpoint();
   void consolidateSavedKeyframes();
+  void streamSavedKeyframes();
 
   std::vector<InstanceRecord> instanceRecords_;
+  // node -> index in instanceRecords_
+  std::unordered_map<const scene::SceneNode*, int> instanceIndexByNode_;
+  // nodes of instances whose state may have changed since the last keyframe
+  std::vector<const scene::SceneNode*> dirtyInstanceNodes_;
   Keyframe currKeyframe_;
   std::vector<Keyframe> savedKeyframes_;
+  // checkpoints of keyframes in savedKeyframes_
+  std::vector<Checkpoint> savedCheckpoints_;
   RenderAssetInstanceKey nextInstanceKey_ = 0;
+
+  // keyframes saved since the last write, including streamed ones, and
+  // their loads, creations and deletions
+  int numKeyframesSinceWrite_ = 0;
+  Keyframe savedKeyframesSummary_;
+  int checkpointInterval_ = 0;
+
+  KeyframeStreamWriter::uptr streamWriter_;
+  int streamKeyframesPerChunk_ = 0;
 };
 
 }  // namespace replay
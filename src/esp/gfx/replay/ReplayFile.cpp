@@ -0,0 +1,237 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "ReplayFile.h"
+
+#include "BinaryFormat.h"
+#include "esp/io/JsonAllTypes.h"
+#include "esp/io/json.h"
+
+#include <Corrade/Containers/ArrayView.h>
+#include <Corrade/Containers/Optional.h>
+#include <Corrade/Utility/Directory.h>
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <utility>
+
+namespace esp {
+namespace gfx {
+namespace replay {
+
+namespace {
+
+// scene state after some keyframe, see sliceKeyframes
+struct SceneState {
+  std::vector<esp::assets::AssetInfo> loads;
+  std::set<std::string> loadedFilepaths;
+  // ordered, so instances are recreated in the order of their keys
+  std::map<RenderAssetInstanceKey,
+           std::pair<esp::assets::RenderAssetInstanceCreationInfo,
+                     Corrade::Containers::Optional<RenderAssetInstanceState>>>
+      instances;
+
+  void apply(const Keyframe& keyframe) {
+    for (const auto& assetInfo : keyframe.loads) {
+      if (loadedFilepaths.insert(assetInfo.filepath).second) {
+        loads.push_back(assetInfo);
+      }
+    }
+    for (const auto& pair : keyframe.creations) {
+      instances[pair.first] = {pair.second, Corrade::Containers::NullOpt};
+    }
+    for (const auto& pair : keyframe.renderAssetChanges) {
+      const auto it = instances.find(pair.first);
+      if (it != instances.end()) {
+        it->second.first = pair.second;
+      }
+    }
+    for (const auto& instanceKey : keyframe.deletions) {
+      instances.erase(instanceKey);
+    }
+    for (const auto& pair : keyframe.stateUpdates) {
+      const auto it = instances.find(pair.first);
+      if (it != instances.end()) {
+        it->second.second = pair.second;
+      }
+    }
+  }
+
+  Keyframe toKeyframe() const {
+    Keyframe keyframe;
+    keyframe.loads = loads;
+    for (const auto& pair : instances) {
+      keyframe.creations.emplace_back(pair.first, pair.second.first);
+      if (pair.second.second) {
+        keyframe.stateUpdates.emplace_back(pair.first, *pair.second.second);
+      }
+    }
+    return keyframe;
+  }
+};
+
+}  // namespace
+
+bool readKeyframesFromFile(const std::string& filepath,
+                           std::vector<Keyframe>& keyframes,
+                           std::vector<Checkpoint>* checkpoints) {
+  if (!Corrade::Utility::Directory::exists(filepath)) {
+    LOG(ERROR) << "readKeyframesFromFile: file " << filepath << " not found.";
+    return false;
+  }
+  try {
+    const auto data = Corrade::Utility::Directory::read(filepath);
+    if (isBinaryReplay(data.data(), data.size())) {
+      auto decoded =
+          readKeyframesFromBinary(data.data(), data.size(), checkpoints);
+      if (!decoded) {
+        LOG(ERROR) << "readKeyframesFromFile: " << filepath
+                   << " is malformed.";
+        return false;
+      }
+      keyframes = std::move(*decoded);
+    } else {
+      const auto document =
+          esp::io::parseJsonString(std::string(data.data(), data.size()));
+      keyframes.clear();
+      esp::io::readMember(document, "keyframes", keyframes);
+      if (checkpoints) {
+        checkpoints->clear();
+        esp::io::readMember(document, "checkpoints", *checkpoints);
+      }
+    }
+  } catch (...) {
+    LOG(ERROR) << "readKeyframesFromFile: failed to parse keyframes from "
+               << filepath << ".";
+    return false;
+  }
+  return true;
+}
+
+bool writeKeyframesToFile(const std::string& filepath,
+                          const std::vector<Keyframe>& keyframes,
+                          const std::vector<Checkpoint>& checkpoints) {
+  bool success;
+  if (isBinaryReplayFilepath(filepath)) {
+    std::vector<char> buffer;
+    writeKeyframesToBinary(keyframes, buffer, DefaultKeyframesPerChunk,
+                           checkpoints);
+    success = Corrade::Utility::Directory::write(
+        filepath,
+        Corrade::Containers::arrayView(buffer.data(), buffer.size()));
+  } else {
+    const auto document = keyframesToJsonDocument(keyframes, checkpoints);
+    success = esp::io::writeJsonToFile(document, filepath);
+  }
+  LOG_IF(ERROR, !success) << "writeKeyframesToFile: failed to write "
+                          << filepath;
+  return success;
+}
+
+rapidjson::Document keyframesToJsonDocument(
+    const std::vector<Keyframe>& keyframes,
+    const std::vector<Checkpoint>& checkpoints) {
+  rapidjson::Document d(rapidjson::kObjectType);
+  rapidjson::Document::AllocatorType& allocator = d.GetAllocator();
+  esp::io::addMember(d, "keyframes", keyframes, allocator);
+  if (!checkpoints.empty()) {
+    esp::io::addMember(d, "checkpoints", checkpoints, allocator);
+  }
+  return d;
+}
+
+CompactionStats compactKeyframes(std::vector<Keyframe>& keyframes) {
+  CompactionStats stats;
+  std::set<std::string> loadedFilepaths;
+  // compared against the last kept state, so small changes which are each
+  // within the comparison tolerance can't add up
+  std::unordered_map<RenderAssetInstanceKey, RenderAssetInstanceState>
+      keptStates;
+
+  for (auto& keyframe : keyframes) {
+    auto newLoadsEnd = std::remove_if(
+        keyframe.loads.begin(), keyframe.loads.end(),
+        [&](const esp::assets::AssetInfo& assetInfo) {
+          return !loadedFilepaths.insert(assetInfo.filepath).second;
+        });
+    stats.numLoads += keyframe.loads.end() - newLoadsEnd;
+    keyframe.loads.erase(newLoadsEnd, keyframe.loads.end());
+
+    // a new instance needs its state even if a deleted one had the same key
+    for (const auto& pair : keyframe.creations) {
+      keptStates.erase(pair.first);
+    }
+    for (const auto& instanceKey : keyframe.deletions) {
+      keptStates.erase(instanceKey);
+    }
+
+    auto newUpdatesEnd = std::remove_if(
+        keyframe.stateUpdates.begin(), keyframe.stateUpdates.end(),
+        [&](const std::pair<RenderAssetInstanceKey, RenderAssetInstanceState>&
+                pair) {
+          auto it = keptStates.find(pair.first);
+          if (it != keptStates.end() && it->second == pair.second) {
+            return true;
+          }
+          keptStates[pair.first] = pair.second;
+          return false;
+        });
+    stats.numStateUpdates += keyframe.stateUpdates.end() - newUpdatesEnd;
+    keyframe.stateUpdates.erase(newUpdatesEnd, keyframe.stateUpdates.end());
+  }
+  return stats;
+}
+
+std::vector<Keyframe> sliceKeyframes(
+    const std::vector<Keyframe>& keyframes,
+    const std::vector<Checkpoint>& checkpoints,
+    int begin,
+    int end,
+    std::vector<Checkpoint>* slicedCheckpoints) {
+  CORRADE_ASSERT(
+      begin >= 0 && begin < end && end <= int(keyframes.size()),
+      "sliceKeyframes: invalid range" << begin << end << "of"
+                                      << keyframes.size() << "keyframes",
+      {});
+
+  // start from the last checkpoint at or before begin, if any
+  SceneState state;
+  int next = 0;
+  for (const auto& checkpoint : checkpoints) {
+    if (checkpoint.keyframeIndex > begin) {
+      break;
+    }
+    state = SceneState{};
+    state.apply(checkpoint.state);
+    next = checkpoint.keyframeIndex + 1;
+  }
+  for (; next <= begin; ++next) {
+    state.apply(keyframes[next]);
+  }
+
+  std::vector<Keyframe> sliced;
+  sliced.reserve(end - begin);
+  sliced.push_back(state.toKeyframe());
+  sliced.back().userTransforms = keyframes[begin].userTransforms;
+  sliced.insert(sliced.end(), keyframes.begin() + begin + 1,
+                keyframes.begin() + end);
+
+  if (slicedCheckpoints) {
+    slicedCheckpoints->clear();
+    for (const auto& checkpoint : checkpoints) {
+      // a checkpoint at begin would duplicate the first keyframe
+      if (checkpoint.keyframeIndex > begin && checkpoint.keyframeIndex < end) {
+        slicedCheckpoints->push_back(checkpoint);
+        slicedCheckpoints->back().keyframeIndex -= begin;
+      }
+    }
+  }
+  return sliced;
+}
+
+}  // namespace replay
+}  // namespace gfx
+}  // namespace esp
@@ -0,0 +1,86 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#ifndef ESP_GFX_REPLAY_REPLAYFILE_H_
+#define ESP_GFX_REPLAY_REPLAYFILE_H_
+
+/** @file
+ * @brief Functions to read, write and rewrite whole replay files outside of a
+ * @ref esp::gfx::replay::Recorder or @ref esp::gfx::replay::Player, e.g. with
+ * the replaytool utility.
+ */
+
+#include "Keyframe.h"
+
+#include <rapidjson/document.h>
+
+#include <string>
+#include <vector>
+
+namespace esp {
+namespace gfx {
+namespace replay {
+
+/**
+ * @brief Read all keyframes, and checkpoints unless @p checkpoints is
+ * nullptr, of a JSON or binary replay file. Returns false and logs an error if
+ * the file can't be read.
+ */
+bool readKeyframesFromFile(const std::string& filepath,
+                           std::vector<Keyframe>& keyframes,
+                           std::vector<Checkpoint>* checkpoints = nullptr);
+
+/**
+ * @brief Write keyframes and checkpoints to a replay file, in the binary format
+ * if @p filepath ends with ".bin" and as JSON otherwise. Returns false and logs
+ * an error if the file can't be written.
+ */
+bool writeKeyframesToFile(const std::string& filepath,
+                          const std::vector<Keyframe>& keyframes,
+                          const std::vector<Checkpoint>& checkpoints = {});
+
+/**
+ * @brief Serialize keyframes and checkpoints as a JSON replay document.
+ */
+rapidjson::Document keyframesToJsonDocument(
+    const std::vector<Keyframe>& keyframes,
+    const std::vector<Checkpoint>& checkpoints);
+
+/**
+ * @brief What @ref compactKeyframes removed.
+ */
+struct CompactionStats {
+  //! State updates which didn't change the instance's state
+  std::size_t numStateUpdates = 0;
+  //! Loads of assets which were loaded already
+  std::size_t numLoads = 0;
+};
+
+/**
+ * @brief Remove entries of @p keyframes which don't change the played back
+ * scene: state updates equal to the instance's previous state, and repeated
+ * loads of an asset. Checkpoints stay valid.
+ */
+CompactionStats compactKeyframes(std::vector<Keyframe>& keyframes);
+
+/**
+ * @brief Cut out keyframes [@p begin, @p end) as a self-contained replay.
+ *
+ * The first keyframe of the result holds the complete scene state after
+ * keyframe @p begin, like a @ref Checkpoint. Checkpoints within the range are
+ * kept with their keyframe index adjusted, if @p slicedCheckpoints isn't
+ * nullptr.
+ */
+std::vector<Keyframe> sliceKeyframes(
+    const std::vector<Keyframe>& keyframes,
+    const std::vector<Checkpoint>& checkpoints,
+    int begin,
+    int end,
+    std::vector<Checkpoint>* slicedCheckpoints = nullptr);
+
+}  // namespace replay
+}  // namespace gfx
+}  // namespace esp
+
+#endif  // ESP_GFX_REPLAY_REPLAYFILE_H_
@@ -4,13 +4,32 @@
 
 #include "ReplayManager.h"
 
+#include <algorithm>
+
 namespace esp {
 namespace gfx {
 namespace replay {
 
 std::shared_ptr<Player> ReplayManager::readKeyframesFromFile(
-    const std::string& filepath) {
-  auto player = std::make_shared<Player>(playerCallback_);
+    const std::string& filepath,
+    bool drivePhysics) {
+  if (drivePhysics && !playerPhysicsCallbacks_.createObject) {
+    LOG(ERROR) << "ReplayManager::readKeyframesFromFile: no physics callbacks "
+                  "set, can't drive physics from ["
+               << filepath << "]";
+    return nullptr;
+  }
+  // the physics objects come with their own render assets
+  auto player = std::make_shared<Player>(
+      drivePhysics ? Player::LoadAndCreateRenderAssetInstanceCallback{}
+                   : playerCallback_);
+  if (drivePhysics) {
+    player->setPhysicsCallbacks(playerPhysicsCallbacks_);
+  }
+  if (playerPrefetchCallback_) {
+    player->setPrefetchCallback(playerPrefetchCallback_,
+                                playerPrefetchKeyframesAhead_);
+  }
   player->readKeyframesFromFile(filepath);
   if (!player->getNumKeyframes()) {
     LOG(ERROR) << "ReplayManager::readKeyframesFromFile: failed to load any "
@@ -18,9 +37,27 @@ std::shared_ptr<Player> ReplayManager::readKeyframesFromFile(
                << filepath << "]";
     return nullptr;
   }
+  if (drivePhysics) {
+    physicsPlayers_.erase(
+        std::remove_if(physicsPlayers_.begin(), physicsPlayers_.end(),
+                       [](const std::weak_ptr<Player>& weakPlayer) {
+                         return weakPlayer.expired();
+                       }),
+        physicsPlayers_.end());
+    physicsPlayers_.push_back(player);
+  }
   return player;
 }
 
+void ReplayManager::detachPhysicsPlayers() {
+  for (const auto& weakPlayer : physicsPlayers_) {
+    if (auto player = weakPlayer.lock()) {
+      player->detachPhysics();
+    }
+  }
+  physicsPlayers_.clear();
+}
+
 }  // namespace replay
 }  // namespace gfx
 }  // namespace esp
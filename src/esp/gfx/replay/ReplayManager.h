@@ -41,15 +41,58 @@ class ReplayManager {
     playerCallback_ = callback;
   }
 
+  /**
+   * @brief Set a callback for constructed Player instances to prefetch the
+   * files of render assets with. See @ref Player::setPrefetchCallback.
+   */
+  void setPlayerPrefetchCallback(
+      const Player::PrefetchRenderAssetCallback& callback) {
+    playerPrefetchCallback_ = callback;
+  }
+
+  /**
+   * @brief Set how many keyframes ahead constructed Player instances
+   * prefetch render assets. Pass 0 to only prefetch the assets of the set
+   * keyframe.
+   */
+  void setPlayerPrefetchKeyframesAhead(int numKeyframesAhead) {
+    playerPrefetchKeyframesAhead_ = numKeyframesAhead;
+  }
+
+  /**
+   * @brief Set the callbacks for Player instances which drive physics
+   * objects. See @ref Player::setPhysicsCallbacks.
+   */
+  void setPlayerPhysicsCallbacks(const Player::PhysicsCallbacks& callbacks) {
+    playerPhysicsCallbacks_ = callbacks;
+  }
+
   /**
    * @brief Read keyframes from a file and construct a Player. Returns nullptr
    * if no keyframes could be read.
+   * @param filepath
+   * @param drivePhysics If true, the Player drives kinematic physics objects
+   * instead of creating render asset instances, see
+   * @ref setPlayerPhysicsCallbacks.
+   */
+  std::shared_ptr<Player> readKeyframesFromFile(const std::string& filepath,
+                                                bool drivePhysics = false);
+
+  /**
+   * @brief Detach the constructed Player instances which drive physics from
+   * their physics objects, see @ref Player::detachPhysics. Call it before
+   * the physics world or the owner of the physics callbacks goes away.
    */
-  std::shared_ptr<Player> readKeyframesFromFile(const std::string& filepath);
+  void detachPhysicsPlayers();
 
  private:
   std::shared_ptr<Recorder> recorder_;
   Player::LoadAndCreateRenderAssetInstanceCallback playerCallback_;
+  Player::PrefetchRenderAssetCallback playerPrefetchCallback_;
+  Player::PhysicsCallbacks playerPhysicsCallbacks_;
+  // players which drive physics, which may outlive this manager
+  std::vector<std::weak_ptr<Player>> physicsPlayers_;
+  int playerPrefetchKeyframesAhead_ = 32;
 
   ESP_SMART_POINTERS(ReplayManager)
 };
@@ -0,0 +1,172 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include <Corrade/Containers/Optional.h>
+#include <Corrade/TestSuite/Tester.h>
+#include <Magnum/Magnum.h>
+#include <Magnum/Math/Vector3.h>
+
+#include <vector>
+
+#include "esp/gfx/replay/Recorder.h"
+#include "esp/scene/SceneGraph.h"
+
+namespace Cr = Corrade;
+namespace Mn = Magnum;
+
+using esp::assets::RenderAssetInstanceCreationInfo;
+using esp::gfx::replay::Recorder;
+using esp::scene::SceneNode;
+
+namespace {
+
+constexpr struct {
+  const char* name;
+  int numStatic;
+  int numMoving;
+} InstanceCountData[]{{"10k static, 100 moving", 10000, 100},
+                      {"10k moving", 0, 10000}};
+
+const RenderAssetInstanceCreationInfo& boxCreation() {
+  static const RenderAssetInstanceCreationInfo creation(
+      "box.glb", Cr::Containers::NullOpt, {}, "");
+  return creation;
+}
+
+std::vector<SceneNode*> createInstances(esp::scene::SceneGraph& sceneGraph,
+                                        Recorder& recorder,
+                                        int count) {
+  std::vector<SceneNode*> nodes;
+  nodes.reserve(count);
+  for (int i = 0; i < count; ++i) {
+    auto& node = sceneGraph.getRootNode().createChild();
+    node.setTranslation(Mn::Vector3(float(i), 0.0f, 0.0f));
+    recorder.onCreateRenderAssetInstance(&node, boxCreation());
+    nodes.push_back(&node);
+  }
+  return nodes;
+}
+
+std::size_t lastNumStateUpdates(const Recorder& recorder) {
+  return recorder.debugGetSavedKeyframes().back().stateUpdates.size();
+}
+
+struct ReplayRecorderTest : Cr::TestSuite::Tester {
+  explicit ReplayRecorderTest();
+
+  void capturesChangedInstances();
+  void capturesAfterDeletion();
+
+  void benchmarkSaveKeyframe();
+};
+
+ReplayRecorderTest::ReplayRecorderTest() {
+  addTests({&ReplayRecorderTest::capturesChangedInstances,
+            &ReplayRecorderTest::capturesAfterDeletion});
+
+  addInstancedBenchmarks({&ReplayRecorderTest::benchmarkSaveKeyframe}, 10,
+                         Cr::Containers::arraySize(InstanceCountData));
+}
+
+void ReplayRecorderTest::capturesChangedInstances() {
+  esp::scene::SceneGraph sceneGraph;
+  Recorder recorder;
+  auto& parent = sceneGraph.getRootNode().createChild();
+  auto& child = parent.createChild();
+  recorder.onCreateRenderAssetInstance(&child, boxCreation());
+  auto nodes = createInstances(sceneGraph, recorder, 10);
+
+  recorder.saveKeyframe();
+  CORRADE_COMPARE(lastNumStateUpdates(recorder), 11);
+
+  recorder.saveKeyframe();
+  CORRADE_COMPARE(lastNumStateUpdates(recorder), 0);
+
+  nodes[3]->setTranslation(Mn::Vector3(0.0f, 1.0f, 0.0f));
+  // a change back and forth doesn't produce an update
+  nodes[4]->setTranslation(Mn::Vector3(0.0f, 1.0f, 0.0f));
+  nodes[4]->setTranslation(Mn::Vector3(4.0f, 0.0f, 0.0f));
+  recorder.saveKeyframe();
+  CORRADE_COMPARE(lastNumStateUpdates(recorder), 1);
+  CORRADE_COMPARE(recorder.debugGetSavedKeyframes()
+                      .back()
+                      .stateUpdates[0]
+                      .second.absTransform.translation,
+                  Mn::Vector3(0.0f, 1.0f, 0.0f));
+
+  // moving the parent moves the child instance
+  parent.setTranslation(Mn::Vector3(0.0f, 0.0f, 2.0f));
+  recorder.saveKeyframe();
+  CORRADE_COMPARE(lastNumStateUpdates(recorder), 1);
+
+  // moved again after being captured
+  parent.setTranslation(Mn::Vector3(0.0f, 0.0f, 3.0f));
+  recorder.saveKeyframe();
+  CORRADE_COMPARE(lastNumStateUpdates(recorder), 1);
+  CORRADE_COMPARE(recorder.debugGetSavedKeyframes()
+                      .back()
+                      .stateUpdates[0]
+                      .second.absTransform.translation,
+                  Mn::Vector3(0.0f, 0.0f, 3.0f));
+
+  nodes[7]->setSemanticId(5);
+  recorder.saveKeyframe();
+  CORRADE_COMPARE(lastNumStateUpdates(recorder), 1);
+  const auto& semanticUpdate =
+      recorder.debugGetSavedKeyframes().back().stateUpdates[0];
+  CORRADE_COMPARE(semanticUpdate.second.semanticId, 5);
+
+  // writing the keyframes out includes every instance in the next keyframe
+  recorder.writeSavedKeyframesToString();
+  recorder.saveKeyframe();
+  CORRADE_COMPARE(lastNumStateUpdates(recorder), 11);
+}
+
+void ReplayRecorderTest::capturesAfterDeletion() {
+  esp::scene::SceneGraph sceneGraph;
+  Recorder recorder;
+  auto nodes = createInstances(sceneGraph, recorder, 5);
+  recorder.saveKeyframe();
+  const auto lastKey =
+      recorder.debugGetSavedKeyframes()[0].creations.back().first;
+
+  // moved, then deleted before the next keyframe
+  nodes[1]->setTranslation(Mn::Vector3(0.0f, 1.0f, 0.0f));
+  delete nodes[1];
+  // the last record takes over the deleted one's slot
+  nodes[4]->setTranslation(Mn::Vector3(0.0f, 2.0f, 0.0f));
+  recorder.saveKeyframe();
+
+  const auto& keyframe = recorder.debugGetSavedKeyframes().back();
+  CORRADE_COMPARE(keyframe.deletions.size(), 1);
+  CORRADE_COMPARE(keyframe.stateUpdates.size(), 1);
+  CORRADE_COMPARE(keyframe.stateUpdates[0].first, lastKey);
+  CORRADE_COMPARE(keyframe.stateUpdates[0].second.absTransform.translation,
+                  Mn::Vector3(0.0f, 2.0f, 0.0f));
+}
+
+void ReplayRecorderTest::benchmarkSaveKeyframe() {
+  auto&& data = InstanceCountData[testCaseInstanceId()];
+  setTestCaseDescription(data.name);
+
+  esp::scene::SceneGraph sceneGraph;
+  Recorder recorder;
+  createInstances(sceneGraph, recorder, data.numStatic);
+  auto moving = createInstances(sceneGraph, recorder, data.numMoving);
+  recorder.saveKeyframe();
+
+  float offset = 0.0f;
+  CORRADE_BENCHMARK(10) {
+    offset += 1.0f;
+    for (auto* node : moving) {
+      node->setTranslation(Mn::Vector3(0.0f, offset, 0.0f));
+    }
+    recorder.saveKeyframe();
+  }
+  CORRADE_COMPARE(lastNumStateUpdates(recorder), data.numMoving);
+}
+
+}  // namespace
+
+CORRADE_TEST_MAIN(ReplayRecorderTest)
@@ -27,6 +27,17 @@ JsonGenericValue toJsonValue(const esp::gfx::replay::Keyframe& keyframe,
 
   esp::io::addMember(obj, "deletions", keyframe.deletions, allocator);
 
+  if (!keyframe.renderAssetChanges.empty()) {
+    JsonGenericValue changesArray(rapidjson::kArrayType);
+    for (const auto& pair : keyframe.renderAssetChanges) {
+      JsonGenericValue changePairObj(rapidjson::kObjectType);
+      esp::io::addMember(changePairObj, "instanceKey", pair.first, allocator);
+      esp::io::addMember(changePairObj, "creation", pair.second, allocator);
+      changesArray.PushBack(changePairObj, allocator);
+    }
+    esp::io::addMember(obj, "renderAssetChanges", changesArray, allocator);
+  }
+
   if (!keyframe.stateUpdates.empty()) {
     JsonGenericValue stateUpdatesArray(rapidjson::kArrayType);
     for (const auto& pair : keyframe.stateUpdates) {
@@ -72,6 +83,20 @@ bool fromJsonValue(const JsonGenericValue& obj,
 
   esp::io::readMember(obj, "deletions", keyframe.deletions);
 
+  itr = obj.FindMember("renderAssetChanges");
+  if (itr != obj.MemberEnd()) {
+    const JsonGenericValue& changesArray = itr->value;
+    keyframe.renderAssetChanges.reserve(changesArray.Size());
+    for (const auto& changePairObj : changesArray.GetArray()) {
+      std::pair<esp::gfx::replay::RenderAssetInstanceKey,
+                esp::assets::RenderAssetInstanceCreationInfo>
+          pair;
+      esp::io::readMember(changePairObj, "instanceKey", pair.first);
+      esp::io::readMember(changePairObj, "creation", pair.second);
+      keyframe.renderAssetChanges.emplace_back(std::move(pair));
+    }
+  }
+
   itr = obj.FindMember("stateUpdates");
   if (itr != obj.MemberEnd()) {
     const JsonGenericValue& stateUpdatesArray = itr->value;
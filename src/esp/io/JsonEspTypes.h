@@ -159,6 +159,22 @@ JsonGenericValue toJsonValue(const esp::gfx::replay::Keyframe& x,
 bool fromJsonValue(const JsonGenericValue& keyframeObj,
                    esp::gfx::replay::Keyframe& keyframe);
 
+inline JsonGenericValue toJsonValue(const esp::gfx::replay::Checkpoint& x,
+                                    JsonAllocator& allocator) {
+  JsonGenericValue obj(rapidjson::kObjectType);
+  addMember(obj, "keyframeIndex", x.keyframeIndex, allocator);
+  addMember(obj, "state", x.state, allocator);
+  return obj;
+}
+
+inline bool fromJsonValue(const JsonGenericValue& obj,
+                          esp::gfx::replay::Checkpoint& x) {
+  bool success = true;
+  success &= readMember(obj, "keyframeIndex", x.keyframeIndex);
+  success &= readMember(obj, "state", x.state);
+  return success;
+}
+
 }  // namespace io
 }  // namespace esp
 
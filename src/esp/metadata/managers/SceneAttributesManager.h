@@ -91,6 +91,19 @@ class SceneAttributesManager
     return attributes::SceneObjectInstanceAttributes::create(handle);
   }
 
+  /**
+   * @brief Create a @ref
+   * esp::metadata::attributes::SceneObjectInstanceAttributes object from the
+   * passed JSON doc.
+   * @param jCell JSON object containing the description of the stage or object
+   * instance. Also used by other instance-based JSON configs, such as
+   * scripted entity scenes.
+   * @return the constructed @ref
+   * esp::metadata::attributes::SceneObjectInstanceAttributes object
+   */
+  attributes::SceneObjectInstanceAttributes::ptr
+  createInstanceAttributesFromJSON(const io::JsonGenericValue& jCell);
+
  protected:
   /**
    * @brief Gets the int value of the appropriate enum corresponding to the
@@ -102,18 +115,6 @@ class SceneAttributesManager
    */
   int getTranslationOriginVal(const io::JsonGenericValue& jsonDoc);
 
-  /**
-   * @brief Used Internally.  Create a @ref
-   * esp::metadata::attributes::SceneObjectInstanceAttributes object from the
-   * passed JSON doc.
-   * @param jCell JSON object containing the description of the stage or object
-   * instance.
-   * @return the constructed @ref
-   * esp::metadata::attributes::SceneObjectInstanceAttributes object
-   */
-  attributes::SceneObjectInstanceAttributes::ptr
-  createInstanceAttributesFromJSON(const io::JsonGenericValue& jCell);
-
   /**
    * @brief Used Internally.  Create and configure newly-created scene instance
    * attributes with any default values, before any specific values are set.
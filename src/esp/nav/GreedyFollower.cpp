@@ -34,6 +34,9 @@ GreedyGeodesicFollowerImpl::GreedyGeodesicFollowerImpl(
 
 float GreedyGeodesicFollowerImpl::geoDist(const Mn::Vector3& start,
                                           const Mn::Vector3& end) {
+  if (distanceField_) {
+    return distanceField_->geodesicDistance(cast<vec3f>(start));
+  }
   geoDistPath_.requestedStart = cast<vec3f>(start);
   geoDistPath_.requestedEnd = cast<vec3f>(end);
   pathfinder_->findPath(geoDistPath_);
@@ -160,7 +163,7 @@ GreedyGeodesicFollowerImpl::CODES GreedyGeodesicFollowerImpl::nextActionAlong(
   ShortestPath path;
   path.requestedStart = cast<vec3f>(start.translation);
   path.requestedEnd = cast<vec3f>(end);
-  pathfinder_->findPath(path);
+  path.geodesicDistance = geoDist(start.translation, end);
 
   CODES nextAction;
   if (fixThrashing_ && thrashingActions_.size() > 0) {
@@ -197,7 +200,7 @@ GreedyGeodesicFollowerImpl::findPath(const core::RigidState& start,
     ShortestPath path;
     path.requestedStart = cast<vec3f>(state.translation);
     path.requestedEnd = cast<vec3f>(end);
-    pathfinder_->findPath(path);
+    path.geodesicDistance = geoDist(state.translation, end);
     const auto nextPrim = nextBestPrimAlong(state, path);
     if (nextPrim.size() == 0) {
       actions_.emplace_back(CODES::ERROR);
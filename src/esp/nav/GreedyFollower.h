@@ -112,6 +112,19 @@ class GreedyGeodesicFollowerImpl {
   std::vector<CODES> findPath(const core::RigidState& start,
                               const Magnum::Vector3& end);
 
+  /**
+   * @brief Use a precomputed distance field for geodesic distances instead of
+   * finding a path for each of the many distances a step needs.
+   *
+   * @param[in] distanceField Field built for the end location(s) passed to
+   * @ref nextActionAlong and @ref findPath, which are then ignored. nullptr to
+   * find paths again. Has to be set again with a new field after @ref
+   * PathFinder::updateObstacles, see @ref GeodesicDistanceField::isUpToDate.
+   */
+  void setDistanceField(GeodesicDistanceField::ptr distanceField) {
+    distanceField_ = std::move(distanceField);
+  }
+
   /**
    * @brief Reset the planner.
    *
@@ -139,6 +152,7 @@ class GreedyGeodesicFollowerImpl {
       tryStepDummyNode_{dummyScene_.getRootNode()};
 
   ShortestPath geoDistPath_;
+  GeodesicDistanceField::ptr distanceField_ = nullptr;
   float geoDist(const Magnum::Vector3& start, const Magnum::Vector3& end);
 
   struct TryStepResult {
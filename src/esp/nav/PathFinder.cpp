@@ -3,7 +3,13 @@
 // LICENSE file in the root directory of this source tree.
 
 #include "PathFinder.h"
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
 #include <numeric>
+#include <queue>
 #include <stack>
 #include <unordered_map>
 
@@ -22,12 +28,17 @@
 #include <limits>
 
 #include "esp/assets/MeshData.h"
+#include "esp/core/Check.h"
+#include "esp/core/TaskScheduler.h"
 #include "esp/core/esp.h"
 
+#include "DetourCommon.h"
 #include "DetourNavMesh.h"
 #include "DetourNavMeshBuilder.h"
 #include "DetourNavMeshQuery.h"
 #include "DetourNode.h"
+#include "DetourTileCache.h"
+#include "DetourTileCacheBuilder.h"
 #include "Recast.h"
 
 namespace Mn = Magnum;
@@ -41,7 +52,12 @@ struct MultiGoalShortestPath::Impl {
 
   std::vector<dtPolyRef> endRefs;
   std::vector<vec3f> pathEnds;
+  //! Navmesh generation endRefs were snapped on, see
+  //! PathFinder::Impl::navMeshGeneration_. 0 if they weren't snapped yet.
+  std::uint64_t navMeshGeneration = 0;
 
+  //! Lower bounds of the distances to the ends, carried over from the
+  //! previous search
   std::vector<float> minTheoreticalDist;
   vec3f prevRequestedStart = vec3f::Zero();
 };
@@ -53,9 +69,9 @@ void MultiGoalShortestPath::setRequestedEnds(
     const std::vector<vec3f>& newEnds) {
   pimpl_->endRefs.clear();
   pimpl_->pathEnds.clear();
-  pimpl_->requestedEnds = newEnds;
-
+  pimpl_->navMeshGeneration = 0;
   pimpl_->minTheoreticalDist.assign(newEnds.size(), 0);
+  pimpl_->requestedEnds = newEnds;
 }
 
 const std::vector<vec3f>& MultiGoalShortestPath::getRequestedEnds() const {
@@ -63,6 +79,22 @@ const std::vector<vec3f>& MultiGoalShortestPath::getRequestedEnds() const {
 }
 
 namespace {
+struct NavMeshDeleter {
+  void operator()(dtNavMesh* mesh) { dtFreeNavMesh(mesh); }
+};
+struct NavQueryDeleter {
+  void operator()(dtNavMeshQuery* query) { dtFreeNavMeshQuery(query); }
+};
+struct TileCacheDeleter {
+  void operator()(dtTileCache* cache) { dtFreeTileCache(cache); }
+};
+
+using NavQueryPtr = std::unique_ptr<dtNavMeshQuery, NavQueryDeleter>;
+
+//! Shared by all PathFinders, so a path snapped on one navmesh is snapped
+//! again when used with another
+std::atomic<std::uint64_t> lastNavMeshGeneration{0};
+
 template <typename T>
 std::tuple<dtStatus, dtPolyRef, vec3f> projectToPoly(
     const T& pt,
@@ -101,7 +133,7 @@ class IslandSystem {
     // Iterate over all tiles
     for (int iTile = 0; iTile < navMesh->getMaxTiles(); ++iTile) {
       const dtMeshTile* tile = navMesh->getTile(iTile);
-      if (!tile)
+      if (!tile || !tile->header)
         continue;
 
       // Iterate over all polygons in a tile
@@ -149,6 +181,14 @@ class IslandSystem {
     return itStart->second == itEnd->second;
   }
 
+  inline int islandId(dtPolyRef ref) const {
+    auto itRef = polyToIsland_.find(ref);
+    if (itRef == polyToIsland_.end())
+      return ID_UNDEFINED;
+
+    return itRef->second;
+  }
+
   inline float islandRadius(dtPolyRef ref) const {
     auto itRef = polyToIsland_.find(ref);
     if (itRef == polyToIsland_.end())
@@ -213,6 +253,300 @@ class IslandSystem {
 };
 }  // namespace impl
 
+struct GeodesicDistanceField::Impl {
+  std::vector<vec3f> goals;
+
+  //! Kept alive if the PathFinder loads another navmesh
+  std::shared_ptr<dtNavMesh> navMesh = nullptr;
+  //! PathFinder::Impl::navMeshGeneration_ the field was built on and the
+  //! current generation of navMesh, which updateObstacles changes in place
+  std::uint64_t navMeshGeneration = 0;
+  std::shared_ptr<const std::uint64_t> currentNavMeshGeneration = nullptr;
+  //! Only used for const queries, see geodesicDistance
+  NavQueryPtr navQuery = nullptr;
+  dtQueryFilter filter;
+
+  //! Graph nodes: polygon vertices and portal endpoints, shared between the
+  //! polygons they're on, and the snapped goals
+  std::vector<vec3f> nodePositions;
+  std::vector<float> nodeDistances;
+  //! Next node on the way to the closest goal; goals are their own parent
+  std::vector<int> nodeParents;
+
+  //! Nodes of polygon i are polyNodes[polyNodeOffsets[i]] up to
+  //! polyNodes[polyNodeOffsets[i + 1]], sorted
+  std::unordered_map<dtPolyRef, int> polyIndices;
+  std::vector<int> polyNodeOffsets;
+  std::vector<int> polyNodes;
+
+  void build();
+
+  /**
+   * @brief Snap @p pt to its polygon and find the polygon node through which
+   * the closest goal is reached. Returns -1 if @p pt isn't near the navmesh
+   * or no goal is reachable from it.
+   */
+  int closestNode(const vec3f& pt, vec3f& snapped, float& distance) const;
+
+ private:
+  bool isPolyNode(int poly, int node) const {
+    return std::binary_search(polyNodes.begin() + polyNodeOffsets[poly],
+                              polyNodes.begin() + polyNodeOffsets[poly + 1],
+                              node);
+  }
+
+  bool isVisible(int from, dtPolyRef fromRef, int to) const;
+};
+
+GeodesicDistanceField::GeodesicDistanceField()
+    : pimpl_{spimpl::make_unique_impl<Impl>()} {}
+
+const std::vector<vec3f>& GeodesicDistanceField::getGoals() const {
+  return pimpl_->goals;
+}
+
+bool GeodesicDistanceField::isUpToDate() const {
+  return pimpl_->currentNavMeshGeneration &&
+         *pimpl_->currentNavMeshGeneration == pimpl_->navMeshGeneration;
+}
+
+float GeodesicDistanceField::geodesicDistance(const vec3f& pt) const {
+  ESP_CHECK(isUpToDate(),
+            "GeodesicDistanceField::geodesicDistance: the navmesh was "
+            "updated since the field was built, build it again");
+  vec3f snapped;
+  float distance = 0;
+  pimpl_->closestNode(pt, snapped, distance);
+  return distance;
+}
+
+vec3f GeodesicDistanceField::nextWaypoint(const vec3f& pt) const {
+  ESP_CHECK(isUpToDate(),
+            "GeodesicDistanceField::nextWaypoint: the navmesh was updated "
+            "since the field was built, build it again");
+  vec3f snapped;
+  float distance = 0;
+  int node = pimpl_->closestNode(pt, snapped, distance);
+  if (node < 0) {
+    return vec3f::Constant(Mn::Constants::nan());
+  }
+  // at a corner already, e.g. after following the previous waypoint
+  constexpr float reachedDistance = 1e-3;
+  if ((pimpl_->nodePositions[node] - snapped).norm() < reachedDistance) {
+    node = pimpl_->nodeParents[node];
+  }
+  return pimpl_->nodePositions[node];
+}
+
+int GeodesicDistanceField::Impl::closestNode(const vec3f& pt,
+                                             vec3f& snapped,
+                                             float& distance) const {
+  distance = std::numeric_limits<float>::infinity();
+  dtStatus status = 0;
+  dtPolyRef ref = 0;
+  std::tie(status, ref, snapped) = projectToPoly(pt, navQuery.get(), &filter);
+  if (dtStatusFailed(status) || ref == 0) {
+    return -1;
+  }
+  const auto found = polyIndices.find(ref);
+  if (found == polyIndices.end()) {
+    return -1;
+  }
+
+  // polygons are convex, so the straight line to each of their nodes is on
+  // the navmesh
+  int closest = -1;
+  for (int i = polyNodeOffsets[found->second];
+       i != polyNodeOffsets[found->second + 1]; ++i) {
+    const int node = polyNodes[i];
+    const float nodeDistance =
+        nodeDistances[node] + (nodePositions[node] - snapped).norm();
+    if (nodeDistance < distance) {
+      distance = nodeDistance;
+      closest = node;
+    }
+  }
+  return closest;
+}
+
+bool GeodesicDistanceField::Impl::isVisible(int from,
+                                            dtPolyRef fromRef,
+                                            int to) const {
+  static const int MAX_POLYS = 256;
+  dtPolyRef polys[MAX_POLYS];
+  int numPolys = 0;
+  float t = 0;
+  vec3f hitNormal;
+  const dtStatus status = navQuery->raycast(
+      fromRef, nodePositions[from].data(), nodePositions[to].data(), &filter,
+      &t, hitNormal.data(), polys, &numPolys, MAX_POLYS);
+  // t is FLT_MAX if nothing was hit. The raycast is 2D, so also check that it
+  // ends on a polygon of the target, not one above or below it.
+  if (dtStatusFailed(status) || dtStatusDetail(status, DT_BUFFER_TOO_SMALL) ||
+      t < 0.999f || numPolys == 0) {
+    return false;
+  }
+  const auto found = polyIndices.find(polys[numPolys - 1]);
+  return found != polyIndices.end() && isPolyNode(found->second, to);
+}
+
+void GeodesicDistanceField::Impl::build() {
+  const dtNavMesh* mesh = navMesh.get();
+
+  // merges vertices of neighbouring polygons, also across tile borders
+  constexpr float mergeDistance = 1e-3;
+  std::map<std::tuple<long, long, long>, int> nodesByPosition;
+  auto addNode = [&](const vec3f& position) {
+    const auto key = std::make_tuple(std::lround(position[0] / mergeDistance),
+                                     std::lround(position[1] / mergeDistance),
+                                     std::lround(position[2] / mergeDistance));
+    const auto inserted =
+        nodesByPosition.emplace(key, int(nodePositions.size()));
+    if (inserted.second) {
+      nodePositions.push_back(position);
+    }
+    return inserted.first->second;
+  };
+
+  std::vector<dtPolyRef> polyRefs;
+  std::vector<std::vector<int>> nodesOfPolys;
+  for (int iTile = 0; iTile < mesh->getMaxTiles(); ++iTile) {
+    const dtMeshTile* tile = mesh->getTile(iTile);
+    if (!tile || !tile->header)
+      continue;
+
+    for (int jPoly = 0; jPoly < tile->header->polyCount; ++jPoly) {
+      const dtPolyRef ref = mesh->encodePolyId(tile->salt, iTile, jPoly);
+      const dtPoly* poly = &tile->polys[jPoly];
+      if (poly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION ||
+          !filter.passFilter(ref, tile, poly))
+        continue;
+
+      polyIndices.emplace(ref, int(polyRefs.size()));
+      polyRefs.push_back(ref);
+      nodesOfPolys.emplace_back();
+      std::vector<int>& nodes = nodesOfPolys.back();
+      for (int iVert = 0; iVert < poly->vertCount; ++iVert) {
+        nodes.push_back(
+            addNode(Eigen::Map<vec3f>(&tile->verts[poly->verts[iVert] * 3])));
+      }
+
+      // a portal to another tile can be part of an edge only, so its
+      // endpoints aren't vertices of both polygons. Same as
+      // dtNavMeshQuery::getPortalPoints().
+      for (unsigned int iLink = poly->firstLink; iLink != DT_NULL_LINK;
+           iLink = tile->links[iLink].next) {
+        const dtLink& link = tile->links[iLink];
+        if (link.side == 0xff || (link.bmin == 0 && link.bmax == 255))
+          continue;
+        const vec3f a = Eigen::Map<vec3f>(
+            &tile->verts[poly->verts[link.edge] * 3]);
+        const vec3f b = Eigen::Map<vec3f>(
+            &tile->verts[poly->verts[(link.edge + 1) % poly->vertCount] * 3]);
+        nodes.push_back(addNode(a + (b - a) * (link.bmin / 255.0f)));
+        nodes.push_back(addNode(a + (b - a) * (link.bmax / 255.0f)));
+      }
+    }
+  }
+
+  std::vector<int> goalNodes;
+  for (const vec3f& goal : goals) {
+    dtStatus status = 0;
+    dtPolyRef ref = 0;
+    vec3f snapped;
+    std::tie(status, ref, snapped) =
+        projectToPoly(goal, navQuery.get(), &filter);
+    const auto found = polyIndices.find(ref);
+    if (dtStatusFailed(status) || found == polyIndices.end()) {
+      LOG(WARNING) << "PathFinder::buildDistanceField: ignoring goal "
+                   << goal.transpose() << ", it isn't near the navmesh";
+      continue;
+    }
+    goalNodes.push_back(addNode(snapped));
+    nodesOfPolys[found->second].push_back(goalNodes.back());
+  }
+
+  // flatten, and invert to the polygons of each node
+  const int numNodes = nodePositions.size();
+  std::vector<int> nodePolyOffsets(numNodes + 1, 0);
+  polyNodeOffsets.assign(1, 0);
+  for (auto& nodes : nodesOfPolys) {
+    std::sort(nodes.begin(), nodes.end());
+    nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+    polyNodes.insert(polyNodes.end(), nodes.begin(), nodes.end());
+    polyNodeOffsets.push_back(polyNodes.size());
+    for (const int node : nodes) {
+      ++nodePolyOffsets[node + 1];
+    }
+  }
+  std::partial_sum(nodePolyOffsets.begin(), nodePolyOffsets.end(),
+                   nodePolyOffsets.begin());
+  std::vector<int> nodePolys(nodePolyOffsets.back());
+  {
+    std::vector<int> next(nodePolyOffsets.begin(), nodePolyOffsets.end() - 1);
+    for (int iPoly = 0; iPoly < int(nodesOfPolys.size()); ++iPoly) {
+      for (const int node : nodesOfPolys[iPoly]) {
+        nodePolys[next[node]++] = iPoly;
+      }
+    }
+  }
+
+  // Dijkstra out from the goals. Nodes of the same polygon see each other as
+  // polygons are convex; a node is connected straight to the parent of its
+  // neighbour if the navmesh raycast between them is clear, as in Theta*, so
+  // distances don't zigzag along vertices.
+  nodeDistances.assign(numNodes, std::numeric_limits<float>::infinity());
+  nodeParents.assign(numNodes, -1);
+  using QueueEntry = std::pair<float, int>;
+  std::priority_queue<QueueEntry, std::vector<QueueEntry>,
+                      std::greater<QueueEntry>>
+      queue;
+  for (const int goal : goalNodes) {
+    nodeDistances[goal] = 0;
+    nodeParents[goal] = goal;
+    queue.emplace(0.0f, goal);
+  }
+
+  while (!queue.empty()) {
+    const float distance = queue.top().first;
+    const int node = queue.top().second;
+    queue.pop();
+    // outdated entry, the node was reached on a shorter path since
+    if (distance > nodeDistances[node])
+      continue;
+
+    const int parent = nodeParents[node];
+    for (int i = nodePolyOffsets[node]; i != nodePolyOffsets[node + 1]; ++i) {
+      const int poly = nodePolys[i];
+      for (int j = polyNodeOffsets[poly]; j != polyNodeOffsets[poly + 1];
+           ++j) {
+        const int neighbour = polyNodes[j];
+        // by the triangle inequality, going through node is never shorter
+        // than going straight to its parent
+        const float viaParent =
+            nodeDistances[parent] +
+            (nodePositions[parent] - nodePositions[neighbour]).norm();
+        if (viaParent >= nodeDistances[neighbour])
+          continue;
+
+        float neighbourDistance = viaParent;
+        int neighbourParent = parent;
+        if (parent != node && !isVisible(neighbour, polyRefs[poly], parent)) {
+          neighbourDistance =
+              distance +
+              (nodePositions[node] - nodePositions[neighbour]).norm();
+          neighbourParent = node;
+        }
+        if (neighbourDistance < nodeDistances[neighbour]) {
+          nodeDistances[neighbour] = neighbourDistance;
+          nodeParents[neighbour] = neighbourParent;
+          queue.emplace(neighbourDistance, neighbour);
+        }
+      }
+    }
+  }
+}
+
 struct PathFinder::Impl {
   Impl();
   ~Impl() = default;
@@ -228,14 +562,35 @@ struct PathFinder::Impl {
 
   vec3f getRandomNavigablePoint(int maxTries);
 
-  bool findPath(ShortestPath& path);
-  bool findPath(MultiGoalShortestPath& path);
+  bool findPath(ShortestPath& path) {
+    return findPath(navQuery_.get(), path);
+  }
+  bool findPath(MultiGoalShortestPath& path) {
+    return findPath(navQuery_.get(), path);
+  }
 
   template <typename T>
-  T tryStep(const T& start, const T& end, bool allowSliding);
+  T tryStep(const T& start, const T& end, bool allowSliding) {
+    return tryStep(navQuery_.get(), start, end, allowSliding);
+  }
 
   template <typename T>
-  T snapPoint(const T& pt);
+  T snapPoint(const T& pt) {
+    return snapPoint(navQuery_.get(), pt);
+  }
+
+  void findPaths(Cr::Containers::ArrayView<ShortestPath> paths);
+
+  GeodesicDistanceField::ptr buildDistanceField(
+      const std::vector<vec3f>& goals);
+
+  void snapPoints(Cr::Containers::ArrayView<const vec3f> points,
+                  Cr::Containers::ArrayView<vec3f> snapped);
+
+  void trySteps(Cr::Containers::ArrayView<const vec3f> starts,
+                Cr::Containers::ArrayView<const vec3f> ends,
+                Cr::Containers::ArrayView<vec3f> results,
+                bool allowSliding);
 
   bool loadNavMesh(const std::string& path);
 
@@ -255,7 +610,9 @@ struct PathFinder::Impl {
       const vec3f& pt,
       const float maxSearchRadius = 2.0) const;
 
-  bool isNavigable(const vec3f& pt, const float maxYDelta = 0.5) const;
+  bool isNavigable(const vec3f& pt, const float maxYDelta = 0.5) const {
+    return navigablePolyRef(navQuery_.get(), pt, maxYDelta) != 0;
+  }
 
   std::pair<vec3f, vec3f> bounds() const { return bounds_; };
 
@@ -263,18 +620,29 @@ struct PathFinder::Impl {
       const float metersPerPixel,
       const float height);
 
+  Eigen::Matrix<uint8_t, Eigen::Dynamic, Eigen::Dynamic> getTopDownIslandView(
+      const float metersPerPixel,
+      const float height);
+
   const assets::MeshData::ptr getNavMeshData();
 
- private:
-  struct NavMeshDeleter {
-    void operator()(dtNavMesh* mesh) { dtFreeNavMesh(mesh); }
-  };
-  struct NavQueryDeleter {
-    void operator()(dtNavMeshQuery* query) { dtFreeNavMeshQuery(query); }
-  };
+  bool supportsObstacles() const { return tileCache_ != nullptr; }
+
+  bool setObstacle(int obstacleID,
+                   const vec3f& center,
+                   const vec3f& halfExtents,
+                   float yRotation);
 
-  std::unique_ptr<dtNavMesh, NavMeshDeleter> navMesh_ = nullptr;
-  std::unique_ptr<dtNavMeshQuery, NavQueryDeleter> navQuery_ = nullptr;
+  bool removeObstacle(int obstacleID);
+
+  std::vector<int> getObstacleIDs() const;
+
+  bool updateObstacles();
+
+ private:
+  //! Shared with the distance fields built on it
+  std::shared_ptr<dtNavMesh> navMesh_ = nullptr;
+  NavQueryPtr navQuery_ = nullptr;
   std::unique_ptr<dtQueryFilter> filter_ = nullptr;
   std::unique_ptr<impl::IslandSystem> islandSystem_ = nullptr;
 
@@ -286,23 +654,137 @@ struct PathFinder::Impl {
   //! removeZeroAreaPolys.
   float navMeshArea_ = 0;
 
+  //! Changes whenever polygon references may change, i.e. on navmesh
+  //! (re)initialization and updateObstacles, which gives the rebuilt
+  //! polygons new salts. Paths snapped on another generation are snapped
+  //! again, see findPathSetup.
+  std::uint64_t navMeshGeneration_ = 0;
+  //! Generation of navMesh_ shared with the distance fields built on it.
+  //! Replaced along with the navmesh, so fields built on a previous one
+  //! stay valid, but updated with it by updateObstacles.
+  std::shared_ptr<std::uint64_t> sharedNavMeshGeneration_ = nullptr;
+
   std::pair<vec3f, vec3f> bounds_;
 
+  //! Query objects for batched queries, see forEachBatch. A dtNavMeshQuery
+  //! keeps its search state in itself, so each concurrent query needs its
+  //! own; the navmesh is only read.
+  std::vector<NavQueryPtr> batchQueries_;
+  std::mutex batchQueriesMutex_;
+  //! Created on the first batched query
+  std::unique_ptr<core::TaskScheduler> batchScheduler_ = nullptr;
+
+  //! Recent results of getTopDownView, by meters per pixel and height. Reset
+  //! with navQuery_.
+  static constexpr std::size_t MAX_CACHED_TOP_DOWN_VIEWS = 4;
+  std::vector<std::tuple<float,
+                         float,
+                         Eigen::Matrix<bool, Eigen::Dynamic, Eigen::Dynamic>>>
+      topDownViews_;
+
+  //! Sample points of a top-down map, see getTopDownView
+  struct TopDownGrid {
+    std::vector<float> xs, zs;
+  };
+
+  //! Tile cache of navmeshes built with NavMeshSettings::tileSize, see
+  //! buildTileCache. The helpers are used by the tile cache, so they're
+  //! declared first to outlive it.
+  std::unique_ptr<dtTileCacheAlloc> tileCacheAlloc_ = nullptr;
+  std::unique_ptr<dtTileCacheCompressor> tileCacheCompressor_ = nullptr;
+  std::unique_ptr<dtTileCacheMeshProcess> tileCacheMeshProcess_ = nullptr;
+  std::unique_ptr<dtTileCache, TileCacheDeleter> tileCache_ = nullptr;
+
+  struct Obstacle {
+    dtObstacleRef ref;
+    vec3f center;
+    vec3f halfExtents;
+    float yRotation;
+  };
+  //! By the IDs passed to setObstacle
+  std::map<int, Obstacle> obstacles_;
+
+  bool buildTileCache(const NavMeshSettings& bs,
+                      const rcConfig& meshCfg,
+                      const float* verts,
+                      const int nverts,
+                      const int* tris,
+                      const int ntris);
+
+  void resetTileCache();
+
+  //! Call @p request, an obstacle change of tileCache_, processing the
+  //! pending changes first if its request queue is full
+  dtStatus requestObstacleChange(const std::function<dtStatus()>& request);
+
   void removeZeroAreaPolys();
 
   bool initNavQuery();
 
+  NavQueryPtr acquireBatchQuery();
+  void releaseBatchQuery(NavQueryPtr query);
+
+  /**
+   * @brief Call fn(query, begin, end) for chunks of [0, count) in parallel,
+   * each with a query object no other chunk uses at the same time. Returns
+   * false without calling fn if there's no navmesh.
+   */
+  bool forEachBatch(
+      std::size_t count,
+      const std::function<void(dtNavMeshQuery*, std::size_t, std::size_t)>&
+          fn);
+
+  bool findPath(dtNavMeshQuery* navQuery, ShortestPath& path);
+  bool findPath(dtNavMeshQuery* navQuery, MultiGoalShortestPath& path);
+
+  template <typename T>
+  T tryStep(dtNavMeshQuery* navQuery,
+            const T& start,
+            const T& end,
+            bool allowSliding);
+
+  template <typename T>
+  T snapPoint(const dtNavMeshQuery* navQuery, const T& pt);
+
   Cr::Containers::Optional<std::tuple<float, std::vector<vec3f>>>
-  findPathInternal(const vec3f& start,
+  findPathInternal(dtNavMeshQuery* navQuery,
+                   const vec3f& start,
                    dtPolyRef startRef,
                    const vec3f& pathStart,
                    const vec3f& end,
                    dtPolyRef endRef,
                    const vec3f& pathEnd);
 
-  bool findPathSetup(MultiGoalShortestPath& path,
+  bool findPathSetup(const dtNavMeshQuery* navQuery,
+                     MultiGoalShortestPath& path,
                      dtPolyRef& startRef,
                      vec3f& pathStart);
+
+  //! The polygon @p pt is navigable on, or 0, see isNavigable
+  dtPolyRef navigablePolyRef(const dtNavMeshQuery* navQuery,
+                             const vec3f& pt,
+                             const float maxYDelta) const;
+
+  TopDownGrid topDownGrid(const float metersPerPixel) const;
+
+  /**
+   * @brief Call fn(query, point, row, column) in parallel for the points of
+   * @p grid at @p height which can be navigable, those within reach of a
+   * navmesh triangle. Others aren't navigable. Returns false if the queries
+   * can't be set up.
+   */
+  bool forEachTopDownCandidate(
+      const TopDownGrid& grid,
+      const float height,
+      const float maxYDelta,
+      const std::function<void(dtNavMeshQuery*, const vec3f&, int, int)>& fn);
+
+  //! The end whose polygon a search from the start reaches first, or
+  //! NullOpt if none is connected to it
+  Cr::Containers::Optional<std::size_t> findClosestEnd(
+      const MultiGoalShortestPath& path,
+      dtPolyRef startRef,
+      const vec3f& pathStart);
 };
 
 namespace {
@@ -332,6 +814,106 @@ enum PolyFlags {
   POLYFLAGS_DISABLED = 0x04,  // disabled polygon
   POLYFLAGS_ALL = 0xffff      // all abilities
 };
+
+// Layer sizes are stored in bytes
+constexpr int MAX_TILE_CACHE_TILE_SIZE = 255;
+// Floors a tile can have above each other
+constexpr int MAX_TILE_CACHE_LAYERS = 8;
+// Poly refs have 22 bits for the tile and polygon indices
+constexpr int MAX_TILE_CACHE_TILE_BITS = 14;
+constexpr int MAX_TILE_CACHE_OBSTACLES = 4096;
+
+struct TileWorkspace {
+  rcHeightfield* solid = nullptr;
+  rcCompactHeightfield* chf = nullptr;
+  rcHeightfieldLayerSet* lset = nullptr;
+
+  ~TileWorkspace() {
+    rcFreeHeightField(solid);
+    rcFreeCompactHeightfield(chf);
+    rcFreeHeightfieldLayerSet(lset);
+  }
+};
+
+// Scratch memory of a tile rebuild, released all at once when the tile cache
+// starts the next one
+class TileCacheAllocator : public dtTileCacheAlloc {
+ public:
+  void reset() override {
+    top_ = 0;
+    overflow_.clear();
+  }
+
+  void* alloc(const size_t size) override {
+    // keeps the 16 byte alignment of the buffer
+    const std::size_t alignedSize = (size + 15) & ~std::size_t{15};
+    if (top_ + alignedSize > buffer_.size()) {
+      overflow_.emplace_back(new unsigned char[size]);
+      return overflow_.back().get();
+    }
+    void* mem = buffer_.data() + top_;
+    top_ += alignedSize;
+    return mem;
+  }
+
+  void free(void*) override {}
+
+ private:
+  std::vector<unsigned char> buffer_ = std::vector<unsigned char>(256 * 1024);
+  std::size_t top_ = 0;
+  std::vector<std::unique_ptr<unsigned char[]>> overflow_;
+};
+
+// Layers stay in memory and are small, so they're stored as is
+class TileCacheCompressor : public dtTileCacheCompressor {
+ public:
+  int maxCompressedSize(const int bufferSize) override { return bufferSize; }
+
+  dtStatus compress(const unsigned char* buffer,
+                    const int bufferSize,
+                    unsigned char* compressed,
+                    const int maxCompressedSize,
+                    int* compressedSize) override {
+    if (bufferSize > maxCompressedSize) {
+      return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+    }
+    memcpy(compressed, buffer, bufferSize);
+    *compressedSize = bufferSize;
+    return DT_SUCCESS;
+  }
+
+  dtStatus decompress(const unsigned char* compressed,
+                      const int compressedSize,
+                      unsigned char* buffer,
+                      const int maxBufferSize,
+                      int* bufferSize) override {
+    if (compressedSize > maxBufferSize) {
+      return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+    }
+    memcpy(buffer, compressed, compressedSize);
+    *bufferSize = compressedSize;
+    return DT_SUCCESS;
+  }
+};
+
+// Same areas and flags as the polygons of an untiled navmesh
+class TileCacheMeshProcess : public dtTileCacheMeshProcess {
+ public:
+  void process(dtNavMeshCreateParams* params,
+               unsigned char* polyAreas,
+               unsigned short* polyFlags) override {
+    for (int i = 0; i < params->polyCount; ++i) {
+      if (polyAreas[i] == DT_TILECACHE_WALKABLE_AREA) {
+        polyAreas[i] = POLYAREA_GROUND;
+      }
+      if (polyAreas[i] == POLYAREA_GROUND) {
+        polyFlags[i] = POLYFLAGS_WALK;
+      } else if (polyAreas[i] == POLYAREA_DOOR) {
+        polyFlags[i] = POLYFLAGS_WALK | POLYFLAGS_DOOR;
+      }
+    }
+  }
+};
 }  // namespace
 
 PathFinder::Impl::Impl() {
@@ -383,6 +965,10 @@ bool PathFinder::Impl::build(const NavMeshSettings& bs,
   LOG(INFO) << "Building navmesh with " << cfg.width << "x" << cfg.height
             << " cells";
 
+  if (bs.tileSize > 0) {
+    return buildTileCache(bs, cfg, verts, nverts, tris, ntris);
+  }
+
   //
   // Step 2. Rasterize input polygon soup.
   //
@@ -626,7 +1212,8 @@ bool PathFinder::Impl::build(const NavMeshSettings& bs,
       return false;
     }
 
-    navMesh_.reset(dtAllocNavMesh());
+    resetTileCache();
+    navMesh_.reset(dtAllocNavMesh(), NavMeshDeleter{});
     if (!navMesh_) {
       dtFree(navData);
       LOG(ERROR) << "Could not allocate Detour navmesh";
@@ -660,6 +1247,10 @@ bool PathFinder::Impl::initNavQuery() {
   // if we are reinitializing the NavQuery, then also reset the MeshData
   meshData_.reset();
 
+  // batch queries were initialized with the previous navmesh
+  batchQueries_.clear();
+  topDownViews_.clear();
+
   navQuery_.reset(dtAllocNavMeshQuery());
   dtStatus status = navQuery_->init(navMesh_.get(), 2048);
   if (dtStatusFailed(status)) {
@@ -669,6 +1260,9 @@ bool PathFinder::Impl::initNavQuery() {
 
   islandSystem_ =
       std::make_unique<impl::IslandSystem>(navMesh_.get(), filter_.get());
+  navMeshGeneration_ = ++lastNavMeshGeneration;
+  sharedNavMeshGeneration_ =
+      std::make_shared<std::uint64_t>(navMeshGeneration_);
 
   return true;
 }
@@ -698,6 +1292,351 @@ bool PathFinder::Impl::build(const NavMeshSettings& bs,
   return success;
 }
 
+// Builds the navmesh in tiles, following Recast's temporary obstacles sample.
+// The walkable layers of each tile are kept in the tile cache, so a tile can
+// be rebuilt with the obstacles over it without rasterizing the scene again.
+bool PathFinder::Impl::buildTileCache(const NavMeshSettings& bs,
+                                      const rcConfig& meshCfg,
+                                      const float* verts,
+                                      const int nverts,
+                                      const int* tris,
+                                      const int ntris) {
+  rcContext ctx;
+
+  const int tileSize = bs.tileSize;
+  if (tileSize > MAX_TILE_CACHE_TILE_SIZE) {
+    LOG(ERROR) << "NavMeshSettings::tileSize " << tileSize
+               << " is larger than " << MAX_TILE_CACHE_TILE_SIZE;
+    return false;
+  }
+
+  // Tiles are rasterized with a border, so that erosion at their edges sees
+  // the geometry of their neighbours
+  rcConfig cfg = meshCfg;
+  cfg.tileSize = tileSize;
+  cfg.borderSize = cfg.walkableRadius + 3;
+  cfg.width = tileSize + cfg.borderSize * 2;
+  cfg.height = tileSize + cfg.borderSize * 2;
+  const int tilesX = (meshCfg.width + tileSize - 1) / tileSize;
+  const int tilesZ = (meshCfg.height + tileSize - 1) / tileSize;
+  const float tileWidth = tileSize * cfg.cs;
+  const float border = cfg.borderSize * cfg.cs;
+
+  dtTileCacheParams tcparams{};
+  memset(&tcparams, 0, sizeof(tcparams));
+  rcVcopy(tcparams.orig, cfg.bmin);
+  tcparams.cs = cfg.cs;
+  tcparams.ch = cfg.ch;
+  tcparams.width = tileSize;
+  tcparams.height = tileSize;
+  tcparams.walkableHeight = bs.agentHeight;
+  tcparams.walkableRadius = bs.agentRadius;
+  tcparams.walkableClimb = bs.agentMaxClimb;
+  tcparams.maxSimplificationError = cfg.maxSimplificationError;
+  tcparams.maxTiles = tilesX * tilesZ * MAX_TILE_CACHE_LAYERS;
+  tcparams.maxObstacles = MAX_TILE_CACHE_OBSTACLES;
+
+  const int tileBits = dtIlog2(dtNextPow2(tcparams.maxTiles));
+  if (tileBits > MAX_TILE_CACHE_TILE_BITS) {
+    LOG(ERROR) << "Navmesh with " << tilesX << "x" << tilesZ
+               << " tiles has too many tiles, increase "
+                  "NavMeshSettings::tileSize";
+    return false;
+  }
+
+  // Released in reverse order, so the tile cache goes before its helpers
+  std::unique_ptr<dtTileCacheAlloc> alloc =
+      std::make_unique<TileCacheAllocator>();
+  std::unique_ptr<dtTileCacheCompressor> compressor =
+      std::make_unique<TileCacheCompressor>();
+  std::unique_ptr<dtTileCacheMeshProcess> meshProcess =
+      std::make_unique<TileCacheMeshProcess>();
+  std::unique_ptr<dtTileCache, TileCacheDeleter> tileCache{dtAllocTileCache()};
+  if (!tileCache ||
+      dtStatusFailed(tileCache->init(&tcparams, alloc.get(), compressor.get(),
+                                     meshProcess.get()))) {
+    LOG(ERROR) << "Could not init tile cache";
+    return false;
+  }
+
+  dtNavMeshParams params{};
+  memset(&params, 0, sizeof(params));
+  rcVcopy(params.orig, cfg.bmin);
+  params.tileWidth = tileWidth;
+  params.tileHeight = tileWidth;
+  params.maxTiles = 1 << tileBits;
+  params.maxPolys = 1 << (22 - tileBits);
+  std::shared_ptr<dtNavMesh> navMesh(dtAllocNavMesh(), NavMeshDeleter{});
+  if (!navMesh || dtStatusFailed(navMesh->init(&params))) {
+    LOG(ERROR) << "Could not init Detour navmesh";
+    return false;
+  }
+
+  // Triangles overlapping each tile and its border
+  std::vector<std::vector<int>> tileTris(tilesX * tilesZ);
+  for (int i = 0; i < ntris; ++i) {
+    const float* v[3] = {&verts[tris[i * 3] * 3], &verts[tris[i * 3 + 1] * 3],
+                         &verts[tris[i * 3 + 2] * 3]};
+    const float minX = std::min({v[0][0], v[1][0], v[2][0]}) - cfg.bmin[0];
+    const float maxX = std::max({v[0][0], v[1][0], v[2][0]}) - cfg.bmin[0];
+    const float minZ = std::min({v[0][2], v[1][2], v[2][2]}) - cfg.bmin[2];
+    const float maxZ = std::max({v[0][2], v[1][2], v[2][2]}) - cfg.bmin[2];
+    const int tx0 = std::max(int(floorf((minX - border) / tileWidth)), 0);
+    const int tx1 =
+        std::min(int(floorf((maxX + border) / tileWidth)), tilesX - 1);
+    const int tz0 = std::max(int(floorf((minZ - border) / tileWidth)), 0);
+    const int tz1 =
+        std::min(int(floorf((maxZ + border) / tileWidth)), tilesZ - 1);
+    for (int tz = tz0; tz <= tz1; ++tz) {
+      for (int tx = tx0; tx <= tx1; ++tx) {
+        std::vector<int>& indices = tileTris[tz * tilesX + tx];
+        indices.insert(indices.end(), &tris[i * 3], &tris[i * 3 + 3]);
+      }
+    }
+  }
+
+  int numLayers = 0;
+  std::vector<unsigned char> triareas;
+  for (int tz = 0; tz < tilesZ; ++tz) {
+    for (int tx = 0; tx < tilesX; ++tx) {
+      const std::vector<int>& indices = tileTris[tz * tilesX + tx];
+      if (indices.empty()) {
+        continue;
+      }
+      const int numTileTris = indices.size() / 3;
+
+      rcConfig tcfg = cfg;
+      tcfg.bmin[0] = cfg.bmin[0] + tx * tileWidth - border;
+      tcfg.bmin[2] = cfg.bmin[2] + tz * tileWidth - border;
+      tcfg.bmax[0] = cfg.bmin[0] + (tx + 1) * tileWidth + border;
+      tcfg.bmax[2] = cfg.bmin[2] + (tz + 1) * tileWidth + border;
+
+      // Same steps as the untiled build up to the compact heightfield
+      TileWorkspace ws;
+      ws.solid = rcAllocHeightfield();
+      if (!ws.solid ||
+          !rcCreateHeightfield(&ctx, *ws.solid, tcfg.width, tcfg.height,
+                               tcfg.bmin, tcfg.bmax, tcfg.cs, tcfg.ch)) {
+        LOG(ERROR) << "Could not create solid heightfield";
+        return false;
+      }
+      triareas.assign(numTileTris, 0);
+      rcMarkWalkableTriangles(&ctx, tcfg.walkableSlopeAngle, verts, nverts,
+                              indices.data(), numTileTris, triareas.data());
+      if (!rcRasterizeTriangles(&ctx, verts, nverts, indices.data(),
+                                triareas.data(), numTileTris, *ws.solid,
+                                tcfg.walkableClimb)) {
+        LOG(ERROR) << "Could not rasterize triangles.";
+        return false;
+      }
+
+      if (bs.filterLowHangingObstacles)
+        rcFilterLowHangingWalkableObstacles(&ctx, tcfg.walkableClimb,
+                                            *ws.solid);
+      if (bs.filterLedgeSpans)
+        rcFilterLedgeSpans(&ctx, tcfg.walkableHeight, tcfg.walkableClimb,
+                           *ws.solid);
+      if (bs.filterWalkableLowHeightSpans)
+        rcFilterWalkableLowHeightSpans(&ctx, tcfg.walkableHeight, *ws.solid);
+
+      ws.chf = rcAllocCompactHeightfield();
+      if (!ws.chf ||
+          !rcBuildCompactHeightfield(&ctx, tcfg.walkableHeight,
+                                     tcfg.walkableClimb, *ws.solid, *ws.chf)) {
+        LOG(ERROR) << "Could not build compact heightfield";
+        return false;
+      }
+      if (!rcErodeWalkableArea(&ctx, tcfg.walkableRadius, *ws.chf)) {
+        LOG(ERROR) << "Could not erode walkable area";
+        return false;
+      }
+
+      ws.lset = rcAllocHeightfieldLayerSet();
+      if (!ws.lset ||
+          !rcBuildHeightfieldLayers(&ctx, *ws.chf, tcfg.borderSize,
+                                    tcfg.walkableHeight, *ws.lset)) {
+        LOG(ERROR) << "Could not build heightfield layers";
+        return false;
+      }
+
+      for (int i = 0; i < std::min(ws.lset->nlayers, MAX_TILE_CACHE_LAYERS);
+           ++i) {
+        const rcHeightfieldLayer& layer = ws.lset->layers[i];
+        dtTileCacheLayerHeader header{};
+        memset(&header, 0, sizeof(header));
+        header.magic = DT_TILECACHE_MAGIC;
+        header.version = DT_TILECACHE_VERSION;
+        header.tx = tx;
+        header.ty = tz;
+        header.tlayer = i;
+        rcVcopy(header.bmin, layer.bmin);
+        rcVcopy(header.bmax, layer.bmax);
+        header.width = static_cast<unsigned char>(layer.width);
+        header.height = static_cast<unsigned char>(layer.height);
+        header.minx = static_cast<unsigned char>(layer.minx);
+        header.maxx = static_cast<unsigned char>(layer.maxx);
+        header.miny = static_cast<unsigned char>(layer.miny);
+        header.maxy = static_cast<unsigned char>(layer.maxy);
+        header.hmin = static_cast<unsigned short>(layer.hmin);
+        header.hmax = static_cast<unsigned short>(layer.hmax);
+
+        unsigned char* data = nullptr;
+        int dataSize = 0;
+        dtStatus status =
+            dtBuildTileCacheLayer(compressor.get(), &header, layer.heights,
+                                  layer.areas, layer.cons, &data, &dataSize);
+        if (dtStatusSucceed(status)) {
+          status = tileCache->addTile(data, dataSize,
+                                      DT_COMPRESSEDTILE_FREE_DATA, nullptr);
+          if (dtStatusFailed(status)) {
+            dtFree(data);
+          }
+        }
+        if (dtStatusFailed(status)) {
+          LOG(ERROR) << "Could not add layer " << i << " of tile " << tx
+                     << ", " << tz << " to the tile cache";
+          return false;
+        }
+        ++numLayers;
+      }
+
+      if (dtStatusFailed(
+              tileCache->buildNavMeshTilesAt(tx, tz, navMesh.get()))) {
+        LOG(ERROR) << "Could not build navmesh tile " << tx << ", " << tz;
+        return false;
+      }
+    }
+  }
+
+  resetTileCache();
+  tileCacheAlloc_ = std::move(alloc);
+  tileCacheCompressor_ = std::move(compressor);
+  tileCacheMeshProcess_ = std::move(meshProcess);
+  tileCache_ = std::move(tileCache);
+  navMesh_ = std::move(navMesh);
+  if (!initNavQuery()) {
+    return false;
+  }
+
+  bounds_ = std::make_pair(vec3f(cfg.bmin), vec3f(cfg.bmax));
+
+  removeZeroAreaPolys();
+
+  LOG(INFO) << "Created navmesh with " << tilesX << "x" << tilesZ
+            << " tiles of " << numLayers << " layers";
+
+  return true;
+}
+
+void PathFinder::Impl::resetTileCache() {
+  tileCache_.reset();
+  tileCacheMeshProcess_.reset();
+  tileCacheCompressor_.reset();
+  tileCacheAlloc_.reset();
+  obstacles_.clear();
+}
+
+dtStatus PathFinder::Impl::requestObstacleChange(
+    const std::function<dtStatus()>& request) {
+  dtStatus status = request();
+  if (dtStatusDetail(status, DT_BUFFER_TOO_SMALL) && updateObstacles()) {
+    status = request();
+  }
+  return status;
+}
+
+bool PathFinder::Impl::setObstacle(int obstacleID,
+                                   const vec3f& center,
+                                   const vec3f& halfExtents,
+                                   float yRotation) {
+  if (!tileCache_) {
+    LOG(ERROR) << "PathFinder::setObstacle: the navmesh doesn't support "
+                  "obstacles, build it with a positive "
+                  "NavMeshSettings::tileSize";
+    return false;
+  }
+
+  auto it = obstacles_.find(obstacleID);
+  if (it != obstacles_.end()) {
+    const Obstacle& obstacle = it->second;
+    if (obstacle.center == center && obstacle.halfExtents == halfExtents &&
+        obstacle.yRotation == yRotation) {
+      return true;
+    }
+    if (!removeObstacle(obstacleID)) {
+      return false;
+    }
+  }
+
+  dtObstacleRef ref = 0;
+  const dtStatus status = requestObstacleChange([&]() {
+    return tileCache_->addBoxObstacle(center.data(), halfExtents.data(),
+                                      yRotation, &ref);
+  });
+  if (dtStatusFailed(status)) {
+    LOG(ERROR) << "PathFinder::setObstacle: could not add obstacle "
+               << obstacleID << ", there can be at most "
+               << MAX_TILE_CACHE_OBSTACLES;
+    return false;
+  }
+  obstacles_[obstacleID] = Obstacle{ref, center, halfExtents, yRotation};
+  return true;
+}
+
+bool PathFinder::Impl::removeObstacle(int obstacleID) {
+  auto it = obstacles_.find(obstacleID);
+  if (it == obstacles_.end()) {
+    return false;
+  }
+  const dtObstacleRef ref = it->second.ref;
+  if (dtStatusFailed(requestObstacleChange(
+          [&]() { return tileCache_->removeObstacle(ref); }))) {
+    LOG(ERROR) << "PathFinder::removeObstacle: could not remove obstacle "
+               << obstacleID;
+    return false;
+  }
+  obstacles_.erase(obstacleID);
+  return true;
+}
+
+std::vector<int> PathFinder::Impl::getObstacleIDs() const {
+  std::vector<int> obstacleIDs;
+  obstacleIDs.reserve(obstacles_.size());
+  for (const auto& obstacle : obstacles_) {
+    obstacleIDs.push_back(obstacle.first);
+  }
+  return obstacleIDs;
+}
+
+bool PathFinder::Impl::updateObstacles() {
+  if (!tileCache_) {
+    LOG(ERROR) << "PathFinder::updateObstacles: the navmesh doesn't support "
+                  "obstacles, build it with a positive "
+                  "NavMeshSettings::tileSize";
+    return false;
+  }
+
+  // Each update rebuilds a limited number of tiles
+  bool upToDate = false;
+  while (!upToDate) {
+    if (dtStatusFailed(tileCache_->update(0, navMesh_.get(), &upToDate))) {
+      LOG(ERROR) << "PathFinder::updateObstacles: could not rebuild tiles";
+      return false;
+    }
+  }
+
+  // Same as after a build, except the queries stay valid for the navmesh
+  // object, which is updated in place
+  meshData_.reset();
+  topDownViews_.clear();
+  removeZeroAreaPolys();
+  islandSystem_ =
+      std::make_unique<impl::IslandSystem>(navMesh_.get(), filter_.get());
+  navMeshGeneration_ = ++lastNavMeshGeneration;
+  *sharedNavMeshGeneration_ = navMeshGeneration_;
+  return true;
+}
+
 namespace {
 const int NAVMESHSET_MAGIC = 'M' << 24 | 'S' << 16 | 'E' << 8 | 'T';  //'MSET';
 const int NAVMESHSET_VERSION = 1;
@@ -769,7 +1708,7 @@ void PathFinder::Impl::removeZeroAreaPolys() {
   for (int iTile = 0; iTile < navMesh_->getMaxTiles(); ++iTile) {
     const dtMeshTile* tile =
         const_cast<const dtNavMesh*>(navMesh_.get())->getTile(iTile);
-    if (!tile)
+    if (!tile || !tile->header)
       continue;
 
     // Iterate over all polygons in a tile
@@ -865,7 +1804,9 @@ bool PathFinder::Impl::loadNavMesh(const std::string& path) {
 
   fclose(fp);
 
-  navMesh_.reset(mesh);
+  // the tile cache of a built navmesh doesn't match the loaded one
+  resetTileCache();
+  navMesh_.reset(mesh, NavMeshDeleter{});
   bounds_ = std::make_pair(bmin, bmax);
 
   removeZeroAreaPolys();
@@ -967,12 +1908,12 @@ float pathLength(const std::vector<vec3f>& points) {
 }
 }  // namespace
 
-bool PathFinder::Impl::findPath(ShortestPath& path) {
+bool PathFinder::Impl::findPath(dtNavMeshQuery* navQuery, ShortestPath& path) {
   MultiGoalShortestPath tmp;
   tmp.requestedStart = path.requestedStart;
   tmp.setRequestedEnds({path.requestedEnd});
 
-  bool status = findPath(tmp);
+  bool status = findPath(navQuery, tmp);
 
   path.geodesicDistance = tmp.geodesicDistance;
   path.points = std::move(tmp.points);
@@ -980,7 +1921,8 @@ bool PathFinder::Impl::findPath(ShortestPath& path) {
 }
 
 Cr::Containers::Optional<std::tuple<float, std::vector<vec3f>>>
-PathFinder::Impl::findPathInternal(const vec3f& start,
+PathFinder::Impl::findPathInternal(dtNavMeshQuery* navQuery,
+                                   const vec3f& start,
                                    dtPolyRef startRef,
                                    const vec3f& pathStart,
                                    const vec3f& end,
@@ -1001,17 +1943,17 @@ PathFinder::Impl::findPathInternal(const vec3f& start,
 
   int numPolys = 0;
   dtStatus status =
-      navQuery_->findPath(startRef, endRef, pathStart.data(), pathEnd.data(),
-                          filter_.get(), polys, &numPolys, MAX_POLYS);
+      navQuery->findPath(startRef, endRef, pathStart.data(), pathEnd.data(),
+                         filter_.get(), polys, &numPolys, MAX_POLYS);
   if (status != DT_SUCCESS || numPolys == 0) {
     return Cr::Containers::NullOpt;
   }
 
   int numPoints = 0;
   std::vector<vec3f> points(MAX_POLYS);
-  status = navQuery_->findStraightPath(start.data(), end.data(), polys,
-                                       numPolys, points[0].data(), nullptr,
-                                       nullptr, &numPoints, MAX_POLYS);
+  status = navQuery->findStraightPath(start.data(), end.data(), polys,
+                                      numPolys, points[0].data(), nullptr,
+                                      nullptr, &numPoints, MAX_POLYS);
   if (status != DT_SUCCESS || numPoints == 0) {
     return Corrade::Containers::NullOpt;
   }
@@ -1023,7 +1965,8 @@ PathFinder::Impl::findPathInternal(const vec3f& start,
   return std::make_tuple(length, std::move(points));
 }
 
-bool PathFinder::Impl::findPathSetup(MultiGoalShortestPath& path,
+bool PathFinder::Impl::findPathSetup(const dtNavMeshQuery* navQuery,
+                                     MultiGoalShortestPath& path,
                                      dtPolyRef& startRef,
                                      vec3f& pathStart) {
   path.geodesicDistance = std::numeric_limits<float>::infinity();
@@ -1032,20 +1975,27 @@ bool PathFinder::Impl::findPathSetup(MultiGoalShortestPath& path,
   // find nearest polys and path
   dtStatus status = 0;
   std::tie(status, startRef, pathStart) =
-      projectToPoly(path.requestedStart, navQuery_.get(), filter_.get());
+      projectToPoly(path.requestedStart, navQuery, filter_.get());
 
   if (status != DT_SUCCESS || startRef == 0) {
     return false;
   }
 
-  if (path.pimpl_->endRefs.size() != 0)
+  // the ends are snapped once per navmesh generation
+  if (path.pimpl_->navMeshGeneration == navMeshGeneration_)
     return true;
 
+  // distances from before the navmesh changed aren't bounds anymore
+  path.pimpl_->endRefs.clear();
+  path.pimpl_->pathEnds.clear();
+  std::fill(path.pimpl_->minTheoreticalDist.begin(),
+            path.pimpl_->minTheoreticalDist.end(), 0.0f);
+  path.pimpl_->prevRequestedStart = path.requestedStart;
   for (const auto& rqEnd : path.getRequestedEnds()) {
     dtPolyRef endRef = 0;
     vec3f pathEnd;
     std::tie(status, endRef, pathEnd) =
-        projectToPoly(rqEnd, navQuery_.get(), filter_.get());
+        projectToPoly(rqEnd, navQuery, filter_.get());
 
     if (status != DT_SUCCESS || endRef == 0) {
       return false;
@@ -1054,57 +2004,175 @@ bool PathFinder::Impl::findPathSetup(MultiGoalShortestPath& path,
     path.pimpl_->endRefs.emplace_back(endRef);
     path.pimpl_->pathEnds.emplace_back(pathEnd);
   }
+  path.pimpl_->navMeshGeneration = navMeshGeneration_;
 
   return true;
 }
 
-bool PathFinder::Impl::findPath(MultiGoalShortestPath& path) {
+Cr::Containers::Optional<std::size_t> PathFinder::Impl::findClosestEnd(
+    const MultiGoalShortestPath& path,
+    dtPolyRef startRef,
+    const vec3f& pathStart) {
+  const std::vector<dtPolyRef>& endRefs = path.pimpl_->endRefs;
+  std::unordered_map<dtPolyRef, std::size_t> endOfPolys;
+  for (std::size_t i = 0; i < endRefs.size(); ++i) {
+    if (islandSystem_->hasConnection(startRef, endRefs[i])) {
+      endOfPolys.emplace(endRefs[i], i);
+    }
+  }
+  if (endOfPolys.empty()) {
+    return Cr::Containers::NullOpt;
+  }
+
+  // Dijkstra over polygons, with the same costs as Detour's A*: from portal
+  // midpoint to portal midpoint. It stops at the first polygon with an end.
+  struct SearchNode {
+    float cost;
+    dtPolyRef parent;
+    vec3f pos;
+    bool closed;
+  };
+  std::unordered_map<dtPolyRef, SearchNode> nodes;
+  using QueueEntry = std::pair<float, dtPolyRef>;
+  std::priority_queue<QueueEntry, std::vector<QueueEntry>,
+                      std::greater<QueueEntry>>
+      queue;
+  nodes[startRef] = {0.0f, 0, pathStart, false};
+  queue.emplace(0.0f, startRef);
+
+  while (!queue.empty()) {
+    const dtPolyRef ref = queue.top().second;
+    const float cost = queue.top().first;
+    queue.pop();
+    SearchNode& node = nodes[ref];
+    if (node.closed || cost > node.cost) {
+      continue;
+    }
+    node.closed = true;
+    const vec3f pos = node.pos;
+    const dtPolyRef parentRef = node.parent;
+
+    const auto end = endOfPolys.find(ref);
+    if (end != endOfPolys.end()) {
+      return end->second;
+    }
+
+    const dtMeshTile* tile = nullptr;
+    const dtPoly* poly = nullptr;
+    navMesh_->getTileAndPolyByRefUnsafe(ref, &tile, &poly);
+    for (unsigned int iLink = poly->firstLink; iLink != DT_NULL_LINK;
+         iLink = tile->links[iLink].next) {
+      const dtLink& link = tile->links[iLink];
+      const dtPolyRef neighbourRef = link.ref;
+      if (!neighbourRef || neighbourRef == parentRef)
+        continue;
+
+      const dtMeshTile* neighbourTile = nullptr;
+      const dtPoly* neighbourPoly = nullptr;
+      navMesh_->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile,
+                                          &neighbourPoly);
+      if (!filter_->passFilter(neighbourRef, neighbourTile, neighbourPoly))
+        continue;
+
+      // midpoint of the portal, which on tile borders is only part of the
+      // edge. Same as dtNavMeshQuery::getEdgeMidPoint().
+      const vec3f a =
+          Eigen::Map<const vec3f>(&tile->verts[poly->verts[link.edge] * 3]);
+      const vec3f b = Eigen::Map<const vec3f>(
+          &tile->verts[poly->verts[(link.edge + 1) % poly->vertCount] * 3]);
+      float tmin = 0.0f, tmax = 1.0f;
+      if (link.side != 0xff) {
+        tmin = link.bmin / 255.0f;
+        tmax = link.bmax / 255.0f;
+      }
+      const vec3f mid = a + (b - a) * (0.5f * (tmin + tmax));
+
+      const float neighbourCost =
+          cost + filter_->getCost(pos.data(), mid.data(), parentRef, nullptr,
+                                  nullptr, ref, tile, poly, neighbourRef,
+                                  neighbourTile, neighbourPoly);
+      auto inserted = nodes.emplace(
+          neighbourRef,
+          SearchNode{std::numeric_limits<float>::infinity(), 0, mid, false});
+      SearchNode& neighbour = inserted.first->second;
+      if (neighbour.closed || neighbourCost >= neighbour.cost)
+        continue;
+      neighbour = {neighbourCost, ref, mid, false};
+      queue.emplace(neighbourCost, neighbourRef);
+    }
+  }
+
+  return Cr::Containers::NullOpt;
+}
+
+bool PathFinder::Impl::findPath(dtNavMeshQuery* navQuery,
+                                MultiGoalShortestPath& path) {
   dtPolyRef startRef = 0;
   vec3f pathStart;
-  if (!findPathSetup(path, startRef, pathStart))
+  if (!findPathSetup(navQuery, path, startRef, pathStart))
     return false;
 
-  if (path.pimpl_->requestedEnds.size() > 1) {
-    // Bound the minimum distance any point could be from the start by either
-    // how close it use to be minus how much we moved from the last search point
-    // or just the L2 distance.
+  const std::vector<vec3f>& requestedEnds = path.pimpl_->requestedEnds;
+  std::vector<float>& minTheoreticalDist = path.pimpl_->minTheoreticalDist;
 
+  // Bound the distance to each end by how far it was from the previous start
+  // minus how much the start moved, or by the straight line between the
+  // ends of the path. findStraightPath clamps both ends to their polygons the
+  // same way.
+  float movedAmount = std::numeric_limits<float>::infinity();
+  if (requestedEnds.size() > 1) {
     ShortestPath prevPath;
     prevPath.requestedStart = path.requestedStart;
     prevPath.requestedEnd = path.pimpl_->prevRequestedStart;
-    findPath(prevPath);
-    const float movedAmount = prevPath.geodesicDistance;
-
-    for (int i = 0; i < path.pimpl_->requestedEnds.size(); ++i) {
-      path.pimpl_->minTheoreticalDist[i] = std::max(
-          path.pimpl_->minTheoreticalDist[i] - movedAmount,
-          (path.pimpl_->requestedEnds[i] - path.requestedStart).norm());
-    }
+    findPath(navQuery, prevPath);
+    movedAmount = prevPath.geodesicDistance;
 
     path.pimpl_->prevRequestedStart = path.requestedStart;
   }
+  vec3f clampedStart;
+  navQuery->closestPointOnPolyBoundary(startRef, path.requestedStart.data(),
+                                       clampedStart.data());
+  for (std::size_t i = 0; i < requestedEnds.size(); ++i) {
+    vec3f clampedEnd;
+    navQuery->closestPointOnPolyBoundary(path.pimpl_->endRefs[i],
+                                         requestedEnds[i].data(),
+                                         clampedEnd.data());
+    minTheoreticalDist[i] = std::max(minTheoreticalDist[i] - movedAmount,
+                                     (clampedEnd - clampedStart).norm());
+  }
 
-  // Explore possible goal points by their minimum theoretical distance.
-  std::vector<size_t> ordering(path.pimpl_->requestedEnds.size());
+  // Explore the ends by their minimum theoretical distance, except for the
+  // one a single search from the start reaches first. Its path is usually the
+  // shortest, so most other ends are skipped without a search of their own.
+  std::vector<std::size_t> ordering(requestedEnds.size());
   std::iota(ordering.begin(), ordering.end(), 0);
   std::sort(ordering.begin(), ordering.end(),
-            [&path](const size_t a, const size_t b) -> bool {
-              return path.pimpl_->minTheoreticalDist[a] <
-                     path.pimpl_->minTheoreticalDist[b];
+            [&](std::size_t a, std::size_t b) {
+              return minTheoreticalDist[a] < minTheoreticalDist[b];
             });
+  if (requestedEnds.size() > 1) {
+    const Cr::Containers::Optional<std::size_t> closest =
+        findClosestEnd(path, startRef, pathStart);
+    if (closest) {
+      const auto it = std::find(ordering.begin(), ordering.end(), *closest);
+      std::rotate(ordering.begin(), it, it + 1);
+    }
+  }
 
-  for (size_t i : ordering) {
-    if (path.pimpl_->minTheoreticalDist[i] > path.geodesicDistance)
+  for (const std::size_t i : ordering) {
+    if (minTheoreticalDist[i] > path.geodesicDistance)
       continue;
 
     const Cr::Containers::Optional<std::tuple<float, std::vector<vec3f>>>
         findResult =
-            findPathInternal(path.requestedStart, startRef, pathStart,
-                             path.pimpl_->requestedEnds[i],
-                             path.pimpl_->endRefs[i], path.pimpl_->pathEnds[i]);
+            findPathInternal(navQuery, path.requestedStart, startRef, pathStart,
+                             requestedEnds[i], path.pimpl_->endRefs[i],
+                             path.pimpl_->pathEnds[i]);
+    if (!findResult)
+      continue;
 
-    if (findResult && std::get<0>(*findResult) < path.geodesicDistance) {
-      path.pimpl_->minTheoreticalDist[i] = std::get<0>(*findResult);
+    minTheoreticalDist[i] = std::get<0>(*findResult);
+    if (std::get<0>(*findResult) < path.geodesicDistance) {
       path.geodesicDistance = std::get<0>(*findResult);
       path.points = std::get<1>(*findResult);
     }
@@ -1114,7 +2182,10 @@ bool PathFinder::Impl::findPath(MultiGoalShortestPath& path) {
 }
 
 template <typename T>
-T PathFinder::Impl::tryStep(const T& start, const T& end, bool allowSliding) {
+T PathFinder::Impl::tryStep(dtNavMeshQuery* navQuery,
+                            const T& start,
+                            const T& end,
+                            bool allowSliding) {
   static const int MAX_POLYS = 256;
   dtPolyRef polys[MAX_POLYS];
 
@@ -1122,9 +2193,9 @@ T PathFinder::Impl::tryStep(const T& start, const T& end, bool allowSliding) {
   dtPolyRef startRef = 0, endRef = 0;
   vec3f pathStart;
   std::tie(startStatus, startRef, pathStart) =
-      projectToPoly(start, navQuery_.get(), filter_.get());
+      projectToPoly(start, navQuery, filter_.get());
   std::tie(endStatus, endRef, std::ignore) =
-      projectToPoly(end, navQuery_.get(), filter_.get());
+      projectToPoly(end, navQuery, filter_.get());
 
   if (dtStatusFailed(startStatus) || dtStatusFailed(endStatus)) {
     return start;
@@ -1136,9 +2207,9 @@ T PathFinder::Impl::tryStep(const T& start, const T& end, bool allowSliding) {
 
   vec3f endPoint;
   int numPolys = 0;
-  navQuery_->moveAlongSurface(startRef, pathStart.data(), end.data(),
-                              filter_.get(), endPoint.data(), polys, &numPolys,
-                              MAX_POLYS, allowSliding);
+  navQuery->moveAlongSurface(startRef, pathStart.data(), end.data(),
+                             filter_.get(), endPoint.data(), polys, &numPolys,
+                             MAX_POLYS, allowSliding);
   // If there isn't any possible path between start and end, just return
   // start, that is cleanest
   if (numPolys == 0) {
@@ -1153,7 +2224,7 @@ T PathFinder::Impl::tryStep(const T& start, const T& end, bool allowSliding) {
   // surface at the endPoint and set its height to that.
   // Note, this will never fail as endPoint is always within in the poly
   // polys[numPolys - 1]
-  navQuery_->getPolyHeight(polys[numPolys - 1], endPoint.data(), &endPoint[1]);
+  navQuery->getPolyHeight(polys[numPolys - 1], endPoint.data(), &endPoint[1]);
 
   // Hack to deal with infinitely thin walls in recast allowing you to
   // transition between two different connected components
@@ -1161,7 +2232,7 @@ T PathFinder::Impl::tryStep(const T& start, const T& end, bool allowSliding) {
   // is in the same connected component as the startRef according to
   // findNearestPoly
   std::tie(std::ignore, endRef, std::ignore) =
-      projectToPoly(endPoint, navQuery_.get(), filter_.get());
+      projectToPoly(endPoint, navQuery, filter_.get());
   if (!this->islandSystem_->hasConnection(startRef, endRef)) {
     // There isn't a connection!  This happens when endPoint is on an edge
     // shared between two different connected components (aka infinitely thin
@@ -1189,11 +2260,11 @@ T PathFinder::Impl::tryStep(const T& start, const T& end, bool allowSliding) {
 }
 
 template <typename T>
-T PathFinder::Impl::snapPoint(const T& pt) {
+T PathFinder::Impl::snapPoint(const dtNavMeshQuery* navQuery, const T& pt) {
   dtStatus status = 0;
   vec3f projectedPt;
   std::tie(status, std::ignore, projectedPt) =
-      projectToPoly(pt, navQuery_.get(), filter_.get());
+      projectToPoly(pt, navQuery, filter_.get());
 
   if (dtStatusSucceed(status)) {
     return T{projectedPt};
@@ -1202,6 +2273,137 @@ T PathFinder::Impl::snapPoint(const T& pt) {
   }
 }
 
+NavQueryPtr PathFinder::Impl::acquireBatchQuery() {
+  std::lock_guard<std::mutex> lock(batchQueriesMutex_);
+  // forEachBatch allocates one per thread upfront
+  CORRADE_INTERNAL_ASSERT(!batchQueries_.empty());
+  NavQueryPtr query = std::move(batchQueries_.back());
+  batchQueries_.pop_back();
+  return query;
+}
+
+void PathFinder::Impl::releaseBatchQuery(NavQueryPtr query) {
+  std::lock_guard<std::mutex> lock(batchQueriesMutex_);
+  batchQueries_.push_back(std::move(query));
+}
+
+bool PathFinder::Impl::forEachBatch(
+    std::size_t count,
+    const std::function<void(dtNavMeshQuery*, std::size_t, std::size_t)>&
+        fn) {
+  if (!isLoaded()) {
+    LOG(ERROR) << "PathFinder: no navmesh loaded for batched queries";
+    return false;
+  }
+  if (!batchScheduler_) {
+    batchScheduler_ = std::make_unique<core::TaskScheduler>();
+  }
+  // at most one chunk per thread runs at a time
+  while (batchQueries_.size() < std::size_t(batchScheduler_->getNumThreads())) {
+    NavQueryPtr query{dtAllocNavMeshQuery()};
+    if (!query || dtStatusFailed(query->init(navMesh_.get(), 2048))) {
+      LOG(ERROR) << "PathFinder: could not init Detour navmesh query for "
+                    "batched queries";
+      return false;
+    }
+    batchQueries_.push_back(std::move(query));
+  }
+
+  // parallelFor makes a few chunks per thread, so each query object is reused
+  // for many queries
+  batchScheduler_->parallelFor(count, [&](std::size_t begin, std::size_t end) {
+    NavQueryPtr query = acquireBatchQuery();
+    fn(query.get(), begin, end);
+    releaseBatchQuery(std::move(query));
+  });
+  return true;
+}
+
+void PathFinder::Impl::findPaths(
+    Cr::Containers::ArrayView<ShortestPath> paths) {
+  const bool success = forEachBatch(
+      paths.size(),
+      [&](dtNavMeshQuery* navQuery, std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i != end; ++i) {
+          findPath(navQuery, paths[i]);
+        }
+      });
+  if (!success) {
+    for (auto& path : paths) {
+      path.geodesicDistance = std::numeric_limits<float>::infinity();
+      path.points.clear();
+    }
+  }
+}
+
+GeodesicDistanceField::ptr PathFinder::Impl::buildDistanceField(
+    const std::vector<vec3f>& goals) {
+  if (!isLoaded()) {
+    LOG(ERROR) << "PathFinder::buildDistanceField: no navmesh loaded";
+    return nullptr;
+  }
+  auto field = GeodesicDistanceField::create();
+  GeodesicDistanceField::Impl& impl = *field->pimpl_;
+  impl.goals = goals;
+  impl.navMesh = navMesh_;
+  impl.navMeshGeneration = navMeshGeneration_;
+  impl.currentNavMeshGeneration = sharedNavMeshGeneration_;
+  impl.filter = *filter_;
+  impl.navQuery.reset(dtAllocNavMeshQuery());
+  if (!impl.navQuery ||
+      dtStatusFailed(impl.navQuery->init(navMesh_.get(), 2048))) {
+    LOG(ERROR) << "PathFinder::buildDistanceField: could not init Detour "
+                  "navmesh query";
+    return nullptr;
+  }
+  impl.build();
+  return field;
+}
+
+void PathFinder::Impl::snapPoints(
+    Cr::Containers::ArrayView<const vec3f> points,
+    Cr::Containers::ArrayView<vec3f> snapped) {
+  CORRADE_ASSERT(points.size() == snapped.size(),
+                 "PathFinder::snapPoints(): expected" << points.size()
+                                                      << "outputs but got"
+                                                      << snapped.size(), );
+  const bool success = forEachBatch(
+      points.size(),
+      [&](dtNavMeshQuery* navQuery, std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i != end; ++i) {
+          snapped[i] = snapPoint(navQuery, points[i]);
+        }
+      });
+  if (!success) {
+    for (auto& pt : snapped) {
+      pt = vec3f::Constant(Mn::Constants::nan());
+    }
+  }
+}
+
+void PathFinder::Impl::trySteps(Cr::Containers::ArrayView<const vec3f> starts,
+                                Cr::Containers::ArrayView<const vec3f> ends,
+                                Cr::Containers::ArrayView<vec3f> results,
+                                bool allowSliding) {
+  CORRADE_ASSERT(
+      starts.size() == ends.size() && starts.size() == results.size(),
+      "PathFinder::trySteps(): expected as many ends and results as starts, "
+      "got" << starts.size() << ends.size() << "and" << results.size(), );
+  const bool success = forEachBatch(
+      starts.size(),
+      [&](dtNavMeshQuery* navQuery, std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i != end; ++i) {
+          results[i] = tryStep(navQuery, starts[i], ends[i], allowSliding);
+        }
+      });
+  if (!success) {
+    // like tryStep, stay at the start if the step can't be taken
+    for (std::size_t i = 0; i != starts.size(); ++i) {
+      results[i] = starts[i];
+    }
+  }
+}
+
 float PathFinder::Impl::islandRadius(const vec3f& pt) const {
   dtPolyRef ptRef = 0;
   dtStatus status = 0;
@@ -1241,57 +2443,236 @@ HitRecord PathFinder::Impl::closestObstacleSurfacePoint(
   }
 }
 
-bool PathFinder::Impl::isNavigable(const vec3f& pt,
-                                   const float maxYDelta /*= 0.5*/) const {
+dtPolyRef PathFinder::Impl::navigablePolyRef(const dtNavMeshQuery* navQuery,
+                                             const vec3f& pt,
+                                             const float maxYDelta) const {
   dtPolyRef ptRef = 0;
   dtStatus status = 0;
   vec3f polyPt;
   std::tie(status, ptRef, polyPt) =
-      projectToPoly(pt, navQuery_.get(), filter_.get());
+      projectToPoly(pt, navQuery, filter_.get());
 
   if (status != DT_SUCCESS || ptRef == 0)
-    return false;
+    return 0;
 
   if (std::abs(polyPt[1] - pt[1]) > maxYDelta ||
       (Eigen::Vector2f(pt[0], pt[2]) - Eigen::Vector2f(polyPt[0], polyPt[2]))
               .norm() > 1e-2)
-    return false;
+    return 0;
 
-  return true;
+  return ptRef;
 }
 
 typedef Eigen::Matrix<bool, Eigen::Dynamic, Eigen::Dynamic> MatrixXb;
 
-Eigen::Matrix<bool, Eigen::Dynamic, Eigen::Dynamic>
-PathFinder::Impl::getTopDownView(const float metersPerPixel,
-                                 const float height) {
-  std::pair<vec3f, vec3f> mapBounds = bounds();
-  vec3f bound1 = mapBounds.first;
-  vec3f bound2 = mapBounds.second;
+namespace {
+// How far from its navmesh point a point can be and still be navigable, see
+// isNavigable. Padded a little for rounding.
+constexpr float topDownMargin = 1e-2 + 1e-3;
+
+// A navmesh triangle projected to the x-z plane
+struct TopDownTriangle {
+  Eigen::Vector2f v[3];
+  float zmin, zmax;
+};
+
+// x extent of the part of tri with z in [zlo, zhi], the corners of which are
+// the corners of tri in that range and the crossings of its edges with the
+// range bounds. False if there's no such part.
+bool slabExtent(const TopDownTriangle& tri,
+                float zlo,
+                float zhi,
+                float& xlo,
+                float& xhi) {
+  xlo = std::numeric_limits<float>::infinity();
+  xhi = -std::numeric_limits<float>::infinity();
+  for (int i = 0; i < 3; ++i) {
+    const Eigen::Vector2f& a = tri.v[i];
+    const Eigen::Vector2f& b = tri.v[(i + 1) % 3];
+    if (a[1] >= zlo && a[1] <= zhi) {
+      xlo = std::min(xlo, a[0]);
+      xhi = std::max(xhi, a[0]);
+    }
+    for (const float z : {zlo, zhi}) {
+      if ((a[1] - z) * (b[1] - z) < 0) {
+        const float x = a[0] + (z - a[1]) / (b[1] - a[1]) * (b[0] - a[0]);
+        xlo = std::min(xlo, x);
+        xhi = std::max(xhi, x);
+      }
+    }
+  }
+  return xlo <= xhi;
+}
+}  // namespace
+
+PathFinder::Impl::TopDownGrid PathFinder::Impl::topDownGrid(
+    const float metersPerPixel) const {
+  vec3f bound1 = bounds_.first;
+  vec3f bound2 = bounds_.second;
 
   float xspan = std::abs(bound1[0] - bound2[0]);
   float zspan = std::abs(bound1[2] - bound2[2]);
   int xResolution = xspan / metersPerPixel;
   int zResolution = zspan / metersPerPixel;
-  float startx = fmin(bound1[0], bound2[0]);
-  float startz = fmin(bound1[2], bound2[2]);
-  MatrixXb topdownMap(zResolution, xResolution);
 
-  float curz = startz;
-  float curx = startx;
+  // accumulated like this so the points are exactly those of older versions
+  TopDownGrid grid;
+  float curx = fmin(bound1[0], bound2[0]);
+  for (int w = 0; w < xResolution; w++) {
+    grid.xs.push_back(curx);
+    curx = curx + metersPerPixel;
+  }
+  float curz = fmin(bound1[2], bound2[2]);
   for (int h = 0; h < zResolution; h++) {
-    for (int w = 0; w < xResolution; w++) {
-      vec3f point = vec3f(curx, height, curz);
-      topdownMap(h, w) = isNavigable(point, 0.5);
-      curx = curx + metersPerPixel;
-    }
+    grid.zs.push_back(curz);
     curz = curz + metersPerPixel;
-    curx = startx;
   }
+  return grid;
+}
+
+bool PathFinder::Impl::forEachTopDownCandidate(
+    const TopDownGrid& grid,
+    const float height,
+    const float maxYDelta,
+    const std::function<void(dtNavMeshQuery*, const vec3f&, int, int)>& fn) {
+  // triangles of the polygons isNavigable can snap to, which are in reach of
+  // height
+  std::vector<TopDownTriangle> triangles;
+  const dtNavMesh* navMesh = navMesh_.get();
+  for (int iTile = 0; iTile < navMesh->getMaxTiles(); ++iTile) {
+    const dtMeshTile* tile = navMesh->getTile(iTile);
+    if (!tile || !tile->header)
+      continue;
 
+    for (int jPoly = 0; jPoly < tile->header->polyCount; ++jPoly) {
+      const dtPolyRef polyRef = navMesh->encodePolyId(tile->salt, iTile, jPoly);
+      const dtPoly* poly = &tile->polys[jPoly];
+      if (poly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION ||
+          !filter_->passFilter(polyRef, tile, poly))
+        continue;
+
+      for (const Triangle& tri : getPolygonTriangles(poly, tile)) {
+        const float ymin =
+            std::min({tri.v[0][1], tri.v[1][1], tri.v[2][1]}) - 1e-3f;
+        const float ymax =
+            std::max({tri.v[0][1], tri.v[1][1], tri.v[2][1]}) + 1e-3f;
+        if (ymax < height - maxYDelta || ymin > height + maxYDelta)
+          continue;
+
+        TopDownTriangle topDown;
+        for (int k = 0; k < 3; ++k) {
+          topDown.v[k] = Eigen::Vector2f(tri.v[k][0], tri.v[k][2]);
+        }
+        topDown.zmin = std::min({topDown.v[0][1], topDown.v[1][1],
+                                 topDown.v[2][1]});
+        topDown.zmax = std::max({topDown.v[0][1], topDown.v[1][1],
+                                 topDown.v[2][1]});
+        triangles.push_back(topDown);
+      }
+    }
+  }
+
+  const int xResolution = grid.xs.size();
+  return forEachBatch(
+      grid.zs.size(),
+      [&](dtNavMeshQuery* navQuery, std::size_t begin, std::size_t end) {
+        // scanline fill of the triangles into the rows of this chunk, marking
+        // pixels which can be navigable. Only those get the exact query.
+        std::vector<char> candidates((end - begin) * xResolution, 0);
+        const float zbegin = grid.zs[begin] - topDownMargin;
+        const float zend = grid.zs[end - 1] + topDownMargin;
+        for (const TopDownTriangle& tri : triangles) {
+          if (tri.zmax < zbegin || tri.zmin > zend)
+            continue;
+
+          for (auto z = std::lower_bound(grid.zs.begin() + begin,
+                                         grid.zs.begin() + end,
+                                         tri.zmin - topDownMargin);
+               z != grid.zs.begin() + end && *z <= tri.zmax + topDownMargin;
+               ++z) {
+            float xlo = 0, xhi = 0;
+            if (!slabExtent(tri, *z - topDownMargin, *z + topDownMargin, xlo,
+                            xhi))
+              continue;
+
+            const auto first = std::lower_bound(
+                grid.xs.begin(), grid.xs.end(), xlo - topDownMargin);
+            const auto last = std::upper_bound(first, grid.xs.end(),
+                                               xhi + topDownMargin);
+            char* row = &candidates[(z - grid.zs.begin() - begin) *
+                                    xResolution];
+            std::fill(row + (first - grid.xs.begin()),
+                      row + (last - grid.xs.begin()), 1);
+          }
+        }
+
+        for (std::size_t h = begin; h != end; ++h) {
+          const char* row = &candidates[(h - begin) * xResolution];
+          for (int w = 0; w < xResolution; ++w) {
+            if (row[w]) {
+              fn(navQuery, vec3f(grid.xs[w], height, grid.zs[h]), h, w);
+            }
+          }
+        }
+      });
+}
+
+Eigen::Matrix<bool, Eigen::Dynamic, Eigen::Dynamic>
+PathFinder::Impl::getTopDownView(const float metersPerPixel,
+                                 const float height) {
+  for (const auto& cached : topDownViews_) {
+    if (std::get<0>(cached) == metersPerPixel &&
+        std::get<1>(cached) == height) {
+      return std::get<2>(cached);
+    }
+  }
+  if (!isLoaded()) {
+    LOG(ERROR) << "PathFinder::getTopDownView: no navmesh loaded";
+    return {};
+  }
+
+  const TopDownGrid grid = topDownGrid(metersPerPixel);
+  MatrixXb topdownMap = MatrixXb::Zero(grid.zs.size(), grid.xs.size());
+  const bool success = forEachTopDownCandidate(
+      grid, height, 0.5,
+      [&](dtNavMeshQuery* navQuery, const vec3f& point, int h, int w) {
+        topdownMap(h, w) = navigablePolyRef(navQuery, point, 0.5) != 0;
+      });
+  if (!success) {
+    return topdownMap;
+  }
+
+  if (topDownViews_.size() == MAX_CACHED_TOP_DOWN_VIEWS) {
+    topDownViews_.erase(topDownViews_.begin());
+  }
+  topDownViews_.emplace_back(metersPerPixel, height, topdownMap);
   return topdownMap;
 }
 
+Eigen::Matrix<uint8_t, Eigen::Dynamic, Eigen::Dynamic>
+PathFinder::Impl::getTopDownIslandView(const float metersPerPixel,
+                                       const float height) {
+  if (!isLoaded()) {
+    LOG(ERROR) << "PathFinder::getTopDownIslandView: no navmesh loaded";
+    return {};
+  }
+
+  const TopDownGrid grid = topDownGrid(metersPerPixel);
+  Eigen::Matrix<uint8_t, Eigen::Dynamic, Eigen::Dynamic> islandMap =
+      Eigen::Matrix<uint8_t, Eigen::Dynamic, Eigen::Dynamic>::Zero(
+          grid.zs.size(), grid.xs.size());
+  forEachTopDownCandidate(
+      grid, height, 0.5,
+      [&](dtNavMeshQuery* navQuery, const vec3f& point, int h, int w) {
+        const dtPolyRef ref = navigablePolyRef(navQuery, point, 0.5);
+        if (ref) {
+          // 0 is for non-navigable pixels
+          islandMap(h, w) = std::min(islandSystem_->islandId(ref) + 1, 255);
+        }
+      });
+  return islandMap;
+}
+
 const assets::MeshData::ptr PathFinder::Impl::getNavMeshData() {
   if (meshData_ == nullptr && isLoaded()) {
     meshData_ = assets::MeshData::create();
@@ -1302,7 +2683,7 @@ const assets::MeshData::ptr PathFinder::Impl::getNavMeshData() {
     for (int iTile = 0; iTile < navMesh_->getMaxTiles(); ++iTile) {
       const dtMeshTile* tile =
           const_cast<const dtNavMesh*>(navMesh_.get())->getTile(iTile);
-      if (!tile)
+      if (!tile || !tile->header)
         continue;
 
       // Iterate over all polygons in a tile
@@ -1358,6 +2739,15 @@ bool PathFinder::findPath(MultiGoalShortestPath& path) {
   return pimpl_->findPath(path);
 }
 
+void PathFinder::findPaths(Cr::Containers::ArrayView<ShortestPath> paths) {
+  pimpl_->findPaths(paths);
+}
+
+GeodesicDistanceField::ptr PathFinder::buildDistanceField(
+    const std::vector<vec3f>& goals) {
+  return pimpl_->buildDistanceField(goals);
+}
+
 template vec3f PathFinder::tryStep<vec3f>(const vec3f&, const vec3f&);
 template Mn::Vector3 PathFinder::tryStep<Mn::Vector3>(const Mn::Vector3&,
                                                       const Mn::Vector3&);
@@ -1377,6 +2767,19 @@ T PathFinder::tryStepNoSliding(const T& start, const T& end) {
   return pimpl_->tryStep(start, end, /*allowSliding=*/false);
 }
 
+void PathFinder::trySteps(Cr::Containers::ArrayView<const vec3f> starts,
+                          Cr::Containers::ArrayView<const vec3f> ends,
+                          Cr::Containers::ArrayView<vec3f> results) {
+  pimpl_->trySteps(starts, ends, results, /*allowSliding=*/true);
+}
+
+void PathFinder::tryStepsNoSliding(
+    Cr::Containers::ArrayView<const vec3f> starts,
+    Cr::Containers::ArrayView<const vec3f> ends,
+    Cr::Containers::ArrayView<vec3f> results) {
+  pimpl_->trySteps(starts, ends, results, /*allowSliding=*/false);
+}
+
 template vec3f PathFinder::snapPoint<vec3f>(const vec3f& pt);
 template Mn::Vector3 PathFinder::snapPoint<Mn::Vector3>(const Mn::Vector3& pt);
 
@@ -1385,6 +2788,11 @@ T PathFinder::snapPoint(const T& pt) {
   return pimpl_->snapPoint(pt);
 }
 
+void PathFinder::snapPoints(Cr::Containers::ArrayView<const vec3f> points,
+                            Cr::Containers::ArrayView<vec3f> snapped) {
+  pimpl_->snapPoints(points, snapped);
+}
+
 bool PathFinder::loadNavMesh(const std::string& path) {
   return pimpl_->loadNavMesh(path);
 }
@@ -1428,6 +2836,12 @@ std::pair<vec3f, vec3f> PathFinder::bounds() const {
   return pimpl_->bounds();
 }
 
+Eigen::Matrix<uint8_t, Eigen::Dynamic, Eigen::Dynamic>
+PathFinder::getTopDownIslandView(const float metersPerPixel,
+                                 const float height) {
+  return pimpl_->getTopDownIslandView(metersPerPixel, height);
+}
+
 Eigen::Matrix<bool, Eigen::Dynamic, Eigen::Dynamic> PathFinder::getTopDownView(
     const float metersPerPixel,
     const float height) {
@@ -1438,5 +2852,28 @@ const assets::MeshData::ptr PathFinder::getNavMeshData() {
   return pimpl_->getNavMeshData();
 }
 
+bool PathFinder::supportsObstacles() const {
+  return pimpl_->supportsObstacles();
+}
+
+bool PathFinder::setObstacle(int obstacleID,
+                             const vec3f& center,
+                             const vec3f& halfExtents,
+                             float yRotation) {
+  return pimpl_->setObstacle(obstacleID, center, halfExtents, yRotation);
+}
+
+bool PathFinder::removeObstacle(int obstacleID) {
+  return pimpl_->removeObstacle(obstacleID);
+}
+
+std::vector<int> PathFinder::getObstacleIDs() const {
+  return pimpl_->getObstacleIDs();
+}
+
+bool PathFinder::updateObstacles() {
+  return pimpl_->updateObstacles();
+}
+
 }  // namespace nav
 }  // namespace esp
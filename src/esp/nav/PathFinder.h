@@ -8,6 +8,8 @@
 #include <string>
 #include <vector>
 
+#include <Corrade/Containers/ArrayView.h>
+
 #include "esp/core/esp.h"
 
 namespace esp {
@@ -100,6 +102,64 @@ struct MultiGoalShortestPath {
   ESP_SMART_POINTERS_WITH_UNIQUE_PIMPL(MultiGoalShortestPath);
 };
 
+/**
+ * @brief Geodesic distances to a fixed set of goals, precomputed by @ref
+ * PathFinder::buildDistanceField.
+ *
+ * The distances are computed once for the whole navmesh, by a Dijkstra search
+ * out from the goals over the polygon vertices and portal endpoints of the
+ * navmesh, with any-angle shortcuts as in Theta*. A query then only snaps the
+ * point to its polygon and takes the shortest straight line to one of that
+ * polygon's vertices plus the vertex's distance, so tasks which ask for the
+ * distance to the same goals at every step don't search the navmesh each
+ * time.
+ *
+ * Distances are lengths of paths on the navmesh to the closest goal, so they
+ * are close to but can be slightly longer than those of @ref
+ * PathFinder::findPath. The field keeps the navmesh it was built on alive and
+ * isn't affected by the @ref PathFinder loading another one. @ref
+ * PathFinder::updateObstacles however rebuilds that navmesh in place, after
+ * which the field is out of date, see @ref isUpToDate, and has to be built
+ * again.
+ */
+class GeodesicDistanceField {
+ public:
+  GeodesicDistanceField();
+
+  /**
+   * @brief The goals the field was built for
+   */
+  const std::vector<vec3f>& getGoals() const;
+
+  /**
+   * @brief Whether the navmesh the field was built on wasn't updated since
+   *
+   * False after @ref PathFinder::updateObstacles, in which case @ref
+   * geodesicDistance and @ref nextWaypoint fail with a fatal error.
+   */
+  bool isUpToDate() const;
+
+  /**
+   * @brief The geodesic distance from @p pt to the closest goal
+   *
+   * @note Will be inf if @p pt isn't near the navmesh or no goal can be
+   * reached from it
+   */
+  float geodesicDistance(const vec3f& pt) const;
+
+  /**
+   * @brief The next point on the shortest path from @p pt to the closest
+   * goal, i.e. the first corner of the path or the goal itself
+   *
+   * @note Will be `{NAN, NAN, NAN}` if no goal can be reached from @p pt
+   */
+  vec3f nextWaypoint(const vec3f& pt) const;
+
+  friend class PathFinder;
+
+  ESP_SMART_POINTERS_WITH_UNIQUE_PIMPL(GeodesicDistanceField);
+};
+
 struct NavMeshSettings {
   //! Cell size in world units
   float cellSize{};
@@ -134,6 +194,12 @@ struct NavMeshSettings {
   bool filterLedgeSpans{};
   bool filterWalkableLowHeightSpans{};
 
+  //! Tile size in cells. If positive, the navmesh is built in tiles of a
+  //! tile cache, which supports obstacles, see @ref PathFinder::setObstacle.
+  //! Tiles use layer partitioning and no detail mesh, so the navmesh is a
+  //! little coarser than an untiled one. 0 builds a single tile.
+  int tileSize{};
+
   void setDefaults() {
     cellSize = 0.05f;
     cellHeight = 0.2f;
@@ -151,6 +217,7 @@ struct NavMeshSettings {
     filterLowHangingObstacles = true;
     filterLedgeSpans = true;
     filterWalkableLowHeightSpans = true;
+    tileSize = 0;
   }
 
   NavMeshSettings() { setDefaults(); }
@@ -161,6 +228,10 @@ struct NavMeshSettings {
 /** Loads and/or builds a navigation mesh and then performs path
  * finding and collision queries on that navmesh
  *
+ * Single queries must not be called concurrently. The batched queries
+ * (@ref findPaths, @ref snapPoints, @ref trySteps) spread their queries
+ * over a thread pool, each thread with its own Detour query object on the
+ * shared navmesh; they must not run concurrently with other calls either.
  */
 class PathFinder {
  public:
@@ -220,6 +291,28 @@ class PathFinder {
    */
   bool findPath(MultiGoalShortestPath& path);
 
+  /**
+   * @brief Finds many shortest paths in parallel. Same as calling @ref
+   * findPath on each path, e.g. for reward or oracle computations.
+   *
+   * @param[inout] paths The paths to find. Paths which don't exist get an
+   * infinite @ref ShortestPath.geodesicDistance and no points.
+   */
+  void findPaths(Corrade::Containers::ArrayView<ShortestPath> paths);
+
+  /**
+   * @brief Precomputes the geodesic distances to @p goals over the whole
+   * navmesh, for tasks which query the distance to the same goals from many
+   * points. See @ref GeodesicDistanceField.
+   *
+   * @param[in] goals The goals, snapped to the navigation mesh. Goals which
+   * aren't near the navmesh are ignored with a warning.
+   *
+   * @return The distance field, or nullptr if no navmesh is loaded
+   */
+  GeodesicDistanceField::ptr buildDistanceField(
+      const std::vector<vec3f>& goals);
+
   /**
    * @brief Attempts to move from @ref start to @ref end and returns the
    * navigable point closest to @ref end that is feasibly reachable from @ref
@@ -239,6 +332,25 @@ class PathFinder {
   template <typename T>
   T tryStepNoSliding(const T& start, const T& end);
 
+  /**
+   * @brief Same as calling @ref tryStep for each pair of @p starts and
+   * @p ends, in parallel. All three views must have the same size.
+   *
+   * @param[in] starts The starting locations
+   * @param[in] ends The desired end locations
+   * @param[out] results Receives the found end locations
+   */
+  void trySteps(Corrade::Containers::ArrayView<const vec3f> starts,
+                Corrade::Containers::ArrayView<const vec3f> ends,
+                Corrade::Containers::ArrayView<vec3f> results);
+
+  /**
+   * @brief Same as @ref trySteps but does not allow for sliding along walls
+   */
+  void tryStepsNoSliding(Corrade::Containers::ArrayView<const vec3f> starts,
+                         Corrade::Containers::ArrayView<const vec3f> ends,
+                         Corrade::Containers::ArrayView<vec3f> results);
+
   /**
    * @brief Snaps a point to the navigation mesh
    *
@@ -250,6 +362,16 @@ class PathFinder {
   template <typename T>
   T snapPoint(const T& pt);
 
+  /**
+   * @brief Same as calling @ref snapPoint for each point, in parallel
+   *
+   * @param[in] points The points to snap to the navigation mesh
+   * @param[out] snapped Receives the snapped points. Must have the same size
+   * as @p points.
+   */
+  void snapPoints(Corrade::Containers::ArrayView<const vec3f> points,
+                  Corrade::Containers::ArrayView<vec3f> snapped);
+
   /**
    * @brief Loads a navigation meshed saved by @ref saveNavMesh
    *
@@ -337,10 +459,34 @@ class PathFinder {
    */
   std::pair<vec3f, vec3f> bounds() const;
 
+  /**
+   * @brief Returns a top-down occupancy map of the navmesh at a height
+   *
+   * Pixel (row, column) is whether the point at the navmesh bounds minimum
+   * plus (column, row) * @p metersPerPixel in x and z, at y @p height, is
+   * navigable, same as @ref isNavigable. The navmesh triangles near
+   * @p height are rasterized first, so only pixels they cover are queried,
+   * in parallel. The most recent maps are cached until the navmesh changes.
+   *
+   * @param[in] metersPerPixel The size of a pixel
+   * @param[in] height The height of the map
+   */
   Eigen::Matrix<bool, Eigen::Dynamic, Eigen::Dynamic> getTopDownView(
       const float metersPerPixel,
       const float height);
 
+  /**
+   * @brief Same as @ref getTopDownView but with the island, i.e. connected
+   * component, each navigable pixel belongs to, e.g. to tell apart floors or
+   * disconnected areas
+   *
+   * @return 0 for pixels which aren't navigable, 1 + the island index for
+   * navigable ones, saturated to 255
+   */
+  Eigen::Matrix<uint8_t, Eigen::Dynamic, Eigen::Dynamic> getTopDownIslandView(
+      const float metersPerPixel,
+      const float height);
+
   /**
    * @brief Returns a MeshData object containing triangulated NavMesh polys. The
    * object is generated and stored if this is the first query.
@@ -351,6 +497,62 @@ class PathFinder {
    */
   const std::shared_ptr<assets::MeshData> getNavMeshData();
 
+  /**
+   * @brief Whether the navmesh supports obstacles, i.e. was built with a
+   * positive @ref NavMeshSettings::tileSize. Loaded navmeshes don't.
+   */
+  bool supportsObstacles() const;
+
+  /**
+   * @brief Adds an obstacle, or moves it if @p obstacleID exists already
+   *
+   * An obstacle is an upright box which cuts the navmesh under it, e.g. the
+   * bounding box of a piece of furniture. The navmesh only changes on
+   * @ref updateObstacles, which rebuilds just the tiles the changed
+   * obstacles overlap.
+   *
+   * @param[in] obstacleID An ID of the caller's choice, e.g. an object ID
+   * @param[in] center The center of the box
+   * @param[in] halfExtents Half of the size of the box along its axes
+   * @param[in] yRotation Rotation of the box around +y, in radians
+   *
+   * @return Whether the obstacle was set. Fails if the navmesh doesn't
+   * support obstacles or has too many.
+   */
+  bool setObstacle(int obstacleID,
+                   const vec3f& center,
+                   const vec3f& halfExtents,
+                   float yRotation = 0.0f);
+
+  /**
+   * @brief Removes an obstacle added with @ref setObstacle. The navmesh only
+   * changes on @ref updateObstacles.
+   *
+   * @return Whether the obstacle existed
+   */
+  bool removeObstacle(int obstacleID);
+
+  /**
+   * @brief The IDs of the obstacles set with @ref setObstacle, in ascending
+   * order
+   */
+  std::vector<int> getObstacleIDs() const;
+
+  /**
+   * @brief Rebuilds the tiles of the navmesh which obstacles were added to,
+   * moved in or removed from since the last update
+   *
+   * The rebuilt tiles get new polygons. The ends of a
+   * @ref MultiGoalShortestPath are snapped to the navmesh again the next
+   * time the path is found, so paths can be reused across updates. Distance
+   * fields built with @ref buildDistanceField before the update still
+   * describe the old navmesh and have to be built again.
+   *
+   * @return Whether the tiles were rebuilt. Fails if the navmesh doesn't
+   * support obstacles.
+   */
+  bool updateObstacles();
+
   ESP_SMART_POINTERS_WITH_UNIQUE_PIMPL(PathFinder);
 };
 
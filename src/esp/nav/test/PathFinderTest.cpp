@@ -1,7 +1,9 @@
 #include <Corrade/Containers/ArrayView.h>
+#include <Corrade/Containers/ArrayViewStl.h>
 #include <Corrade/TestSuite/Compare/Numeric.h>
 #include <Corrade/TestSuite/Tester.h>
 
+#include <esp/assets/MeshData.h>
 #include <esp/nav/PathFinder.h>
 
 #include <Corrade/Utility/Directory.h>
@@ -27,26 +29,54 @@ constexpr struct {
 } MultiGoalBenchMarkData[]{{"path to closest of 1000", false},
                            {"cached path to closest of 1000", true}};
 
+constexpr struct {
+  const char* name;
+  int numEnds;
+  bool searchPerEnd;
+} MultiGoalCountBenchMarkData[]{{"1 end", 1, false},
+                                {"10 ends", 10, false},
+                                {"100 ends", 100, false},
+                                {"500 ends", 500, false},
+                                {"1 end, path per end", 1, true},
+                                {"10 ends, path per end", 10, true},
+                                {"100 ends, path per end", 100, true},
+                                {"500 ends, path per end", 500, true}};
+
 struct PathFinderTest : Cr::TestSuite::Tester {
   explicit PathFinderTest();
 
   void bounds();
   void tryStepNoSliding();
   void multiGoalPath();
+  void multiGoalPathManyEnds();
+  void batchedQueries();
+  void distanceField();
+  void topDownView();
+  void obstacles();
 
   void benchmarkSingleGoal();
   void benchmarkMultiGoal();
+  void benchmarkMultiGoalCount();
+  void benchmarkFindPaths();
 
   void testCaching();
 };
 
 PathFinderTest::PathFinderTest() {
   addTests({&PathFinderTest::bounds, &PathFinderTest::tryStepNoSliding,
-            &PathFinderTest::multiGoalPath, &PathFinderTest::testCaching});
+            &PathFinderTest::multiGoalPath,
+            &PathFinderTest::multiGoalPathManyEnds,
+            &PathFinderTest::batchedQueries,
+            &PathFinderTest::distanceField, &PathFinderTest::topDownView,
+            &PathFinderTest::obstacles, &PathFinderTest::testCaching});
 
   addBenchmarks({&PathFinderTest::benchmarkSingleGoal}, 1000);
+  addBenchmarks({&PathFinderTest::benchmarkFindPaths}, 10);
   addInstancedBenchmarks({&PathFinderTest::benchmarkMultiGoal}, 100,
                          Cr::Containers::arraySize(MultiGoalBenchMarkData));
+  addInstancedBenchmarks(
+      {&PathFinderTest::benchmarkMultiGoalCount}, 10,
+      Cr::Containers::arraySize(MultiGoalCountBenchMarkData));
 }
 
 void PathFinderTest::bounds() {
@@ -126,6 +156,246 @@ void PathFinderTest::multiGoalPath() {
   }
 }
 
+void PathFinderTest::multiGoalPathManyEnds() {
+  esp::nav::PathFinder pathFinder;
+  pathFinder.loadNavMesh(skokloster);
+  CORRADE_VERIFY(pathFinder.isLoaded());
+  pathFinder.seed(0);
+
+  // with many ends, the end a search from the start reaches first is searched
+  // first and most others are skipped; the result has to match searching
+  // each end
+  for (int j = 0; j < 200; ++j) {
+    CORRADE_ITERATION(j);
+    std::vector<esp::vec3f> ends;
+    ends.reserve(50);
+    for (int i = 0; i < 50; ++i) {
+      ends.emplace_back(pathFinder.getRandomNavigablePoint());
+    }
+
+    esp::nav::MultiGoalShortestPath multiPath;
+    multiPath.requestedStart = pathFinder.getRandomNavigablePoint();
+    multiPath.setRequestedEnds(ends);
+    pathFinder.findPath(multiPath);
+
+    esp::nav::ShortestPath path;
+    path.requestedStart = multiPath.requestedStart;
+    float trueMinDist = std::numeric_limits<float>::infinity();
+    for (const esp::vec3f& end : ends) {
+      path.requestedEnd = end;
+      if (pathFinder.findPath(path)) {
+        trueMinDist = std::min(trueMinDist, path.geodesicDistance);
+      }
+    }
+
+    CORRADE_COMPARE(multiPath.geodesicDistance, trueMinDist);
+  }
+}
+
+void PathFinderTest::batchedQueries() {
+  esp::nav::PathFinder pathFinder;
+  pathFinder.loadNavMesh(skokloster);
+  CORRADE_VERIFY(pathFinder.isLoaded());
+  pathFinder.seed(0);
+
+  constexpr std::size_t count = 1000;
+  std::vector<esp::nav::ShortestPath> paths(count);
+  std::vector<esp::vec3f> starts, ends;
+  for (auto& path : paths) {
+    path.requestedStart = pathFinder.getRandomNavigablePoint();
+    path.requestedEnd = pathFinder.getRandomNavigablePoint();
+    starts.push_back(path.requestedStart);
+    // off the navmesh, so snapping and stepping have something to do
+    ends.push_back(path.requestedEnd + esp::vec3f{0.0f, 0.5f, 0.0f});
+  }
+  // also covers a path without a start on the navmesh
+  paths.back().requestedStart = esp::vec3f{1e5f, 1e5f, 1e5f};
+
+  pathFinder.findPaths(Cr::Containers::arrayView(paths));
+  std::vector<esp::vec3f> snapped(count);
+  pathFinder.snapPoints(Cr::Containers::arrayView(ends),
+                        Cr::Containers::arrayView(snapped));
+  std::vector<esp::vec3f> stepped(count);
+  pathFinder.trySteps(Cr::Containers::arrayView(starts),
+                      Cr::Containers::arrayView(ends),
+                      Cr::Containers::arrayView(stepped));
+
+  for (std::size_t i = 0; i < count; ++i) {
+    CORRADE_ITERATION(i);
+    esp::nav::ShortestPath path;
+    path.requestedStart = paths[i].requestedStart;
+    path.requestedEnd = paths[i].requestedEnd;
+    pathFinder.findPath(path);
+    CORRADE_COMPARE(paths[i].geodesicDistance, path.geodesicDistance);
+    CORRADE_COMPARE(paths[i].points.size(), path.points.size());
+
+    CORRADE_COMPARE(Mn::Vector3{snapped[i]},
+                    Mn::Vector3{pathFinder.snapPoint(ends[i])});
+    CORRADE_COMPARE(Mn::Vector3{stepped[i]},
+                    Mn::Vector3{pathFinder.tryStep(starts[i], ends[i])});
+  }
+  CORRADE_COMPARE(paths.back().geodesicDistance,
+                  std::numeric_limits<float>::infinity());
+}
+
+void PathFinderTest::distanceField() {
+  esp::nav::PathFinder pathFinder;
+  pathFinder.loadNavMesh(skokloster);
+  CORRADE_VERIFY(pathFinder.isLoaded());
+  pathFinder.seed(0);
+
+  std::vector<esp::vec3f> goals;
+  for (int i = 0; i < 3; ++i) {
+    goals.emplace_back(pathFinder.getRandomNavigablePoint());
+  }
+  esp::nav::GeodesicDistanceField::ptr field =
+      pathFinder.buildDistanceField(goals);
+  CORRADE_VERIFY(field);
+  CORRADE_COMPARE(field->getGoals().size(), goals.size());
+  for (const auto& goal : goals) {
+    CORRADE_COMPARE_WITH(field->geodesicDistance(goal), 0.0f,
+                         Cr::TestSuite::Compare::around(1e-3f));
+  }
+
+  esp::nav::MultiGoalShortestPath path;
+  path.setRequestedEnds(goals);
+  for (int i = 0; i < 200; ++i) {
+    CORRADE_ITERATION(i);
+    path.requestedStart = pathFinder.getRandomNavigablePoint();
+    pathFinder.findPath(path);
+    const float distance = field->geodesicDistance(path.requestedStart);
+    if (path.geodesicDistance == std::numeric_limits<float>::infinity()) {
+      CORRADE_COMPARE(distance, path.geodesicDistance);
+      CORRADE_VERIFY(std::isnan(field->nextWaypoint(path.requestedStart)[0]));
+      continue;
+    }
+    // the field only approximates the straightened path of findPath
+    CORRADE_COMPARE_WITH(
+        distance, path.geodesicDistance,
+        Cr::TestSuite::Compare::around(0.1f + 0.05f * path.geodesicDistance));
+
+    // following the waypoints gets to a goal without detours
+    esp::vec3f pt = path.requestedStart;
+    float walked = 0;
+    for (int j = 0; j < 100 && field->geodesicDistance(pt) > 1e-3f; ++j) {
+      const esp::vec3f next = field->nextWaypoint(pt);
+      walked += (next - pt).norm();
+      pt = next;
+    }
+    CORRADE_COMPARE_WITH(walked, distance,
+                         Cr::TestSuite::Compare::around(1e-2f));
+  }
+}
+
+void PathFinderTest::topDownView() {
+  esp::nav::PathFinder pathFinder;
+  pathFinder.loadNavMesh(skokloster);
+  CORRADE_VERIFY(pathFinder.isLoaded());
+
+  pathFinder.seed(0);
+
+  constexpr float metersPerPixel = 0.1f;
+  const std::pair<esp::vec3f, esp::vec3f> bounds = pathFinder.bounds();
+  for (int i = 0; i < 2; ++i) {
+    const float height = pathFinder.getRandomNavigablePoint()[1];
+    CORRADE_ITERATION(height);
+    const auto view = pathFinder.getTopDownView(metersPerPixel, height);
+    const auto islandView =
+        pathFinder.getTopDownIslandView(metersPerPixel, height);
+    CORRADE_COMPARE(islandView.rows(), view.rows());
+    CORRADE_COMPARE(islandView.cols(), view.cols());
+
+    // the points are those of a pixel by pixel isNavigable
+    int numNavigable = 0;
+    float z = bounds.first[2];
+    for (int h = 0; h < view.rows(); ++h) {
+      float x = bounds.first[0];
+      for (int w = 0; w < view.cols(); ++w) {
+        const bool navigable =
+            pathFinder.isNavigable(esp::vec3f(x, height, z), 0.5);
+        CORRADE_COMPARE(view(h, w), navigable);
+        CORRADE_COMPARE(islandView(h, w) != 0, navigable);
+        numNavigable += navigable;
+        x = x + metersPerPixel;
+      }
+      z = z + metersPerPixel;
+    }
+    CORRADE_VERIFY(numNavigable > 0);
+
+    // cached
+    CORRADE_VERIFY(pathFinder.getTopDownView(metersPerPixel, height) == view);
+  }
+}
+
+void PathFinderTest::obstacles() {
+  std::shared_ptr<esp::assets::MeshData> mesh;
+  {
+    esp::nav::PathFinder loaded;
+    loaded.loadNavMesh(skokloster);
+    CORRADE_VERIFY(loaded.isLoaded());
+    CORRADE_VERIFY(!loaded.supportsObstacles());
+    CORRADE_VERIFY(!loaded.setObstacle(0, esp::vec3f::Zero(),
+                                       esp::vec3f::Ones()));
+    mesh = loaded.getNavMeshData();
+  }
+
+  esp::nav::NavMeshSettings settings;
+  settings.tileSize = 64;
+  esp::nav::PathFinder pathFinder;
+  CORRADE_VERIFY(pathFinder.build(settings, *mesh));
+  CORRADE_VERIFY(pathFinder.supportsObstacles());
+
+  pathFinder.seed(0);
+  const esp::vec3f pt = pathFinder.getRandomNavigablePoint();
+  CORRADE_VERIFY(pathFinder.isNavigable(pt));
+  const float area = pathFinder.getNavigableArea();
+
+  // a path keeps its ends snapped to the navmesh across updates, verify
+  // they're snapped again to the rebuilt tiles
+  esp::nav::MultiGoalShortestPath cachePath;
+  cachePath.requestedStart = pathFinder.getRandomNavigablePoint();
+  cachePath.setRequestedEnds({pathFinder.getRandomNavigablePoint(),
+                              pathFinder.getRandomNavigablePoint()});
+  pathFinder.findPath(cachePath);
+  const float distance = cachePath.geodesicDistance;
+  esp::nav::GeodesicDistanceField::ptr field =
+      pathFinder.buildDistanceField(cachePath.getRequestedEnds());
+  CORRADE_VERIFY(field);
+  CORRADE_VERIFY(field->isUpToDate());
+  auto compareWithUncached = [&]() {
+    esp::nav::MultiGoalShortestPath noCachePath;
+    noCachePath.requestedStart = cachePath.requestedStart;
+    noCachePath.setRequestedEnds(cachePath.getRequestedEnds());
+    pathFinder.findPath(cachePath);
+    pathFinder.findPath(noCachePath);
+    CORRADE_COMPARE(cachePath.geodesicDistance, noCachePath.geodesicDistance);
+  };
+
+  CORRADE_VERIFY(
+      pathFinder.setObstacle(7, pt, esp::vec3f(0.5f, 1.0f, 0.5f), 0.3f));
+  CORRADE_VERIFY(pathFinder.getObstacleIDs() == std::vector<int>{7});
+  // the navmesh only changes on update
+  CORRADE_VERIFY(pathFinder.isNavigable(pt));
+  CORRADE_VERIFY(pathFinder.updateObstacles());
+  CORRADE_VERIFY(!pathFinder.isNavigable(pt));
+  CORRADE_VERIFY(pathFinder.getNavigableArea() < area);
+  compareWithUncached();
+  // the field was built on the navmesh before the update
+  CORRADE_VERIFY(!field->isUpToDate());
+  CORRADE_VERIFY(
+      pathFinder.buildDistanceField(cachePath.getRequestedEnds())
+          ->isUpToDate());
+
+  CORRADE_VERIFY(pathFinder.removeObstacle(7));
+  CORRADE_VERIFY(!pathFinder.removeObstacle(7));
+  CORRADE_VERIFY(pathFinder.getObstacleIDs().empty());
+  CORRADE_VERIFY(pathFinder.updateObstacles());
+  CORRADE_VERIFY(pathFinder.isNavigable(pt));
+  CORRADE_COMPARE(pathFinder.getNavigableArea(), area);
+  compareWithUncached();
+  CORRADE_COMPARE(cachePath.geodesicDistance, distance);
+}
+
 void PathFinderTest::testCaching() {
   esp::nav::PathFinder pathFinder;
   pathFinder.loadNavMesh(skokloster);
@@ -202,6 +472,73 @@ void PathFinderTest::benchmarkMultiGoal() {
   CORRADE_VERIFY(status);
 }
 
+void PathFinderTest::benchmarkMultiGoalCount() {
+  esp::nav::PathFinder pathFinder;
+  pathFinder.loadNavMesh(skokloster);
+  CORRADE_VERIFY(pathFinder.isLoaded());
+  pathFinder.seed(0);
+
+  auto&& data = MultiGoalCountBenchMarkData[testCaseInstanceId()];
+  setTestCaseDescription(data.name);
+
+  std::vector<esp::vec3f> starts;
+  do {
+    const esp::vec3f start = pathFinder.getRandomNavigablePoint();
+    if (pathFinder.islandRadius(start) >= 10.0) {
+      starts.push_back(start);
+    }
+  } while (starts.size() < 100);
+
+  std::vector<esp::vec3f> rqEnds;
+  rqEnds.reserve(data.numEnds);
+  for (int i = 0; i < data.numEnds; ++i) {
+    rqEnds.emplace_back(pathFinder.getRandomNavigablePoint());
+  }
+
+  esp::nav::MultiGoalShortestPath path;
+  path.setRequestedEnds(rqEnds);
+  esp::nav::ShortestPath singlePath;
+  float totalDistance = 0.0f;
+  CORRADE_BENCHMARK(1) {
+    for (const auto& start : starts) {
+      // the baseline, an A* search to each end
+      if (data.searchPerEnd) {
+        float distance = std::numeric_limits<float>::infinity();
+        singlePath.requestedStart = start;
+        for (const auto& end : rqEnds) {
+          singlePath.requestedEnd = end;
+          pathFinder.findPath(singlePath);
+          distance = std::min(distance, singlePath.geodesicDistance);
+        }
+        totalDistance += distance;
+      } else {
+        path.requestedStart = start;
+        pathFinder.findPath(path);
+        totalDistance += path.geodesicDistance;
+      }
+    }
+  };
+  CORRADE_VERIFY(totalDistance > 0.0f);
+}
+
+void PathFinderTest::benchmarkFindPaths() {
+  esp::nav::PathFinder pathFinder;
+  pathFinder.loadNavMesh(skokloster);
+  CORRADE_VERIFY(pathFinder.isLoaded());
+  pathFinder.seed(0);
+
+  std::vector<esp::nav::ShortestPath> paths(1000);
+  for (auto& path : paths) {
+    path.requestedStart = pathFinder.getRandomNavigablePoint();
+    path.requestedEnd = pathFinder.getRandomNavigablePoint();
+  }
+
+  CORRADE_BENCHMARK(1) {
+    pathFinder.findPaths(Cr::Containers::arrayView(paths));
+  };
+  CORRADE_VERIFY(paths[0].geodesicDistance > 0.0f);
+}
+
 }  // namespace
 
 CORRADE_TEST_MAIN(PathFinderTest)
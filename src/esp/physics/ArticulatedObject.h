@@ -294,6 +294,16 @@ class ArticulatedObject : public Magnum::SceneGraph::AbstractFeature3D {
 
   virtual void setRootState(CORRADE_UNUSED const Magnum::Matrix4& state){};
 
+  virtual Magnum::Vector3 getRootLinearVelocity() { return {}; };
+
+  virtual void setRootLinearVelocity(
+      CORRADE_UNUSED const Magnum::Vector3& linVel){};
+
+  virtual Magnum::Vector3 getRootAngularVelocity() { return {}; };
+
+  virtual void setRootAngularVelocity(
+      CORRADE_UNUSED const Magnum::Vector3& angVel){};
+
   virtual void setForces(CORRADE_UNUSED const std::vector<float>& forces){};
 
   virtual std::vector<float> getForces() { return {}; };
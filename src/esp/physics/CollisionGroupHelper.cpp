@@ -62,6 +62,11 @@ int CollisionGroupHelper::getMaskForGroup(CollisionGroup group) {
       // nothing
       return 0;
 
+    case CollisionGroup::Trigger:
+      // everything but other triggers
+      return int(-1) & ~int(CollisionGroup::Trigger) &
+             ~int(CollisionGroup::Noncollidable);
+
     default:
       CORRADE_ASSERT(
           false,
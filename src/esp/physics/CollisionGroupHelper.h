@@ -32,7 +32,8 @@ enum class CollisionGroup {
   Robot = 32,
   EeMargin = 64,
   SelObj = 128,
-  Noncollidable = 256
+  Noncollidable = 256,
+  Trigger = 512
 };
 
 class CollisionGroupHelper {
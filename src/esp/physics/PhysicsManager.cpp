@@ -4,9 +4,14 @@
 
 #include "PhysicsManager.h"
 #include "esp/assets/CollisionMeshData.h"
+#include "esp/core/Check.h"
 
+#include <Corrade/Utility/Assert.h>
 #include <Magnum/Math/Range.h>
 
+#include <algorithm>
+#include <iterator>
+
 namespace esp {
 namespace physics {
 
@@ -109,9 +114,9 @@ int PhysicsManager::addObject(
   //! Render node as child of physics node
   //! Verify we should make the object drawable
   if (obj->getInitializationAttributes()->getIsVisible()) {
-    resourceManager_.addObjectToDrawables(obj->getInitializationAttributes(),
-                                          obj->visualNode_, drawables,
-                                          obj->visualNodes_, lightSetup);
+    obj->renderAssetInstanceNode_ = resourceManager_.addObjectToDrawables(
+        obj->getInitializationAttributes(), obj->visualNode_, drawables,
+        obj->visualNodes_, lightSetup);
   }
 
   // finalize rigid object creation
@@ -134,6 +139,15 @@ void PhysicsManager::removeObject(const int physObjectID,
   scene::SceneNode* visualNode = existingObjects_.at(physObjectID)->visualNode_;
   existingObjects_.erase(physObjectID);
   deallocateObjectID(physObjectID);
+  // record the exit now, the ID may be reused before the next step
+  for (auto& trigger : triggerVolumes_) {
+    auto& inside = trigger.second.objectsInside;
+    auto it = std::lower_bound(inside.begin(), inside.end(), physObjectID);
+    if (it != inside.end() && *it == physObjectID) {
+      inside.erase(it);
+      triggerEvents_.push_back({trigger.first, physObjectID, false});
+    }
+  }
   if (deleteObjectNode) {
     delete objectNode;
   } else if (deleteVisualNode && visualNode) {
@@ -141,6 +155,39 @@ void PhysicsManager::removeObject(const int physObjectID,
   }
 }
 
+bool PhysicsManager::swapObjectRenderAsset(const int physObjectID,
+                                           const std::string& attributesHandle,
+                                           DrawableGroup* drawables,
+                                           const std::string& lightSetup) {
+  assertIDValidity(physObjectID);
+  RigidObject* obj = existingObjects_.at(physObjectID).get();
+  if (!obj->renderAssetInstanceNode_) {
+    LOG(ERROR) << "PhysicsManager::swapObjectRenderAsset : object "
+               << physObjectID << " has no render asset instance to replace.";
+    return false;
+  }
+  auto attributes =
+      resourceManager_.getObjectAttributesManager()->getObjectCopyByHandle(
+          attributesHandle);
+  if (!attributes) {
+    LOG(ERROR) << "PhysicsManager::swapObjectRenderAsset : unknown attributes "
+               << attributesHandle;
+    return false;
+  }
+  if (!resourceManager_.instantiateAssetsOnDemand(attributes)) {
+    LOG(ERROR) << "PhysicsManager::swapObjectRenderAsset : "
+                  "ResourceManager::instantiateAssetsOnDemand unsuccessful.";
+    return false;
+  }
+
+  const int semanticId = obj->getSemanticId();
+  obj->renderAssetInstanceNode_ = resourceManager_.swapObjectDrawables(
+      obj->renderAssetInstanceNode_, attributes, drawables, obj->visualNodes_,
+      lightSetup);
+  obj->setSemanticId(semanticId);
+  return true;
+}
+
 void PhysicsManager::removeArticulatedObject(int physObjectID) {
   CHECK(existingArticulatedObjects_.count(physObjectID));
   scene::SceneNode* objectNode =
@@ -241,7 +288,192 @@ void PhysicsManager::stepPhysics(double dt) {
     }
     worldTime_ += fixedTimeStep_;
   }
+
+  updateTriggerVolumes();
+}
+
+int PhysicsManager::addTriggerVolume(const Magnum::Range3D& localBox,
+                                     const Magnum::Matrix4& transform,
+                                     TriggerCallback callback) {
+  const int triggerId = nextTriggerID_++;
+  TriggerVolume& trigger = triggerVolumes_[triggerId];
+  trigger.localBox = localBox;
+  trigger.transform = transform;
+  trigger.invTransform = transform.inverted();
+  trigger.callback = std::move(callback);
+  return triggerId;
+}
+
+void PhysicsManager::setTriggerVolumeTransformation(
+    const int triggerId,
+    const Magnum::Matrix4& transform) {
+  CHECK(triggerVolumes_.count(triggerId) > 0);
+  TriggerVolume& trigger = triggerVolumes_.at(triggerId);
+  trigger.transform = transform;
+  trigger.invTransform = transform.inverted();
 }
+
+void PhysicsManager::removeTriggerVolume(const int triggerId) {
+  CHECK(triggerVolumes_.count(triggerId) > 0);
+  triggerVolumes_.erase(triggerId);
+}
+
+std::vector<TriggerEvent> PhysicsManager::takeTriggerEvents() {
+  std::vector<TriggerEvent> events;
+  events.swap(triggerEvents_);
+  return events;
+}
+
+void PhysicsManager::writeSnapshot(core::SnapshotWriter& writer) const {
+  writer.write(worldTime_);
+
+  writer.write(uint32_t(existingObjects_.size()));
+  for (const auto& it : existingObjects_) {
+    writer.write(it.first);
+    writer.write(it.second->getRigidState());
+    writer.write(it.second->getLinearVelocity());
+    writer.write(it.second->getAngularVelocity());
+  }
+
+  writer.write(uint32_t(existingArticulatedObjects_.size()));
+  for (const auto& it : existingArticulatedObjects_) {
+    writer.write(it.first);
+    writer.write(it.second->getRootState());
+    writer.write(it.second->getRootLinearVelocity());
+    writer.write(it.second->getRootAngularVelocity());
+    writer.writeVector(it.second->getPositions());
+    writer.writeVector(it.second->getVelocities());
+  }
+
+  writer.write(uint32_t(triggerVolumes_.size()));
+  for (const auto& it : triggerVolumes_) {
+    writer.write(it.first);
+    writer.writeVector(it.second.objectsInside);
+  }
+}
+
+void PhysicsManager::readSnapshot(core::SnapshotReader& reader) {
+  worldTime_ = reader.read<double>();
+
+  const uint32_t numObjects = reader.read<uint32_t>();
+  ESP_CHECK(numObjects == existingObjects_.size(),
+            "PhysicsManager::readSnapshot(): snapshot has"
+                << numObjects << "rigid objects but the world has"
+                << existingObjects_.size());
+  for (auto& it : existingObjects_) {
+    const int objectID = reader.read<int>();
+    ESP_CHECK(objectID == it.first,
+              "PhysicsManager::readSnapshot(): rigid object" << objectID
+                  << "of the snapshot doesn't exist");
+    it.second->setRigidState(reader.read<core::RigidState>());
+    it.second->setLinearVelocity(reader.read<Magnum::Vector3>());
+    it.second->setAngularVelocity(reader.read<Magnum::Vector3>());
+  }
+
+  const uint32_t numArticulatedObjects = reader.read<uint32_t>();
+  ESP_CHECK(numArticulatedObjects == existingArticulatedObjects_.size(),
+            "PhysicsManager::readSnapshot(): snapshot has"
+                << numArticulatedObjects
+                << "articulated objects but the world has"
+                << existingArticulatedObjects_.size());
+  std::vector<float> jointValues;
+  for (auto& it : existingArticulatedObjects_) {
+    const int objectID = reader.read<int>();
+    ESP_CHECK(objectID == it.first,
+              "PhysicsManager::readSnapshot(): articulated object"
+                  << objectID << "of the snapshot doesn't exist");
+    it.second->setRootState(reader.read<Magnum::Matrix4>());
+    it.second->setRootLinearVelocity(reader.read<Magnum::Vector3>());
+    it.second->setRootAngularVelocity(reader.read<Magnum::Vector3>());
+    reader.readVector(jointValues);
+    it.second->setPositions(jointValues);
+    reader.readVector(jointValues);
+    it.second->setVelocities(jointValues);
+  }
+
+  const uint32_t numTriggerVolumes = reader.read<uint32_t>();
+  ESP_CHECK(numTriggerVolumes == triggerVolumes_.size(),
+            "PhysicsManager::readSnapshot(): snapshot has"
+                << numTriggerVolumes << "trigger volumes but the world has"
+                << triggerVolumes_.size());
+  for (auto& it : triggerVolumes_) {
+    const int triggerId = reader.read<int>();
+    ESP_CHECK(triggerId == it.first,
+              "PhysicsManager::readSnapshot(): trigger volume"
+                  << triggerId << "of the snapshot doesn't exist");
+    reader.readVector(it.second.objectsInside);
+  }
+  // events since the snapshot didn't happen in the restored world
+  triggerEvents_.clear();
+}
+
+void PhysicsManager::getTriggerVolumeCandidates(
+    CORRADE_UNUSED const int triggerId,
+    std::vector<int>& objectIDs) const {
+  objectIDs.reserve(objectIDs.size() + existingObjects_.size());
+  for (const auto& object : existingObjects_) {
+    objectIDs.push_back(object.first);
+  }
+}
+
+void PhysicsManager::updateTriggerVolumes() {
+  std::vector<int> candidates;
+  std::vector<int> inside;
+  for (auto& triggerItr : triggerVolumes_) {
+    TriggerVolume& trigger = triggerItr.second;
+    candidates.clear();
+    getTriggerVolumeCandidates(triggerItr.first, candidates);
+
+    inside.clear();
+    for (const int objectID : candidates) {
+      auto objectItr = existingObjects_.find(objectID);
+      if (objectItr == existingObjects_.end()) {
+        continue;
+      }
+      const Magnum::Vector3 localPos = trigger.invTransform.transformPoint(
+          objectItr->second->getTranslation());
+      if (trigger.localBox.contains(localPos)) {
+        inside.push_back(objectID);
+      }
+    }
+    std::sort(inside.begin(), inside.end());
+    inside.erase(std::unique(inside.begin(), inside.end()), inside.end());
+
+    // both lists are sorted, so a single merge finds entries and exits
+    auto prevItr = trigger.objectsInside.begin();
+    auto curItr = inside.begin();
+    while (prevItr != trigger.objectsInside.end() || curItr != inside.end()) {
+      if (curItr == inside.end() ||
+          (prevItr != trigger.objectsInside.end() && *prevItr < *curItr)) {
+        triggerEvents_.push_back({triggerItr.first, *prevItr++, false});
+      } else if (prevItr == trigger.objectsInside.end() || *curItr < *prevItr) {
+        triggerEvents_.push_back({triggerItr.first, *curItr++, true});
+      } else {
+        ++prevItr;
+        ++curItr;
+      }
+    }
+    trigger.objectsInside.swap(inside);
+  }
+
+  // callbacks may add or remove objects and volumes, so dispatch last
+  std::vector<TriggerEvent> events;
+  events.swap(triggerEvents_);
+  for (const TriggerEvent& event : events) {
+    auto triggerItr = triggerVolumes_.find(event.triggerId);
+    if (triggerItr == triggerVolumes_.end()) {
+      continue;
+    }
+    if (!triggerItr->second.callback) {
+      triggerEvents_.push_back(event);
+      continue;
+    }
+    // copied, since the callback may remove its own volume
+    TriggerCallback callback = triggerItr->second.callback;
+    callback(event);
+  }
+}
+
 void PhysicsManager::deferNodesUpdate() {
   for (auto& o : existingObjects_)
     o.second->deferUpdate();
@@ -407,6 +639,66 @@ esp::core::RigidState PhysicsManager::getRigidState(
   return existingObjects_.at(physObjectID)->getRigidState();
 }
 
+std::map<int, RigidObject::uptr>::const_iterator
+PhysicsManager::findExistingObjectFrom(
+    const int physObjectID,
+    std::map<int, RigidObject::uptr>::const_iterator prev) const {
+  if (prev != existingObjects_.end()) {
+    if (prev->first == physObjectID) {
+      return prev;
+    }
+    auto next = std::next(prev);
+    if (next != existingObjects_.end() && next->first == physObjectID) {
+      return next;
+    }
+  }
+  auto it = existingObjects_.find(physObjectID);
+  CHECK(it != existingObjects_.end());
+  return it;
+}
+
+void PhysicsManager::getTransformations(
+    Corrade::Containers::ArrayView<const int> physObjectIDs,
+    Corrade::Containers::ArrayView<Magnum::Matrix4> transforms) const {
+  CORRADE_ASSERT(physObjectIDs.size() == transforms.size(),
+                 "PhysicsManager::getTransformations(): expected"
+                     << physObjectIDs.size() << "transforms but got"
+                     << transforms.size(), );
+  auto it = existingObjects_.cend();
+  for (std::size_t i = 0; i < physObjectIDs.size(); ++i) {
+    it = findExistingObjectFrom(physObjectIDs[i], it);
+    transforms[i] = it->second->node().transformation();
+  }
+}
+
+void PhysicsManager::getRigidStates(
+    Corrade::Containers::ArrayView<const int> physObjectIDs,
+    Corrade::Containers::ArrayView<esp::core::RigidState> rigidStates) const {
+  CORRADE_ASSERT(physObjectIDs.size() == rigidStates.size(),
+                 "PhysicsManager::getRigidStates(): expected"
+                     << physObjectIDs.size() << "states but got"
+                     << rigidStates.size(), );
+  auto it = existingObjects_.cend();
+  for (std::size_t i = 0; i < physObjectIDs.size(); ++i) {
+    it = findExistingObjectFrom(physObjectIDs[i], it);
+    rigidStates[i] = it->second->getRigidState();
+  }
+}
+
+void PhysicsManager::setRigidStates(
+    Corrade::Containers::ArrayView<const int> physObjectIDs,
+    Corrade::Containers::ArrayView<const esp::core::RigidState> rigidStates) {
+  CORRADE_ASSERT(physObjectIDs.size() == rigidStates.size(),
+                 "PhysicsManager::setRigidStates(): expected"
+                     << physObjectIDs.size() << "states but got"
+                     << rigidStates.size(), );
+  auto it = existingObjects_.cend();
+  for (std::size_t i = 0; i < physObjectIDs.size(); ++i) {
+    it = findExistingObjectFrom(physObjectIDs[i], it);
+    it->second->setRigidState(rigidStates[i]);
+  }
+}
+
 Magnum::Vector3 PhysicsManager::getTranslation(const int physObjectID) const {
   assertIDValidity(physObjectID);
   return existingObjects_.at(physObjectID)->node().translation();
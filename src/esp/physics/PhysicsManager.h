@@ -10,6 +10,9 @@
  * esp::physics::PhysicsManager::PhysicsSimulationLibrary
  */
 
+#include <Corrade/Containers/ArrayView.h>
+#include <Magnum/Math/Range.h>
+#include <functional>
 #include <map>
 #include <memory>
 #include <string>
@@ -29,6 +32,7 @@
 #include "esp/assets/MeshData.h"
 #include "esp/assets/MeshMetaData.h"
 #include "esp/assets/ResourceManager.h"
+#include "esp/core/Snapshot.h"
 #include "esp/gfx/DrawableGroup.h"
 #include "esp/scene/SceneNode.h"
 
@@ -99,6 +103,19 @@ struct ContactPointData {
   ESP_SMART_POINTERS(ContactPointData)
 };
 
+//! Reports a rigid object entering or leaving a trigger volume.
+struct TriggerEvent {
+  int triggerId = ID_UNDEFINED;
+  int objectId = ID_UNDEFINED;
+  // true if the object entered the volume, false if it left it (or was
+  // removed while inside)
+  bool entered = false;
+};
+
+//! Receives the events of one trigger volume. See @ref
+//! PhysicsManager::addTriggerVolume.
+typedef std::function<void(const TriggerEvent&)> TriggerCallback;
+
 // TODO: repurpose to manage multiple physical worlds. Currently represents
 // exactly one world.
 
@@ -276,6 +293,26 @@ class PhysicsManager {
       scene::SceneNode* attachmentNode = nullptr,
       const std::string& lightSetup = DEFAULT_LIGHTING_KEY);
 
+  /** @brief Replace the render asset of an object with that of another
+   * object template, keeping its ID, physical body and scene node. Only the
+   * drawables are rebuilt, which makes this much cheaper than removing and
+   * re-adding the object, and a gfx replay recording sees it as a change of
+   * the existing instance.
+   * @param physObjectID The object ID and key identifying the object in @ref
+   * PhysicsManager::existingObjects_.
+   * @param attributesHandle The handle of the object template whose render
+   * asset and scale to use. Its physical properties are ignored.
+   * @param drawables Reference to the scene graph drawables group to render
+   * the new asset with.
+   * @param lightSetup The light setup key for the new asset.
+   * @return Whether the render asset was replaced.
+   */
+  bool swapObjectRenderAsset(
+      const int physObjectID,
+      const std::string& attributesHandle,
+      DrawableGroup* drawables,
+      const std::string& lightSetup = DEFAULT_LIGHTING_KEY);
+
   /** @brief Remove an object instance from the pysical scene by ID, destroying
    * its scene graph node and removing it from @ref
    * PhysicsManager::existingObjects_.
@@ -634,6 +671,67 @@ class PhysicsManager {
   // Syncs the state of the bullet scene graph to the rendering scene graph
   virtual void updateNodes();
 
+  //============ Trigger volume functions =============
+
+  /**
+   * @brief Add a non-colliding box volume which reports rigid objects
+   * entering and leaving it. Objects are tested by their origin, once at the
+   * end of each @ref stepPhysics call.
+   * @param localBox The box, in the local space of @p transform.
+   * @param transform The world transformation of the volume.
+   * @param callback Called on the stepping thread for each event of this
+   * volume. If empty, events are queued for @ref takeTriggerEvents instead.
+   * @return The id of the new trigger volume.
+   */
+  virtual int addTriggerVolume(const Magnum::Range3D& localBox,
+                               const Magnum::Matrix4& transform,
+                               TriggerCallback callback = nullptr);
+
+  /**
+   * @brief Move a trigger volume. Membership is re-evaluated on the next
+   * @ref stepPhysics.
+   * @param triggerId The id returned by @ref addTriggerVolume.
+   * @param transform The new world transformation of the volume.
+   */
+  virtual void setTriggerVolumeTransformation(int triggerId,
+                                              const Magnum::Matrix4& transform);
+
+  /**
+   * @brief Remove a trigger volume. No exit events are generated for objects
+   * still inside it.
+   * @param triggerId The id returned by @ref addTriggerVolume.
+   */
+  virtual void removeTriggerVolume(int triggerId);
+
+  /** @brief Get the number of trigger volumes in the world. */
+  int getNumTriggerVolumes() const { return triggerVolumes_.size(); }
+
+  /**
+   * @brief Get the queued events of volumes without a callback and clear the
+   * queue. Events of one step are ordered by trigger id, then object id.
+   */
+  std::vector<TriggerEvent> takeTriggerEvents();
+
+  // =========== Snapshots ===========
+
+  /**
+   * @brief Append the dynamic state of the world to @p writer: the world
+   * time, rigid object states and velocities, articulated object root states
+   * and velocities, joint positions and joint velocities, and trigger volume
+   * membership. Objects and volumes themselves aren't recorded.
+   */
+  void writeSnapshot(core::SnapshotWriter& writer) const;
+
+  /**
+   * @brief Restore state written by @ref writeSnapshot. The world must hold
+   * the same rigid objects, articulated objects and trigger volumes as when
+   * the snapshot was taken. Trigger events not taken yet are dropped, see
+   * @ref takeTriggerEvents. Solver caches such as contact points aren't part
+   * of the snapshot, so stepping after a restore isn't guaranteed to be
+   * bit-identical to stepping the original world.
+   */
+  void readSnapshot(core::SnapshotReader& reader);
+
   // =========== Global Setter functions ===========
 
   /** @brief Set the @ref fixedTimeStep_ of the physical world. See @ref
@@ -863,6 +961,40 @@ class PhysicsManager {
    */
   esp::core::RigidState getRigidState(const int objectID) const;
 
+  /** @brief Get the current 4x4 transformation matrices of many objects in a
+   * single pass. Lookups of ascending, consecutive IDs (e.g. objects added
+   * together) step through @ref existingObjects_ instead of searching it.
+   * @param physObjectIDs The object IDs and keys identifying the objects in
+   * @ref PhysicsManager::existingObjects_.
+   * @param [out] transforms Receives the transform of each object. Must be the
+   * same size as @p physObjectIDs.
+   */
+  void getTransformations(
+      Corrade::Containers::ArrayView<const int> physObjectIDs,
+      Corrade::Containers::ArrayView<Magnum::Matrix4> transforms) const;
+
+  /** @brief Get the current @ref esp::core::RigidState of many objects in a
+   * single pass. See @ref getTransformations.
+   * @param physObjectIDs The object IDs and keys identifying the objects in
+   * @ref PhysicsManager::existingObjects_.
+   * @param [out] rigidStates Receives the state of each object. Must be the
+   * same size as @p physObjectIDs.
+   */
+  void getRigidStates(
+      Corrade::Containers::ArrayView<const int> physObjectIDs,
+      Corrade::Containers::ArrayView<esp::core::RigidState> rigidStates) const;
+
+  /** @brief Set the @ref esp::core::RigidState of many objects kinematically
+   * in a single pass. See @ref setRigidState and @ref getTransformations.
+   * @param physObjectIDs The object IDs and keys identifying the objects in
+   * @ref PhysicsManager::existingObjects_.
+   * @param rigidStates The desired state of each object. Must be the same
+   * size as @p physObjectIDs.
+   */
+  void setRigidStates(
+      Corrade::Containers::ArrayView<const int> physObjectIDs,
+      Corrade::Containers::ArrayView<const esp::core::RigidState> rigidStates);
+
   /** @brief Get the current 3D position of an object.
    * @param  physObjectID The object ID and key identifying the object in @ref
    * PhysicsManager::existingObjects_.
@@ -1542,6 +1674,31 @@ class PhysicsManager {
     CHECK(existingObjects_.count(physObjectID) > 0);
   };
 
+  /** @brief Find an object for a bulk query, starting from the previous
+   * query's result. Ascending consecutive IDs are found in O(1).
+   * @param physObjectID The object ID to find.
+   * @param prev The iterator returned for the previous ID in the batch, or
+   * @ref existingObjects_.end() for the first one.
+   */
+  std::map<int, RigidObject::uptr>::const_iterator findExistingObjectFrom(
+      const int physObjectID,
+      std::map<int, RigidObject::uptr>::const_iterator prev) const;
+
+  /** @brief Collect the ids of the objects which may be inside a trigger
+   * volume. The default implementation returns every rigid object; derived
+   * classes with a broadphase return only overlapping ones.
+   * @param triggerId The trigger volume to query.
+   * @param [out] objectIDs Receives the candidate object IDs.
+   */
+  virtual void getTriggerVolumeCandidates(int triggerId,
+                                          std::vector<int>& objectIDs) const;
+
+  /** @brief Re-evaluate the contents of every trigger volume and dispatch
+   * an event for each object which entered or left one. Called at the end of
+   * @ref stepPhysics.
+   */
+  void updateTriggerVolumes();
+
   /** @brief Check if a particular mesh can be used as a collision mesh for a
    * particular physics implemenation. Always True for base @ref PhysicsManager
    * class, since the mesh has already been successfully loaded by @ref
@@ -1669,6 +1826,29 @@ class PhysicsManager {
    * allocateObjectID before new IDs are acquired with @ref nextObjectID_. */
   std::vector<int> recycledObjectIDs_;
 
+  //! ==== Trigger volumes ====
+
+  //! A box volume and the objects found inside it on the last update.
+  struct TriggerVolume {
+    Magnum::Range3D localBox;
+    Magnum::Matrix4 transform;
+    Magnum::Matrix4 invTransform;
+    //! Sorted object IDs inside the volume after the last update.
+    std::vector<int> objectsInside;
+    TriggerCallback callback;
+  };
+
+  /** @brief Maps trigger ids to the trigger volumes in the world. */
+  std::map<int, TriggerVolume> triggerVolumes_;
+
+  /** @brief The id to give the next trigger volume. Trigger ids are not
+   * recycled. */
+  int nextTriggerID_ = 0;
+
+  /** @brief Events not yet dispatched to a callback or taken with @ref
+   * takeTriggerEvents. */
+  std::vector<TriggerEvent> triggerEvents_;
+
   //! Utilities
 
   /** @brief Tracks whether or not this @ref PhysicsManager has already been
@@ -601,6 +601,10 @@ class RigidBase : public esp::physics::PhysicsObjectBase {
   //! SceneGraph
   std::vector<esp::scene::SceneNode*> visualNodes_;
 
+  //! root of the render asset instance under @ref visualNode_, if any. See
+  //! @ref PhysicsManager::swapObjectRenderAsset.
+  scene::SceneNode* renderAssetInstanceNode_ = nullptr;
+
   //! ptr to the VoxelWrapper associated with this RigidBase
   std::shared_ptr<esp::geo::VoxelWrapper> voxelWrapper = nullptr;
 
@@ -361,6 +361,24 @@ void BulletArticulatedObject::setRootState(const Magnum::Matrix4& state) {
   updateKinematicState();
 }
 
+Magnum::Vector3 BulletArticulatedObject::getRootLinearVelocity() {
+  return Magnum::Vector3{btMultiBody_->getBaseVel()};
+}
+
+void BulletArticulatedObject::setRootLinearVelocity(
+    const Magnum::Vector3& linVel) {
+  btMultiBody_->setBaseVel(btVector3(linVel));
+}
+
+Magnum::Vector3 BulletArticulatedObject::getRootAngularVelocity() {
+  return Magnum::Vector3{btMultiBody_->getBaseOmega()};
+}
+
+void BulletArticulatedObject::setRootAngularVelocity(
+    const Magnum::Vector3& angVel) {
+  btMultiBody_->setBaseOmega(btVector3(angVel));
+}
+
 void BulletArticulatedObject::setForces(const std::vector<float>& forces) {
   if (forces.size() != size_t(btMultiBody_->getNumDofs())) {
     Corrade::Utility::Debug()
@@ -85,6 +85,14 @@ class BulletArticulatedObject : public ArticulatedObject {
 
   virtual void setRootState(const Magnum::Matrix4& state) override;
 
+  virtual Magnum::Vector3 getRootLinearVelocity() override;
+
+  virtual void setRootLinearVelocity(const Magnum::Vector3& linVel) override;
+
+  virtual Magnum::Vector3 getRootAngularVelocity() override;
+
+  virtual void setRootAngularVelocity(const Magnum::Vector3& angVel) override;
+
   virtual void setForces(const std::vector<float>& forces) override;
 
   virtual std::vector<float> getForces() override;
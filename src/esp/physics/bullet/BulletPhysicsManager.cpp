@@ -28,6 +28,10 @@ BulletPhysicsManager::BulletPhysicsManager(
 BulletPhysicsManager::~BulletPhysicsManager() {
   LOG(INFO) << "Deconstructing BulletPhysicsManager";
 
+  for (auto& trigger : bTriggerVolumes_) {
+    bWorld_->removeCollisionObject(trigger.second.ghost.get());
+  }
+  bTriggerVolumes_.clear();
   existingObjects_.clear();
   existingArticulatedObjects_.clear();
   staticStageObject_.reset(nullptr);
@@ -66,6 +70,8 @@ bool BulletPhysicsManager::initPhysicsFinalize() {
   // btGImpactCollisionAlgorithm::registerAlgorithm(&bDispatcher_);
   bWorld_ = std::make_shared<btMultiBodyDynamicsWorld>(
       &bDispatcher_, &bBroadphase_, &bSolver_, &bCollisionConfig_);
+  bBroadphase_.getOverlappingPairCache()->setInternalGhostPairCallback(
+      &bGhostPairCallback_);
 
   debugDrawer_.setMode(
       Magnum::BulletIntegration::DebugDraw::Mode::DrawWireframe |
@@ -269,6 +275,14 @@ void BulletPhysicsManager::stepPhysics(double dt) {
   worldTime_ += numSubStepsTaken * fixedTimeStep_;
   m_recentNumSubStepsTaken = numSubStepsTaken;
 
+  if (!bTriggerVolumes_.empty()) {
+    // stepSimulation finds pairs before integrating, so refresh them for the
+    // final poses before testing trigger volumes
+    bWorld_->updateAabbs();
+    bWorld_->computeOverlappingPairs();
+  }
+  updateTriggerVolumes();
+
 #if 0  // print collision debug info periodically?
   {
     // Beware getCollisionFilteringSummary is currently only safe to use if your program never removes physics objects. Otherwise it will crash.
@@ -294,6 +308,54 @@ void BulletPhysicsManager::stepPhysics(double dt) {
 #endif
 }
 
+int BulletPhysicsManager::addTriggerVolume(const Magnum::Range3D& localBox,
+                                           const Magnum::Matrix4& transform,
+                                           TriggerCallback callback) {
+  const int triggerId = PhysicsManager::addTriggerVolume(
+      localBox, transform, std::move(callback));
+
+  BulletTriggerVolume& trigger = bTriggerVolumes_[triggerId];
+  trigger.shape =
+      std::make_unique<btBoxShape>(btVector3(localBox.size() / 2.0f));
+  trigger.ghost = std::make_unique<btGhostObject>();
+  trigger.ghost->setCollisionShape(trigger.shape.get());
+  trigger.ghost->setCollisionFlags(trigger.ghost->getCollisionFlags() |
+                                   btCollisionObject::CF_NO_CONTACT_RESPONSE);
+  trigger.ghost->setWorldTransform(btTransform(
+      transform * Magnum::Matrix4::translation(localBox.center())));
+  bWorld_->addCollisionObject(
+      trigger.ghost.get(), int(CollisionGroup::Trigger),
+      CollisionGroupHelper::getMaskForGroup(CollisionGroup::Trigger));
+  return triggerId;
+}
+
+void BulletPhysicsManager::setTriggerVolumeTransformation(
+    const int triggerId,
+    const Magnum::Matrix4& transform) {
+  PhysicsManager::setTriggerVolumeTransformation(triggerId, transform);
+  const Magnum::Range3D& localBox = triggerVolumes_.at(triggerId).localBox;
+  bTriggerVolumes_.at(triggerId).ghost->setWorldTransform(btTransform(
+      transform * Magnum::Matrix4::translation(localBox.center())));
+}
+
+void BulletPhysicsManager::removeTriggerVolume(const int triggerId) {
+  PhysicsManager::removeTriggerVolume(triggerId);
+  bWorld_->removeCollisionObject(bTriggerVolumes_.at(triggerId).ghost.get());
+  bTriggerVolumes_.erase(triggerId);
+}
+
+void BulletPhysicsManager::getTriggerVolumeCandidates(
+    const int triggerId,
+    std::vector<int>& objectIDs) const {
+  const btGhostObject& ghost = *bTriggerVolumes_.at(triggerId).ghost;
+  for (int i = 0; i < ghost.getNumOverlappingObjects(); ++i) {
+    auto objIdItr = collisionObjToObjIds_->find(ghost.getOverlappingObject(i));
+    if (objIdItr != collisionObjToObjIds_->end()) {
+      objectIDs.push_back(objIdItr->second);
+    }
+  }
+}
+
 void BulletPhysicsManager::setMargin(const int physObjectID,
                                      const double margin) {
   assertIDValidity(physObjectID);
@@ -694,6 +756,8 @@ RaycastResults BulletPhysicsManager::castRay(const esp::geo::Ray& ray,
   btVector3 to(ray.origin + ray.direction * maxDistance);
 
   btCollisionWorld::AllHitsRayResultCallback allResults(from, to);
+  // rays pass through trigger volumes
+  allResults.m_collisionFilterMask &= ~int(CollisionGroup::Trigger);
   bWorld_->rayTest(from, to, allResults);
 
   // convert to RaycastResults
@@ -15,6 +15,7 @@
 #include <Magnum/BulletIntegration/MotionState.h>
 #include <btBulletDynamicsCommon.h>
 
+#include "BulletCollision/CollisionDispatch/btGhostObject.h"
 #include "BulletDynamics/ConstraintSolver/btPoint2PointConstraint.h"
 #include "BulletDynamics/Featherstone/btMultiBodyConstraintSolver.h"
 #include "BulletDynamics/Featherstone/btMultiBodyFixedConstraint.h"
@@ -225,6 +226,23 @@ class BulletPhysicsManager : public PhysicsManager {
   RaycastResults castRay(const esp::geo::Ray& ray,
                          double maxDistance = 100.0) override;
 
+  //============ Trigger volumes =============
+
+  /**
+   * @brief Add a trigger volume backed by a non-responding Bullet ghost
+   * object, so only objects overlapping it in the broadphase are tested. See
+   * @ref PhysicsManager::addTriggerVolume. @p transform must be rigid.
+   */
+  int addTriggerVolume(const Magnum::Range3D& localBox,
+                       const Magnum::Matrix4& transform,
+                       TriggerCallback callback = nullptr) override;
+
+  void setTriggerVolumeTransformation(
+      int triggerId,
+      const Magnum::Matrix4& transform) override;
+
+  void removeTriggerVolume(int triggerId) override;
+
   //============ Point To Point Constraints =============
 
   /**
@@ -411,6 +429,16 @@ class BulletPhysicsManager : public PhysicsManager {
       const esp::metadata::attributes::ObjectAttributes::ptr& objectAttributes,
       scene::SceneNode* objectNode) override;
 
+  /** @brief Collect the objects whose collision shapes overlap the ghost
+   * object of a trigger volume in the broadphase.
+   */
+  void getTriggerVolumeCandidates(int triggerId,
+                                  std::vector<int>& objectIDs) const override;
+
+  //! Keeps the overlapping pair lists of ghost objects up to date. Declared
+  //! before the broadphase, which references it until destruction.
+  btGhostPairCallback bGhostPairCallback_;
+
   btDbvtBroadphase bBroadphase_;
   btDefaultCollisionConfiguration bCollisionConfig_;
 
@@ -429,6 +457,15 @@ class BulletPhysicsManager : public PhysicsManager {
 
   int m_recentNumSubStepsTaken = -1;  // for recent call to stepPhysics
 
+  //! The Bullet collision representation of a trigger volume.
+  struct BulletTriggerVolume {
+    std::unique_ptr<btBoxShape> shape;
+    std::unique_ptr<btGhostObject> ghost;
+  };
+
+  //! Maps trigger ids to their ghost objects. See @ref triggerVolumes_.
+  std::map<int, BulletTriggerVolume> bTriggerVolumes_;
+
  private:
   /** @brief Check if a particular mesh can be used as a collision mesh for
    * Bullet.
@@ -481,6 +481,8 @@ Magnum::Vector3 BulletRigidObject::getCOM() const {
 
 bool BulletRigidObject::contactTest() {
   SimulationContactResultCallback src;
+  // trigger volumes only report overlaps, they aren't contacts
+  src.m_collisionFilterMask &= ~int(CollisionGroup::Trigger);
   bWorld_->getCollisionWorld()->contactTest(bObjectRigidBody_.get(), src);
   return src.bCollision;
 }  // contactTest
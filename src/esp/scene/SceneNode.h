@@ -122,13 +122,27 @@ class SceneNode : public MagnumObject,
   //! Returns node semanticId
   virtual int getSemanticId() const { return semanticId_; }
 
-  //! Sets node semanticId
-  virtual void setSemanticId(int semanticId) { semanticId_ = semanticId; }
+  /**
+   * @brief Sets node semanticId. A change marks the node dirty, like a
+   * transformation change, so features watching for dirty nodes (e.g. the
+   * gfx replay Recorder) are notified.
+   */
+  virtual void setSemanticId(int semanticId) {
+    if (semanticId_ != uint32_t(semanticId)) {
+      semanticId_ = semanticId;
+      setDirty();
+    }
+  }
 
   Magnum::Vector3 absoluteTranslation() const;
 
   Magnum::Vector3 absoluteTranslation();
 
+  /**
+   * @brief Clean the node, then return its cached absolute transformation.
+   */
+  const Magnum::Matrix4& cleanAbsoluteTransformation();
+
   //! recursively compute the cumulative bounding box of the full scene graph
   //! tree for which this node is the root
   const Magnum::Range3D& computeCumulativeBB();
@@ -3,9 +3,9 @@
 // LICENSE file in the root directory of this source tree.
 
 #include "CookableEntity.h"
-#include "EntityManager.h"
 #include "OvenEntity.h"
 
+#include <algorithm>
 #include <iomanip>
 #include <sstream>
 
@@ -17,10 +17,7 @@ CookableEntity::CookableEntity(esp::sim::Simulator* sim,
                                const Magnum::Vector3& translation,
                                const Magnum::Quaternion& rotation)
     : bp_(bp), sim_(sim) {
-  EntityManager<CookableEntity>::get().onConstruct(this);
-
-  auto id =
-      sim->addObjectByHandle("data/objects/cookie_ball.object_config.json");
+  auto id = sim->addObjectByHandle(bp_.objHandle);
   CORRADE_INTERNAL_ASSERT(id != -1);
   sim_->setTranslation(translation, id);
   sim_->setRotation(rotation, id);
@@ -29,36 +26,55 @@ CookableEntity::CookableEntity(esp::sim::Simulator* sim,
   objId_ = id;
 }
 
-void CookableEntity::update(float dt) {
-  bool wasCooked = cookTime_ > bp_.targetCookTime;
+void CookableEntity::update(float dt,
+                            const EntityManager<OvenEntity>& ovens,
+                            EntityCommandBuffer& commands,
+                            uint64_t commandOrder) {
+  bool wasCooked = isCooked();
 
-  const auto pos = sim_->getTranslation(objId_);
   constexpr float minCookTemp = 350.f;
-  for (auto* oven : EntityManager<OvenEntity>::get().getVector()) {
-    float temp = oven->getTemperature();
-    if (temp >= minCookTemp) {
-      if (oven->isInsideCookVolume(pos)) {
-        cookTime_ += dt;
-      }
+  for (const EntityHandle& handle : heatSources_) {
+    // ovens removed while the cookable was inside give a stale handle
+    const OvenEntity* oven = ovens.get(handle);
+    if (oven && oven->getTemperature() >= minCookTemp) {
+      cookTime_ += dt;
     }
   }
 
-  if (!wasCooked && cookTime_ > bp_.targetCookTime) {
-    auto translation = sim_->getTranslation(objId_);
-    // auto rotation = sim_->getRotation(objId_);
-    sim_->removeObject(objId_);
-    auto id = sim_->addObjectByHandle(
-        "data/objects/cookie_cooked.object_config.json");
-    CORRADE_INTERNAL_ASSERT(id != -1);
-    sim_->setTranslation(translation, id);
-    // use identity transform?
-    // sim_->setRotation(rotation, id);
-    objId_ = id;
+  if (!wasCooked && isCooked()) {
+    // changing the scene graph isn't safe while other entities update
+    commands.push(commandOrder, [this]() { swapRenderAsset(true); });
+  }
+}
+
+void CookableEntity::onHeatVolumeEvent(EntityHandle oven, bool entered) {
+  auto it = std::find(heatSources_.begin(), heatSources_.end(), oven);
+  if (entered && it == heatSources_.end()) {
+    heatSources_.push_back(oven);
+  } else if (!entered && it != heatSources_.end()) {
+    heatSources_.erase(it);
   }
 }
 
-CookableEntity::~CookableEntity() {
-  EntityManager<CookableEntity>::get().onDelete(this);
+void CookableEntity::swapRenderAsset(bool cooked) {
+  // keeps the object id and physics body, so heat volume membership carries
+  // over to the cooked object
+  CORRADE_INTERNAL_ASSERT_OUTPUT(sim_->swapObjectRenderAsset(
+      objId_, cooked ? bp_.cookedObjHandle : bp_.objHandle));
+}
+
+void CookableEntity::writeSnapshot(core::SnapshotWriter& writer) const {
+  writer.write(cookTime_);
+  writer.writeVector(heatSources_);
+}
+
+void CookableEntity::readSnapshot(core::SnapshotReader& reader) {
+  const bool wasCooked = isCooked();
+  cookTime_ = reader.read<float>();
+  reader.readVector(heatSources_);
+  if (isCooked() != wasCooked) {
+    swapRenderAsset(isCooked());
+  }
 }
 
 void CookableEntity::debugRender(esp::gfx::Debug3DText& debug3dText,
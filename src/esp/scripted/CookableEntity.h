@@ -10,14 +10,25 @@
 #include <Magnum/Math/Vector3.h>
 #include <esp/gfx/Debug3DText.h>
 #include <esp/gfx/DebugRender.h>
+
+#include <vector>
+
+#include "EntityCommandBuffer.h"
+#include "EntityManager.h"
 #include "esp/sim/Simulator.h"
 
 namespace esp {
 namespace scripted {
 
+class OvenEntity;
+
 class CookableEntity {
  public:
   struct Blueprint {
+    std::string objHandle = "data/objects/cookie_ball.object_config.json";
+    // swapped in once cooked; must share the collision asset of objHandle
+    std::string cookedObjHandle =
+        "data/objects/cookie_cooked.object_config.json";
     float targetCookTime = 10.f;
   };
   CookableEntity(esp::sim::Simulator* sim,
@@ -25,18 +36,45 @@ class CookableEntity {
                  const Magnum::Vector3& translation,
                  const Magnum::Quaternion& rotation);
 
-  ~CookableEntity();
+  /**
+   * @brief Accumulate cook time from the hot ovens this cookable is inside.
+   * Safe to call concurrently for different cookables; swapping in the
+   * cooked object is deferred to @p commands.
+   */
+  void update(float dt,
+              const EntityManager<OvenEntity>& ovens,
+              EntityCommandBuffer& commands,
+              uint64_t commandOrder);
 
-  void update(float dt);
+  /**
+   * @brief Record this cookable entering or leaving the heat volume of
+   * @p oven.
+   */
+  void onHeatVolumeEvent(EntityHandle oven, bool entered);
 
   void debugRender(esp::gfx::Debug3DText& debug3dText,
                    esp::gfx::DebugRender& debugRender);
 
+  int getObjectId() const { return objId_; }
+
+  /**
+   * @brief Save and restore the cook time and heat sources. Restoring across
+   * the cooked threshold swaps the object's render asset accordingly.
+   */
+  void writeSnapshot(core::SnapshotWriter& writer) const;
+  void readSnapshot(core::SnapshotReader& reader);
+
  private:
   Blueprint bp_;
   int objId_ = -1;
   esp::sim::Simulator* sim_ = nullptr;
   float cookTime_ = 0.f;
+  // ovens whose heat volume currently contains this cookable
+  std::vector<EntityHandle> heatSources_;
+
+  bool isCooked() const { return cookTime_ > bp_.targetCookTime; }
+
+  void swapRenderAsset(bool cooked);
 };
 
 }  // namespace scripted
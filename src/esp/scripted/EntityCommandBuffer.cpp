@@ -0,0 +1,29 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "EntityCommandBuffer.h"
+
+#include <algorithm>
+
+namespace esp {
+namespace scripted {
+
+void EntityCommandBuffer::push(uint64_t order, Command command) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  commands_.emplace_back(order, std::move(command));
+}
+
+void EntityCommandBuffer::apply() {
+  std::stable_sort(
+      commands_.begin(), commands_.end(),
+      [](const std::pair<uint64_t, Command>& a,
+         const std::pair<uint64_t, Command>& b) { return a.first < b.first; });
+  for (auto& command : commands_) {
+    command.second();
+  }
+  commands_.clear();
+}
+
+}  // namespace scripted
+}  // namespace esp
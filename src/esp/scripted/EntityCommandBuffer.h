@@ -0,0 +1,60 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#ifndef ESP_SCRIPTED_ENTITYCOMMANDBUFFER_H_
+#define ESP_SCRIPTED_ENTITYCOMMANDBUFFER_H_
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace esp {
+namespace scripted {
+
+/**
+ * @brief Deferred simulator mutations recorded by scripted entities during a
+ * (possibly parallel) tick and applied on the main thread at the end of it.
+ *
+ * Use this for anything that isn't safe to do while other entities are being
+ * updated, e.g. Simulator::removeObject / addObjectByHandle. Commands are
+ * applied sorted by their order key, so the result doesn't depend on thread
+ * scheduling. Commands must not add or remove scripted entities.
+ */
+class EntityCommandBuffer {
+ public:
+  typedef std::function<void()> Command;
+
+  /**
+   * @brief Record a command. Thread-safe.
+   * @param order Sort key; see @ref makeOrder.
+   * @param command The deferred work.
+   */
+  void push(uint64_t order, Command command);
+
+  /**
+   * @brief Run all recorded commands in order, then clear. Main thread only.
+   */
+  void apply();
+
+  bool empty() const { return commands_.empty(); }
+
+  /**
+   * @brief Order key for an entity's command within a system, matching the
+   * order a serial update would have produced.
+   */
+  static uint64_t makeOrder(uint32_t systemIndex, uint32_t entityIndex) {
+    return (uint64_t(systemIndex) << 32) | entityIndex;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::vector<std::pair<uint64_t, Command>> commands_;
+};
+
+}  // namespace scripted
+}  // namespace esp
+
+#endif  // ESP_SCRIPTED_ENTITYCOMMANDBUFFER_H_
@@ -5,25 +5,98 @@
 #ifndef ESP_SCRIPTED_ENTITYMANAGER_H_
 #define ESP_SCRIPTED_ENTITYMANAGER_H_
 
-#include <memory>
+#include <cstdint>
 #include <vector>
 
 namespace esp {
 namespace scripted {
 
+/**
+ * @brief Generational handle to an entity owned by an @ref EntityManager.
+ *
+ * The index refers to a stable slot in the manager; the generation is bumped
+ * every time the slot is freed, so stale handles to destroyed entities are
+ * detected instead of silently aliasing a newer entity.
+ */
+struct EntityHandle {
+  static constexpr uint32_t InvalidIndex = ~uint32_t(0);
+
+  uint32_t index = InvalidIndex;
+  uint32_t generation = 0;
+
+  bool isValid() const { return index != InvalidIndex; }
+
+  bool operator==(const EntityHandle& rhs) const {
+    return index == rhs.index && generation == rhs.generation;
+  }
+  bool operator!=(const EntityHandle& rhs) const { return !(*this == rhs); }
+};
+
+/**
+ * @brief Owns all entities of one scripted type in a single packed array.
+ *
+ * Entities are stored by value and contiguously, so per-tick iteration via
+ * @ref getEntities walks linear memory instead of chasing heap pointers.
+ * Removal swaps the last entity into the freed position (O(1)); handles stay
+ * valid across these moves via an indirection table of slots. Pointers and
+ * references into the packed array are invalidated by @ref add and
+ * @ref remove, so hold on to @ref EntityHandle instead.
+ *
+ * Managers are plain values; each @ref EntityManagerHelper owns its own set,
+ * so multiple simulators can run scripted worlds in the same process.
+ */
 template <typename T>
 class EntityManager {
  public:
-  static EntityManager& get();
+  /**
+   * @brief Take ownership of an entity.
+   * @return A handle that stays valid until @ref remove is called for it.
+   */
+  EntityHandle add(T&& entity);
 
-  void onConstruct(T* ent);
+  /**
+   * @brief Destroy the entity referenced by @p handle, swap-removing it from
+   * the packed array. The handle must be alive.
+   */
+  void remove(EntityHandle handle);
 
-  void onDelete(const T* ent);
+  bool isAlive(EntityHandle handle) const;
 
-  std::vector<T*>& getVector() { return entities_; }
+  /**
+   * @brief Get the entity for @p handle or nullptr if the handle is stale.
+   * The pointer is invalidated by the next @ref add or @ref remove.
+   */
+  T* get(EntityHandle handle);
+  const T* get(EntityHandle handle) const;
+
+  /**
+   * @brief Get the handle of the entity at a packed-array index, e.g. while
+   * iterating @ref getEntities.
+   */
+  EntityHandle getHandle(std::size_t denseIndex) const;
+
+  std::vector<T>& getEntities() { return entities_; }
+  const std::vector<T>& getEntities() const { return entities_; }
+
+  std::size_t size() const { return entities_.size(); }
+
+  /**
+   * @brief Destroy all entities. Outstanding handles become stale.
+   */
+  void clear();
 
  private:
-  std::vector<T*> entities_;
+  struct Slot {
+    // index into entities_ while alive, otherwise next free slot
+    uint32_t denseIndex = EntityHandle::InvalidIndex;
+    uint32_t generation = 0;
+  };
+
+  // packed entities; entities_[i] is owned by slots_[denseToSlot_[i]]
+  std::vector<T> entities_;
+  std::vector<uint32_t> denseToSlot_;
+  std::vector<Slot> slots_;
+  uint32_t freeSlotHead_ = EntityHandle::InvalidIndex;
 };
 
 }  // namespace scripted
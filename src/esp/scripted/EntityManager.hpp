@@ -6,30 +6,91 @@
 
 #include <Corrade/Utility/Assert.h>
 
-#include <algorithm>
+#include <utility>
 
 namespace esp {
 namespace scripted {
 
 template <typename T>
-EntityManager<T>& EntityManager<T>::get() {
-  static std::unique_ptr<EntityManager> instance_;
-  if (!instance_) {
-    instance_ = std::make_unique<EntityManager>();
+EntityHandle EntityManager<T>::add(T&& entity) {
+  uint32_t slotIndex;
+  if (freeSlotHead_ != EntityHandle::InvalidIndex) {
+    slotIndex = freeSlotHead_;
+    freeSlotHead_ = slots_[slotIndex].denseIndex;
+  } else {
+    slotIndex = static_cast<uint32_t>(slots_.size());
+    slots_.emplace_back();
   }
-  return *instance_;
+
+  Slot& slot = slots_[slotIndex];
+  slot.denseIndex = static_cast<uint32_t>(entities_.size());
+  entities_.push_back(std::move(entity));
+  denseToSlot_.push_back(slotIndex);
+
+  EntityHandle handle;
+  handle.index = slotIndex;
+  handle.generation = slot.generation;
+  return handle;
+}
+
+template <typename T>
+void EntityManager<T>::remove(EntityHandle handle) {
+  CORRADE_INTERNAL_ASSERT(isAlive(handle));
+  Slot& slot = slots_[handle.index];
+  const uint32_t denseIndex = slot.denseIndex;
+  const uint32_t lastIndex = static_cast<uint32_t>(entities_.size()) - 1;
+
+  if (denseIndex != lastIndex) {
+    entities_[denseIndex] = std::move(entities_[lastIndex]);
+    denseToSlot_[denseIndex] = denseToSlot_[lastIndex];
+    slots_[denseToSlot_[denseIndex]].denseIndex = denseIndex;
+  }
+  entities_.pop_back();
+  denseToSlot_.pop_back();
+
+  // retire the slot; bumping the generation invalidates outstanding handles
+  ++slot.generation;
+  slot.denseIndex = freeSlotHead_;
+  freeSlotHead_ = handle.index;
 }
 
 template <typename T>
-void EntityManager<T>::onConstruct(T* ent) {
-  entities_.push_back(ent);
+bool EntityManager<T>::isAlive(EntityHandle handle) const {
+  if (handle.index >= slots_.size()) {
+    return false;
+  }
+  const Slot& slot = slots_[handle.index];
+  return slot.generation == handle.generation &&
+         slot.denseIndex < denseToSlot_.size() &&
+         denseToSlot_[slot.denseIndex] == handle.index;
 }
 
 template <typename T>
-void EntityManager<T>::onDelete(const T* ent) {
-  auto it = std::find(entities_.begin(), entities_.end(), ent);
-  CORRADE_INTERNAL_ASSERT(it != entities_.end());
-  entities_.erase(it);
+T* EntityManager<T>::get(EntityHandle handle) {
+  return isAlive(handle) ? &entities_[slots_[handle.index].denseIndex]
+                         : nullptr;
+}
+
+template <typename T>
+const T* EntityManager<T>::get(EntityHandle handle) const {
+  return isAlive(handle) ? &entities_[slots_[handle.index].denseIndex]
+                         : nullptr;
+}
+
+template <typename T>
+EntityHandle EntityManager<T>::getHandle(std::size_t denseIndex) const {
+  CORRADE_INTERNAL_ASSERT(denseIndex < entities_.size());
+  EntityHandle handle;
+  handle.index = denseToSlot_[denseIndex];
+  handle.generation = slots_[handle.index].generation;
+  return handle;
+}
+
+template <typename T>
+void EntityManager<T>::clear() {
+  while (!entities_.empty()) {
+    remove(getHandle(entities_.size() - 1));
+  }
 }
 
 }  // namespace scripted
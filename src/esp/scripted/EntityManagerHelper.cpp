@@ -5,39 +5,267 @@
 #include "EntityManagerHelper.h"
 #include <esp/gfx/Debug3DText.h>
 #include <esp/gfx/DebugRender.h>
-#include "CookableEntity.h"
-#include "FluidVesselEntity.h"
 #include "EntityManager.hpp"
-#include "OvenEntity.h"
+#include "esp/core/Check.h"
+
+#include <algorithm>
 
 namespace esp {
 namespace scripted {
 
-void EntityManagerHelper::update(float dt) {
-  for (auto* ent : EntityManager<OvenEntity>::get().getVector()) {
-    ent->update(dt);
+namespace {
+bool systemsConflict(const EntitySystem& a, const EntitySystem& b) {
+  return (a.writes & (b.reads | b.writes)) || (b.writes & a.reads);
+}
+}  // namespace
+
+EntityManagerHelper::EntityManagerHelper() {
+  addSystems();
+  stages_ = buildStages(systems_);
+}
+
+EntityManagerHelper::~EntityManagerHelper() {
+  removeHeatTriggers();
+}
+
+void EntityManagerHelper::removeHeatTriggers() {
+  for (auto& oven : ovens_.getEntities()) {
+    oven.removeHeatTrigger();
   }
-  for (auto* ent : EntityManager<CookableEntity>::get().getVector()) {
-    ent->update(dt);
+}
+
+void EntityManagerHelper::addSystems() {
+  // Entities are addressed by index into the packed arrays below, which is
+  // fine since no system adds or removes entities mid-tick.
+  // ovens cast rays, so they go one at a time
+  const uint32_t ovensSystemIndex = static_cast<uint32_t>(systems_.size());
+  systems_.push_back(
+      {"ovens", EntityResource::ObjectTransforms,
+       EntityResource::OvenState | EntityResource::PhysicsQueries,
+       [this, ovensSystemIndex](float dt) {
+         auto& ovens = ovens_.getEntities();
+         for (std::size_t i = 0; i < ovens.size(); ++i) {
+           ovens[i].update(dt, commands_,
+                           EntityCommandBuffer::makeOrder(ovensSystemIndex,
+                                                          uint32_t(i)));
+         }
+       }});
+
+  const uint32_t cookablesSystemIndex = static_cast<uint32_t>(systems_.size());
+  systems_.push_back(
+      {"cookables",
+       EntityResource::ObjectTransforms | EntityResource::OvenState,
+       EntityResource::CookState, [this, cookablesSystemIndex](float dt) {
+         auto& cookables = cookables_.getEntities();
+         forEachEntity(cookables.size(), [&](std::size_t i) {
+           cookables[i].update(dt, ovens_, commands_,
+                               EntityCommandBuffer::makeOrder(
+                                   cookablesSystemIndex, uint32_t(i)));
+         });
+       }});
+
+  systems_.push_back({"fluidReceivers", EntityResource::ObjectTransforms,
+                      EntityResource::FluidReceivers, [this](float) {
+                        FluidVesselEntity::buildReceiverGrid(
+                            fluidVessels_, fluidReceiverScratch_,
+                            fluidReceiverGrid_);
+                      }});
+
+  systems_.push_back(
+      {"fluidPourTargets",
+       EntityResource::ObjectTransforms | EntityResource::FluidReceivers |
+           EntityResource::FluidVolumes,
+       EntityResource::FluidPourTargets, [this](float) {
+         auto& vessels = fluidVessels_.getEntities();
+         forEachEntity(vessels.size(), [&](std::size_t i) {
+           vessels[i].updatePourTarget(fluidVessels_, fluidReceiverGrid_);
+         });
+       }});
+
+  // pouring writes to the receiving vessel, so vessels go one at a time
+  systems_.push_back({"fluidPour", EntityResource::FluidPourTargets,
+                      EntityResource::FluidVolumes, [this](float dt) {
+                        for (auto& ent : fluidVessels_.getEntities()) {
+                          ent.applyPour(dt, fluidVessels_);
+                        }
+                      }});
+}
+
+std::vector<std::vector<std::size_t>> EntityManagerHelper::buildStages(
+    const std::vector<EntitySystem>& systems) {
+  std::vector<std::vector<std::size_t>> stages;
+  std::vector<std::size_t> stageOfSystem(systems.size());
+  for (std::size_t i = 0; i < systems.size(); ++i) {
+    std::size_t stage = 0;
+    for (std::size_t j = 0; j < i; ++j) {
+      if (systemsConflict(systems[i], systems[j])) {
+        stage = std::max(stage, stageOfSystem[j] + 1);
+      }
+    }
+    stageOfSystem[i] = stage;
+    if (stage == stages.size()) {
+      stages.emplace_back();
+    }
+    stages[stage].push_back(i);
   }
-  for (auto* ent : EntityManager<FluidVesselEntity>::get().getVector()) {
-    ent->update(dt);
+  return stages;
+}
+
+void EntityManagerHelper::forEachEntity(
+    std::size_t count,
+    const std::function<void(std::size_t)>& fn) {
+  if (!scheduler_) {
+    for (std::size_t i = 0; i < count; ++i) {
+      fn(i);
+    }
+    return;
+  }
+  scheduler_->parallelFor(count, [&fn](std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin; i < end; ++i) {
+      fn(i);
+    }
+  });
+}
+
+void EntityManagerHelper::onHeatVolumeEvent(
+    const esp::physics::TriggerEvent& event) {
+  const EntityHandle oven = findOvenByTrigger(event.triggerId);
+  const EntityHandle cookable = findCookableByObject(event.objectId);
+  if (!oven.isValid() || !cookable.isValid()) {
+    return;
   }
+  cookables_.get(cookable)->onHeatVolumeEvent(oven, event.entered);
+}
+
+EntityHandle EntityManagerHelper::findOvenByTrigger(int triggerId) {
+  auto it = ovenByTrigger_.find(triggerId);
+  const OvenEntity* oven =
+      it != ovenByTrigger_.end() ? ovens_.get(it->second) : nullptr;
+  if (oven && oven->getHeatTriggerId() == triggerId) {
+    return it->second;
+  }
+  if (eventLookupsRebuilt_) {
+    return {};
+  }
+  rebuildEventLookups();
+  return findOvenByTrigger(triggerId);
+}
+
+EntityHandle EntityManagerHelper::findCookableByObject(int objectId) {
+  auto it = cookableByObject_.find(objectId);
+  const CookableEntity* cookable =
+      it != cookableByObject_.end() ? cookables_.get(it->second) : nullptr;
+  if (cookable && cookable->getObjectId() == objectId) {
+    return it->second;
+  }
+  if (eventLookupsRebuilt_) {
+    return {};
+  }
+  rebuildEventLookups();
+  return findCookableByObject(objectId);
+}
+
+void EntityManagerHelper::rebuildEventLookups() {
+  ovenByTrigger_.clear();
+  const auto& ovens = ovens_.getEntities();
+  for (std::size_t i = 0; i < ovens.size(); ++i) {
+    ovenByTrigger_[ovens[i].getHeatTriggerId()] = ovens_.getHandle(i);
+  }
+  cookableByObject_.clear();
+  const auto& cookables = cookables_.getEntities();
+  for (std::size_t i = 0; i < cookables.size(); ++i) {
+    cookableByObject_[cookables[i].getObjectId()] = cookables_.getHandle(i);
+  }
+  eventLookupsRebuilt_ = true;
+}
+
+void EntityManagerHelper::update(float dt) {
+  for (const auto& stage : stages_) {
+    if (!scheduler_ || stage.size() == 1) {
+      for (std::size_t systemIndex : stage) {
+        systems_[systemIndex].run(dt);
+      }
+      continue;
+    }
+    core::TaskScheduler::TaskGroup group;
+    for (std::size_t systemIndex : stage) {
+      scheduler_->submit(
+          group, [this, systemIndex, dt]() { systems_[systemIndex].run(dt); });
+    }
+    scheduler_->wait(group);
+  }
+  commands_.apply();
+  // entities may be added or removed before the next physics step
+  eventLookupsRebuilt_ = false;
 }
 
 void EntityManagerHelper::debugRender(esp::gfx::Debug3DText& debug3dText,
                                       esp::gfx::DebugRender& debugRender) {
-  for (auto* ent : EntityManager<OvenEntity>::get().getVector()) {
-    ent->debugRender(debug3dText, debugRender);
+  for (auto& ent : ovens_.getEntities()) {
+    ent.debugRender(debug3dText, debugRender);
   }
-  for (auto* ent : EntityManager<CookableEntity>::get().getVector()) {
-    ent->debugRender(debug3dText, debugRender);
+  for (auto& ent : cookables_.getEntities()) {
+    ent.debugRender(debug3dText, debugRender);
+  }
+  for (auto& ent : fluidVessels_.getEntities()) {
+    ent.debugRender(debug3dText, debugRender);
+  }
+}
+
+void EntityManagerHelper::clear() {
+  removeHeatTriggers();
+  ovens_.clear();
+  cookables_.clear();
+  fluidVessels_.clear();
+  eventLookupsRebuilt_ = false;
+}
+
+void EntityManagerHelper::removeOven(EntityHandle oven) {
+  CORRADE_INTERNAL_ASSERT(ovens_.isAlive(oven));
+  ovens_.get(oven)->removeHeatTrigger();
+  ovens_.remove(oven);
+  eventLookupsRebuilt_ = false;
+}
+
+namespace {
+
+template <typename T>
+void writeEntitiesSnapshot(const EntityManager<T>& manager,
+                           core::SnapshotWriter& writer) {
+  writer.write(uint32_t(manager.size()));
+  for (const T& entity : manager.getEntities()) {
+    entity.writeSnapshot(writer);
   }
-  for (auto* ent : EntityManager<FluidVesselEntity>::get().getVector()) {
-    ent->debugRender(debug3dText, debugRender);
+}
+
+template <typename T>
+void readEntitiesSnapshot(EntityManager<T>& manager,
+                          const char* typeName,
+                          core::SnapshotReader& reader) {
+  const uint32_t count = reader.read<uint32_t>();
+  ESP_CHECK(count == manager.size(),
+            "EntityManagerHelper::readSnapshot(): snapshot has"
+                << count << typeName << "entities but the world has"
+                << manager.size());
+  for (T& entity : manager.getEntities()) {
+    entity.readSnapshot(reader);
   }
 }
 
+}  // namespace
+
+void EntityManagerHelper::writeSnapshot(core::SnapshotWriter& writer) const {
+  writeEntitiesSnapshot(ovens_, writer);
+  writeEntitiesSnapshot(cookables_, writer);
+  writeEntitiesSnapshot(fluidVessels_, writer);
+}
+
+void EntityManagerHelper::readSnapshot(core::SnapshotReader& reader) {
+  readEntitiesSnapshot(ovens_, "oven", reader);
+  readEntitiesSnapshot(cookables_, "cookable", reader);
+  readEntitiesSnapshot(fluidVessels_, "fluid vessel", reader);
+}
+
 // explicit instantiation
 template class EntityManager<OvenEntity>;
 template class EntityManager<CookableEntity>;
@@ -5,19 +5,184 @@
 #ifndef ESP_SCRIPTED_ENTITYMANAGERHELPER_H_
 #define ESP_SCRIPTED_ENTITYMANAGERHELPER_H_
 
+#include <Corrade/Containers/EnumSet.h>
 #include <esp/gfx/Debug3DText.h>
 #include <esp/gfx/DebugRender.h>
 
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "CookableEntity.h"
+#include "EntityCommandBuffer.h"
+#include "EntityManager.h"
+#include "FluidVesselEntity.h"
+#include "OvenEntity.h"
+#include "SpatialGrid.h"
+#include "esp/core/TaskScheduler.h"
+
 namespace esp {
 namespace scripted {
 
+/**
+ * @brief World state a scripted system may read or write during a tick. Used
+ * to decide which systems can run concurrently.
+ */
+enum class EntityResource : uint32_t {
+  /** Simulator object poses. */
+  ObjectTransforms = 1 << 0,
+  OvenState = 1 << 1,
+  CookState = 1 << 2,
+  FluidReceivers = 1 << 3,
+  FluidPourTargets = 1 << 4,
+  FluidVolumes = 1 << 5,
+  /**
+   * Physics queries like @ref esp::sim::Simulator::castRay. Bullet isn't
+   * built thread-safe and its ray casts share scratch state, so a system
+   * casting rays writes this and casts them one at a time.
+   */
+  PhysicsQueries = 1 << 6,
+};
+
+typedef Corrade::Containers::EnumSet<EntityResource> EntityResources;
+CORRADE_ENUMSET_OPERATORS(EntityResources)
+
+/**
+ * @brief One step of the scripted tick, with the resources it touches.
+ */
+struct EntitySystem {
+  std::string name;
+  EntityResources reads;
+  EntityResources writes;
+  std::function<void(float dt)> run;
+};
+
+/**
+ * @brief Owns the scripted entities of one scripted world (typically one per
+ * @ref esp::sim::Simulator) and drives their per-tick update.
+ *
+ * The tick is a list of @ref EntitySystem "systems" grouped into stages of
+ * systems with no conflicting resource accesses. With a task scheduler set,
+ * systems in a stage run concurrently and most systems spread their entities
+ * over the scheduler's threads, except those casting rays (see
+ * @ref EntityResource::PhysicsQueries); otherwise everything runs serially
+ * on the calling thread. Simulator mutations are recorded into an
+ * @ref EntityCommandBuffer and applied on the calling thread at the end of
+ * the tick.
+ */
 class EntityManagerHelper {
  public:
-  static void update(float dt);
-  static void debugRender(esp::gfx::Debug3DText& debug3dText,
-                          esp::gfx::DebugRender& debugRender);
+  EntityManagerHelper();
+
+  /**
+   * @brief Removes the heat trigger volumes of the ovens, whose callbacks
+   * refer to this object. The simulator must still exist.
+   */
+  ~EntityManagerHelper();
+
+  EntityManagerHelper(const EntityManagerHelper&) = delete;
+  EntityManagerHelper& operator=(const EntityManagerHelper&) = delete;
+
+  void update(float dt);
+  void debugRender(esp::gfx::Debug3DText& debug3dText,
+                   esp::gfx::DebugRender& debugRender);
+
+  /**
+   * @brief Destroy all entities and the heat trigger volumes of the ovens.
+   * Doesn't remove their simulator objects.
+   */
+  void clear();
+
+  /**
+   * @brief Destroy an oven and its heat trigger volume. Use this instead of
+   * removing it from @ref getOvens directly, which would leave the trigger
+   * volume reporting to this object.
+   */
+  void removeOven(EntityHandle oven);
+
+  /**
+   * @brief Save and restore the state of all entities, in packed-array order.
+   * Entities must not be added or removed between saving and restoring. See
+   * @ref esp::sim::Simulator::addSnapshotParticipant.
+   */
+  void writeSnapshot(core::SnapshotWriter& writer) const;
+  void readSnapshot(core::SnapshotReader& reader);
+
+  /**
+   * @brief Run systems and entities in parallel on @p scheduler, or serially
+   * if nullptr. The scheduler must outlive this object or be unset first.
+   */
+  void setTaskScheduler(core::TaskScheduler* scheduler) {
+    scheduler_ = scheduler;
+  }
+
+  core::TaskScheduler* getTaskScheduler() const { return scheduler_; }
+
+  const std::vector<EntitySystem>& getSystems() const { return systems_; }
+
+  /**
+   * @brief Indices into @ref getSystems of the systems in each stage.
+   */
+  const std::vector<std::vector<std::size_t>>& getStages() const {
+    return stages_;
+  }
+
+  /**
+   * @brief The callback to give an oven's heat trigger volume, which routes
+   * its enter/exit events to the cookables of this world. Events for objects
+   * that aren't cookables are ignored.
+   */
+  esp::physics::TriggerCallback getHeatVolumeCallback() {
+    return [this](const esp::physics::TriggerEvent& event) {
+      onHeatVolumeEvent(event);
+    };
+  }
+
+  EntityManager<OvenEntity>& getOvens() { return ovens_; }
+  EntityManager<CookableEntity>& getCookables() { return cookables_; }
+  EntityManager<FluidVesselEntity>& getFluidVessels() { return fluidVessels_; }
+
+  /**
+   * @brief Group systems into stages. A system goes into the stage after the
+   * last one holding a system it conflicts with, which preserves the
+   * declaration order between every pair of conflicting systems.
+   */
+  static std::vector<std::vector<std::size_t>> buildStages(
+      const std::vector<EntitySystem>& systems);
 
  private:
+  void addSystems();
+
+  void onHeatVolumeEvent(const esp::physics::TriggerEvent& event);
+  void removeHeatTriggers();
+
+  // Look up the entity owning a trigger or simulator object. The maps are
+  // caches which are rebuilt on a miss, at most once per tick.
+  EntityHandle findOvenByTrigger(int triggerId);
+  EntityHandle findCookableByObject(int objectId);
+  void rebuildEventLookups();
+
+  // run fn(i) for i in [0, count), in parallel if a scheduler is set
+  void forEachEntity(std::size_t count,
+                     const std::function<void(std::size_t)>& fn);
+
+  EntityManager<OvenEntity> ovens_;
+  EntityManager<CookableEntity> cookables_;
+  EntityManager<FluidVesselEntity> fluidVessels_;
+
+  // upright fluid receivers, rebuilt every tick
+  SpatialGrid fluidReceiverGrid_;
+  FluidVesselEntity::ReceiverGridScratch fluidReceiverScratch_;
+
+  std::unordered_map<int, EntityHandle> ovenByTrigger_;
+  std::unordered_map<int, EntityHandle> cookableByObject_;
+  bool eventLookupsRebuilt_ = false;
+
+  std::vector<EntitySystem> systems_;
+  std::vector<std::vector<std::size_t>> stages_;
+  EntityCommandBuffer commands_;
+  core::TaskScheduler* scheduler_ = nullptr;
 };
 
 }  // namespace scripted
@@ -0,0 +1,49 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "FluidTypeRegistry.h"
+#include "esp/core/Check.h"
+
+#include <Corrade/Utility/DebugStl.h>
+
+#include <algorithm>
+
+namespace esp {
+namespace scripted {
+
+FluidTypeId FluidTypeRegistry::getOrAddType(const std::string& name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = std::find(names_.begin(), names_.end(), name);
+  if (it != names_.end()) {
+    return FluidTypeId(it - names_.begin());
+  }
+  ESP_CHECK(names_.size() < MaxFluidTypes,
+            "FluidTypeRegistry::getOrAddType(): can't register fluid type"
+                << name << Corrade::Utility::Debug::nospace
+                << ", the limit of" << MaxFluidTypes << "types is reached");
+  names_.push_back(name);
+  return FluidTypeId(names_.size() - 1);
+}
+
+int FluidTypeRegistry::findType(const std::string& name) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = std::find(names_.begin(), names_.end(), name);
+  return it != names_.end() ? int(it - names_.begin()) : -1;
+}
+
+const std::string& FluidTypeRegistry::getTypeName(FluidTypeId id) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ESP_CHECK(id < names_.size(),
+            "FluidTypeRegistry::getTypeName(): unknown fluid type id"
+                << int(id));
+  return names_[id];
+}
+
+int FluidTypeRegistry::getNumTypes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return names_.size();
+}
+
+}  // namespace scripted
+}  // namespace esp
@@ -0,0 +1,70 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#ifndef ESP_SCRIPTED_FLUIDTYPEREGISTRY_H_
+#define ESP_SCRIPTED_FLUIDTYPEREGISTRY_H_
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace esp {
+namespace scripted {
+
+//! Small integer id of an interned fluid type. See @ref FluidTypeRegistry.
+typedef uint8_t FluidTypeId;
+
+//! Maximum number of distinct fluid types in a process.
+constexpr std::size_t MaxFluidTypes = 8;
+
+//! Volume of each fluid type in a vessel, in liters, indexed by FluidTypeId.
+typedef std::array<float, MaxFluidTypes> FluidVolumes;
+
+/**
+ * @brief Process-wide mapping from fluid type names to @ref FluidTypeId.
+ *
+ * Names are interned once, typically when building entities from blueprints,
+ * so per-tick fluid code works on ids and fixed-size @ref FluidVolumes
+ * arrays without hashing or allocating.
+ */
+class FluidTypeRegistry {
+ public:
+  static FluidTypeRegistry& get() {
+    static FluidTypeRegistry registry;
+    return registry;
+  }
+
+  /**
+   * @brief Get the id of @p name, registering it if it's new. Thread-safe.
+   * Fails if more than @ref MaxFluidTypes types are registered.
+   */
+  FluidTypeId getOrAddType(const std::string& name);
+
+  /**
+   * @brief Get the id of @p name, or -1 if it isn't registered. Thread-safe.
+   */
+  int findType(const std::string& name) const;
+
+  /**
+   * @brief Get the name of a registered fluid type. The reference stays valid
+   * for the lifetime of the process.
+   */
+  const std::string& getTypeName(FluidTypeId id) const;
+
+  int getNumTypes() const;
+
+ private:
+  FluidTypeRegistry() { names_.reserve(MaxFluidTypes); }
+
+  mutable std::mutex mutex_;
+  // never reallocates, so references to names stay valid
+  std::vector<std::string> names_;
+};
+
+}  // namespace scripted
+}  // namespace esp
+
+#endif
@@ -3,9 +3,11 @@
 // LICENSE file in the root directory of this source tree.
 
 #include "FluidVesselEntity.h"
-#include "EntityManager.h"
 #include "esp/core/Check.h"
 
+#include <Corrade/Containers/ArrayViewStl.h>
+
+#include <algorithm>
 #include <iomanip>
 #include <sstream>
 
@@ -16,9 +18,7 @@ FluidVesselEntity::FluidVesselEntity(esp::sim::Simulator* sim,
                                      const FluidVesselEntity::Blueprint& bp,
                                      const Magnum::Vector3& translation,
                                      const Magnum::Quaternion& rotation)
-    : sim_(sim), bp_(bp) {
-  EntityManager<FluidVesselEntity>::get().onConstruct(this);
-
+    : bp_(bp), sim_(sim) {
   // sloppy: fix up spoutDir
   bp_.spoutDir = bp_.spoutDir.normalized();
   ESP_CHECK(bp_.spoutConeAngle <= Mn::Deg(180),
@@ -31,18 +31,75 @@ FluidVesselEntity::FluidVesselEntity(esp::sim::Simulator* sim,
   // sim->setObjectMotionType(esp::physics::MotionType::STATIC, id);
 
   if (!bp_.initialFluidType.empty()) {
-    fluidVolumeByType_[bp_.initialFluidType] = bp_.volume;
+    fluidVolumes_[FluidTypeRegistry::get().getOrAddType(
+        bp_.initialFluidType)] = bp_.volume;
   }
 
   objId_ = id;
 }
 
-void FluidVesselEntity::update(float dt) {
+namespace {
+// receivers count as upright if their spout points this close to straight up
+constexpr float uprightThreshold = 0.9f;
+// make it easier to pour
+constexpr float receivePad = 0.1f;
+}  // namespace
+
+void FluidVesselEntity::buildReceiverGrid(
+    const EntityManager<FluidVesselEntity>& vessels,
+    ReceiverGridScratch& scratch,
+    SpatialGrid& receivers) {
+  const auto& entities = vessels.getEntities();
+
+  // size cells to the largest receive radius so a query touches at most a
+  // 3x3 block of cells
+  float maxReceiveRadius = 0.f;
+  for (const auto& vessel : entities) {
+    maxReceiveRadius = std::max(maxReceiveRadius, vessel.bp_.spoutRadius);
+  }
+  receivers.clear(maxReceiveRadius + receivePad);
+  if (entities.empty()) {
+    receivers.build();
+    return;
+  }
+
+  std::vector<uint32_t>& candidates = scratch.candidates;
+  std::vector<int>& objIds = scratch.objIds;
+  candidates.clear();
+  objIds.clear();
+  for (uint32_t i = 0; i < entities.size(); ++i) {
+    // volume 0 vessels can't receive anything
+    if (entities[i].bp_.volume != 0.f) {
+      candidates.push_back(i);
+      objIds.push_back(entities[i].objId_);
+    }
+  }
+
+  // all vessels of a scripted world live in the same simulator
+  scratch.transforms.resize(objIds.size());
+  entities.front().sim_->getTransformations(objIds, scratch.transforms);
+
+  for (std::size_t j = 0; j < candidates.size(); ++j) {
+    const auto& vessel = entities[candidates[j]];
+    const auto& transform = scratch.transforms[j];
+    Mn::Vector3 spoutDirWorld = transform.transformVector(vessel.bp_.spoutDir);
+    if (spoutDirWorld.y() < uprightThreshold) {
+      continue;
+    }
+    receivers.insert(transform.transformPoint(vessel.bp_.spoutPos),
+                     candidates[j]);
+  }
+  receivers.build();
+}
+
+void FluidVesselEntity::updatePourTarget(
+    const EntityManager<FluidVesselEntity>& vessels,
+    const SpatialGrid& receivers) {
   // by default, we aren't pouring anything
   recentPourTarget_ = Cr::Containers::NullOpt;
+  pourTargetIndex_ = -1;
 
-  std::string fluidType = "milk";
-  if (fluidVolumeByType_[fluidType] == 0.f) {
+  if (getTotalFluidVolume() == 0.f) {
     // nothing to pour
     return;
   }
@@ -57,55 +114,60 @@ void FluidVesselEntity::update(float dt) {
   static float fudge = 0.05f;
   Mn::Vector3 targetPourXY = spoutPosWorld + spoutDirWorld * fudge;
 
-  FluidVesselEntity* bestVessel = nullptr;
-  Mn::Vector3 bestSpoutPosWorld(Mn::Math::ZeroInit);
   float bestXyDist = -1.f;
 
-  for (auto* other : EntityManager<FluidVesselEntity>::get().getVector()) {
-    if (other == this) {
-      continue;
-    }
-
-    if (other->bp_.volume == 0.f) {
-      // can't receive anything
-      continue;
-    }
-
-    const auto otherTransform = sim_->getTransformation(other->objId_);
-    Mn::Vector3 otherSpoutDirWorld =
-        otherTransform.transformVector(other->bp_.spoutDir);
-    static float uprightThreshold = 0.9;
-    if (otherSpoutDirWorld.y() < uprightThreshold) {
-      continue;
-    }
-
-    Mn::Vector3 otherSpoutPosWorld =
-        otherTransform.transformPoint(other->bp_.spoutPos);
-
-    float xyDist =
-        (Mn::Vector3(targetPourXY.x(), 0.f, targetPourXY.z()) -
-         Mn::Vector3(otherSpoutPosWorld.x(), 0.f, otherSpoutPosWorld.z()))
-            .length();
-    static float pad = 0.1f;  // make it easier to pour
-    if (xyDist > other->bp_.spoutRadius + pad) {
-      continue;
-    }
-
-    if (!bestVessel || xyDist < bestXyDist) {
-      bestVessel = other;
-      bestSpoutPosWorld = otherSpoutPosWorld;
-      bestXyDist = xyDist;
-    }
-  }
+  const auto& entities = vessels.getEntities();
+  // cell size is the largest receive radius, so this covers every candidate
+  receivers.queryRadiusXZ(
+      targetPourXY, receivers.getCellSize(),
+      [&](const SpatialGrid::Entry& entry) {
+        const FluidVesselEntity* other = &entities[entry.value];
+        if (other == this) {
+          return;
+        }
+
+        const Mn::Vector3& otherSpoutPosWorld = entry.pos;
+        float xyDist =
+            (Mn::Vector3(targetPourXY.x(), 0.f, targetPourXY.z()) -
+             Mn::Vector3(otherSpoutPosWorld.x(), 0.f, otherSpoutPosWorld.z()))
+                .length();
+        if (xyDist > other->bp_.spoutRadius + receivePad) {
+          return;
+        }
+
+        if (pourTargetIndex_ == -1 || xyDist < bestXyDist) {
+          pourTargetIndex_ = static_cast<int>(entry.value);
+          pourTargetSpoutPosWorld_ = otherSpoutPosWorld;
+          bestXyDist = xyDist;
+        }
+      });
+}
 
-  if (bestVessel) {
-    pour(bestVessel, bestSpoutPosWorld, dt);
+void FluidVesselEntity::applyPour(float dt,
+                                  EntityManager<FluidVesselEntity>& vessels) {
+  if (pourTargetIndex_ != -1) {
+    pour(&vessels.getEntities()[pourTargetIndex_], pourTargetSpoutPosWorld_,
+         dt);
   } else {
     // todo
     // CORRADE_INTERNAL_ASSERT_UNREACHABLE();
   }
+}
+
+float FluidVesselEntity::getTotalFluidVolume() const {
+  float total = 0.f;
+  for (float volume : fluidVolumes_) {
+    total += volume;
+  }
+  return total;
+}
 
-  // tod
+void FluidVesselEntity::writeSnapshot(core::SnapshotWriter& writer) const {
+  writer.write(fluidVolumes_);
+}
+
+void FluidVesselEntity::readSnapshot(core::SnapshotReader& reader) {
+  fluidVolumes_ = reader.read<FluidVolumes>();
 }
 
 void FluidVesselEntity::pour(FluidVesselEntity* other,
@@ -114,35 +176,27 @@ void FluidVesselEntity::pour(FluidVesselEntity* other,
   static float pourRate = 0.03;  // liter/s
   float amountToPour = pourRate * dt;
 
-  std::string fluidType = "milk";
-
-  amountToPour = std::min(amountToPour, fluidVolumeByType_[fluidType]);
+  const float totalVolume = getTotalFluidVolume();
+  amountToPour = std::min(amountToPour, totalVolume);
 
-  float freeCapacity = other->bp_.volume - other->fluidVolumeByType_[fluidType];
+  float freeCapacity = other->bp_.volume - other->getTotalFluidVolume();
   amountToPour = std::min(amountToPour, freeCapacity);
 
   if (amountToPour > 0.f) {
-    other->receiveFluid(fluidType, amountToPour);
-
-    fluidVolumeByType_[fluidType] -= amountToPour;
+    // pour the mix as it is
+    const float fraction = amountToPour / totalVolume;
+    for (std::size_t i = 0; i < fluidVolumes_.size(); ++i) {
+      const float amount = fluidVolumes_[i] * fraction;
+      other->fluidVolumes_[i] += amount;
+      fluidVolumes_[i] -= amount;
+    }
 
     recentPourTarget_ = otherSpoutPosWorld;
   }
 }
 
-void FluidVesselEntity::receiveFluid(const std::string& fluidType,
-                                     float amount) {
-  float prevAmount = 0.f;
-  const auto it = fluidVolumeByType_.find(fluidType);
-  if (it != fluidVolumeByType_.end()) {
-    prevAmount = it->second;
-  }
-
-  fluidVolumeByType_[fluidType] = prevAmount + amount;
-}
-
-FluidVesselEntity::~FluidVesselEntity() {
-  EntityManager<FluidVesselEntity>::get().onDelete(this);
+void FluidVesselEntity::receiveFluid(FluidTypeId fluidType, float amount) {
+  fluidVolumes_[fluidType] += amount;
 }
 
 void FluidVesselEntity::debugRender(esp::gfx::Debug3DText& debug3dText,
@@ -169,12 +223,15 @@ void FluidVesselEntity::debugRender(esp::gfx::Debug3DText& debug3dText,
                           Mn::Color4(1, 1, 1), 16);
   }
 
-  std::string fluidType = "milk";
-  float amount = fluidVolumeByType_[fluidType];
-  if (amount > 0) {
-    std::stringstream ss;
-    ss << fluidType << "\n"
-       << std::fixed << std::setprecision(1) << (amount * 1000.f) << "ml";
+  std::stringstream ss;
+  for (std::size_t i = 0; i < fluidVolumes_.size(); ++i) {
+    const float amount = fluidVolumes_[i];
+    if (amount > 0) {
+      ss << FluidTypeRegistry::get().getTypeName(FluidTypeId(i)) << "\n"
+         << std::fixed << std::setprecision(1) << (amount * 1000.f) << "ml\n";
+    }
+  }
+  if (ss.tellp() > 0) {
     debug3dText.addText(ss.str(), pos);
   }
 }
@@ -11,6 +11,9 @@
 #include <Corrade/Containers/Optional.h>
 #include <esp/gfx/Debug3DText.h>
 #include <esp/gfx/DebugRender.h>
+#include "EntityManager.h"
+#include "FluidTypeRegistry.h"
+#include "SpatialGrid.h"
 #include "esp/sim/Simulator.h"
 
 namespace esp {
@@ -33,24 +36,74 @@ class FluidVesselEntity {
              const Magnum::Vector3& translation,
              const Magnum::Quaternion& rotation);
 
-  ~FluidVesselEntity();
+  /**
+   * @brief Buffers of @ref buildReceiverGrid, kept by the caller so their
+   * capacity carries over from tick to tick.
+   */
+  struct ReceiverGridScratch {
+    std::vector<uint32_t> candidates;
+    std::vector<int> objIds;
+    std::vector<Magnum::Matrix4> transforms;
+  };
+
+  /**
+   * @brief Rebuild @p receivers with the world-space spout positions of all
+   * upright vessels that can receive fluid. Call once per tick before any
+   * vessel's @ref updatePourTarget; entry values are indices into
+   * @p vessels.getEntities().
+   */
+  static void buildReceiverGrid(const EntityManager<FluidVesselEntity>& vessels,
+                                ReceiverGridScratch& scratch,
+                                SpatialGrid& receivers);
+
+  /**
+   * @brief Pick the receiver this vessel pours into this tick, if any. Only
+   * writes this vessel's state, so it's safe to call concurrently for
+   * different vessels.
+   */
+  void updatePourTarget(const EntityManager<FluidVesselEntity>& vessels,
+                        const SpatialGrid& receivers);
 
-  void update(float dt);
+  /**
+   * @brief Transfer fluid to the target chosen by @ref updatePourTarget. This
+   * writes to the receiving vessel, so vessels must be processed serially.
+   */
+  void applyPour(float dt, EntityManager<FluidVesselEntity>& vessels);
 
   void debugRender(esp::gfx::Debug3DText& debug3dText,
                    esp::gfx::DebugRender& debugRender);
 
 
+  /**
+   * @brief Pour into @p other for @p dt seconds. A mix of fluid types pours
+   * in proportion to each type's share of the volume.
+   */
   void pour(FluidVesselEntity* other, const Magnum::Vector3& otherSpoutPosWorld, float dt);
 
-  void receiveFluid(const std::string& fluidType, float amount);
+  void receiveFluid(FluidTypeId fluidType, float amount);
+
+  float getFluidVolume(FluidTypeId fluidType) const {
+    return fluidVolumes_[fluidType];
+  }
+
+  float getTotalFluidVolume() const;
+
+  /**
+   * @brief Save and restore the fluid volumes. Pour targets are recomputed
+   * every tick and aren't saved.
+   */
+  void writeSnapshot(core::SnapshotWriter& writer) const;
+  void readSnapshot(core::SnapshotReader& reader);
 
  private:
   Blueprint bp_;
   int objId_ = -1;
   esp::sim::Simulator* sim_ = nullptr;
-  std::unordered_map<std::string, float> fluidVolumeByType_; // rename to amount
+  FluidVolumes fluidVolumes_{};
   Corrade::Containers::Optional<Magnum::Vector3> recentPourTarget_;
+  // receiver index in the vessel manager's packed array, or -1
+  int pourTargetIndex_ = -1;
+  Magnum::Vector3 pourTargetSpoutPosWorld_;
 };
 
 }  // namespace scripted
@@ -0,0 +1,114 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "HeadlessScriptedWorld.h"
+
+#include "KitchenSetup.h"
+#include "esp/metadata/MetadataMediator.h"
+
+#include <chrono>
+
+namespace Mn = Magnum;
+
+namespace esp {
+namespace scripted {
+
+namespace {
+
+constexpr const char* SnapshotParticipantName = "scripted_entities";
+
+// Repeat @p instances until there are @p count of them. Copy k of an
+// instance is moved by k * copyOffset, so entities that were placed together
+// (e.g. cookies inside an oven) stay together in each copy.
+void resizeInstances(metadata::managers::SceneAttributesManager& sceneManager,
+                     int count,
+                     const Mn::Vector3& copyOffset,
+                     std::vector<KitchenSetup::InstancePtr>& instances) {
+  if (count < 0) {
+    return;
+  }
+  const std::vector<KitchenSetup::InstancePtr> originals = instances;
+  instances.clear();
+  if (originals.empty()) {
+    LOG_IF(WARNING, count > 0)
+        << "HeadlessScriptedWorld: no instances to repeat, ignoring count "
+        << count;
+    return;
+  }
+  for (int i = 0; i < count; ++i) {
+    const auto& original = originals[i % originals.size()];
+    const int copy = i / originals.size();
+    auto instance =
+        sceneManager.createEmptyInstanceAttributes(original->getHandle());
+    instance->setTranslation(original->getTranslation() +
+                             copyOffset * float(copy));
+    instance->setRotation(original->getRotation());
+    instance->setMotionType(original->getMotionType());
+    instances.push_back(std::move(instance));
+  }
+}
+
+}  // namespace
+
+HeadlessScriptedWorld::HeadlessScriptedWorld(const Config& config)
+    : config_(config) {
+  // Without a renderer, Simulator doesn't create a physics world, and asset
+  // instancing uploads meshes to the GPU. So a (windowless) GL context is
+  // still created, but nothing is ever drawn.
+  esp::sim::SimulatorConfiguration simConfig;
+  simConfig.activeSceneName = config_.activeSceneName;
+  simConfig.sceneDatasetConfigFile = config_.sceneDatasetConfigFile;
+  simConfig.physicsConfigFile = config_.physicsConfigFile;
+  simConfig.enablePhysics = true;
+  simConfig.requiresTextures = false;
+  simConfig.gpuDeviceId = config_.gpuDeviceId;
+  sim_ = esp::sim::Simulator::create_unique(simConfig);
+
+  if (config_.numWorkerThreads != 0) {
+    scheduler_ = core::TaskScheduler::create_unique(config_.numWorkerThreads);
+    entities_.setTaskScheduler(scheduler_.get());
+  }
+
+  KitchenSetup::SceneDescription desc = KitchenSetup::loadSceneDescription(
+      sim_.get(), config_.sceneDescriptionFilepath);
+  auto sceneManager =
+      sim_->getMetadataMediator()->getSceneAttributesManager();
+  resizeInstances(*sceneManager, config_.numOvens, config_.copyOffset,
+                  desc.ovens);
+  resizeInstances(*sceneManager, config_.numCookables, config_.copyOffset,
+                  desc.cookables);
+  resizeInstances(*sceneManager, config_.numFluidVessels, config_.copyOffset,
+                  desc.fluidVessels);
+  KitchenSetup kitchenSetup(sim_.get(), entities_, desc);
+
+  sim_->addSnapshotParticipant(
+      SnapshotParticipantName,
+      [this](core::SnapshotWriter& writer) { entities_.writeSnapshot(writer); },
+      [this](core::SnapshotReader& reader) { entities_.readSnapshot(reader); });
+}
+
+HeadlessScriptedWorld::~HeadlessScriptedWorld() {
+  sim_->removeSnapshotParticipant(SnapshotParticipantName);
+}
+
+void HeadlessScriptedWorld::step() {
+  sim_->stepWorld(config_.dt);
+  entities_.update(config_.dt);
+}
+
+HeadlessScriptedWorld::RunStats HeadlessScriptedWorld::run(int numSteps) {
+  RunStats stats;
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < numSteps; ++i) {
+    step();
+  }
+  stats.numSteps = numSteps;
+  stats.seconds = std::chrono::duration<double>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+  return stats;
+}
+
+}  // namespace scripted
+}  // namespace esp
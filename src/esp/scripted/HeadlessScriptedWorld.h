@@ -0,0 +1,98 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#ifndef ESP_SCRIPTED_HEADLESSSCRIPTEDWORLD_H_
+#define ESP_SCRIPTED_HEADLESSSCRIPTEDWORLD_H_
+
+#include <string>
+
+#include "EntityManagerHelper.h"
+#include "esp/core/TaskScheduler.h"
+#include "esp/core/esp.h"
+#include "esp/sim/Simulator.h"
+
+namespace esp {
+namespace scripted {
+
+/**
+ * @brief Steps physics and scripted entities at a fixed timestep, as fast as
+ * possible and without drawing anything.
+ *
+ * The world is populated from a scripted scene description (see
+ * @ref KitchenSetup), with the oven, cookable and fluid vessel instances
+ * repeated to reach the configured counts. Used to measure scripted
+ * simulation throughput independent of rendering.
+ */
+class HeadlessScriptedWorld {
+ public:
+  struct Config {
+    std::string sceneDescriptionFilepath = "data/kitchen.scripted_scene.json";
+    //! Stage or scene to load; "NONE" for an empty stage.
+    std::string activeSceneName = "NONE";
+    std::string sceneDatasetConfigFile = "default";
+    std::string physicsConfigFile = ESP_DEFAULT_PHYSICS_CONFIG_REL_PATH;
+    //! Entity counts; a negative value keeps the count of the description.
+    int numOvens = -1;
+    int numCookables = -1;
+    int numFluidVessels = -1;
+    //! Offset between repeated copies of the described entities.
+    Magnum::Vector3 copyOffset{0.0f, 0.0f, 4.0f};
+    //! Fixed timestep of @ref step, in seconds.
+    float dt = 1.0f / 60.0f;
+    /**
+     * @brief Worker threads for entity systems: 0 updates entities serially,
+     * a negative value uses one less than the hardware concurrency.
+     */
+    int numWorkerThreads = 0;
+    int gpuDeviceId = 0;
+  };
+
+  struct RunStats {
+    int numSteps = 0;
+    double seconds = 0.0;
+
+    double getStepsPerSecond() const {
+      return seconds > 0.0 ? numSteps / seconds : 0.0;
+    }
+  };
+
+  /**
+   * @brief Constructor. The entities are registered as a snapshot participant
+   * of the simulator, so @ref esp::sim::Simulator::saveSnapshot captures the
+   * whole world.
+   */
+  explicit HeadlessScriptedWorld(const Config& config);
+
+  ~HeadlessScriptedWorld();
+
+  /**
+   * @brief Advance physics, then scripted entities, by one fixed timestep.
+   */
+  void step();
+
+  /**
+   * @brief Run @p numSteps steps and measure the wall-clock time they take.
+   */
+  RunStats run(int numSteps);
+
+  const Config& getConfig() const { return config_; }
+
+  esp::sim::Simulator& getSimulator() { return *sim_; }
+
+  EntityManagerHelper& getEntities() { return entities_; }
+
+ private:
+  Config config_;
+  // members are destroyed bottom-up: entities, then scheduler, then simulator
+  esp::sim::Simulator::uptr sim_;
+  core::TaskScheduler::uptr scheduler_;
+  EntityManagerHelper entities_;
+
+  ESP_SMART_POINTERS(HeadlessScriptedWorld)
+};
+
+}  // namespace scripted
+}  // namespace esp
+
+#endif  // ESP_SCRIPTED_HEADLESSSCRIPTEDWORLD_H_
@@ -4,9 +4,16 @@
 
 #include "KitchenSetup.h"
 
-#include "CookableEntity.h"
-#include "FluidVesselEntity.h"
-#include "OvenEntity.h"
+#include "EntityManagerHelper.h"
+#include "esp/core/Check.h"
+#include "esp/io/URDFParser.h"
+#include "esp/io/json.h"
+#include "esp/metadata/MetadataMediator.h"
+
+#include <Corrade/Utility/DebugStl.h>
+#include <Corrade/Utility/Directory.h>
+
+#include <algorithm>
 
 namespace Cr = Corrade;
 namespace Mn = Magnum;
@@ -16,131 +23,273 @@ namespace scripted {
 
 namespace {
 
-void loadStaticObjects(esp::sim::Simulator* sim) {
-  int id;
-
-  // I0430 19:08:51.906787 2074313 viewer.cpp:181] trans:
-  // {0.725298,-1.43959,-0.0876577} I0430 19:08:51.906834 2074313
-  // viewer.cpp:182] rot: {{0.000733241,0.0650282,-0.0104461},0.997829}
-
-  id = sim->addObjectByHandle("data/objects/ktc_cabinets1.object_config.json");
-  CORRADE_INTERNAL_ASSERT(id != -1);
-  sim->setTranslation(Mn::Vector3(0.725298, -1.43959, -0.0876577), id);
-  sim->setRotation(
-      Mn::Quaternion({0.000733241, 0.0650282, -0.0104461}, 0.997829), id);
-  sim->setObjectMotionType(esp::physics::MotionType::STATIC, id);
-
-  id = sim->addObjectByHandle(
-      "data/objects/ktc_cabinets2_open.object_config.json");
-  CORRADE_INTERNAL_ASSERT(id != -1);
-  sim->setTranslation(Mn::Vector3(-1.35265291, -1.435616, -0.272905648), id);
-  sim->setRotation(
-      Mn::Quaternion({-0.00328475982, -0.65820694, 0.00287134061}, 0.7528244),
-      id);
-  sim->setObjectMotionType(esp::physics::MotionType::STATIC, id);
-
-  id = sim->addObjectByHandle("data/objects/ktc_cabinets3.object_config.json");
-  CORRADE_INTERNAL_ASSERT(id != -1);
-  sim->setTranslation(Mn::Vector3(-0.06714147, -1.46629739, -2.338812), id);
-  sim->setRotation(
-      Mn::Quaternion({-0.007838256, -0.998030961, -0.0004889179}, 0.0622297749),
-      id);
-  sim->setObjectMotionType(esp::physics::MotionType::STATIC, id);
-
-  // I0430 19:09:25.283691 2074313 viewer.cpp:181] trans:
-  // {3.43251,-1.48142,-0.563389} I0430 19:09:25.283751 2074313 viewer.cpp:182]
-  // rot: {{-2.6077e-08,0.74753,2.98023e-08},0.664229}
-  id =
-      sim->addObjectByHandle("data/objects/ktc_fridge_open.object_config.json");
-  CORRADE_INTERNAL_ASSERT(id != -1);
-  sim->setTranslation(Mn::Vector3(3.43251, -1.48142, -0.563389), id);
-  sim->setRotation(Mn::Quaternion({0.0, 0.74753, 2.98023e-08}, 0.664229), id);
-  sim->setObjectMotionType(esp::physics::MotionType::STATIC, id);
-
-  id = sim->addObjectByHandle("data/objects/ktc_hood.object_config.json");
-  CORRADE_INTERNAL_ASSERT(id != -1);
-  sim->setTranslation(Mn::Vector3(-1.419739, 0.258229047, -1.16238475), id);
-  sim->setRotation(Mn::Quaternion({0.0, -0.654761255, 0.0}, 0.7558358), id);
-  sim->setObjectMotionType(esp::physics::MotionType::STATIC, id);
+constexpr const char* DefaultKitchenSceneFilepath =
+    "data/kitchen.scripted_scene.json";
+
+template <typename T>
+void readRequiredMember(const io::JsonGenericValue& obj,
+                        const char* tag,
+                        const std::string& blueprintName,
+                        T& x) {
+  ESP_CHECK(io::readMember(obj, tag, x),
+            "KitchenSetup: blueprint" << blueprintName
+                                      << "is missing a valid" << tag);
+}
+
+OvenEntity::Blueprint ovenBlueprintFromJson(const io::JsonGenericValue& obj,
+                                            const std::string& name) {
+  OvenEntity::Blueprint bp;
+  Mn::Vector3 heatVolumeMin;
+  Mn::Vector3 heatVolumeMax;
+  readRequiredMember(obj, "urdf_filepath", name, bp.urdfFilepath);
+  readRequiredMember(obj, "heat_volume_min", name, heatVolumeMin);
+  readRequiredMember(obj, "heat_volume_max", name, heatVolumeMax);
+  bp.heatVolume = Mn::Range3D(heatVolumeMin, heatVolumeMax);
+  readRequiredMember(obj, "open_sensor_position", name, bp.openSensorPos);
+  readRequiredMember(obj, "open_sensor_direction", name, bp.openSensorDir);
+  io::readMember(obj, "room_temp", bp.roomTemp);
+  io::readMember(obj, "target_temp", bp.targetTemp);
+  io::readMember(obj, "closed_temp_per_sec", bp.closedTempPerSec);
+  io::readMember(obj, "open_temp_per_sec", bp.openTempPerSec);
+  return bp;
+}
+
+CookableEntity::Blueprint cookableBlueprintFromJson(
+    const io::JsonGenericValue& obj,
+    CORRADE_UNUSED const std::string& name) {
+  CookableEntity::Blueprint bp;
+  io::readMember(obj, "object_handle", bp.objHandle);
+  io::readMember(obj, "cooked_object_handle", bp.cookedObjHandle);
+  io::readMember(obj, "target_cook_time", bp.targetCookTime);
+  return bp;
+}
+
+FluidVesselEntity::Blueprint fluidVesselBlueprintFromJson(
+    const io::JsonGenericValue& obj,
+    const std::string& name) {
+  FluidVesselEntity::Blueprint bp;
+  readRequiredMember(obj, "object_handle", name, bp.objHandle);
+  readRequiredMember(obj, "spout_position", name, bp.spoutPos);
+  readRequiredMember(obj, "spout_direction", name, bp.spoutDir);
+  float spoutConeAngleDeg = float(Mn::Deg(bp.spoutConeAngle));
+  io::readMember(obj, "spout_cone_angle", spoutConeAngleDeg);
+  bp.spoutConeAngle = Mn::Deg(spoutConeAngleDeg);
+  readRequiredMember(obj, "spout_radius", name, bp.spoutRadius);
+  readRequiredMember(obj, "volume", name, bp.volume);
+  io::readMember(obj, "initial_fluid_type", bp.initialFluidType);
+  return bp;
+}
+
+template <typename Blueprint, typename FromJson>
+void readBlueprints(const io::JsonGenericValue& doc,
+                    const char* tag,
+                    FromJson fromJson,
+                    std::map<std::string, Blueprint>& blueprints) {
+  if (!doc.HasMember(tag)) {
+    return;
+  }
+  const auto& obj = doc[tag];
+  ESP_CHECK(obj.IsObject(), "KitchenSetup:" << tag << "must be an object");
+  for (auto it = obj.MemberBegin(); it != obj.MemberEnd(); ++it) {
+    const std::string name = it->name.GetString();
+    ESP_CHECK(it->value.IsObject(),
+              "KitchenSetup: blueprint" << name << "must be an object");
+    blueprints[name] = fromJson(it->value, name);
+  }
+}
+
+void readInstances(const io::JsonGenericValue& doc,
+                   const char* tag,
+                   metadata::managers::SceneAttributesManager& sceneManager,
+                   std::vector<KitchenSetup::InstancePtr>& instances) {
+  if (!doc.HasMember(tag)) {
+    return;
+  }
+  const auto& arr = doc[tag];
+  ESP_CHECK(arr.IsArray(), "KitchenSetup:" << tag << "must be an array");
+  for (rapidjson::SizeType i = 0; i < arr.Size(); ++i) {
+    auto instance = sceneManager.createInstanceAttributesFromJSON(arr[i]);
+    ESP_CHECK(!instance->getHandle().empty(),
+              "KitchenSetup: instance" << i << "of" << tag
+                                        << "has no template_name");
+    instances.push_back(std::move(instance));
+  }
+}
+
+template <typename Blueprint>
+void checkBlueprintsExist(
+    const std::map<std::string, Blueprint>& blueprints,
+    const std::vector<KitchenSetup::InstancePtr>& instances) {
+  for (const auto& instance : instances) {
+    ESP_CHECK(blueprints.count(instance->getHandle()),
+              "KitchenSetup: instance of unknown blueprint"
+                  << instance->getHandle());
+  }
+}
+
+template <typename Blueprint>
+const Blueprint& getBlueprint(
+    const std::map<std::string, Blueprint>& blueprints,
+    const KitchenSetup::InstancePtr& instance) {
+  return blueprints.at(instance->getHandle());
+}
+
+void addObjectAssetFilepaths(esp::sim::Simulator* sim,
+                             const std::string& handle,
+                             std::vector<std::string>& filepaths) {
+  auto objAttrMgr = sim->getObjectAttributesManager();
+  if (!objAttrMgr->getObjectLibHasHandle(handle)) {
+    objAttrMgr->createObject(handle, true);
+  }
+  auto attributes = objAttrMgr->getObjectCopyByHandle(handle);
+  if (!attributes) {
+    LOG(WARNING) << "KitchenSetup: can't prefetch assets of unknown object "
+                 << handle;
+    return;
+  }
+  filepaths.push_back(attributes->getRenderAssetHandle());
+  filepaths.push_back(attributes->getCollisionAssetHandle());
+}
+
+void addUrdfAssetFilepaths(const std::string& urdfFilepath,
+                           std::vector<std::string>& filepaths) {
+  io::URDF::Parser parser;
+  if (!parser.parseURDF(urdfFilepath)) {
+    return;
+  }
+  for (const auto& link : parser.getModel()->m_links) {
+    for (const auto& visual : link.second->m_visualArray) {
+      if (visual.m_geometry.m_type == io::URDF::GEOM_MESH) {
+        filepaths.push_back(visual.m_geometry.m_meshFileName);
+      }
+    }
+    for (const auto& collision : link.second->m_collisionArray) {
+      if (collision.m_geometry.m_type == io::URDF::GEOM_MESH) {
+        filepaths.push_back(collision.m_geometry.m_meshFileName);
+      }
+    }
+  }
 }
 
 }  // namespace
 
-KitchenSetup::KitchenSetup(esp::sim::Simulator* sim) {
-  // perhaps configure SimConfig with stage as desired?
-
-  auto identRot = Mn::Quaternion(Magnum::Math::IdentityInit);
-
-  {
-    constexpr Mn::Vector3 insetPad(0.01, 0.01, 0.01);
-    OvenEntity::Blueprint ovenBp{
-        .urdfFilepath = "data/URDF/kitchen_oven/kitchen_oven.urdf",
-        .heatVolume = Mn::Range3D(Mn::Vector3{-0.315, 0.28, -0.58} + insetPad,
-                                  Mn::Vector3{0.315, 0.71, -0.10} - insetPad),
-        .openSensorPos = {-0.30f, 0.69, -0.61},
-        .openSensorDir = {0.f, 0.f, -1.f},
-        .roomTemp = 75.f,
-        .targetTemp = 350.f,
-        .closedTempPerSec = 20.f,
-        .openTempPerSec = -5.f};
-    new OvenEntity(sim, ovenBp, {-1.39339, -1.37402, -1.08876},
-                   {{-1.63913e-07, -0.662357, -6.79866e-08}, 0.749188});
-  }
-
-  CookableEntity::Blueprint cookieBp{.targetCookTime = 10.f};
-  new CookableEntity(sim, cookieBp, {-0.98, -0.46, -0.23}, identRot);
-  new CookableEntity(sim, cookieBp, {-0.99, -0.46, -0.44}, identRot);
-  new CookableEntity(sim, cookieBp, {-0.86, -0.46, -0.23}, identRot);
-  new CookableEntity(sim, cookieBp, {-0.87, -0.46, -0.44}, identRot);
-
-  FluidVesselEntity::Blueprint milkCartonBp{
-      .objHandle = "data/objects/milk_carton.object_config.json",
-      .spoutPos = Mn::Vector3(-0.05, 0.28, 0.0) * 0.5,
-      .spoutDir = Mn::Vector3(-1.0, 1.0, 0.0),
-      .spoutConeAngle = Mn::Deg(45),
-      .spoutRadius = 0.02,
-      .volume = 0.5,
-      .initialFluidType = "milk"};
-  // I0501 11:25:17.516863 2188294 viewer.cpp:199] trans:
-  // {1.66911,-0.893705,0.343503} I0501 11:25:17.516891 2188294 viewer.cpp:200]
-  // rot: {{2.42591e-05,0.204182,6.09457e-06},0.978933}
-  new FluidVesselEntity(sim, milkCartonBp, {1.66911, -0.893705, 0.343503},
-                        {{2.42591e-05, 0.204182, 6.09457e-06}, 0.978933});
-
-  FluidVesselEntity::Blueprint cupBp{
-      .objHandle = "data/objects/frl_apartment_cup_02.object_config.json",
-      .spoutPos = Mn::Vector3(0.0, 0.07, 0.0),
-      .spoutDir = Mn::Vector3(0.0, 1.0, 0.0),
-      .spoutConeAngle = Mn::Deg(90),
-      .spoutRadius = 0.06,
-      .volume = 0.1,
-      .initialFluidType = ""};
-  new FluidVesselEntity(sim, cupBp, {-1.13638, 0.0986672, -0.0401146},
-                        {{-0.00422984, 0.460589, -0.00228002}, 0.887601});
-  new FluidVesselEntity(sim, cupBp, {-1.18466, 0.122834, -0.213545},
-                        {{-0.00159926, -0.263621, -0.00384322}, 0.964617});
-  new FluidVesselEntity(sim, cupBp, {-1.19154, 0.0934808, -0.406106},
-                        {{-0.0037857, 0.404066, -0.00216265}, 0.914719});
-  new FluidVesselEntity(sim, cupBp, {-1.19012, 0.100953, -0.607053},
-                        {{-0.00413282, -0.049436, -0.00137842}, 0.998768});
-
-  // I0501 11:27:08.155495 2188294 viewer.cpp:199] trans:
-  // {-0.919036,-0.47911,-0.333129} I0501 11:27:08.155521 2188294
-  // viewer.cpp:200] rot: {{-0.00436143,0.0346233,-0.000107795},0.999391}
-  int id;
-  id = sim->addObjectByHandle(
-      "data/objects/ktc_clutter_tray.object_config.json");
-  CORRADE_INTERNAL_ASSERT(id != -1);
-  sim->setTranslation({-0.919036, -0.47911, -0.333129}, id);
-  sim->setRotation({{-0.00436143, 0.0346233, -0.000107795}, 0.999391}, id);
-
-  id = sim->addObjectByHandle(
-      "data/objects/ktc_clutter_potmatt.object_config.json");
-  CORRADE_INTERNAL_ASSERT(id != -1);
-  sim->setTranslation({-0.127363, -0.431755, 1.4129}, id);
-  sim->setRotation({{-0.00295681, 0.751272, 0.00389342}, 0.659974}, id);
-
-  loadStaticObjects(sim);
+KitchenSetup::KitchenSetup(esp::sim::Simulator* sim,
+                           EntityManagerHelper& entities)
+    : KitchenSetup(sim, entities, DefaultKitchenSceneFilepath) {}
+
+KitchenSetup::KitchenSetup(esp::sim::Simulator* sim,
+                           EntityManagerHelper& entities,
+                           const std::string& sceneFilepath)
+    : KitchenSetup(sim, entities, loadSceneDescription(sim, sceneFilepath)) {}
+
+KitchenSetup::KitchenSetup(esp::sim::Simulator* sim,
+                           EntityManagerHelper& entities,
+                           const SceneDescription& desc) {
+  prefetchFiles(sim, getAssetFilepaths(sim, desc));
+
+  for (const auto& instance : desc.ovens) {
+    entities.getOvens().add(
+        OvenEntity(sim, getBlueprint(desc.ovenBlueprints, instance),
+                   instance->getTranslation(), instance->getRotation(),
+                   entities.getHeatVolumeCallback()));
+  }
+
+  for (const auto& instance : desc.cookables) {
+    entities.getCookables().add(
+        CookableEntity(sim, getBlueprint(desc.cookableBlueprints, instance),
+                       instance->getTranslation(), instance->getRotation()));
+  }
+
+  for (const auto& instance : desc.fluidVessels) {
+    entities.getFluidVessels().add(FluidVesselEntity(
+        sim, getBlueprint(desc.fluidVesselBlueprints, instance),
+        instance->getTranslation(), instance->getRotation()));
+  }
+
+  for (const auto& instance : desc.objects) {
+    int id = sim->addObjectByHandle(instance->getHandle());
+    ESP_CHECK(id != ID_UNDEFINED,
+              "KitchenSetup: can't add object" << instance->getHandle());
+    sim->setTranslation(instance->getTranslation(), id);
+    sim->setRotation(instance->getRotation(), id);
+    const auto motionType =
+        static_cast<esp::physics::MotionType>(instance->getMotionType());
+    if (motionType != esp::physics::MotionType::UNDEFINED) {
+      sim->setObjectMotionType(motionType, id);
+    }
+  }
+}
+
+KitchenSetup::SceneDescription KitchenSetup::loadSceneDescription(
+    esp::sim::Simulator* sim,
+    const std::string& filepath) {
+  ESP_CHECK(Cr::Utility::Directory::exists(filepath),
+            "KitchenSetup: scene description" << filepath << "not found");
+  const io::JsonDocument doc = io::parseJsonFile(filepath);
+  ESP_CHECK(doc.IsObject(), "KitchenSetup: scene description"
+                                << filepath << "must be a JSON object");
+
+  SceneDescription desc;
+  readBlueprints(doc, "oven_blueprints", ovenBlueprintFromJson,
+                 desc.ovenBlueprints);
+  readBlueprints(doc, "cookable_blueprints", cookableBlueprintFromJson,
+                 desc.cookableBlueprints);
+  readBlueprints(doc, "fluid_vessel_blueprints", fluidVesselBlueprintFromJson,
+                 desc.fluidVesselBlueprints);
+
+  auto sceneManager = sim->getMetadataMediator()->getSceneAttributesManager();
+  readInstances(doc, "oven_instances", *sceneManager, desc.ovens);
+  readInstances(doc, "cookable_instances", *sceneManager, desc.cookables);
+  readInstances(doc, "fluid_vessel_instances", *sceneManager,
+                desc.fluidVessels);
+  readInstances(doc, "object_instances", *sceneManager, desc.objects);
+  checkBlueprintsExist(desc.ovenBlueprints, desc.ovens);
+  checkBlueprintsExist(desc.cookableBlueprints, desc.cookables);
+  checkBlueprintsExist(desc.fluidVesselBlueprints, desc.fluidVessels);
+  return desc;
+}
+
+std::vector<std::string> KitchenSetup::getAssetFilepaths(
+    esp::sim::Simulator* sim,
+    const SceneDescription& desc) {
+  std::vector<std::string> filepaths;
+  for (const auto& instance : desc.ovens) {
+    addUrdfAssetFilepaths(
+        getBlueprint(desc.ovenBlueprints, instance).urdfFilepath, filepaths);
+  }
+  for (const auto& instance : desc.cookables) {
+    const auto& bp = getBlueprint(desc.cookableBlueprints, instance);
+    addObjectAssetFilepaths(sim, bp.objHandle, filepaths);
+    addObjectAssetFilepaths(sim, bp.cookedObjHandle, filepaths);
+  }
+  for (const auto& instance : desc.fluidVessels) {
+    addObjectAssetFilepaths(
+        sim, getBlueprint(desc.fluidVesselBlueprints, instance).objHandle,
+        filepaths);
+  }
+  for (const auto& instance : desc.objects) {
+    addObjectAssetFilepaths(sim, instance->getHandle(), filepaths);
+  }
+
+  std::sort(filepaths.begin(), filepaths.end());
+  filepaths.erase(std::unique(filepaths.begin(), filepaths.end()),
+                  filepaths.end());
+  filepaths.erase(std::remove(filepaths.begin(), filepaths.end(), ""),
+                  filepaths.end());
+  return filepaths;
+}
+
+void KitchenSetup::prefetchFiles(esp::sim::Simulator* sim,
+                                 const std::vector<std::string>& filepaths) {
+  // The simulator's resource manager reads the files on its own workers and
+  // hands the contents to the importer when the objects are added;
+  // importing and GPU upload stay on the thread that owns the GL context.
+  for (const std::string& filepath : filepaths) {
+    if (Cr::Utility::Directory::exists(filepath) &&
+        !Cr::Utility::Directory::isDirectory(filepath)) {
+      sim->prefetchRenderAssetFile(assets::AssetInfo::fromPath(filepath));
+    }
+  }
 }
 
 }  // namespace scripted
@@ -5,14 +5,94 @@
 #ifndef ESP_SCRIPTED_KITCHENSETUP_H_
 #define ESP_SCRIPTED_KITCHENSETUP_H_
 
+#include <map>
+#include <string>
+#include <vector>
+
+#include "CookableEntity.h"
+#include "FluidVesselEntity.h"
+#include "OvenEntity.h"
+#include "esp/metadata/attributes/SceneAttributes.h"
 #include "esp/sim/Simulator.h"
 
 namespace esp {
 namespace scripted {
 
+class EntityManagerHelper;
+
+/**
+ * @brief Populates a kitchen episode from a JSON scripted scene description,
+ * e.g. data/kitchen.scripted_scene.json.
+ *
+ * The description holds named entity blueprints plus lists of oven,
+ * cookable, fluid vessel and plain object instances. Instances use the same
+ * keys as scene instance files ("template_name", "translation", "rotation",
+ * "motion_type"); for entities, "template_name" names a blueprint.
+ *
+ * Before anything is instanced, the unique render, collision and URDF asset
+ * files are read on worker threads, so the serial instancing that follows
+ * isn't bound on file I/O.
+ */
 class KitchenSetup {
  public:
-  KitchenSetup(esp::sim::Simulator* sim);
+  typedef metadata::attributes::SceneObjectInstanceAttributes::ptr
+      InstancePtr;
+
+  struct SceneDescription {
+    std::map<std::string, OvenEntity::Blueprint> ovenBlueprints;
+    std::map<std::string, CookableEntity::Blueprint> cookableBlueprints;
+    std::map<std::string, FluidVesselEntity::Blueprint> fluidVesselBlueprints;
+    std::vector<InstancePtr> ovens;
+    std::vector<InstancePtr> cookables;
+    std::vector<InstancePtr> fluidVessels;
+    std::vector<InstancePtr> objects;
+  };
+
+  //! Load the default kitchen, data/kitchen.scripted_scene.json.
+  KitchenSetup(esp::sim::Simulator* sim, EntityManagerHelper& entities);
+
+  /**
+   * @brief Load the scripted scene description at @p sceneFilepath, prefetch
+   * its assets and add its entities and objects.
+   */
+  KitchenSetup(esp::sim::Simulator* sim,
+               EntityManagerHelper& entities,
+               const std::string& sceneFilepath);
+
+  /**
+   * @brief Prefetch the assets of @p desc and add its entities and objects,
+   * e.g. after editing a loaded description.
+   */
+  KitchenSetup(esp::sim::Simulator* sim,
+               EntityManagerHelper& entities,
+               const SceneDescription& desc);
+
+  /**
+   * @brief Parse a scripted scene description. Instances are parsed through
+   * the scene attributes manager of @p sim. Fails on malformed blueprints or
+   * instances of unknown blueprints.
+   */
+  static SceneDescription loadSceneDescription(esp::sim::Simulator* sim,
+                                               const std::string& filepath);
+
+  /**
+   * @brief Get the unique asset files that instancing @p desc will load:
+   * render and collision assets of all objects plus the meshes of URDF
+   * files. Object configs that aren't registered yet are loaded into the
+   * object attributes manager of @p sim.
+   */
+  static std::vector<std::string> getAssetFilepaths(
+      esp::sim::Simulator* sim,
+      const SceneDescription& desc);
+
+  /**
+   * @brief Start reading @p filepaths on the asset prefetch workers of
+   * @p sim, so that loading them doesn't wait on the disk. See
+   * @ref esp::sim::Simulator::prefetchRenderAssetFile. Missing files and
+   * non-file asset handles (e.g. primitives) are skipped.
+   */
+  static void prefetchFiles(esp::sim::Simulator* sim,
+                            const std::vector<std::string>& filepaths);
 };
 
 }  // namespace scripted
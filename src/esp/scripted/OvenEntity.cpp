@@ -3,7 +3,6 @@
 // LICENSE file in the root directory of this source tree.
 
 #include "OvenEntity.h"
-#include "EntityManager.h"
 
 #include <iomanip>
 #include <sstream>
@@ -16,10 +15,9 @@ constexpr float openSensorRaycastLen = 0.03;
 OvenEntity::OvenEntity(esp::sim::Simulator* sim,
                        const OvenEntity::Blueprint& bp,
                        const Magnum::Vector3& translation,
-                       const Magnum::Quaternion& rotation)
+                       const Magnum::Quaternion& rotation,
+                       esp::physics::TriggerCallback onHeatVolumeEvent)
     : bp_(bp), sim_(sim) {
-  EntityManager<OvenEntity>::get().onConstruct(this);
-
   // hack normalize dir
   bp_.openSensorDir = bp_.openSensorDir.normalized();
 
@@ -40,18 +38,24 @@ OvenEntity::OvenEntity(esp::sim::Simulator* sim,
 
   objId_ = id;
   temp_ = bp_.roomTemp;
-}
 
-bool OvenEntity::isInsideCookVolume(const Magnum::Vector3& pos) {
-  // const auto transform = sim_->getTransformation(objId_);
-  const auto transform = sim_->getArticulatedObjectRootState(objId_);
-  // perf todo: cache inverted transform
-  const auto posLocal = transform.invertedRigid().transformPoint(pos);
-  return bp_.heatVolume.contains(posLocal);
+  heatTriggerTransform_ = transform;
+  heatTriggerId_ = sim_->addTriggerVolume(bp_.heatVolume, transform,
+                                          std::move(onHeatVolumeEvent));
 }
 
-void OvenEntity::update(float dt) {
+void OvenEntity::update(float dt,
+                        EntityCommandBuffer& commands,
+                        uint64_t commandOrder) {
   const auto transform = sim_->getArticulatedObjectRootState(objId_);
+  if (transform != heatTriggerTransform_) {
+    // trigger volumes can't be modified while other entities update
+    heatTriggerTransform_ = transform;
+    commands.push(commandOrder, [this, transform]() {
+      sim_->setTriggerVolumeTransformation(heatTriggerId_, transform);
+    });
+  }
+
   const Mn::Vector3& pos = transform.translation();
   Mn::Vector3 openSensorDirWorld = transform.transformVector(bp_.openSensorDir);
   Mn::Vector3 openSensorPosWorld = transform.transformPoint(bp_.openSensorPos);
@@ -69,8 +73,21 @@ void OvenEntity::update(float dt) {
       std::max(bp_.roomTemp, std::min(bp_.targetTemp, temp_ + dt * tempPerSec));
 }
 
-OvenEntity::~OvenEntity() {
-  EntityManager<OvenEntity>::get().onDelete(this);
+void OvenEntity::removeHeatTrigger() {
+  if (heatTriggerId_ != ID_UNDEFINED) {
+    sim_->removeTriggerVolume(heatTriggerId_);
+    heatTriggerId_ = ID_UNDEFINED;
+  }
+}
+
+void OvenEntity::writeSnapshot(core::SnapshotWriter& writer) const {
+  writer.write(temp_);
+  writer.write(isClosed_);
+}
+
+void OvenEntity::readSnapshot(core::SnapshotReader& reader) {
+  temp_ = reader.read<float>();
+  isClosed_ = reader.read<bool>();
 }
 
 void OvenEntity::debugRender(esp::gfx::Debug3DText& debug3dText,
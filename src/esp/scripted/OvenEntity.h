@@ -10,6 +10,7 @@
 #include <Magnum/Math/Vector3.h>
 #include <esp/gfx/Debug3DText.h>
 #include <esp/gfx/DebugRender.h>
+#include "EntityCommandBuffer.h"
 #include "esp/sim/Simulator.h"
 
 namespace esp {
@@ -28,25 +29,49 @@ class OvenEntity {
     float openTempPerSec = -1;
   };
 
+  /**
+   * @brief Add the oven to @p sim, with a trigger volume over
+   * Blueprint::heatVolume which reports to @p onHeatVolumeEvent.
+   */
   OvenEntity(esp::sim::Simulator* sim,
              const OvenEntity::Blueprint& bp,
              const Magnum::Vector3& translation,
-             const Magnum::Quaternion& rotation);
+             const Magnum::Quaternion& rotation,
+             esp::physics::TriggerCallback onHeatVolumeEvent);
 
-  ~OvenEntity();
-
-  bool isInsideCookVolume(const Magnum::Vector3& pos);
-
-  void update(float dt);
+  /**
+   * @brief Update the temperature. Casts a ray to check the door, so it must
+   * not run concurrently with other physics queries; moving the heat trigger
+   * volume is deferred to @p commands.
+   */
+  void update(float dt, EntityCommandBuffer& commands, uint64_t commandOrder);
 
   void debugRender(esp::gfx::Debug3DText& debug3dText,
                    esp::gfx::DebugRender& debugRender);
 
-  float getTemperature() { return temp_; }
+  float getTemperature() const { return temp_; }
+
+  int getHeatTriggerId() const { return heatTriggerId_; }
+
+  /**
+   * @brief Remove the heat trigger volume from the simulator, e.g. before the
+   * oven is destroyed. See @ref EntityManagerHelper::removeOven.
+   */
+  void removeHeatTrigger();
+
+  /**
+   * @brief Save and restore the temperature and door state. The oven pose is
+   * part of the physics snapshot.
+   */
+  void writeSnapshot(core::SnapshotWriter& writer) const;
+  void readSnapshot(core::SnapshotReader& reader);
 
  private:
   Blueprint bp_;
   int objId_ = -1;
+  int heatTriggerId_ = -1;
+  // root transform the heat trigger volume was last placed with
+  Magnum::Matrix4 heatTriggerTransform_;
   esp::sim::Simulator* sim_ = nullptr;
   float temp_ = 0.f;
   bool isClosed_ = true;
@@ -0,0 +1,50 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "SpatialGrid.h"
+
+#include <Corrade/Utility/Assert.h>
+
+#include <algorithm>
+
+namespace esp {
+namespace scripted {
+
+SpatialGrid::SpatialGrid(float cellSize) : cellSize_(cellSize) {
+  CORRADE_INTERNAL_ASSERT(cellSize_ > 0.f);
+}
+
+void SpatialGrid::clear(float cellSize) {
+  CORRADE_INTERNAL_ASSERT(cellSize > 0.f);
+  cellSize_ = cellSize;
+  entries_.clear();
+  sortedEntries_.clear();
+  sortedKeys_.clear();
+  isBuilt_ = false;
+}
+
+void SpatialGrid::build() {
+  const uint32_t numEntries = static_cast<uint32_t>(entries_.size());
+  entryKeys_.resize(numEntries);
+  order_.resize(numEntries);
+  for (uint32_t i = 0; i < numEntries; ++i) {
+    const auto& pos = entries_[i].pos;
+    entryKeys_[i] = cellKey(cellCoord(pos.x()), cellCoord(pos.z()));
+    order_[i] = i;
+  }
+  std::sort(order_.begin(), order_.end(), [&](uint32_t a, uint32_t b) {
+    return entryKeys_[a] < entryKeys_[b];
+  });
+
+  sortedEntries_.resize(numEntries);
+  sortedKeys_.resize(numEntries);
+  for (uint32_t i = 0; i < numEntries; ++i) {
+    sortedEntries_[i] = entries_[order_[i]];
+    sortedKeys_[i] = entryKeys_[order_[i]];
+  }
+  isBuilt_ = true;
+}
+
+}  // namespace scripted
+}  // namespace esp
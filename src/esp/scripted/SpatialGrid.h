@@ -0,0 +1,122 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#ifndef ESP_SCRIPTED_SPATIALGRID_H_
+#define ESP_SCRIPTED_SPATIALGRID_H_
+
+#include <Corrade/Utility/Assert.h>
+#include <Magnum/Magnum.h>
+#include <Magnum/Math/Functions.h>
+#include <Magnum/Math/Vector3.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace esp {
+namespace scripted {
+
+/**
+ * @brief Uniform grid over the horizontal (XZ) plane.
+ *
+ * Intended to be rebuilt once per tick: @ref clear, @ref insert every point,
+ * then @ref build. Points are kept in flat arrays sorted by cell, which keep
+ * their capacity across rebuilds, so steady-state ticks don't allocate.
+ * Queries visit only the cells overlapping the query disc, one binary search
+ * per row of cells. With a query radius up to the cell size, that's at most
+ * a 3x3 block of cells.
+ */
+class SpatialGrid {
+ public:
+  struct Entry {
+    Magnum::Vector3 pos;
+    uint32_t value = 0;
+  };
+
+  explicit SpatialGrid(float cellSize = 0.25f);
+
+  /**
+   * @brief Remove all points and set the cell size for the next build. The
+   * cell size should be on the order of the typical query radius.
+   */
+  void clear(float cellSize);
+  void clear() { clear(cellSize_); }
+
+  void insert(const Magnum::Vector3& pos, uint32_t value) {
+    entries_.push_back({pos, value});
+  }
+
+  /**
+   * @brief Bucket all inserted points by cell. Must be called after the last
+   * @ref insert and before querying.
+   */
+  void build();
+
+  std::size_t size() const { return entries_.size(); }
+
+  float getCellSize() const { return cellSize_; }
+
+  /**
+   * @brief Call @p callback with every entry whose XZ position may lie within
+   * @p radius of @p center's XZ position. Entries are a superset of the exact
+   * answer (whole cells); callers do the exact distance test.
+   */
+  template <typename Callback>
+  void queryRadiusXZ(const Magnum::Vector3& center,
+                     float radius,
+                     Callback&& callback) const;
+
+ private:
+  int cellCoord(float x) const {
+    return static_cast<int>(Magnum::Math::floor(x / cellSize_));
+  }
+
+  //! Orders keys by cx, then cz, so the cells of a row with consecutive cz
+  //! are adjacent. The sign bits are flipped to keep negative coordinates
+  //! in order.
+  static uint64_t cellKey(int cx, int cz) {
+    return (uint64_t(uint32_t(cx) ^ 0x80000000u) << 32) |
+           uint64_t(uint32_t(cz) ^ 0x80000000u);
+  }
+
+  float cellSize_;
+  bool isBuilt_ = false;
+  std::vector<Entry> entries_;
+  // entries_ sorted by cell, and their cell keys
+  std::vector<Entry> sortedEntries_;
+  std::vector<uint64_t> sortedKeys_;
+  std::vector<uint64_t> entryKeys_;
+  std::vector<uint32_t> order_;
+};
+
+template <typename Callback>
+void SpatialGrid::queryRadiusXZ(const Magnum::Vector3& center,
+                                    float radius,
+                                    Callback&& callback) const {
+  CORRADE_INTERNAL_ASSERT(isBuilt_);
+  if (sortedKeys_.empty()) {
+    return;
+  }
+  const int minX = cellCoord(center.x() - radius);
+  const int maxX = cellCoord(center.x() + radius);
+  const int minZ = cellCoord(center.z() - radius);
+  const int maxZ = cellCoord(center.z() + radius);
+  for (int cx = minX; cx <= maxX; ++cx) {
+    // the cells [minZ, maxZ] of a row are one range of the sorted entries
+    const auto begin = std::lower_bound(
+        sortedKeys_.begin(), sortedKeys_.end(), cellKey(cx, minZ));
+    const auto end =
+        std::upper_bound(begin, sortedKeys_.end(), cellKey(cx, maxZ));
+    for (auto i = std::size_t(begin - sortedKeys_.begin()),
+              iEnd = std::size_t(end - sortedKeys_.begin());
+         i < iEnd; ++i) {
+      callback(sortedEntries_[i]);
+    }
+  }
+}
+
+}  // namespace scripted
+}  // namespace esp
+
+#endif  // ESP_SCRIPTED_SPATIALGRID_H_
@@ -0,0 +1,77 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include <Corrade/TestSuite/Tester.h>
+
+#include "esp/scripted/EntityManagerHelper.h"
+
+namespace Cr = Corrade;
+
+using esp::scripted::EntityManagerHelper;
+using esp::scripted::EntityResource;
+using esp::scripted::EntitySystem;
+
+namespace {
+
+struct EntityManagerHelperTest : Cr::TestSuite::Tester {
+  explicit EntityManagerHelperTest();
+
+  void buildStages();
+  void defaultSystemStages();
+};
+
+EntityManagerHelperTest::EntityManagerHelperTest() {
+  addTests({&EntityManagerHelperTest::buildStages,
+            &EntityManagerHelperTest::defaultSystemStages});
+}
+
+void EntityManagerHelperTest::buildStages() {
+  std::vector<EntitySystem> systems{
+      {"a", EntityResource::ObjectTransforms, EntityResource::OvenState, {}},
+      {"b", EntityResource::ObjectTransforms, EntityResource::FluidReceivers,
+       {}},
+      // reads what a writes
+      {"c", EntityResource::OvenState, EntityResource::CookState, {}},
+      // writes what b reads; must stay after b
+      {"d", {}, EntityResource::ObjectTransforms, {}},
+      // independent of everything
+      {"e", {}, EntityResource::FluidVolumes, {}},
+  };
+  const auto stages = EntityManagerHelper::buildStages(systems);
+  CORRADE_COMPARE(stages.size(), 2);
+  CORRADE_COMPARE(stages[0].size(), 3);
+  CORRADE_COMPARE(stages[0][0], 0);
+  CORRADE_COMPARE(stages[0][1], 1);
+  CORRADE_COMPARE(stages[0][2], 4);
+  CORRADE_COMPARE(stages[1].size(), 2);
+  CORRADE_COMPARE(stages[1][0], 2);
+  CORRADE_COMPARE(stages[1][1], 3);
+}
+
+void EntityManagerHelperTest::defaultSystemStages() {
+  EntityManagerHelper helper;
+  const auto& systems = helper.getSystems();
+  const auto& stages = helper.getStages();
+  // every system is scheduled exactly once, and no stage contains systems
+  // with conflicting accesses
+  std::size_t numScheduled = 0;
+  for (const auto& stage : stages) {
+    numScheduled += stage.size();
+    for (std::size_t i : stage) {
+      for (std::size_t j : stage) {
+        if (i != j) {
+          CORRADE_VERIFY(!(systems[i].writes &
+                           (systems[j].reads | systems[j].writes)));
+        }
+      }
+    }
+  }
+  CORRADE_COMPARE(numScheduled, systems.size());
+  // ovens and the receiver grid don't depend on each other
+  CORRADE_COMPARE(stages[0].size(), 2);
+}
+
+}  // namespace
+
+CORRADE_TEST_MAIN(EntityManagerHelperTest)
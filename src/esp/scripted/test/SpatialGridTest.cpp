@@ -0,0 +1,202 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include <Corrade/Containers/ArrayView.h>
+#include <Corrade/TestSuite/Tester.h>
+#include <Magnum/Magnum.h>
+#include <Magnum/Math/Vector3.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "esp/scripted/SpatialGrid.h"
+
+namespace Cr = Corrade;
+namespace Mn = Magnum;
+
+using esp::scripted::SpatialGrid;
+
+namespace {
+
+// roughly a kitchen counter's worth of receive radius (spout radius + pad)
+constexpr float receiveRadius = 0.16f;
+// side length of the square area vessels are scattered over
+constexpr float areaSize = 8.f;
+
+constexpr struct {
+  const char* name;
+  int numVessels;
+} VesselCountData[]{{"10 vessels", 10},
+                    {"100 vessels", 100},
+                    {"1000 vessels", 1000},
+                    {"5000 vessels", 5000}};
+
+std::vector<Mn::Vector3> randomSpouts(int count, unsigned seed) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> xz(0.f, areaSize);
+  std::uniform_real_distribution<float> y(0.5f, 1.5f);
+  std::vector<Mn::Vector3> spouts;
+  spouts.reserve(count);
+  for (int i = 0; i < count; ++i) {
+    spouts.emplace_back(xz(rng), y(rng), xz(rng));
+  }
+  return spouts;
+}
+
+float xzDist(const Mn::Vector3& a, const Mn::Vector3& b) {
+  return (a.xz() - b.xz()).length();
+}
+
+// the pre-broadphase behavior: every pourer scans every receiver
+int bruteForceClosest(const std::vector<Mn::Vector3>& spouts, int pourer) {
+  int best = -1;
+  float bestDist = 0.f;
+  for (int i = 0; i < int(spouts.size()); ++i) {
+    if (i == pourer) {
+      continue;
+    }
+    float dist = xzDist(spouts[pourer], spouts[i]);
+    if (dist <= receiveRadius && (best == -1 || dist < bestDist)) {
+      best = i;
+      bestDist = dist;
+    }
+  }
+  return best;
+}
+
+int gridClosest(const SpatialGrid& grid,
+                const std::vector<Mn::Vector3>& spouts,
+                int pourer) {
+  int best = -1;
+  float bestDist = 0.f;
+  grid.queryRadiusXZ(spouts[pourer], receiveRadius,
+                     [&](const SpatialGrid::Entry& entry) {
+                       int i = int(entry.value);
+                       if (i == pourer) {
+                         return;
+                       }
+                       float dist = xzDist(spouts[pourer], entry.pos);
+                       if (dist <= receiveRadius &&
+                           (best == -1 || dist < bestDist ||
+                            (dist == bestDist && i < best))) {
+                         best = i;
+                         bestDist = dist;
+                       }
+                     });
+  return best;
+}
+
+void buildGrid(SpatialGrid& grid, const std::vector<Mn::Vector3>& spouts) {
+  grid.clear(receiveRadius);
+  for (uint32_t i = 0; i < spouts.size(); ++i) {
+    grid.insert(spouts[i], i);
+  }
+  grid.build();
+}
+
+struct SpatialGridTest : Cr::TestSuite::Tester {
+  explicit SpatialGridTest();
+
+  void empty();
+  void matchesBruteForce();
+  void negativeCoords();
+
+  void benchmarkBruteForce();
+  void benchmarkGrid();
+};
+
+SpatialGridTest::SpatialGridTest() {
+  addTests({&SpatialGridTest::empty,
+            &SpatialGridTest::matchesBruteForce,
+            &SpatialGridTest::negativeCoords});
+
+  addInstancedBenchmarks({&SpatialGridTest::benchmarkBruteForce,
+                          &SpatialGridTest::benchmarkGrid},
+                         10, Cr::Containers::arraySize(VesselCountData));
+}
+
+void SpatialGridTest::empty() {
+  SpatialGrid grid;
+  grid.build();
+  int visited = 0;
+  grid.queryRadiusXZ({}, 1.f, [&](const SpatialGrid::Entry&) {
+    ++visited;
+  });
+  CORRADE_COMPARE(visited, 0);
+  CORRADE_COMPARE(grid.size(), 0);
+}
+
+void SpatialGridTest::matchesBruteForce() {
+  // dense enough that many pourers have several candidates
+  const auto spouts = randomSpouts(2000, 0);
+  SpatialGrid grid;
+  buildGrid(grid, spouts);
+  CORRADE_COMPARE(grid.size(), spouts.size());
+
+  int numMatched = 0;
+  for (int i = 0; i < int(spouts.size()); ++i) {
+    int expected = bruteForceClosest(spouts, i);
+    CORRADE_COMPARE(gridClosest(grid, spouts, i), expected);
+    numMatched += expected != -1;
+  }
+  // make sure the test actually exercises neighbor lookups
+  CORRADE_VERIFY(numMatched > 100);
+}
+
+void SpatialGridTest::negativeCoords() {
+  // points straddling the origin land in cells -1 and 0
+  std::vector<Mn::Vector3> spouts{{-0.01f, 0.f, -0.01f}, {0.01f, 0.f, 0.01f}};
+  SpatialGrid grid;
+  buildGrid(grid, spouts);
+  CORRADE_COMPARE(gridClosest(grid, spouts, 0), 1);
+  CORRADE_COMPARE(gridClosest(grid, spouts, 1), 0);
+
+  // rows and columns of cells on both sides of the origin, rebuilt into the
+  // same grid
+  auto centered = randomSpouts(2000, 2);
+  for (auto& spout : centered) {
+    spout -= Mn::Vector3{areaSize * 0.5f, 0.f, areaSize * 0.5f};
+  }
+  buildGrid(grid, centered);
+  for (int i = 0; i < int(centered.size()); ++i) {
+    CORRADE_COMPARE(gridClosest(grid, centered, i),
+                    bruteForceClosest(centered, i));
+  }
+}
+
+void SpatialGridTest::benchmarkBruteForce() {
+  auto&& data = VesselCountData[testCaseInstanceId()];
+  setTestCaseDescription(data.name);
+  const auto spouts = randomSpouts(data.numVessels, 1);
+
+  int found = 0;
+  CORRADE_BENCHMARK(1) {
+    for (int i = 0; i < data.numVessels; ++i) {
+      found += bruteForceClosest(spouts, i) != -1;
+    }
+  }
+  CORRADE_VERIFY(found >= 0);
+}
+
+void SpatialGridTest::benchmarkGrid() {
+  auto&& data = VesselCountData[testCaseInstanceId()];
+  setTestCaseDescription(data.name);
+  const auto spouts = randomSpouts(data.numVessels, 1);
+
+  // includes the once-per-tick rebuild
+  SpatialGrid grid;
+  int found = 0;
+  CORRADE_BENCHMARK(1) {
+    buildGrid(grid, spouts);
+    for (int i = 0; i < data.numVessels; ++i) {
+      found += gridClosest(grid, spouts, i) != -1;
+    }
+  }
+  CORRADE_VERIFY(found >= 0);
+}
+
+}  // namespace
+
+CORRADE_TEST_MAIN(SpatialGridTest)
@@ -0,0 +1,199 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#include "BatchReplayRenderer.h"
+
+#include <algorithm>
+#include <numeric>
+
+#include <Magnum/GL/Context.h>
+#include <Magnum/PixelFormat.h>
+
+#include "esp/core/Check.h"
+#include "esp/sim/SimulatorConfiguration.h"
+
+namespace Mn = Magnum;
+
+namespace esp {
+namespace sim {
+
+namespace {
+
+int firstKeyframeIndex(const BatchReplayJob& job) {
+  int first = job.views.empty() ? 0 : job.views[0].keyframeIndex;
+  for (const auto& view : job.views) {
+    first = std::min(first, view.keyframeIndex);
+  }
+  return std::max(first, 0);
+}
+
+}  // namespace
+
+BatchReplayRenderer::BatchReplayRenderer(
+    const BatchReplayRendererConfiguration& cfg)
+    : config_(cfg) {
+  ESP_CHECK(config_.resolution.product() > 0,
+            "BatchReplayRenderer: invalid resolution" << config_.resolution);
+
+  if (!Mn::GL::Context::hasCurrent()) {
+    context_ = gfx::WindowlessContext::create_unique(config_.gpuDeviceId);
+  }
+  gfx::Renderer::Flags flags;
+  if (!config_.requiresTextures) {
+    flags |= gfx::Renderer::Flag::NoTextures;
+  }
+  renderer_ = gfx::Renderer::create(context_.get(), flags);
+  renderer_->acquireGlContext();
+
+  SimulatorConfiguration simConfig;
+  simConfig.requiresTextures = config_.requiresTextures;
+  metadataMediator_ = metadata::MetadataMediator::create(simConfig);
+  resourceManager_ =
+      std::make_unique<assets::ResourceManager>(metadataMediator_);
+  resourceManager_->setRequiresTextures(config_.requiresTextures);
+
+  sceneID_ = sceneManager_.initSceneGraph();
+  auto& cameraNode =
+      sceneManager_.getSceneGraph(sceneID_).getRootNode().createChild();
+  // owned by the node
+  camera_ = new gfx::RenderCamera(cameraNode);
+  camera_->setProjectionMatrix(config_.resolution.x(), config_.resolution.y(),
+                               config_.znear, config_.zfar, config_.hfov);
+
+  renderTarget_ = gfx::RenderTarget::create_unique(
+      config_.resolution, Mn::Vector2{}, nullptr,
+      gfx::RenderTarget::Flag::RgbaBuffer);
+  const std::size_t rgbaSize = std::size_t(config_.resolution.product()) * 4;
+  rgbaData_ = Corrade::Containers::Array<char>{Corrade::Containers::NoInit,
+                                               rgbaSize};
+}
+
+BatchReplayRenderer::~BatchReplayRenderer() {
+  // the scene graph and render assets are GL resources
+  renderer_->acquireGlContext();
+}
+
+gfx::replay::Player::uptr BatchReplayRenderer::createPlayer() {
+  auto player = gfx::replay::Player::create_unique(
+      [this](const assets::AssetInfo& assetInfo,
+             const assets::RenderAssetInstanceCreationInfo& creation) {
+        // there's no separate semantic scene graph, see the class docs
+        const std::vector<int> sceneIDs{sceneID_, sceneID_};
+        return resourceManager_->loadAndCreateRenderAssetInstance(
+            assetInfo, creation, &sceneManager_, sceneIDs);
+      });
+  player->setPrefetchCallback(
+      [this](const assets::AssetInfo& assetInfo) {
+        return resourceManager_->prefetchRenderAssetFile(assetInfo);
+      },
+      config_.prefetchKeyframesAhead);
+  return player;
+}
+
+void BatchReplayRenderer::render(const std::vector<BatchReplayJob>& jobs,
+                                 const ObservationCallback& callback) {
+  if (jobs.empty()) {
+    return;
+  }
+  renderer_->acquireGlContext();
+
+  core::TaskScheduler::TaskGroup readGroup;
+  gfx::replay::Player::uptr nextPlayer;
+  auto startRead = [&](std::size_t jobIndex) {
+    nextPlayer = createPlayer();
+    gfx::replay::Player* player = nextPlayer.get();
+    const std::string& filepath = jobs[jobIndex].filepath;
+    readScheduler_.submit(readGroup, [player, &filepath]() {
+      player->readKeyframesFromFile(filepath);
+    });
+  };
+
+  startRead(0);
+  for (std::size_t jobIndex = 0; jobIndex != jobs.size(); ++jobIndex) {
+    readScheduler_.wait(readGroup);
+    gfx::replay::Player::uptr player = std::move(nextPlayer);
+    const bool hasNext = jobIndex + 1 != jobs.size();
+    if (hasNext) {
+      startRead(jobIndex + 1);
+    }
+    bool nextPrefetched = !hasNext;
+
+    const BatchReplayJob& job = jobs[jobIndex];
+    const int numKeyframes = player->getNumKeyframes();
+    if (!numKeyframes) {
+      // the player already logged why
+      LOG(WARNING) << "BatchReplayRenderer::render: skipping job " << jobIndex
+                   << ", no keyframes in " << job.filepath;
+      continue;
+    }
+
+    // stable, so views of the same keyframe keep their order
+    std::vector<std::size_t> viewOrder(job.views.size());
+    std::iota(viewOrder.begin(), viewOrder.end(), 0);
+    std::stable_sort(viewOrder.begin(), viewOrder.end(),
+                     [&](std::size_t a, std::size_t b) {
+                       return job.views[a].keyframeIndex <
+                              job.views[b].keyframeIndex;
+                     });
+
+    for (const std::size_t viewIndex : viewOrder) {
+      const BatchReplayView& view = job.views[viewIndex];
+      if (view.keyframeIndex < 0 || view.keyframeIndex >= numKeyframes) {
+        LOG(WARNING) << "BatchReplayRenderer::render: skipping view "
+                     << viewIndex << " of job " << jobIndex << ", keyframe "
+                     << view.keyframeIndex << " is out of range for "
+                     << job.filepath;
+        continue;
+      }
+      renderView(*player, view);
+      callback(int(jobIndex), int(viewIndex),
+               Mn::ImageView2D{Mn::PixelFormat::RGBA8Unorm, config_.resolution,
+                               rgbaData_});
+
+      // start loading the next replay's assets as soon as its file is read
+      if (!nextPrefetched && readGroup.isDone()) {
+        nextPlayer->prefetchAssets(firstKeyframeIndex(jobs[jobIndex + 1]));
+        nextPrefetched = true;
+      }
+    }
+
+    const auto& stats = player->getPrefetchStats();
+    prefetchStats_.hits += stats.hits;
+    prefetchStats_.misses += stats.misses;
+    // removes the replay's instances from the scene graph, render assets stay
+    // loaded for the following replays
+    player->close();
+  }
+}
+
+void BatchReplayRenderer::renderView(gfx::replay::Player& player,
+                                     const BatchReplayView& view) {
+  player.setKeyframeIndex(view.keyframeIndex);
+
+  Mn::Vector3 translation = view.translation;
+  Mn::Quaternion rotation = view.rotation;
+  if (!view.userTransformName.empty() &&
+      !player.getUserTransform(view.userTransformName, &translation,
+                               &rotation)) {
+    LOG(WARNING) << "BatchReplayRenderer::render: user transform "
+                 << view.userTransformName << " not found in keyframe "
+                 << view.keyframeIndex << ", using the view's pose";
+  }
+  auto& cameraNode = camera_->node();
+  cameraNode.setTranslation(translation);
+  cameraNode.setRotation(rotation);
+
+  gfx::RenderCamera::Flags flags;
+  if (config_.frustumCulling) {
+    flags |= gfx::RenderCamera::Flag::FrustumCulling;
+  }
+  renderTarget_->renderEnter();
+  renderer_->draw(*camera_, sceneManager_.getSceneGraph(sceneID_), flags);
+  renderTarget_->renderExit();
+  renderTarget_->readFrameRgba(Mn::MutableImageView2D{
+      Mn::PixelFormat::RGBA8Unorm, config_.resolution, rgbaData_});
+}
+
+}  // namespace sim
+}  // namespace esp
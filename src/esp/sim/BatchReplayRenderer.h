@@ -0,0 +1,150 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+#ifndef ESP_SIM_BATCHREPLAYRENDERER_H_
+#define ESP_SIM_BATCHREPLAYRENDERER_H_
+
+/** @file
+ * @brief Class @ref esp::sim::BatchReplayRenderer, struct
+ * @ref esp::sim::BatchReplayRendererConfiguration
+ */
+
+#include <Corrade/Containers/Array.h>
+#include <Magnum/ImageView.h>
+#include <Magnum/Magnum.h>
+#include <Magnum/Math/Angle.h>
+#include <Magnum/Math/Quaternion.h>
+#include <Magnum/Math/Vector3.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "esp/assets/ResourceManager.h"
+#include "esp/core/TaskScheduler.h"
+#include "esp/core/esp.h"
+#include "esp/gfx/RenderCamera.h"
+#include "esp/gfx/RenderTarget.h"
+#include "esp/gfx/Renderer.h"
+#include "esp/gfx/WindowlessContext.h"
+#include "esp/gfx/replay/Player.h"
+#include "esp/metadata/MetadataMediator.h"
+#include "esp/scene/SceneManager.h"
+
+namespace esp {
+namespace sim {
+
+/**
+ * @brief A camera view of one keyframe of a replay.
+ */
+struct BatchReplayView {
+  int keyframeIndex = 0;
+  //! Camera pose, used if @ref userTransformName is empty
+  Magnum::Vector3 translation;
+  Magnum::Quaternion rotation;
+  //! Name of a user transform of the keyframe to use as the camera pose,
+  //! e.g. a recorded agent camera. See
+  //! @ref gfx::replay::Recorder::addUserTransformToKeyframe.
+  std::string userTransformName;
+};
+
+/**
+ * @brief A replay file and the views to render of it.
+ */
+struct BatchReplayJob {
+  std::string filepath;
+  std::vector<BatchReplayView> views;
+};
+
+struct BatchReplayRendererConfiguration {
+  int gpuDeviceId = 0;
+  //! Resolution of the rendered observations, in pixels
+  Magnum::Vector2i resolution{128, 128};
+  Magnum::Deg hfov{90.0f};
+  float znear = 0.01f;
+  float zfar = 1000.0f;
+  bool requiresTextures = true;
+  bool frustumCulling = true;
+  //! How many keyframes ahead of a view the assets of a replay are prefetched
+  int prefetchKeyframesAhead = 32;
+  ESP_SMART_POINTERS(BatchReplayRendererConfiguration)
+};
+
+/**
+ * @brief Renders views of many replays in one process.
+ *
+ * All replays share one @ref assets::ResourceManager, so each render asset
+ * and shader is loaded once for the whole batch. Replays are played back one
+ * at a time into the same scene graph; a replay's instances are removed when
+ * it's done. While a replay is rendered, the next replay file is read on a
+ * worker thread and the files of its render assets are prefetched, so the
+ * render loop rarely waits on I/O.
+ *
+ * Replays recorded with
+ * @ref SimulatorConfiguration::forceSeparateSemanticSceneGraph aren't
+ * supported, since only RGBA observations are rendered.
+ */
+class BatchReplayRenderer {
+ public:
+  /**
+   * @brief Called with each rendered observation, in RGBA8 format. The view
+   * only stays valid during the call.
+   */
+  using ObservationCallback = std::function<
+      void(int jobIndex, int viewIndex, const Magnum::ImageView2D& rgba)>;
+
+  /**
+   * @brief Create a GL context, unless one is current already, and the
+   * shared renderer resources.
+   */
+  explicit BatchReplayRenderer(const BatchReplayRendererConfiguration& cfg);
+
+  ~BatchReplayRenderer();
+
+  /**
+   * @brief Render all views of all @p jobs and pass them to @p callback.
+   *
+   * Views of a job are rendered in keyframe order, so each keyframe is
+   * applied at most once. Jobs whose file can't be read are skipped with a
+   * warning. Render assets stay loaded for later calls.
+   */
+  void render(const std::vector<BatchReplayJob>& jobs,
+              const ObservationCallback& callback);
+
+  /**
+   * @brief Prefetch hits and misses of all replays rendered so far. See
+   * @ref gfx::replay::Player::getPrefetchStats.
+   */
+  const gfx::replay::Player::PrefetchStats& getPrefetchStats() const {
+    return prefetchStats_;
+  }
+
+ private:
+  gfx::replay::Player::uptr createPlayer();
+  void renderView(gfx::replay::Player& player, const BatchReplayView& view);
+
+  BatchReplayRendererConfiguration config_;
+
+  gfx::WindowlessContext::uptr context_;
+  gfx::Renderer::ptr renderer_;
+  metadata::MetadataMediator::ptr metadataMediator_;
+  // destroyed before the context, see Simulator
+  std::unique_ptr<assets::ResourceManager> resourceManager_;
+  scene::SceneManager sceneManager_;
+  int sceneID_ = ID_UNDEFINED;
+  gfx::RenderCamera* camera_ = nullptr;
+  gfx::RenderTarget::uptr renderTarget_;
+  Corrade::Containers::Array<char> rgbaData_;
+
+  // reads the next replay file while the current one is rendered
+  core::TaskScheduler readScheduler_{1};
+  gfx::replay::Player::PrefetchStats prefetchStats_;
+
+  ESP_SMART_POINTERS(BatchReplayRenderer)
+};
+
+}  // namespace sim
+}  // namespace esp
+
+#endif  // ESP_SIM_BATCHREPLAYRENDERER_H_
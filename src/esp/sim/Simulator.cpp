@@ -4,22 +4,28 @@
 
 #include "Simulator.h"
 
+#include <algorithm>
 #include <memory>
+#include <set>
 #include <string>
 #include <utility>
 
+#include <Corrade/Utility/DebugStl.h>
 #include <Corrade/Utility/Directory.h>
+#include <Corrade/Utility/FormatStl.h>
 #include <Corrade/Utility/String.h>
 #include <Magnum/EigenIntegration/GeometryIntegration.h>
 #include <Magnum/GL/Context.h>
 #include <Magnum/GL/Renderer.h>
 
+#include "esp/core/Check.h"
 #include "esp/core/esp.h"
 #include "esp/gfx/Drawable.h"
 #include "esp/gfx/RenderCamera.h"
 #include "esp/gfx/Renderer.h"
 #include "esp/gfx/replay/Recorder.h"
 #include "esp/gfx/replay/ReplayManager.h"
+#include "esp/geo/geo.h"
 #include "esp/metadata/attributes/AttributesBase.h"
 #include "esp/nav/PathFinder.h"
 #include "esp/physics/PhysicsManager.h"
@@ -64,6 +70,10 @@ void Simulator::close(const bool destroy) {
   navMeshVisNode_ = nullptr;
   agents_.clear();
 
+  // replay players may outlive the simulator and its physics objects
+  if (gfxReplayMgr_) {
+    gfxReplayMgr_->detachPhysicsPlayers();
+  }
   physicsManager_ = nullptr;
   gfxReplayMgr_ = nullptr;
   semanticScene_ = nullptr;
@@ -286,6 +296,8 @@ bool Simulator::createSceneInstance(const std::string& activeSceneName) {
   // current scene instance to correspond to the given name.
   metadata::attributes::SceneAttributes::cptr curSceneInstanceAttributes =
       setSceneInstanceAttributes(activeSceneName);
+  // files prefetched for the previous scene won't be loaded anymore
+  resourceManager_->clearPrefetchedFiles();
 
   // get sceneGraph and rootNode
   auto& sceneGraph = sceneManager_->getSceneGraph(activeSceneID_);
@@ -293,7 +305,10 @@ bool Simulator::createSceneInstance(const std::string& activeSceneName) {
 
   // 2. (re)seat & (re)init physics manager using the physics manager
   // attributes specified in current simulator configuration held in
-  // metadataMediator.
+  // metadataMediator. Replay players' objects belong to the old one.
+  if (gfxReplayMgr_) {
+    gfxReplayMgr_->detachPhysicsPlayers();
+  }
   resourceManager_->initPhysicsManager(
       physicsManager_, config_.enablePhysics, &rootNode,
       metadataMediator_->getCurrentPhysicsManagerAttributes());
@@ -554,6 +569,7 @@ void Simulator::reset() {
   const Magnum::Range3D& sceneBB =
       getActiveSceneGraph().getRootNode().computeCumulativeBB();
   resourceManager_->setLightSetup(gfx::getDefaultLights());
+  resourceManager_->clearPrefetchedFiles();
 }  // Simulator::reset()
 
 void Simulator::seed(uint32_t newSeed) {
@@ -562,6 +578,10 @@ void Simulator::seed(uint32_t newSeed) {
 }
 
 void Simulator::reconfigureReplayManager(bool enableGfxReplaySave) {
+  // the physics callbacks of existing players refer to this simulator
+  if (gfxReplayMgr_) {
+    gfxReplayMgr_->detachPhysicsPlayers();
+  }
   gfxReplayMgr_ = std::make_shared<gfx::replay::ReplayManager>();
 
   // construct Recorder instance if requested
@@ -579,6 +599,28 @@ void Simulator::reconfigureReplayManager(bool enableGfxReplaySave) {
           -> scene::SceneNode* {
         return loadAndCreateRenderAssetInstance(assetInfo, creation);
       });
+  gfxReplayMgr_->setPlayerPrefetchCallback(
+      [this](const assets::AssetInfo& assetInfo) {
+        return resourceManager_->prefetchRenderAssetFile(assetInfo);
+      });
+
+  // players which drive physics replace instances with kinematic objects
+  gfx::replay::Player::PhysicsCallbacks physicsCallbacks;
+  physicsCallbacks.createObject =
+      [this](const assets::AssetInfo&,
+             const assets::RenderAssetInstanceCreationInfo& creation) {
+        return addKinematicObjectForRenderAsset(creation);
+      };
+  physicsCallbacks.removeObject = [this](int objectID) {
+    removeObject(objectID);
+  };
+  physicsCallbacks.setRigidStates =
+      [this](Corrade::Containers::ArrayView<const int> objectIDs,
+             Corrade::Containers::ArrayView<const core::RigidState> states) {
+        setRigidStates(objectIDs, states);
+      };
+  gfxReplayMgr_->setPlayerPhysicsCallbacks(physicsCallbacks);
+  renderAssetObjectTemplates_.clear();
 }
 
 scene::SceneGraph& Simulator::getActiveSceneGraph() {
@@ -629,6 +671,21 @@ int Simulator::addObjectByHandle(const std::string& objectLibHandle,
   return ID_UNDEFINED;
 }
 
+bool Simulator::swapObjectRenderAsset(const int objectID,
+                                      const std::string& objectLibHandle,
+                                      const std::string& lightSetupKey,
+                                      const int sceneID) {
+  if (sceneHasPhysics(sceneID)) {
+    if (renderer_)
+      renderer_->acquireGlContext();
+    auto& sceneGraph = sceneManager_->getSceneGraph(activeSceneID_);
+    auto& drawables = sceneGraph.getDrawables();
+    return physicsManager_->swapObjectRenderAsset(objectID, objectLibHandle,
+                                                  &drawables, lightSetupKey);
+  }
+  return false;
+}
+
 const metadata::attributes::ObjectAttributes::cptr
 Simulator::getObjectInitializationTemplate(const int objectId,
                                            const int sceneID) const {
@@ -774,6 +831,41 @@ void Simulator::setRigidState(const esp::core::RigidState& rigidState,
   }
 }
 
+void Simulator::getTransformations(
+    Corrade::Containers::ArrayView<const int> objectIDs,
+    Corrade::Containers::ArrayView<Magnum::Matrix4> transforms,
+    const int sceneID) const {
+  if (sceneHasPhysics(sceneID)) {
+    physicsManager_->getTransformations(objectIDs, transforms);
+    return;
+  }
+  for (auto& transform : transforms) {
+    transform = Magnum::Matrix4::fromDiagonal(Magnum::Vector4(1));
+  }
+}
+
+void Simulator::getRigidStates(
+    Corrade::Containers::ArrayView<const int> objectIDs,
+    Corrade::Containers::ArrayView<esp::core::RigidState> rigidStates,
+    const int sceneID) const {
+  if (sceneHasPhysics(sceneID)) {
+    physicsManager_->getRigidStates(objectIDs, rigidStates);
+    return;
+  }
+  for (auto& rigidState : rigidStates) {
+    rigidState = esp::core::RigidState();
+  }
+}
+
+void Simulator::setRigidStates(
+    Corrade::Containers::ArrayView<const int> objectIDs,
+    Corrade::Containers::ArrayView<const esp::core::RigidState> rigidStates,
+    const int sceneID) {
+  if (sceneHasPhysics(sceneID)) {
+    physicsManager_->setRigidStates(objectIDs, rigidStates);
+  }
+}
+
 // set object translation directly
 void Simulator::setTranslation(const Magnum::Vector3& translation,
                                const int objectID,
@@ -866,6 +958,39 @@ esp::physics::RaycastResults Simulator::castRay(const esp::geo::Ray& ray,
   return esp::physics::RaycastResults();
 }
 
+int Simulator::addTriggerVolume(const Magnum::Range3D& localBox,
+                                const Magnum::Matrix4& transform,
+                                esp::physics::TriggerCallback callback,
+                                const int sceneID) {
+  if (sceneHasPhysics(sceneID)) {
+    return physicsManager_->addTriggerVolume(localBox, transform,
+                                             std::move(callback));
+  }
+  return ID_UNDEFINED;
+}
+
+void Simulator::setTriggerVolumeTransformation(const int triggerId,
+                                               const Magnum::Matrix4& transform,
+                                               const int sceneID) {
+  if (sceneHasPhysics(sceneID)) {
+    physicsManager_->setTriggerVolumeTransformation(triggerId, transform);
+  }
+}
+
+void Simulator::removeTriggerVolume(const int triggerId, const int sceneID) {
+  if (sceneHasPhysics(sceneID)) {
+    physicsManager_->removeTriggerVolume(triggerId);
+  }
+}
+
+std::vector<esp::physics::TriggerEvent> Simulator::takeTriggerEvents(
+    const int sceneID) {
+  if (sceneHasPhysics(sceneID)) {
+    return physicsManager_->takeTriggerEvents();
+  }
+  return {};
+}
+
 void Simulator::setObjectBBDraw(bool drawBB,
                                 const int objectID,
                                 const int sceneID) {
@@ -944,6 +1069,103 @@ double Simulator::getWorldTime() {
   return NO_TIME;
 }
 
+namespace {
+// "HSNP"; a snapshot starts with this and the format version
+constexpr uint32_t SnapshotMagic = 0x504e5348;
+constexpr uint32_t SnapshotVersion = 2;
+}  // namespace
+
+void Simulator::addSnapshotParticipant(const std::string& name,
+                                       SnapshotSaveCallback save,
+                                       SnapshotRestoreCallback restore) {
+  CORRADE_ASSERT(save && restore,
+                 "Simulator::addSnapshotParticipant(): callbacks of"
+                     << name << "are empty", );
+  for (auto& participant : snapshotParticipants_) {
+    if (participant.name == name) {
+      participant.save = std::move(save);
+      participant.restore = std::move(restore);
+      return;
+    }
+  }
+  snapshotParticipants_.push_back({name, std::move(save), std::move(restore)});
+}
+
+bool Simulator::removeSnapshotParticipant(const std::string& name) {
+  auto it = std::find_if(
+      snapshotParticipants_.begin(), snapshotParticipants_.end(),
+      [&](const SnapshotParticipant& p) { return p.name == name; });
+  if (it == snapshotParticipants_.end()) {
+    return false;
+  }
+  snapshotParticipants_.erase(it);
+  return true;
+}
+
+void Simulator::saveSnapshot(std::vector<char>& buffer, const int sceneID) {
+  buffer.clear();
+  core::SnapshotWriter writer{buffer};
+  writer.write(SnapshotMagic);
+  writer.write(SnapshotVersion);
+
+  const bool hasPhysics = sceneHasPhysics(sceneID);
+  writer.write(hasPhysics);
+  if (hasPhysics) {
+    physicsManager_->writeSnapshot(writer);
+  }
+
+  writer.write(uint32_t(snapshotParticipants_.size()));
+  for (const auto& participant : snapshotParticipants_) {
+    writer.writeString(participant.name);
+    // size of the section, so a reader can tell when a participant
+    // over- or under-reads
+    const std::size_t sizeOffset = writer.reserve<uint64_t>();
+    const std::size_t begin = writer.getSize();
+    participant.save(writer);
+    writer.patch(sizeOffset, uint64_t(writer.getSize() - begin));
+  }
+}
+
+void Simulator::restoreSnapshot(const std::vector<char>& buffer,
+                                const int sceneID) {
+  core::SnapshotReader reader{buffer.data(), buffer.size()};
+  ESP_CHECK(reader.read<uint32_t>() == SnapshotMagic,
+            "Simulator::restoreSnapshot(): buffer isn't a snapshot");
+  const uint32_t version = reader.read<uint32_t>();
+  ESP_CHECK(version == SnapshotVersion,
+            "Simulator::restoreSnapshot(): unsupported snapshot version"
+                << version);
+
+  const bool hasPhysics = reader.read<bool>();
+  ESP_CHECK(hasPhysics == sceneHasPhysics(sceneID),
+            "Simulator::restoreSnapshot(): snapshot was taken"
+                << (hasPhysics ? "with" : "without")
+                << "physics but the scene has"
+                << (hasPhysics ? "none" : "physics"));
+  if (hasPhysics) {
+    physicsManager_->readSnapshot(reader);
+  }
+
+  const uint32_t numParticipants = reader.read<uint32_t>();
+  ESP_CHECK(numParticipants == snapshotParticipants_.size(),
+            "Simulator::restoreSnapshot(): snapshot has"
+                << numParticipants << "participants but"
+                << snapshotParticipants_.size() << "are registered");
+  for (const auto& participant : snapshotParticipants_) {
+    const std::string name = reader.readString();
+    ESP_CHECK(name == participant.name,
+              "Simulator::restoreSnapshot(): expected participant"
+                  << participant.name << "but the snapshot has" << name);
+    core::SnapshotReader section =
+        reader.readSection(reader.read<uint64_t>());
+    participant.restore(section);
+    ESP_CHECK(section.getRemaining() == 0,
+              "Simulator::restoreSnapshot(): participant"
+                  << name << "left" << section.getRemaining()
+                  << "bytes unread");
+  }
+}
+
 void Simulator::setGravity(const Magnum::Vector3& gravity, const int sceneID) {
   if (sceneHasPhysics(sceneID)) {
     physicsManager_->setGravity(gravity);
@@ -1070,6 +1292,65 @@ bool Simulator::recomputeNavMesh(nav::PathFinder& pathfinder,
   return true;
 }
 
+bool Simulator::updateNavMeshObstacles(nav::PathFinder& pathfinder) {
+  if (!pathfinder.supportsObstacles()) {
+    LOG(ERROR) << "Simulator::updateNavMeshObstacles: the navmesh doesn't "
+                  "support obstacles, recompute it with a positive "
+                  "NavMeshSettings::tileSize";
+    return false;
+  }
+
+  // update nodes so SceneNode transforms are up-to-date
+  physicsManager_->updateNodes();
+
+  std::set<int> staticObjectIDs;
+  for (int objectID : physicsManager_->getExistingObjectIDs()) {
+    if (physicsManager_->getObjectMotionType(objectID) !=
+        physics::MotionType::STATIC) {
+      continue;
+    }
+    const scene::SceneNode& node =
+        physicsManager_->getObjectSceneNode(objectID);
+    const Magnum::Range3D& bb = node.getCumulativeBB();
+    const Magnum::Matrix4 transform = node.absoluteTransformationMatrix();
+    const Magnum::Matrix3x3 rotation = transform.rotation();
+
+    // obstacles are upright boxes
+    Magnum::Vector3 halfExtents = bb.size() / 2.0f;
+    float yRotation = 0.0f;
+    if (rotation[1][1] > 1.0f - 1e-4f) {
+      yRotation = std::atan2(rotation[2][0], rotation[0][0]);
+    } else {
+      halfExtents = geo::getTransformedBB(bb, transform).size() / 2.0f;
+    }
+
+    staticObjectIDs.insert(objectID);
+    if (!pathfinder.setObstacle(
+            objectID,
+            Magnum::EigenIntegration::cast<vec3f>(
+                transform.transformPoint(bb.center())),
+            Magnum::EigenIntegration::cast<vec3f>(halfExtents), yRotation)) {
+      return false;
+    }
+  }
+  for (int obstacleID : pathfinder.getObstacleIDs()) {
+    if (staticObjectIDs.count(obstacleID) == 0) {
+      pathfinder.removeObstacle(obstacleID);
+    }
+  }
+
+  if (!pathfinder.updateObstacles()) {
+    LOG(ERROR) << "Failed to update navmesh obstacles";
+    return false;
+  }
+
+  if (&pathfinder == pathfinder_.get() && isNavMeshVisualizationActive()) {
+    setNavMeshVisualization(false);
+    setNavMeshVisualization(true);
+  }
+  return true;
+}
+
 bool Simulator::setNavMeshVisualization(bool visualize) {
   if (renderer_)
     renderer_->acquireGlContext();
@@ -1182,6 +1463,66 @@ scene::SceneNode* Simulator::loadAndCreateRenderAssetInstance(
       assetInfo, creation, sceneManager_.get(), tempIDs);
 }
 
+bool Simulator::prefetchRenderAssetFile(const assets::AssetInfo& assetInfo) {
+  return resourceManager_->prefetchRenderAssetFile(assetInfo);
+}
+
+int Simulator::addKinematicObjectForRenderAsset(
+    const assets::RenderAssetInstanceCreationInfo& creation) {
+  if (!sceneHasPhysics(activeSceneID_)) {
+    return ID_UNDEFINED;
+  }
+  const std::string handle = getRenderAssetObjectTemplateHandle(creation);
+  if (handle.empty()) {
+    return ID_UNDEFINED;
+  }
+  const int objectID =
+      addObjectByHandle(handle, nullptr, creation.lightSetupKey);
+  if (objectID != ID_UNDEFINED) {
+    setObjectMotionType(physics::MotionType::KINEMATIC, objectID);
+  }
+  return objectID;
+}
+
+std::string Simulator::getRenderAssetObjectTemplateHandle(
+    const assets::RenderAssetInstanceCreationInfo& creation) {
+  const Magnum::Vector3 scale = creation.scale ? *creation.scale
+                                               : Magnum::Vector3{1.0f};
+  const std::string key = Cr::Utility::formatString(
+      "{}_replay_scale_{}_{}_{}", creation.filepath, scale.x(), scale.y(),
+      scale.z());
+  const auto it = renderAssetObjectTemplates_.find(key);
+  if (it != renderAssetObjectTemplates_.end()) {
+    return it->second;
+  }
+
+  // also cached if there's no template, so the search and warning happen
+  // once per render asset
+  std::string& handle = renderAssetObjectTemplates_[key];
+  auto objAttrMgr = getObjectAttributesManager();
+  for (const auto& candidate : objAttrMgr->getObjectHandlesBySubstring()) {
+    auto attributes = objAttrMgr->getObjectByHandle(candidate);
+    if (attributes->getRenderAssetHandle() != creation.filepath) {
+      continue;
+    }
+    if (attributes->getScale() == scale) {
+      handle = candidate;
+    } else {
+      auto scaled = objAttrMgr->getObjectCopyByHandle(candidate);
+      scaled->setScale(scale);
+      if (objAttrMgr->registerObject(scaled, key) != ID_UNDEFINED) {
+        handle = key;
+      }
+    }
+    break;
+  }
+  LOG_IF(WARNING, handle.empty())
+      << "Simulator::addKinematicObjectForRenderAsset : no object template "
+         "with render asset "
+      << creation.filepath << ", not adding an object for it.";
+  return handle;
+}
+
 #ifdef ESP_BUILD_WITH_VHACD
 std::string Simulator::convexHullDecomposition(
     const std::string& filename,
@@ -5,11 +5,14 @@
 #ifndef ESP_SIM_SIMULATOR_H_
 #define ESP_SIM_SIMULATOR_H_
 
+#include <Corrade/Containers/ArrayView.h>
 #include <Corrade/Utility/Assert.h>
 
+#include <map>
 #include <utility>
 #include "esp/agent/Agent.h"
 #include "esp/assets/ResourceManager.h"
+#include "esp/core/Snapshot.h"
 #include "esp/core/esp.h"
 #include "esp/core/random.h"
 #include "esp/gfx/RenderTarget.h"
@@ -44,6 +47,13 @@ class ReplayManager;
 
 namespace esp {
 namespace sim {
+
+//! Appends state to a snapshot. See @ref Simulator::addSnapshotParticipant.
+typedef std::function<void(core::SnapshotWriter&)> SnapshotSaveCallback;
+
+//! Reads back state written by a @ref SnapshotSaveCallback.
+typedef std::function<void(core::SnapshotReader&)> SnapshotRestoreCallback;
+
 class Simulator {
  public:
   explicit Simulator(
@@ -218,6 +228,28 @@ class Simulator {
                         const std::string& lightSetupKey = DEFAULT_LIGHTING_KEY,
                         int sceneID = 0);
 
+  /**
+   * @brief Replace the render asset of an object with that of another object
+   * template, keeping the object's ID and physical body. Much cheaper than
+   * removing and re-adding the object, e.g. to show a change of visual
+   * state. See @ref esp::physics::PhysicsManager::swapObjectRenderAsset.
+   * @param objectID The object ID and key identifying the object in @ref
+   * esp::physics::PhysicsManager::existingObjects_.
+   * @param objectLibHandle The handle of the template in @ref
+   * esp::metadata::managers::ObjectAttributesManager whose render asset to
+   * use.
+   * @param lightSetupKey The string key for the @ref gfx::LightSetup to be used
+   * by the new render asset.
+   * @param sceneID !! Not used currently !! Specifies which physical scene of
+   * the object.
+   * @return Whether the render asset was replaced.
+   */
+  bool swapObjectRenderAsset(
+      int objectID,
+      const std::string& objectLibHandle,
+      const std::string& lightSetupKey = DEFAULT_LIGHTING_KEY,
+      int sceneID = 0);
+
   /**
    * @brief Get a static view of a physics object's template when the object
    * was instanced.
@@ -396,6 +428,52 @@ class Simulator {
    */
   esp::core::RigidState getRigidState(int objectID, int sceneID = 0) const;
 
+  /**
+   * @brief Get the current 4x4 transformation matrices of many objects at
+   * once, avoiding the per-call overhead of @ref getTransformation. See @ref
+   * esp::physics::PhysicsManager::getTransformations.
+   * @param objectIDs The object IDs and keys identifying the objects in @ref
+   * esp::physics::PhysicsManager::existingObjects_.
+   * @param [out] transforms Receives the transform of each object, in the
+   * order of @p objectIDs. Must be the same size as @p objectIDs.
+   * @param sceneID !! Not used currently !! Specifies which physical scene of
+   * the objects.
+   */
+  void getTransformations(
+      Corrade::Containers::ArrayView<const int> objectIDs,
+      Corrade::Containers::ArrayView<Magnum::Matrix4> transforms,
+      int sceneID = 0) const;
+
+  /**
+   * @brief Get the current @ref esp::core::RigidState of many objects at once.
+   * See @ref getTransformations.
+   * @param objectIDs The object IDs and keys identifying the objects in @ref
+   * esp::physics::PhysicsManager::existingObjects_.
+   * @param [out] rigidStates Receives the state of each object, in the order
+   * of @p objectIDs. Must be the same size as @p objectIDs.
+   * @param sceneID !! Not used currently !! Specifies which physical scene of
+   * the objects.
+   */
+  void getRigidStates(
+      Corrade::Containers::ArrayView<const int> objectIDs,
+      Corrade::Containers::ArrayView<esp::core::RigidState> rigidStates,
+      int sceneID = 0) const;
+
+  /**
+   * @brief Set the @ref esp::core::RigidState of many objects kinematically at
+   * once. See @ref setRigidState and @ref getTransformations.
+   * @param objectIDs The object IDs and keys identifying the objects in @ref
+   * esp::physics::PhysicsManager::existingObjects_.
+   * @param rigidStates The desired state of each object, in the order of
+   * @p objectIDs. Must be the same size as @p objectIDs.
+   * @param sceneID !! Not used currently !! Specifies which physical scene of
+   * the objects.
+   */
+  void setRigidStates(
+      Corrade::Containers::ArrayView<const int> objectIDs,
+      Corrade::Containers::ArrayView<const esp::core::RigidState> rigidStates,
+      int sceneID = 0);
+
   /**
    * @brief Set the @ref esp::core::RigidState of an object kinematically.
    * @param transform The desired @ref esp::core::RigidState of the object.
@@ -1039,6 +1117,44 @@ class Simulator {
                                        float maxDistance = 100.0,
                                        int sceneID = 0);
 
+  /**
+   * @brief Add a box volume which reports rigid objects entering and leaving
+   * it. See @ref esp::physics::PhysicsManager::addTriggerVolume.
+   * @param localBox The box, in the local space of @p transform.
+   * @param transform The world transformation of the volume.
+   * @param callback Called from @ref stepWorld for each event of this
+   * volume. If empty, events are queued for @ref takeTriggerEvents instead.
+   * @param sceneID !! Not used currently !! Specifies which physical scene of
+   * the volume.
+   * @return The id of the new trigger volume, or @ref esp::ID_UNDEFINED if
+   * the scene has no physics.
+   */
+  int addTriggerVolume(const Magnum::Range3D& localBox,
+                       const Magnum::Matrix4& transform,
+                       esp::physics::TriggerCallback callback = nullptr,
+                       int sceneID = 0);
+
+  /**
+   * @brief Move a trigger volume. See @ref
+   * esp::physics::PhysicsManager::setTriggerVolumeTransformation.
+   */
+  void setTriggerVolumeTransformation(int triggerId,
+                                      const Magnum::Matrix4& transform,
+                                      int sceneID = 0);
+
+  /**
+   * @brief Remove a trigger volume. See @ref
+   * esp::physics::PhysicsManager::removeTriggerVolume.
+   */
+  void removeTriggerVolume(int triggerId, int sceneID = 0);
+
+  /**
+   * @brief Get and clear the queued enter/exit events of trigger volumes
+   * without a callback. See @ref
+   * esp::physics::PhysicsManager::takeTriggerEvents.
+   */
+  std::vector<esp::physics::TriggerEvent> takeTriggerEvents(int sceneID = 0);
+
   /**
    * @brief the physical world has a notion of time which passes during
    * animation/simulation/action/etc... Step the physical world forward in time
@@ -1061,6 +1177,37 @@ class Simulator {
    */
   double getWorldTime();
 
+  /**
+   * @brief Include state kept outside of the physics world, e.g. scripted
+   * entities, in @ref saveSnapshot and @ref restoreSnapshot. Replaces the
+   * participant registered under the same @p name, if any.
+   */
+  void addSnapshotParticipant(const std::string& name,
+                              SnapshotSaveCallback save,
+                              SnapshotRestoreCallback restore);
+
+  /**
+   * @brief Remove a snapshot participant.
+   * @return Whether a participant named @p name was registered.
+   */
+  bool removeSnapshotParticipant(const std::string& name);
+
+  /**
+   * @brief Overwrite @p buffer with a flat binary snapshot of the world: the
+   * physics state (see @ref esp::physics::PhysicsManager::writeSnapshot)
+   * followed by the state of each snapshot participant. Reusing the buffer
+   * across calls avoids reallocating it.
+   */
+  void saveSnapshot(std::vector<char>& buffer, int sceneID = 0);
+
+  /**
+   * @brief Restore a snapshot taken with @ref saveSnapshot, e.g. to branch an
+   * episode. The world must hold the same objects and the same snapshot
+   * participants as when the snapshot was taken; nothing is added or
+   * removed.
+   */
+  void restoreSnapshot(const std::vector<char>& buffer, int sceneID = 0);
+
   /**
    * @brief Set the gravity in a physical scene.
    */
@@ -1084,6 +1231,23 @@ class Simulator {
                         const nav::NavMeshSettings& navMeshSettings,
                         bool includeStaticObjects = false);
 
+  /**
+   * @brief Make the MotionType::STATIC rigid objects of the scene the
+   * obstacles of a navmesh and rebuild the tiles whose obstacles changed.
+   *
+   * Much faster than @ref recomputeNavMesh when objects are rearranged, e.g.
+   * each episode. The navmesh must be recomputed once with a positive
+   * @ref nav::NavMeshSettings::tileSize and without the static objects.
+   * Each object becomes the box of its bounding box, with the object's ID as
+   * obstacle ID; objects rotated other than around y use their world space
+   * bounding box. Obstacles of objects which aren't static anymore are
+   * removed.
+   *
+   * @param pathfinder The pathfinder whose navmesh is updated.
+   * @return Whether or not the navmesh update succeeded.
+   */
+  bool updateNavMeshObstacles(nav::PathFinder& pathfinder);
+
   /**
    * @brief Set visualization of the current NavMesh @ref pathfinder_ on or off.
    *
@@ -1353,6 +1517,27 @@ class Simulator {
       const assets::AssetInfo& assetInfo,
       const assets::RenderAssetInstanceCreationInfo& creation);
 
+  /**
+   * @brief Start reading the file of a render asset on a worker thread, so
+   * loading it later doesn't wait for disk I/O. See
+   * @ref assets::ResourceManager::prefetchRenderAssetFile.
+   * @param assetInfo the asset to prefetch
+   * @return Whether the asset can be loaded without waiting.
+   */
+  bool prefetchRenderAssetFile(const assets::AssetInfo& assetInfo);
+
+  /**
+   * @brief Add a kinematic physics object in place of a render asset
+   * instance, e.g. to drive it from a replay. The object is made from the
+   * first object template with the instance's render asset, scaled like the
+   * instance.
+   * @param creation how the instance was created
+   * @return The ID of the new object, or @ref esp::ID_UNDEFINED if there's
+   * no physics or no object template with the render asset.
+   */
+  int addKinematicObjectForRenderAsset(
+      const assets::RenderAssetInstanceCreationInfo& creation);
+
 #ifdef ESP_BUILD_WITH_VHACD
   /**
    * @brief Runs convex hull decomposition on a specified file. Creates an
@@ -1425,6 +1610,14 @@ class Simulator {
 
   void reconfigureReplayManager(bool enableGfxReplaySave);
 
+  /**
+   * @brief Find or register the object template for
+   * @ref addKinematicObjectForRenderAsset. Returns an empty string if there's
+   * none.
+   */
+  std::string getRenderAssetObjectTemplateHandle(
+      const assets::RenderAssetInstanceCreationInfo& creation);
+
   gfx::WindowlessContext::uptr context_ = nullptr;
   std::shared_ptr<gfx::Renderer> renderer_ = nullptr;
   // CANNOT make the specification of resourceManager_ above the context_!
@@ -1450,6 +1643,17 @@ class Simulator {
   std::shared_ptr<physics::PhysicsManager> physicsManager_ = nullptr;
 
   std::shared_ptr<esp::gfx::replay::ReplayManager> gfxReplayMgr_;
+  //! Object template handles by render asset and scale, see
+  //! @ref getRenderAssetObjectTemplateHandle
+  std::map<std::string, std::string> renderAssetObjectTemplates_;
+
+  struct SnapshotParticipant {
+    std::string name;
+    SnapshotSaveCallback save;
+    SnapshotRestoreCallback restore;
+  };
+  //! In registration order, which is also their order in a snapshot
+  std::vector<SnapshotParticipant> snapshotParticipants_;
 
   core::Random::ptr random_;
   SimulatorConfiguration config_;
@@ -4,7 +4,11 @@
 
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <vector>
+
 #include "esp/core/Configuration.h"
+#include "esp/core/TaskScheduler.h"
 #include "esp/core/esp.h"
 
 using namespace esp::core;
@@ -18,3 +22,41 @@ TEST(CoreTest, ConfigurationTest) {
   EXPECT_EQ(cfg.get<int>("myInt"), 10);
   EXPECT_EQ(cfg.get<std::string>("myString"), "test");
 }
+
+TEST(CoreTest, TaskSchedulerParallelFor) {
+  for (int numWorkers : {0, 1, 4}) {
+    TaskScheduler scheduler(numWorkers);
+    EXPECT_EQ(scheduler.getNumThreads(), numWorkers + 1);
+    std::vector<int> counts(10000, 0);
+    for (int rep = 0; rep < 10; ++rep) {
+      scheduler.parallelFor(
+          counts.size(),
+          [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+              ++counts[i];
+            }
+          },
+          16);
+    }
+    for (int count : counts) {
+      EXPECT_EQ(count, 10);
+    }
+  }
+}
+
+TEST(CoreTest, TaskSchedulerNestedGroups) {
+  TaskScheduler scheduler(3);
+  std::atomic<int> total{0};
+  TaskScheduler::TaskGroup group;
+  for (int i = 0; i < 8; ++i) {
+    // tasks that wait on nested work must not deadlock the pool
+    scheduler.submit(group, [&]() {
+      scheduler.parallelFor(100, [&](std::size_t begin, std::size_t end) {
+        total += static_cast<int>(end - begin);
+      });
+    });
+  }
+  scheduler.wait(group);
+  EXPECT_TRUE(group.isDone());
+  EXPECT_EQ(total.load(), 800);
+}
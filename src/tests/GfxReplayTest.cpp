@@ -8,20 +8,28 @@
 #include "esp/assets/ResourceManager.h"
 #include "esp/gfx/Renderer.h"
 #include "esp/gfx/WindowlessContext.h"
+#include "esp/gfx/replay/BinaryFormat.h"
 #include "esp/gfx/replay/Player.h"
 #include "esp/gfx/replay/Recorder.h"
+#include "esp/gfx/replay/ReplayFile.h"
 #include "esp/gfx/replay/ReplayManager.h"
 #include "esp/scene/SceneManager.h"
+#include "esp/sim/BatchReplayRenderer.h"
 #include "esp/sim/Simulator.h"
 
 #include <Corrade/Containers/Optional.h>
+#include <Corrade/Containers/StridedArrayView.h>
 #include <Corrade/Utility/Directory.h>
 #include <Magnum/EigenIntegration/Integration.h>
+#include <Magnum/ImageView.h>
+#include <Magnum/Math/Color.h>
 #include <Magnum/Math/Range.h>
 
 #include <gtest/gtest.h>
 #include <fstream>
+#include <map>
 #include <string>
+#include <thread>
 
 namespace Cr = Corrade;
 namespace Mn = Magnum;
@@ -122,6 +130,75 @@ TEST(GfxReplayTest, recorder) {
          Mn::Vector3(4.f, 5.f, 6.f));
 }
 
+// replace a recorded instance and verify it's saved as a render asset change
+TEST(GfxReplayTest, recorderRenderAssetChange) {
+  esp::gfx::WindowlessContext::uptr context_ =
+      esp::gfx::WindowlessContext::create_unique(0);
+
+  std::shared_ptr<esp::gfx::Renderer> renderer_ = esp::gfx::Renderer::create();
+
+  auto cfg = esp::sim::SimulatorConfiguration{};
+  auto MM = MetadataMediator::create(cfg);
+  // must declare these in this order due to avoid deallocation errors
+  ResourceManager resourceManager(MM);
+  SceneManager sceneManager_;
+  std::string boxFile =
+      Cr::Utility::Directory::join(TEST_ASSETS, "objects/transform_box.glb");
+  std::string sphereFile =
+      Cr::Utility::Directory::join(TEST_ASSETS, "objects/sphere.glb");
+
+  int sceneID = sceneManager_.initSceneGraph();
+  const esp::assets::AssetInfo boxInfo =
+      esp::assets::AssetInfo::fromPath(boxFile);
+  const esp::assets::AssetInfo sphereInfo =
+      esp::assets::AssetInfo::fromPath(sphereFile);
+
+  const std::string lightSetupKey = "";
+  esp::assets::RenderAssetInstanceCreationInfo::Flags flags;
+  flags |= esp::assets::RenderAssetInstanceCreationInfo::Flag::IsRGBD;
+  flags |= esp::assets::RenderAssetInstanceCreationInfo::Flag::IsSemantic;
+  esp::assets::RenderAssetInstanceCreationInfo boxCreation(
+      boxFile, Corrade::Containers::NullOpt, flags, lightSetupKey);
+  esp::assets::RenderAssetInstanceCreationInfo sphereCreation(
+      sphereFile, Corrade::Containers::NullOpt, flags, lightSetupKey);
+
+  std::vector<int> tempIDs{sceneID, esp::ID_UNDEFINED};
+  auto* boxNode = resourceManager.loadAndCreateRenderAssetInstance(
+      boxInfo, boxCreation, &sceneManager_, tempIDs);
+  auto* sphereNode = resourceManager.loadAndCreateRenderAssetInstance(
+      sphereInfo, sphereCreation, &sceneManager_, tempIDs);
+  ASSERT(boxNode);
+  ASSERT(sphereNode);
+
+  esp::gfx::replay::Recorder recorder;
+  recorder.onLoadRenderAsset(boxInfo);
+  recorder.onCreateRenderAssetInstance(boxNode, boxCreation);
+  recorder.saveKeyframe();
+  recorder.onLoadRenderAsset(sphereInfo);
+  recorder.onChangeRenderAssetInstance(boxNode, sphereNode, sphereCreation);
+  delete boxNode;
+  recorder.saveKeyframe();
+  delete sphereNode;
+  recorder.saveKeyframe();
+
+  const auto& keyframes = recorder.debugGetSavedKeyframes();
+  ASSERT_EQ(keyframes.size(), 3);
+  ASSERT_EQ(keyframes[0].creations.size(), 1);
+  esp::gfx::replay::RenderAssetInstanceKey instanceKey =
+      keyframes[0].creations[0].first;
+
+  // frame #1 changes the asset of the existing instance
+  EXPECT_EQ(keyframes[1].creations.size(), 0);
+  EXPECT_EQ(keyframes[1].deletions.size(), 0);
+  ASSERT_EQ(keyframes[1].renderAssetChanges.size(), 1);
+  EXPECT_EQ(keyframes[1].renderAssetChanges[0].first, instanceKey);
+  EXPECT_EQ(keyframes[1].renderAssetChanges[0].second.filepath, sphereFile);
+
+  // deleting the new node deletes the instance
+  ASSERT_EQ(keyframes[2].deletions.size(), 1);
+  EXPECT_EQ(keyframes[2].deletions[0], instanceKey);
+}
+
 // construct some render keyframes and play them using replay::Player
 TEST(GfxReplayTest, player) {
   esp::gfx::WindowlessContext::uptr context_ =
@@ -276,6 +353,109 @@ TEST(GfxReplayTest, player) {
   }
 }
 
+// prefetch render assets of upcoming keyframes through ResourceManager
+TEST(GfxReplayTest, playerPrefetch) {
+  esp::gfx::WindowlessContext::uptr context_ =
+      esp::gfx::WindowlessContext::create_unique(0);
+
+  std::shared_ptr<esp::gfx::Renderer> renderer_ = esp::gfx::Renderer::create();
+
+  auto cfg = esp::sim::SimulatorConfiguration{};
+  auto MM = MetadataMediator::create(cfg);
+  // must declare these in this order due to avoid deallocation errors
+  ResourceManager resourceManager(MM);
+  SceneManager sceneManager_;
+  std::string boxFile =
+      Cr::Utility::Directory::join(TEST_ASSETS, "objects/transform_box.glb");
+  std::string sphereFile =
+      Cr::Utility::Directory::join(TEST_ASSETS, "objects/sphere.glb");
+
+  int sceneID = sceneManager_.initSceneGraph();
+  auto& rootNode = sceneManager_.getSceneGraph(sceneID).getRootNode();
+  const int numberOfChildren = getNumberOfChildrenOfRoot(rootNode);
+
+  auto callback =
+      [&](const esp::assets::AssetInfo& assetInfo,
+          const esp::assets::RenderAssetInstanceCreationInfo& creation) {
+        std::vector<int> tempIDs{sceneID, esp::ID_UNDEFINED};
+        return resourceManager.loadAndCreateRenderAssetInstance(
+            assetInfo, creation, &sceneManager_, tempIDs);
+      };
+  esp::gfx::replay::Player player(callback);
+  player.setPrefetchCallback(
+      [&](const esp::assets::AssetInfo& assetInfo) {
+        return resourceManager.prefetchRenderAssetFile(assetInfo);
+      },
+      2);
+
+  esp::assets::RenderAssetInstanceCreationInfo::Flags flags;
+  flags |= esp::assets::RenderAssetInstanceCreationInfo::Flag::IsRGBD;
+  flags |= esp::assets::RenderAssetInstanceCreationInfo::Flag::IsSemantic;
+  const esp::assets::AssetInfo sphereInfo =
+      esp::assets::AssetInfo::fromPath(sphereFile);
+
+  std::vector<esp::gfx::replay::Keyframe> keyframes(3);
+  keyframes[0].loads = {esp::assets::AssetInfo::fromPath(boxFile)};
+  keyframes[0].creations = {
+      {0, {boxFile, Corrade::Containers::NullOpt, flags, ""}}};
+  keyframes[2].loads = {sphereInfo};
+  keyframes[2].creations = {
+      {1, {sphereFile, Corrade::Containers::NullOpt, flags, ""}}};
+  player.debugSetKeyframes(std::move(keyframes));
+
+  // keyframe 2 is within reach, so its asset starts loading
+  player.setKeyframeIndex(0);
+  EXPECT_EQ(player.getPrefetchStats().hits +
+                player.getPrefetchStats().misses,
+            1);
+  while (!resourceManager.prefetchRenderAssetFile(sphereInfo)) {
+    std::this_thread::yield();
+  }
+
+  const int hitsBefore = player.getPrefetchStats().hits;
+  player.setKeyframeIndex(2);
+  EXPECT_EQ(player.getPrefetchStats().hits, hitsBefore + 1);
+  EXPECT_EQ(getNumberOfChildrenOfRoot(rootNode), numberOfChildren + 2);
+}
+
+TEST(GfxReplayTest, playerPrefetchFromCheckpoint) {
+  auto dummyCallback =
+      [&](const esp::assets::AssetInfo& assetInfo,
+          const esp::assets::RenderAssetInstanceCreationInfo& creation) {
+        return nullptr;
+      };
+  esp::gfx::replay::Player player(dummyCallback);
+  std::vector<std::string> prefetched;
+  player.setPrefetchCallback(
+      [&](const esp::assets::AssetInfo& assetInfo) {
+        prefetched.push_back(assetInfo.filepath);
+        return false;
+      },
+      1);
+
+  std::vector<esp::gfx::replay::Keyframe> keyframes(6);
+  keyframes[1].loads = {esp::assets::AssetInfo::fromPath("a.glb")};
+  // left out of the checkpoint state, so only scanning the keyframes before
+  // the checkpoint would find it
+  keyframes[2].loads = {esp::assets::AssetInfo::fromPath("skipped.glb")};
+  keyframes[3].loads = {esp::assets::AssetInfo::fromPath("b.glb")};
+  keyframes[5].loads = {esp::assets::AssetInfo::fromPath("c.glb")};
+  esp::gfx::replay::Checkpoint checkpoint;
+  checkpoint.keyframeIndex = 3;
+  checkpoint.state.loads = {esp::assets::AssetInfo::fromPath("a.glb"),
+                            esp::assets::AssetInfo::fromPath("b.glb")};
+  player.debugSetKeyframes(std::move(keyframes));
+  player.debugSetCheckpoints({checkpoint});
+
+  player.prefetchAssets(4);
+  EXPECT_EQ(prefetched, (std::vector<std::string>{"a.glb", "b.glb", "c.glb"}));
+
+  // keyframes already scanned aren't scanned again
+  player.prefetchAssets(0);
+  player.prefetchAssets(5);
+  EXPECT_EQ(prefetched.size(), 3u);
+}
+
 TEST(GfxReplayTest, playerReadMissingFile) {
   auto dummyCallback =
       [&](const esp::assets::AssetInfo& assetInfo,
@@ -356,3 +536,681 @@ TEST(GfxReplayTest, simulatorIntegration) {
                  << testFilepath;
   }
 }
+
+// render views of a recorded replay, skipping a missing one
+TEST(GfxReplayTest, batchReplayRenderer) {
+  std::string boxFile =
+      Cr::Utility::Directory::join(TEST_ASSETS, "objects/transform_box.glb");
+  auto testFilepath = Corrade::Utility::Directory::join(
+      DATA_DIR, "./gfx_replay_test_batch.json");
+
+  {
+    SimulatorConfiguration simConfig{};
+    simConfig.activeSceneName = boxFile;
+    simConfig.enableGfxReplaySave = true;
+    auto sim = Simulator::create_unique(simConfig);
+    const auto recorder = sim->getGfxReplayManager()->getRecorder();
+    recorder->saveKeyframe();
+    recorder->writeSavedKeyframesToFile(testFilepath);
+  }
+
+  esp::sim::BatchReplayRendererConfiguration config;
+  config.resolution = {32, 32};
+  esp::sim::BatchReplayRenderer renderer{config};
+
+  esp::sim::BatchReplayView view;
+  view.translation = Mn::Vector3(0.0f, 0.0f, 3.0f);
+  std::vector<esp::sim::BatchReplayJob> jobs(2);
+  jobs[0].filepath = Corrade::Utility::Directory::join(
+      DATA_DIR, "./gfx_replay_test_missing.json");
+  jobs[0].views = {view};
+  jobs[1].filepath = testFilepath;
+  jobs[1].views = {view, view};
+
+  int numObservations = 0;
+  renderer.render(jobs, [&](int jobIndex, int viewIndex,
+                            const Mn::ImageView2D& rgba) {
+    EXPECT_EQ(jobIndex, 1);
+    EXPECT_EQ(viewIndex, numObservations);
+    EXPECT_EQ(rgba.size(), config.resolution);
+    // the box is in the center of the view
+    EXPECT_NE(rgba.pixels<Mn::Color4ub>()[16][16], Mn::Color4ub(0, 0, 0, 255));
+    ++numObservations;
+  });
+  EXPECT_EQ(numObservations, 2);
+
+  // the replay's instances are removed, its assets stay loaded
+  renderer.render({jobs[1]}, [&](int, int, const Mn::ImageView2D&) {
+    ++numObservations;
+  });
+  EXPECT_EQ(numObservations, 4);
+
+  Corrade::Utility::Directory::rm(testFilepath);
+}
+
+// encode keyframes in the binary format and verify they decode to the same
+// keyframes, up to quantization
+TEST(GfxReplayTest, binaryFormat) {
+  using esp::gfx::replay::Keyframe;
+  using esp::gfx::replay::RenderAssetInstanceState;
+
+  std::string boxFile =
+      Cr::Utility::Directory::join(TEST_ASSETS, "objects/transform_box.glb");
+  std::string sphereFile =
+      Cr::Utility::Directory::join(TEST_ASSETS, "objects/sphere.glb");
+  const esp::assets::AssetInfo boxInfo =
+      esp::assets::AssetInfo::fromPath(boxFile);
+
+  esp::assets::RenderAssetInstanceCreationInfo::Flags flags;
+  flags |= esp::assets::RenderAssetInstanceCreationInfo::Flag::IsRGBD;
+  esp::assets::RenderAssetInstanceCreationInfo boxCreation(
+      boxFile, Mn::Vector3(1.f, 2.f, 0.5f), flags, "");
+  esp::assets::RenderAssetInstanceCreationInfo sphereCreation(
+      sphereFile, Corrade::Containers::NullOpt, flags, "my_lights");
+
+  const Mn::Quaternion rotation =
+      Mn::Quaternion::rotation(Mn::Deg(30.f), Mn::Vector3::yAxis()) *
+      Mn::Quaternion::rotation(Mn::Deg(-75.f), Mn::Vector3::xAxis());
+  const RenderAssetInstanceState state0{
+      {Mn::Vector3(1.f, 2.f, 3.f), Mn::Quaternion(Mn::Math::IdentityInit)},
+      esp::ID_UNDEFINED};
+  const RenderAssetInstanceState state1{
+      {Mn::Vector3(-1.5f, 2.f, 30.25f), rotation}, 4};
+
+  std::vector<Keyframe> keyframes(4);
+  keyframes[0].loads = {boxInfo};
+  keyframes[0].creations = {{0, boxCreation}, {1, boxCreation}};
+  keyframes[0].stateUpdates = {{0, state0}, {1, state0}};
+  keyframes[1].stateUpdates = {{1, state1}};
+  keyframes[1].userTransforms["camera"] = {Mn::Vector3(4.f, 5.f, 6.f),
+                                           rotation};
+  keyframes[2].renderAssetChanges = {{0, sphereCreation}};
+  keyframes[2].creations = {{2, boxCreation}};
+  keyframes[2].stateUpdates = {{2, state1}, {1, state0}};
+  keyframes[3].deletions = {0, 2};
+
+  std::vector<char> buffer;
+  // small chunks, so the instance state is carried across chunks
+  esp::gfx::replay::writeKeyframesToBinary(keyframes, buffer, 3);
+  ASSERT_TRUE(esp::gfx::replay::isBinaryReplay(buffer.data(), buffer.size()));
+  const auto maybeDecoded =
+      esp::gfx::replay::readKeyframesFromBinary(buffer.data(), buffer.size());
+  ASSERT_TRUE(maybeDecoded);
+  const auto& decoded = *maybeDecoded;
+
+  ASSERT_EQ(decoded.size(), keyframes.size());
+  for (std::size_t i = 0; i < keyframes.size(); ++i) {
+    const auto& expected = keyframes[i];
+    const auto& actual = decoded[i];
+    ASSERT_EQ(actual.loads.size(), expected.loads.size());
+    for (std::size_t j = 0; j < expected.loads.size(); ++j) {
+      EXPECT_EQ(actual.loads[j], expected.loads[j]);
+    }
+    ASSERT_EQ(actual.creations.size(), expected.creations.size());
+    for (std::size_t j = 0; j < expected.creations.size(); ++j) {
+      const auto& expectedCreation = expected.creations[j].second;
+      const auto& actualCreation = actual.creations[j].second;
+      EXPECT_EQ(actual.creations[j].first, expected.creations[j].first);
+      EXPECT_EQ(actualCreation.filepath, expectedCreation.filepath);
+      ASSERT_EQ(bool(actualCreation.scale), bool(expectedCreation.scale));
+      if (expectedCreation.scale) {
+        EXPECT_EQ(*actualCreation.scale, *expectedCreation.scale);
+      }
+      EXPECT_EQ(actualCreation.flags, expectedCreation.flags);
+      EXPECT_EQ(actualCreation.lightSetupKey, expectedCreation.lightSetupKey);
+    }
+    ASSERT_EQ(actual.renderAssetChanges.size(),
+              expected.renderAssetChanges.size());
+    for (std::size_t j = 0; j < expected.renderAssetChanges.size(); ++j) {
+      EXPECT_EQ(actual.renderAssetChanges[j].first,
+                expected.renderAssetChanges[j].first);
+      EXPECT_EQ(actual.renderAssetChanges[j].second.lightSetupKey,
+                expected.renderAssetChanges[j].second.lightSetupKey);
+    }
+    EXPECT_EQ(actual.deletions, expected.deletions);
+    ASSERT_EQ(actual.stateUpdates.size(), expected.stateUpdates.size());
+    for (std::size_t j = 0; j < expected.stateUpdates.size(); ++j) {
+      const auto& expectedState = expected.stateUpdates[j].second;
+      const auto& actualState = actual.stateUpdates[j].second;
+      EXPECT_EQ(actual.stateUpdates[j].first, expected.stateUpdates[j].first);
+      EXPECT_LT((actualState.absTransform.translation -
+                 expectedState.absTransform.translation)
+                    .length(),
+                1.0e-3f);
+      // q and -q are the same rotation
+      EXPECT_GT(std::abs(Mn::Math::dot(actualState.absTransform.rotation,
+                                       expectedState.absTransform.rotation)),
+                0.9999f);
+      EXPECT_EQ(actualState.semanticId, expectedState.semanticId);
+    }
+    ASSERT_EQ(actual.userTransforms.size(), expected.userTransforms.size());
+    for (const auto& pair : expected.userTransforms) {
+      ASSERT_TRUE(actual.userTransforms.count(pair.first));
+      EXPECT_TRUE(actual.userTransforms.at(pair.first) == pair.second);
+    }
+  }
+}
+
+// verify malformed binary replays are reported as errors instead of aborting,
+// so tools can skip them
+TEST(GfxReplayTest, binaryFormatMalformed) {
+  using esp::gfx::replay::Keyframe;
+
+  esp::assets::RenderAssetInstanceCreationInfo creation(
+      "my_asset.glb", Mn::Vector3(1.f, 2.f, 0.5f), {}, "my_lights");
+  std::vector<Keyframe> keyframes(3);
+  keyframes[0].creations = {{0, creation}};
+  for (int i = 0; i < 3; ++i) {
+    keyframes[i].stateUpdates = {
+        {0, {{Mn::Vector3(float(i)), Mn::Quaternion{}}, i}}};
+  }
+  keyframes[2].deletions = {0};
+
+  std::vector<char> buffer;
+  esp::gfx::replay::writeKeyframesToBinary(keyframes, buffer, 2);
+  ASSERT_TRUE(
+      esp::gfx::replay::readKeyframesFromBinary(buffer.data(), buffer.size()));
+
+  // header cut short
+  EXPECT_FALSE(esp::gfx::replay::readKeyframesFromBinary(buffer.data(), 6));
+
+  // unknown type of the first chunk, right after the 12-byte header
+  std::vector<char> corrupt = buffer;
+  corrupt[12] = char(0x7f);
+  EXPECT_FALSE(esp::gfx::replay::readKeyframesFromBinary(corrupt.data(),
+                                                         corrupt.size()));
+
+  // any corrupt byte either still decodes or fails, but never aborts
+  for (std::size_t i = 0; i < buffer.size(); ++i) {
+    for (const char value : {char(0x00), char(0x80), char(0xff)}) {
+      corrupt = buffer;
+      corrupt[i] = value;
+      esp::gfx::replay::readKeyframesFromBinary(corrupt.data(),
+                                                corrupt.size());
+    }
+  }
+
+  // a corrupt file is skipped, see replaytool
+  auto testFilepath = Corrade::Utility::Directory::join(
+      DATA_DIR, "./gfx_replay_malformed_test.bin");
+  corrupt = buffer;
+  corrupt[12] = char(0x7f);
+  ASSERT_TRUE(Corrade::Utility::Directory::write(
+      testFilepath,
+      Corrade::Containers::arrayView(corrupt.data(), corrupt.size())));
+  std::vector<Keyframe> readKeyframes;
+  EXPECT_FALSE(
+      esp::gfx::replay::readKeyframesFromFile(testFilepath, readKeyframes));
+
+  bool success = Corrade::Utility::Directory::rm(testFilepath);
+  if (!success) {
+    LOG(WARNING) << "GfxReplayTest::binaryFormatMalformed : unable to remove "
+                    "temporary test file "
+                 << testFilepath;
+  }
+}
+
+// stream keyframes to a binary file and verify the file can be read up to the
+// last complete chunk
+TEST(GfxReplayTest, recorderStreaming) {
+  auto testFilepath = Corrade::Utility::Directory::join(
+      DATA_DIR, "./gfx_replay_stream_test.bin");
+
+  esp::scene::SceneGraph sceneGraph;
+  auto& node = sceneGraph.getRootNode().createChild();
+  esp::assets::RenderAssetInstanceCreationInfo creation(
+      "my_asset.glb", Corrade::Containers::NullOpt, {}, "");
+
+  constexpr int numKeyframes = 5;
+  {
+    esp::gfx::replay::Recorder recorder;
+    recorder.onCreateRenderAssetInstance(&node, creation);
+    recorder.saveKeyframe();
+    recorder.startStreamingToFile(testFilepath, 2);
+    EXPECT_TRUE(recorder.isStreaming());
+    for (int i = 1; i < numKeyframes; ++i) {
+      node.setTranslation(Mn::Vector3(float(i), 0.f, 0.f));
+      recorder.saveKeyframe();
+    }
+    // streamed keyframes don't stay in memory
+    EXPECT_EQ(recorder.debugGetSavedKeyframes().size(), 1);
+    recorder.stopStreaming();
+    EXPECT_FALSE(recorder.isStreaming());
+    EXPECT_EQ(recorder.debugGetSavedKeyframes().size(), 0);
+  }
+
+  const auto data = Corrade::Utility::Directory::read(testFilepath);
+  auto keyframes =
+      esp::gfx::replay::readKeyframesFromBinary(data.data(), data.size());
+  ASSERT_TRUE(keyframes);
+  ASSERT_EQ(keyframes->size(), numKeyframes);
+  ASSERT_EQ((*keyframes)[0].creations.size(), 1);
+  for (int i = 1; i < numKeyframes; ++i) {
+    ASSERT_EQ((*keyframes)[i].stateUpdates.size(), 1);
+    EXPECT_EQ((*keyframes)[i].stateUpdates[0].second.absTransform.translation,
+              Mn::Vector3(float(i), 0.f, 0.f));
+  }
+
+  // the index is written when streaming stops
+  std::vector<esp::gfx::replay::ChunkIndexEntry> index;
+  ASSERT_TRUE(esp::gfx::replay::KeyframeDecoder::readIndex(
+      data.data(), data.size(), index));
+  ASSERT_EQ(index.size(), 3);
+
+  // a file cut off in the last chunk, as if the recording were still in
+  // progress, reads up to the previous chunk
+  keyframes = esp::gfx::replay::readKeyframesFromBinary(
+      data.data(), index.back().offset + 1);
+  ASSERT_TRUE(keyframes);
+  EXPECT_EQ(keyframes->size(), 4);
+  EXPECT_FALSE(esp::gfx::replay::KeyframeDecoder::readIndex(
+      data.data(), index.back().offset + 1, index));
+
+  bool success = Corrade::Utility::Directory::rm(testFilepath);
+  if (!success) {
+    LOG(WARNING) << "GfxReplayTest::recorderStreaming : unable to remove "
+                    "temporary test file "
+                 << testFilepath;
+  }
+}
+
+// record keyframes with checkpoints and verify a binary replay can be decoded
+// starting at a checkpoint found through the index
+TEST(GfxReplayTest, recorderCheckpoints) {
+  using esp::gfx::replay::ChunkIndexEntry;
+  using esp::gfx::replay::ChunkType;
+  using esp::gfx::replay::Keyframe;
+
+  esp::scene::SceneGraph sceneGraph;
+  auto& node0 = sceneGraph.getRootNode().createChild();
+  auto& node1 = sceneGraph.getRootNode().createChild();
+  esp::assets::RenderAssetInstanceCreationInfo creation(
+      "my_asset.glb", Corrade::Containers::NullOpt, {}, "");
+
+  esp::gfx::replay::Recorder recorder;
+  recorder.setCheckpointInterval(2);
+  recorder.onCreateRenderAssetInstance(&node0, creation);
+  recorder.onCreateRenderAssetInstance(&node1, creation);
+  constexpr int numKeyframes = 6;
+  for (int i = 0; i < numKeyframes; ++i) {
+    // only node0 moves, but checkpoints include both instances
+    node0.setTranslation(Mn::Vector3(float(i), 0.f, 0.f));
+    recorder.addUserTransformToKeyframe("camera", Mn::Vector3(float(i)),
+                                        Mn::Quaternion{});
+    recorder.saveKeyframe();
+  }
+
+  const auto& checkpoints = recorder.debugGetSavedCheckpoints();
+  ASSERT_EQ(checkpoints.size(), 2);
+  EXPECT_EQ(checkpoints[0].keyframeIndex, 2);
+  EXPECT_EQ(checkpoints[1].keyframeIndex, 4);
+  EXPECT_EQ(checkpoints[1].state.creations.size(), 2);
+  ASSERT_EQ(checkpoints[1].state.stateUpdates.size(), 2);
+  EXPECT_EQ(checkpoints[1].state.userTransforms.at("camera").translation,
+            Mn::Vector3(4.f));
+
+  std::vector<char> buffer;
+  esp::gfx::replay::writeKeyframesToBinary(
+      recorder.debugGetSavedKeyframes(), buffer,
+      esp::gfx::replay::DefaultKeyframesPerChunk, checkpoints);
+
+  // all keyframes and checkpoints decode from the start
+  std::vector<esp::gfx::replay::Checkpoint> decodedCheckpoints;
+  const auto keyframes = esp::gfx::replay::readKeyframesFromBinary(
+      buffer.data(), buffer.size(), &decodedCheckpoints);
+  ASSERT_TRUE(keyframes);
+  ASSERT_EQ(keyframes->size(), numKeyframes);
+  ASSERT_EQ(decodedCheckpoints.size(), 2);
+  EXPECT_EQ(decodedCheckpoints[1].keyframeIndex, 4);
+  EXPECT_EQ(decodedCheckpoints[1].state.stateUpdates.size(), 2);
+
+  // chunks end at checkpoints
+  std::vector<ChunkIndexEntry> index;
+  ASSERT_TRUE(esp::gfx::replay::KeyframeDecoder::readIndex(
+      buffer.data(), buffer.size(), index));
+  ASSERT_EQ(index.size(), 5);
+  EXPECT_EQ(index[0].type, ChunkType::Keyframes);
+  EXPECT_EQ(index[0].numKeyframes, 3);
+  EXPECT_EQ(index[3].type, ChunkType::Checkpoint);
+  EXPECT_EQ(index[3].keyframeIndex, 4);
+  EXPECT_EQ(index[4].keyframeIndex, 5);
+
+  // decode starting at the second checkpoint
+  esp::core::SnapshotReader headerReader{buffer.data(), buffer.size()};
+  esp::gfx::replay::KeyframeDecoder decoder;
+  decoder.readHeader(headerReader);
+  esp::core::SnapshotReader reader{buffer.data() + index[3].offset,
+                                   buffer.size() - index[3].offset};
+  std::vector<Keyframe> seekKeyframes;
+  decodedCheckpoints.clear();
+  decoder.readChunk(reader, seekKeyframes, &decodedCheckpoints);
+  decoder.readChunk(reader, seekKeyframes, &decodedCheckpoints);
+  ASSERT_EQ(decodedCheckpoints.size(), 1);
+  ASSERT_EQ(seekKeyframes.size(), 1);
+  ASSERT_EQ(seekKeyframes[0].stateUpdates.size(), 1);
+  EXPECT_LT((seekKeyframes[0].stateUpdates[0].second.absTransform.translation -
+             Mn::Vector3(5.f, 0.f, 0.f))
+                .length(),
+            1.0e-3f);
+}
+
+// play back a binary replay with checkpoints, which is decoded lazily, and
+// verify seeking in any order gives the recorded state
+TEST(GfxReplayTest, playerLazyBinary) {
+  auto testFilepath = Corrade::Utility::Directory::join(
+      DATA_DIR, "./gfx_replay_lazy_test.bin");
+
+  esp::scene::SceneGraph sceneGraph;
+  auto& rootNode = sceneGraph.getRootNode();
+  constexpr int numKeyframes = 6;
+  {
+    auto& node0 = rootNode.createChild();
+    auto& node1 = rootNode.createChild();
+    esp::assets::RenderAssetInstanceCreationInfo creation(
+        "my_asset.glb", Corrade::Containers::NullOpt, {}, "");
+    esp::gfx::replay::Recorder recorder;
+    recorder.setCheckpointInterval(2);
+    recorder.onCreateRenderAssetInstance(&node0, creation);
+    recorder.onCreateRenderAssetInstance(&node1, creation);
+    for (int i = 0; i < numKeyframes; ++i) {
+      node0.setTranslation(Mn::Vector3(float(i), 0.f, 0.f));
+      recorder.addUserTransformToKeyframe("camera", Mn::Vector3(float(i)),
+                                          Mn::Quaternion{});
+      recorder.saveKeyframe();
+    }
+    std::vector<char> buffer;
+    esp::gfx::replay::writeKeyframesToBinary(
+        recorder.debugGetSavedKeyframes(), buffer, 2,
+        recorder.debugGetSavedCheckpoints());
+    std::ofstream file(testFilepath, std::ios::binary);
+    file.write(buffer.data(), buffer.size());
+    delete &node0;
+    delete &node1;
+  }
+
+  // instances are plain nodes, no render assets are needed
+  esp::gfx::replay::Player player(
+      [&](const esp::assets::AssetInfo&,
+          const esp::assets::RenderAssetInstanceCreationInfo&) {
+        return &rootNode.createChild();
+      });
+  player.readKeyframesFromFile(testFilepath);
+  ASSERT_EQ(player.getNumKeyframes(), numKeyframes);
+
+  for (const int frameIndex : {5, 1, 3, 0, 5, 2, 4, 4}) {
+    player.setKeyframeIndex(frameIndex);
+    EXPECT_EQ(getNumberOfChildrenOfRoot(rootNode), 2);
+    bool foundMovingNode = false;
+    for (const auto& child : rootNode.children()) {
+      const auto& node = static_cast<const esp::scene::SceneNode&>(child);
+      foundMovingNode |=
+          (node.translation() - Mn::Vector3(float(frameIndex), 0.f, 0.f))
+              .length() < 1.0e-3f;
+    }
+    EXPECT_TRUE(foundMovingNode);
+    Mn::Vector3 translation;
+    Mn::Quaternion rotation;
+    ASSERT_TRUE(player.getUserTransform("camera", &translation, &rotation));
+    EXPECT_EQ(translation, Mn::Vector3(float(frameIndex)));
+  }
+
+  player.close();
+  EXPECT_EQ(player.getNumKeyframes(), 0);
+  EXPECT_EQ(getNumberOfChildrenOfRoot(rootNode), 0);
+  Corrade::Utility::Directory::rm(testFilepath);
+}
+
+// set fractional keyframe times and verify instances and user transforms are
+// interpolated, and restored when a keyframe is set again
+TEST(GfxReplayTest, playerInterpolation) {
+  using esp::gfx::replay::Keyframe;
+
+  esp::scene::SceneGraph sceneGraph;
+  auto& rootNode = sceneGraph.getRootNode();
+  esp::gfx::replay::Player player(
+      [&](const esp::assets::AssetInfo&,
+          const esp::assets::RenderAssetInstanceCreationInfo&) {
+        return &rootNode.createChild();
+      });
+
+  const esp::assets::RenderAssetInstanceCreationInfo creation(
+      "my_asset.glb", Corrade::Containers::NullOpt, {}, "");
+  const Mn::Quaternion rotation =
+      Mn::Quaternion::rotation(Mn::Deg(90.f), Mn::Vector3::yAxis());
+  std::vector<Keyframe> keyframes(3);
+  keyframes[0].loads = {esp::assets::AssetInfo::fromPath("my_asset.glb")};
+  keyframes[0].creations = {{0, creation}};
+  keyframes[0].stateUpdates = {{0, {{Mn::Vector3(0.f), {}}, 0}}};
+  keyframes[0].userTransforms["camera"] = {Mn::Vector3(0.f), {}};
+  keyframes[1].stateUpdates = {{0, {{Mn::Vector3(2.f), rotation}, 0}}};
+  keyframes[1].userTransforms["camera"] = {Mn::Vector3(4.f), {}};
+  // the instance doesn't move after keyframe 1, a new one is created
+  keyframes[2].creations = {{1, creation}};
+  keyframes[2].stateUpdates = {{1, {{Mn::Vector3(8.f), {}}, 0}}};
+  player.debugSetKeyframes(std::move(keyframes));
+
+  player.setKeyframeTime(0.5f);
+  ASSERT_EQ(getNumberOfChildrenOfRoot(rootNode), 1);
+  auto* node = static_cast<esp::scene::SceneNode*>(rootNode.children().first());
+  EXPECT_EQ(node->translation(), Mn::Vector3(1.f));
+  EXPECT_EQ(node->rotation(),
+            Mn::Quaternion::rotation(Mn::Deg(45.f), Mn::Vector3::yAxis()));
+  Mn::Vector3 translation;
+  Mn::Quaternion userRotation;
+  ASSERT_TRUE(player.getUserTransform("camera", &translation, &userRotation));
+  EXPECT_EQ(translation, Mn::Vector3(2.f));
+
+  // setting the keyframe again undoes the interpolation
+  player.setKeyframeIndex(0);
+  EXPECT_EQ(node->translation(), Mn::Vector3(0.f));
+  ASSERT_TRUE(player.getUserTransform("camera", &translation, &userRotation));
+  EXPECT_EQ(translation, Mn::Vector3(0.f));
+
+  player.setKeyframeTime(1.25f);
+  EXPECT_EQ(getNumberOfChildrenOfRoot(rootNode), 1);
+  EXPECT_EQ(node->translation(), Mn::Vector3(2.f));
+  ASSERT_TRUE(player.getUserTransform("camera", &translation, &userRotation));
+  EXPECT_EQ(translation, Mn::Vector3(4.f));
+
+  player.setKeyframeTime(2.0f);
+  EXPECT_EQ(player.getKeyframeIndex(), 2);
+  EXPECT_EQ(getNumberOfChildrenOfRoot(rootNode), 2);
+}
+
+// drive physics objects from keyframes, with one bulk state update per
+// keyframe set
+TEST(GfxReplayTest, playerDrivesPhysics) {
+  using esp::gfx::replay::Keyframe;
+
+  esp::gfx::replay::Player player(
+      esp::gfx::replay::Player::LoadAndCreateRenderAssetInstanceCallback{});
+  std::map<int, esp::core::RigidState> objects;
+  int nextObjectID = 10;
+  int numSetRigidStatesCalls = 0;
+  esp::gfx::replay::Player::PhysicsCallbacks callbacks;
+  callbacks.createObject =
+      [&](const esp::assets::AssetInfo&,
+          const esp::assets::RenderAssetInstanceCreationInfo& creation) {
+        if (creation.filepath != "my_asset.glb") {
+          return esp::ID_UNDEFINED;
+        }
+        objects[nextObjectID] = {};
+        return nextObjectID++;
+      };
+  callbacks.removeObject = [&](int objectID) {
+    EXPECT_EQ(objects.erase(objectID), 1);
+  };
+  callbacks.setRigidStates =
+      [&](Corrade::Containers::ArrayView<const int> objectIDs,
+          Corrade::Containers::ArrayView<const esp::core::RigidState> states) {
+        ASSERT_EQ(objectIDs.size(), states.size());
+        for (std::size_t i = 0; i < objectIDs.size(); ++i) {
+          ASSERT_EQ(objects.count(objectIDs[i]), 1);
+          objects[objectIDs[i]] = states[i];
+        }
+        ++numSetRigidStatesCalls;
+      };
+  player.setPhysicsCallbacks(callbacks);
+
+  const esp::assets::RenderAssetInstanceCreationInfo creation(
+      "my_asset.glb", Corrade::Containers::NullOpt, {}, "");
+  const esp::assets::RenderAssetInstanceCreationInfo stageCreation(
+      "my_stage.glb", Corrade::Containers::NullOpt, {}, "");
+  std::vector<Keyframe> keyframes(4);
+  keyframes[0].loads = {esp::assets::AssetInfo::fromPath("my_asset.glb"),
+                        esp::assets::AssetInfo::fromPath("my_stage.glb")};
+  keyframes[0].creations = {{0, creation}, {1, creation}, {2, stageCreation}};
+  keyframes[0].stateUpdates = {{0, {{Mn::Vector3(0.f), {}}, 0}},
+                               {1, {{Mn::Vector3(5.f), {}}, 0}},
+                               {2, {{Mn::Vector3(0.f), {}}, 0}}};
+  keyframes[1].stateUpdates = {{0, {{Mn::Vector3(2.f), {}}, 0}}};
+  keyframes[2].stateUpdates = {{0, {{Mn::Vector3(4.f), {}}, 0}}};
+  keyframes[3].deletions = {1};
+  player.debugSetKeyframes(std::move(keyframes));
+
+  // instances without an object, like the stage, are skipped
+  player.setKeyframeIndex(0);
+  EXPECT_EQ(player.getPhysicsObjectIDs(), (std::vector<int>{10, 11}));
+  EXPECT_EQ(numSetRigidStatesCalls, 1);
+  EXPECT_EQ(objects[10].translation, Mn::Vector3(0.f));
+  EXPECT_EQ(objects[11].translation, Mn::Vector3(5.f));
+
+  player.setKeyframeTime(0.5f);
+  EXPECT_EQ(numSetRigidStatesCalls, 2);
+  EXPECT_EQ(objects[10].translation, Mn::Vector3(1.f));
+  EXPECT_EQ(objects[11].translation, Mn::Vector3(5.f));
+  // setting the keyframe again undoes the interpolation
+  player.setKeyframeIndex(0);
+  EXPECT_EQ(numSetRigidStatesCalls, 3);
+  EXPECT_EQ(objects[10].translation, Mn::Vector3(0.f));
+
+  // seeking over several keyframes sets the final states once
+  player.setKeyframeIndex(2);
+  EXPECT_EQ(numSetRigidStatesCalls, 4);
+  EXPECT_EQ(objects[10].translation, Mn::Vector3(4.f));
+
+  player.setKeyframeIndex(3);
+  EXPECT_EQ(player.getPhysicsObjectIDs(), (std::vector<int>{10}));
+  EXPECT_EQ(objects.size(), 1);
+
+  player.close();
+  EXPECT_TRUE(objects.empty());
+}
+
+// detach a player from its physics objects, as when the simulator owning
+// them goes away, and verify the callbacks aren't called anymore
+TEST(GfxReplayTest, playerDetachPhysics) {
+  using esp::gfx::replay::Keyframe;
+
+  esp::gfx::replay::Player player(
+      esp::gfx::replay::Player::LoadAndCreateRenderAssetInstanceCallback{});
+  int numCalls = 0;
+  esp::gfx::replay::Player::PhysicsCallbacks callbacks;
+  callbacks.createObject =
+      [&](const esp::assets::AssetInfo&,
+          const esp::assets::RenderAssetInstanceCreationInfo&) {
+        ++numCalls;
+        return 10;
+      };
+  callbacks.removeObject = [&](int) { ++numCalls; };
+  callbacks.setRigidStates =
+      [&](Corrade::Containers::ArrayView<const int>,
+          Corrade::Containers::ArrayView<const esp::core::RigidState>) {
+        ++numCalls;
+      };
+  player.setPhysicsCallbacks(callbacks);
+
+  const esp::assets::RenderAssetInstanceCreationInfo creation(
+      "my_asset.glb", Corrade::Containers::NullOpt, {}, "");
+  std::vector<Keyframe> keyframes(3);
+  keyframes[0].loads = {esp::assets::AssetInfo::fromPath("my_asset.glb")};
+  keyframes[0].creations = {{0, creation}};
+  keyframes[0].stateUpdates = {{0, {{Mn::Vector3(0.f), {}}, 0}}};
+  keyframes[1].stateUpdates = {{0, {{Mn::Vector3(2.f), {}}, 0}}};
+  keyframes[1].creations = {{1, creation}};
+  keyframes[2].deletions = {0};
+  player.debugSetKeyframes(std::move(keyframes));
+
+  player.setKeyframeIndex(0);
+  EXPECT_EQ(numCalls, 2);
+
+  player.detachPhysics();
+  EXPECT_TRUE(player.getPhysicsObjectIDs().empty());
+  player.setKeyframeTime(0.5f);
+  player.setKeyframeIndex(2);
+  player.close();
+  EXPECT_EQ(numCalls, 2);
+}
+
+// drop redundant entries of recorded keyframes and cut out a range of them,
+// verifying playback reaches the same state
+TEST(GfxReplayTest, compactAndSliceKeyframes) {
+  using esp::gfx::replay::Checkpoint;
+  using esp::gfx::replay::Keyframe;
+
+  esp::scene::SceneGraph sceneGraph;
+  auto& node0 = sceneGraph.getRootNode().createChild();
+  auto& node1 = sceneGraph.getRootNode().createChild();
+  esp::assets::RenderAssetInstanceCreationInfo creation(
+      "my_asset.glb", Corrade::Containers::NullOpt, {}, "");
+
+  esp::gfx::replay::Recorder recorder;
+  recorder.setCheckpointInterval(3);
+  recorder.onCreateRenderAssetInstance(&node0, creation);
+  recorder.onCreateRenderAssetInstance(&node1, creation);
+  constexpr int numKeyframes = 8;
+  for (int i = 0; i < numKeyframes; ++i) {
+    node0.setTranslation(Mn::Vector3(float(i), 0.f, 0.f));
+    recorder.saveKeyframe();
+  }
+  std::vector<Keyframe> keyframes = recorder.debugGetSavedKeyframes();
+  const std::vector<Checkpoint> checkpoints =
+      recorder.debugGetSavedCheckpoints();
+  ASSERT_EQ(checkpoints.size(), 2);
+  // redundant entries as in replays written by other tools, or joined ones
+  keyframes[0].loads = {esp::assets::AssetInfo::fromPath("my_asset.glb")};
+  keyframes[4].loads = keyframes[0].loads;
+  ASSERT_EQ(keyframes[0].stateUpdates.size(), 2);
+  keyframes[5].stateUpdates.push_back(keyframes[0].stateUpdates[1]);
+
+  const auto removed = esp::gfx::replay::compactKeyframes(keyframes);
+  EXPECT_EQ(removed.numLoads, 1);
+  EXPECT_EQ(removed.numStateUpdates, 1);
+  EXPECT_TRUE(keyframes[4].loads.empty());
+  ASSERT_EQ(keyframes[0].stateUpdates.size(), 2);
+  for (int i = 1; i < numKeyframes; ++i) {
+    // only node0 moves
+    ASSERT_EQ(keyframes[i].stateUpdates.size(), 1);
+  }
+
+  std::vector<Checkpoint> slicedCheckpoints;
+  const auto sliced = esp::gfx::replay::sliceKeyframes(
+      keyframes, checkpoints, 4, 7, &slicedCheckpoints);
+  ASSERT_EQ(sliced.size(), 3);
+  // the first keyframe recreates both instances in their state at keyframe 4
+  EXPECT_EQ(sliced[0].creations.size(), 2);
+  ASSERT_EQ(sliced[0].stateUpdates.size(), 2);
+  EXPECT_EQ(sliced[0].stateUpdates[0].second.absTransform.translation,
+            Mn::Vector3(4.f, 0.f, 0.f));
+  EXPECT_EQ(sliced[2].stateUpdates[0].second.absTransform.translation,
+            Mn::Vector3(6.f, 0.f, 0.f));
+  // the checkpoint at keyframe 6 is kept
+  ASSERT_EQ(slicedCheckpoints.size(), 1);
+  EXPECT_EQ(slicedCheckpoints[0].keyframeIndex, 2);
+
+  // JSON and binary round trips keep the sliced replay
+  for (const char* filename :
+       {"gfx_replay_sliced_test.json", "gfx_replay_sliced_test.bin"}) {
+    const auto testFilepath =
+        Corrade::Utility::Directory::join(DATA_DIR, filename);
+    ASSERT_TRUE(esp::gfx::replay::writeKeyframesToFile(testFilepath, sliced,
+                                                       slicedCheckpoints));
+    std::vector<Keyframe> readKeyframes;
+    std::vector<Checkpoint> readCheckpoints;
+    ASSERT_TRUE(esp::gfx::replay::readKeyframesFromFile(
+        testFilepath, readKeyframes, &readCheckpoints));
+    EXPECT_EQ(readKeyframes.size(), sliced.size());
+    EXPECT_EQ(readCheckpoints.size(), slicedCheckpoints.size());
+    Corrade::Utility::Directory::rm(testFilepath);
+  }
+}
@@ -888,3 +888,220 @@ TEST_F(PhysicsManagerTest, TestRemoveSleepingSupport) {
     }
   }
 }
+
+TEST_F(PhysicsManagerTest, TestTriggerVolumes) {
+  // test enter/exit events of trigger volumes for kinematic objects
+  LOG(INFO) << "Starting physics test: TestTriggerVolumes";
+
+  std::string stageFile = "NONE";
+
+  initStage(stageFile);
+  auto& drawables = sceneManager_.getSceneGraph(sceneID_).getDrawables();
+
+  auto objectAttributesManager =
+      metadataMediator_->getObjectAttributesManager();
+  std::string cubeHandle =
+      objectAttributesManager->getObjectHandlesBySubstring("cubeSolid")[0];
+
+  const Mn::Vector3 inside(0.1, 0.2, 0.3);
+  const Mn::Vector3 outside(3.0, 0.2, 0.3);
+  std::vector<int> cubeIds;
+  for (int i = 0; i < 2; ++i) {
+    cubeIds.push_back(physicsManager_->addObject(cubeHandle, &drawables));
+    physicsManager_->setObjectMotionType(cubeIds.back(),
+                                         esp::physics::MotionType::KINEMATIC);
+  }
+  physicsManager_->setTranslation(cubeIds[0], inside);
+  physicsManager_->setTranslation(cubeIds[1], outside);
+
+  // a unit box centered at the origin, translated by 0.5 on Y
+  const int queuedId = physicsManager_->addTriggerVolume(
+      Mn::Range3D::fromCenter({}, Mn::Vector3{0.5}),
+      Mn::Matrix4::translation({0, 0.5, 0}));
+  std::vector<esp::physics::TriggerEvent> callbackEvents;
+  const int callbackId = physicsManager_->addTriggerVolume(
+      Mn::Range3D::fromCenter({}, Mn::Vector3{0.5}),
+      Mn::Matrix4::translation({0, 0.5, 0}),
+      [&](const esp::physics::TriggerEvent& event) {
+        callbackEvents.push_back(event);
+      });
+  ASSERT_EQ(physicsManager_->getNumTriggerVolumes(), 2);
+
+  physicsManager_->stepPhysics(0.1);
+  auto events = physicsManager_->takeTriggerEvents();
+  ASSERT_EQ(events.size(), 1);
+  ASSERT_EQ(events[0].triggerId, queuedId);
+  ASSERT_EQ(events[0].objectId, cubeIds[0]);
+  ASSERT_TRUE(events[0].entered);
+  ASSERT_EQ(callbackEvents.size(), 1);
+  ASSERT_EQ(callbackEvents[0].triggerId, callbackId);
+  ASSERT_EQ(callbackEvents[0].objectId, cubeIds[0]);
+
+  // no change, no events
+  physicsManager_->stepPhysics(0.1);
+  ASSERT_TRUE(physicsManager_->takeTriggerEvents().empty());
+
+  // swap the cubes
+  physicsManager_->setTranslation(cubeIds[0], outside);
+  physicsManager_->setTranslation(cubeIds[1], inside);
+  physicsManager_->stepPhysics(0.1);
+  events = physicsManager_->takeTriggerEvents();
+  ASSERT_EQ(events.size(), 2);
+  ASSERT_EQ(events[0].objectId, cubeIds[0]);
+  ASSERT_FALSE(events[0].entered);
+  ASSERT_EQ(events[1].objectId, cubeIds[1]);
+  ASSERT_TRUE(events[1].entered);
+
+  // removing an object inside a volume reports an exit
+  physicsManager_->removeObject(cubeIds[1]);
+  physicsManager_->stepPhysics(0.1);
+  events = physicsManager_->takeTriggerEvents();
+  ASSERT_EQ(events.size(), 1);
+  ASSERT_EQ(events[0].objectId, cubeIds[1]);
+  ASSERT_FALSE(events[0].entered);
+  ASSERT_EQ(callbackEvents.size(), 4);
+
+  // moving a volume onto an object
+  physicsManager_->setTriggerVolumeTransformation(
+      queuedId, Mn::Matrix4::translation(outside));
+  physicsManager_->stepPhysics(0.1);
+  events = physicsManager_->takeTriggerEvents();
+  ASSERT_EQ(events.size(), 1);
+  ASSERT_EQ(events[0].objectId, cubeIds[0]);
+  ASSERT_TRUE(events[0].entered);
+
+  physicsManager_->removeTriggerVolume(queuedId);
+  physicsManager_->removeTriggerVolume(callbackId);
+  ASSERT_EQ(physicsManager_->getNumTriggerVolumes(), 0);
+}
+
+TEST_F(PhysicsManagerTest, TestTriggerVolumesIgnoredByQueries) {
+  // test that rays and contact tests don't see trigger volumes
+  LOG(INFO) << "Starting physics test: TestTriggerVolumesIgnoredByQueries";
+
+  std::string stageFile = "NONE";
+
+  initStage(stageFile);
+
+  if (physicsManager_->getPhysicsSimulationLibrary() ==
+      PhysicsManager::PhysicsSimulationLibrary::BULLET) {
+    auto& drawables = sceneManager_.getSceneGraph(sceneID_).getDrawables();
+
+    auto objectAttributesManager =
+        metadataMediator_->getObjectAttributesManager();
+    std::string cubeHandle =
+        objectAttributesManager->getObjectHandlesBySubstring("cubeSolid")[0];
+
+    // a cube sitting inside a larger volume
+    const int cubeId = physicsManager_->addObject(cubeHandle, &drawables);
+    physicsManager_->setObjectMotionType(cubeId,
+                                         esp::physics::MotionType::KINEMATIC);
+    physicsManager_->addTriggerVolume(
+        Mn::Range3D::fromCenter({}, Mn::Vector3{2.0}), Mn::Matrix4{});
+    physicsManager_->stepPhysics(0.1);
+    ASSERT_EQ(physicsManager_->takeTriggerEvents().size(), 1);
+
+    // overlapping the volume isn't a contact
+    ASSERT_FALSE(physicsManager_->contactTest(cubeId));
+
+    // a ray entering the volume only hits the cube
+    esp::geo::Ray ray{Mn::Vector3{-5.0, 0, 0}, Mn::Vector3::xAxis()};
+    esp::physics::RaycastResults results = physicsManager_->castRay(ray);
+    ASSERT_TRUE(results.hasHits());
+    for (const auto& hit : results.hits) {
+      ASSERT_EQ(hit.objectId, cubeId);
+    }
+
+    // a ray through the volume alone hits nothing
+    esp::geo::Ray missRay{Mn::Vector3{-5.0, 1.5, 0}, Mn::Vector3::xAxis()};
+    ASSERT_FALSE(physicsManager_->castRay(missRay).hasHits());
+  }
+}
+
+TEST_F(PhysicsManagerTest, TestSnapshot) {
+  // test restoring object states, world time and trigger membership
+  LOG(INFO) << "Starting physics test: TestSnapshot";
+
+  std::string stageFile = "NONE";
+
+  initStage(stageFile);
+  auto& drawables = sceneManager_.getSceneGraph(sceneID_).getDrawables();
+
+  auto objectAttributesManager =
+      metadataMediator_->getObjectAttributesManager();
+  std::string cubeHandle =
+      objectAttributesManager->getObjectHandlesBySubstring("cubeSolid")[0];
+
+  const Mn::Vector3 inside(0.1, 0.2, 0.3);
+  const Mn::Vector3 outside(3.0, 0.2, 0.3);
+  std::vector<int> cubeIds;
+  for (int i = 0; i < 2; ++i) {
+    cubeIds.push_back(physicsManager_->addObject(cubeHandle, &drawables));
+    physicsManager_->setObjectMotionType(cubeIds.back(),
+                                         esp::physics::MotionType::KINEMATIC);
+  }
+  physicsManager_->setTranslation(cubeIds[0], inside);
+  physicsManager_->setTranslation(cubeIds[1], outside);
+  const Mn::Quaternion rotation =
+      Mn::Quaternion::rotation(Mn::Deg(30), Mn::Vector3::yAxis());
+  physicsManager_->setRotation(cubeIds[1], rotation);
+  physicsManager_->addTriggerVolume(
+      Mn::Range3D::fromCenter({}, Mn::Vector3{0.5}),
+      Mn::Matrix4::translation({0, 0.5, 0}));
+
+  // a free-floating articulated object, whose root velocity is part of the
+  // snapshot
+  int robotId = esp::ID_UNDEFINED;
+  if (physicsManager_->getPhysicsSimulationLibrary() ==
+      PhysicsManager::PhysicsSimulationLibrary::BULLET) {
+    std::string robotFile = Cr::Utility::Directory::join(
+        TEST_ASSETS, "URDF/kuka_iiwa/model_free_base.urdf");
+    robotId = physicsManager_->addArticulatedObjectFromURDF(robotFile,
+                                                            &drawables);
+    ASSERT_NE(robotId, esp::ID_UNDEFINED);
+    auto& robot = physicsManager_->getArticulatedObject(robotId);
+    // away from the trigger volume
+    robot.setRootState(Mn::Matrix4::translation({-5.0, 0, 0}));
+    robot.setRootLinearVelocity({0.5, 0, 0});
+    robot.setRootAngularVelocity({0, 1.0, 0});
+  }
+
+  physicsManager_->stepPhysics(0.1);
+  ASSERT_EQ(physicsManager_->takeTriggerEvents().size(), 1);
+
+  std::vector<char> buffer;
+  esp::core::SnapshotWriter writer{buffer};
+  physicsManager_->writeSnapshot(writer);
+  const double worldTime = physicsManager_->getWorldTime();
+  Mn::Vector3 robotLinVel, robotAngVel;
+  if (robotId != esp::ID_UNDEFINED) {
+    auto& robot = physicsManager_->getArticulatedObject(robotId);
+    robotLinVel = robot.getRootLinearVelocity();
+    robotAngVel = robot.getRootAngularVelocity();
+    robot.setRootLinearVelocity({});
+    robot.setRootAngularVelocity({});
+  }
+
+  // the exit event is still queued when the snapshot is restored
+  physicsManager_->setTranslation(cubeIds[0], outside);
+  physicsManager_->setRotation(cubeIds[1], Mn::Quaternion{});
+  physicsManager_->stepPhysics(0.1);
+
+  esp::core::SnapshotReader reader{buffer.data(), buffer.size()};
+  physicsManager_->readSnapshot(reader);
+  ASSERT_EQ(reader.getRemaining(), 0);
+  ASSERT_TRUE(physicsManager_->takeTriggerEvents().empty());
+  ASSERT_EQ(physicsManager_->getWorldTime(), worldTime);
+  ASSERT_EQ(physicsManager_->getTranslation(cubeIds[0]), inside);
+  ASSERT_EQ(physicsManager_->getTranslation(cubeIds[1]), outside);
+  ASSERT_EQ(physicsManager_->getRotation(cubeIds[1]), rotation);
+  if (robotId != esp::ID_UNDEFINED) {
+    auto& robot = physicsManager_->getArticulatedObject(robotId);
+    ASSERT_EQ(robot.getRootLinearVelocity(), robotLinVel);
+    ASSERT_EQ(robot.getRootAngularVelocity(), robotAngVel);
+  }
+
+  // the volume remembers the cube inside, so it doesn't enter again
+  physicsManager_->stepPhysics(0.1);
+  ASSERT_TRUE(physicsManager_->takeTriggerEvents().empty());
+}
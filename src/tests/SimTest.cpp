@@ -14,6 +14,7 @@
 
 #include "esp/assets/ResourceManager.h"
 #include "esp/physics/RigidObject.h"
+#include "esp/scripted/EntityManagerHelper.h"
 #include "esp/sensor/CameraSensor.h"
 #include "esp/sim/Simulator.h"
 
@@ -33,6 +34,10 @@ using esp::metadata::MetadataMediator;
 using esp::metadata::attributes::AbstractPrimitiveAttributes;
 using esp::metadata::attributes::ObjectAttributes;
 using esp::nav::PathFinder;
+using esp::scripted::CookableEntity;
+using esp::scripted::EntityHandle;
+using esp::scripted::EntityManagerHelper;
+using esp::scripted::OvenEntity;
 using esp::sensor::CameraSensor;
 using esp::sensor::CameraSensorSpec;
 using esp::sensor::Observation;
@@ -127,6 +132,7 @@ struct SimTest : Cr::TestSuite::Tester {
   void buildingPrimAssetObjectTemplates();
   void addObjectByHandle();
   void addSensorToObject();
+  void snapshot();
 
   // TODO: remove outlier pixels from image and lower maxThreshold
   const Magnum::Float maxThreshold = 255.f;
@@ -166,7 +172,8 @@ SimTest::SimTest() {
             &SimTest::loadingObjectTemplates,
             &SimTest::buildingPrimAssetObjectTemplates,
             &SimTest::addObjectByHandle,
-            &SimTest::addSensorToObject}, Cr::Containers::arraySize(SimulatorBuilder) );
+            &SimTest::addSensorToObject,
+            &SimTest::snapshot}, Cr::Containers::arraySize(SimulatorBuilder) );
   // clang-format on
 }
 
@@ -795,6 +802,82 @@ void SimTest::addSensorToObject() {
       Cr::Utility::Directory::join(screenshotDir, "SimTestExpectedScene.png"),
       (Mn::DebugTools::CompareImageToFile{maxThreshold, 0.75f}));
 }
+
+void SimTest::snapshot() {
+  Corrade::Utility::Debug() << "Starting Test : snapshot ";
+  auto&& data = SimulatorBuilder[testCaseInstanceId()];
+  setTestCaseDescription(data.name);
+  auto simulator = data.creator(*this, planeStage, esp::NO_LIGHT_KEY);
+  if (simulator->getPhysicsSimulationLibrary() !=
+      esp::physics::PhysicsManager::PhysicsSimulationLibrary::BULLET) {
+    CORRADE_SKIP("Ovens are articulated objects, which need Bullet.");
+  }
+
+  // an oven heating up and a cookable next to it, whose state is saved by a
+  // snapshot participant
+  EntityManagerHelper entities;
+  OvenEntity::Blueprint ovenBp;
+  ovenBp.urdfFilepath = Cr::Utility::Directory::join(
+      TEST_ASSETS, "URDF/kuka_iiwa/model_free_base.urdf");
+  ovenBp.heatVolume = Mn::Range3D::fromCenter({}, Mn::Vector3{0.5f});
+  ovenBp.openSensorDir = Mn::Vector3::yAxis();
+  // heats up whether the door is open or not
+  ovenBp.openTempPerSec = ovenBp.closedTempPerSec = 100.0f;
+  const EntityHandle oven = entities.getOvens().add(
+      OvenEntity(simulator.get(), ovenBp, {}, {},
+                 entities.getHeatVolumeCallback()));
+  CookableEntity::Blueprint cookableBp;
+  cookableBp.objHandle = cookableBp.cookedObjHandle =
+      simulator->getObjectAttributesManager()->getObjectHandlesBySubstring(
+          "nested_box")[0];
+  const EntityHandle cookable = entities.getCookables().add(CookableEntity(
+      simulator.get(), cookableBp, {2.0f, 0.5f, 0.0f}, {}));
+  const int cookableObjectId =
+      entities.getCookables().get(cookable)->getObjectId();
+  simulator->addSnapshotParticipant(
+      "entities",
+      [&](esp::core::SnapshotWriter& writer) {
+        entities.writeSnapshot(writer);
+      },
+      [&](esp::core::SnapshotReader& reader) {
+        entities.readSnapshot(reader);
+      });
+
+  auto step = [&]() {
+    constexpr float dt = 1.0f / 60.0f;
+    simulator->stepWorld(dt);
+    entities.update(dt);
+  };
+  for (int i = 0; i < 10; ++i) {
+    step();
+  }
+
+  std::vector<char> buffer;
+  simulator->saveSnapshot(buffer);
+  const double worldTime = simulator->getWorldTime();
+  const float temperature = entities.getOvens().get(oven)->getTemperature();
+  const Mn::Vector3 cookablePos = simulator->getTranslation(cookableObjectId);
+
+  for (int i = 0; i < 10; ++i) {
+    step();
+  }
+  CORRADE_VERIFY(entities.getOvens().get(oven)->getTemperature() >
+                 temperature);
+  simulator->setTranslation({5.0f, 0.5f, 0.0f}, cookableObjectId);
+
+  simulator->restoreSnapshot(buffer);
+  CORRADE_COMPARE(simulator->getWorldTime(), worldTime);
+  CORRADE_COMPARE(entities.getOvens().get(oven)->getTemperature(),
+                  temperature);
+  CORRADE_COMPARE(simulator->getTranslation(cookableObjectId), cookablePos);
+
+  // the restored world keeps stepping
+  step();
+  CORRADE_VERIFY(entities.getOvens().get(oven)->getTemperature() >
+                 temperature);
+
+  CORRADE_VERIFY(simulator->removeSnapshotParticipant("entities"));
+}
 }  // namespace
 
 CORRADE_TEST_MAIN(SimTest)
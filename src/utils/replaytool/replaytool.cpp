@@ -0,0 +1,230 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+// Compacts, converts and slices gfx-replay files in bulk, e.g.
+//
+//   replaytool --output-dir compacted --format binary recordings/
+//
+// Inputs are replay files, or directories whose .json and .bin files are all
+// processed. Files are processed in parallel.
+
+#include <Corrade/Utility/Arguments.h>
+#include <Corrade/Utility/Debug.h>
+#include <Corrade/Utility/DebugStl.h>
+#include <Corrade/Utility/Directory.h>
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "esp/core/TaskScheduler.h"
+#include "esp/gfx/replay/ReplayFile.h"
+
+namespace Cr = Corrade;
+
+using esp::gfx::replay::Checkpoint;
+using esp::gfx::replay::CompactionStats;
+using esp::gfx::replay::Keyframe;
+
+namespace {
+
+struct Options {
+  std::string outputDir;
+  // ".json", ".bin", or empty to keep the input format
+  std::string outputExtension;
+  int begin = 0;
+  int end = -1;
+  bool compact = true;
+};
+
+struct FileResult {
+  bool success = false;
+  std::size_t inputSize = 0;
+  std::size_t outputSize = 0;
+  int numKeyframes = 0;
+  CompactionStats removed;
+};
+
+std::size_t fileSize(const std::string& filepath) {
+  std::ifstream file(filepath, std::ios::binary | std::ios::ate);
+  return file ? std::size_t(file.tellg()) : 0;
+}
+
+bool isReplayFilepath(const std::string& filepath) {
+  const std::string extension =
+      Cr::Utility::Directory::splitExtension(filepath).second;
+  return extension == ".json" || extension == ".bin";
+}
+
+std::string outputFilepath(const std::string& input, const Options& options) {
+  const auto split = Cr::Utility::Directory::splitExtension(
+      Cr::Utility::Directory::filename(input));
+  const std::string& extension = options.outputExtension.empty()
+                                     ? split.second
+                                     : options.outputExtension;
+  return Cr::Utility::Directory::join(options.outputDir,
+                                      split.first + extension);
+}
+
+FileResult processFile(const std::string& input, const Options& options) {
+  FileResult result;
+  std::vector<Keyframe> keyframes;
+  std::vector<Checkpoint> checkpoints;
+  if (!esp::gfx::replay::readKeyframesFromFile(input, keyframes,
+                                               &checkpoints)) {
+    return result;
+  }
+  result.inputSize = fileSize(input);
+
+  const int numKeyframes = keyframes.size();
+  const int end =
+      options.end < 0 ? numKeyframes : std::min(options.end, numKeyframes);
+  if (options.begin >= end) {
+    LOG(ERROR) << "replaytool: " << input << " has " << numKeyframes
+               << " keyframes, none in [" << options.begin << ", " << end
+               << ")";
+    return result;
+  }
+  if (options.begin != 0 || end != numKeyframes) {
+    std::vector<Checkpoint> slicedCheckpoints;
+    keyframes = esp::gfx::replay::sliceKeyframes(
+        keyframes, checkpoints, options.begin, end, &slicedCheckpoints);
+    checkpoints = std::move(slicedCheckpoints);
+  }
+  if (options.compact) {
+    result.removed = esp::gfx::replay::compactKeyframes(keyframes);
+  }
+
+  const std::string output = outputFilepath(input, options);
+  if (!esp::gfx::replay::writeKeyframesToFile(output, keyframes,
+                                              checkpoints)) {
+    return result;
+  }
+  result.success = true;
+  result.outputSize = fileSize(output);
+  result.numKeyframes = keyframes.size();
+  return result;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Cr::Utility::Arguments args;
+  args.addArrayArgument("input")
+      .setHelp("input", "replay files, or directories of replay files")
+      .addOption("output-dir")
+      .setHelp("output-dir",
+               "directory for the output files, which keep the input names")
+      .addOption("format", "keep")
+      .setHelp("format",
+               "output format: json, binary, or keep for the input format")
+      .addOption("begin", "0")
+      .setHelp("begin", "first keyframe to keep")
+      .addOption("end", "-1")
+      .setHelp("end", "keyframe to stop before, or -1 to keep the rest")
+      .addBooleanOption("no-compact")
+      .setHelp("no-compact",
+               "keep unchanged state updates and repeated asset loads")
+      .addOption("threads", "-1")
+      .setHelp("threads",
+               "worker threads, or -1 for one less than the hardware "
+               "concurrency")
+      .setGlobalHelp(
+          "Rewrites gfx-replay files, dropping entries which don't change "
+          "the played back scene, converting between the JSON and binary "
+          "formats, and keeping a range of keyframes.")
+      .parse(argc, argv);
+
+  Options options;
+  options.outputDir = args.value("output-dir");
+  if (options.outputDir.empty()) {
+    Cr::Utility::Error{} << "replaytool: --output-dir is required";
+    return 1;
+  }
+  const std::string format = args.value("format");
+  if (format == "json") {
+    options.outputExtension = ".json";
+  } else if (format == "binary") {
+    options.outputExtension = ".bin";
+  } else if (format != "keep") {
+    Cr::Utility::Error{} << "replaytool: unknown format" << format;
+    return 1;
+  }
+  options.begin = args.value<int>("begin");
+  options.end = args.value<int>("end");
+  options.compact = !args.isSet("no-compact");
+  if (options.begin < 0) {
+    Cr::Utility::Error{} << "replaytool: --begin must not be negative";
+    return 1;
+  }
+
+  std::vector<std::string> inputs;
+  for (std::size_t i = 0; i < args.arrayValueCount("input"); ++i) {
+    const std::string input = args.arrayValue("input", i);
+    if (!Cr::Utility::Directory::isDirectory(input)) {
+      inputs.push_back(input);
+      continue;
+    }
+    auto entries = Cr::Utility::Directory::list(
+        input, Cr::Utility::Directory::Flag::SkipDirectories |
+                   Cr::Utility::Directory::Flag::SkipDotAndDotDot);
+    std::sort(entries.begin(), entries.end());
+    for (const auto& entry : entries) {
+      if (isReplayFilepath(entry)) {
+        inputs.push_back(Cr::Utility::Directory::join(input, entry));
+      }
+    }
+  }
+  // outputs keep only the input file names, and files are written in
+  // parallel, so two inputs can't share an output
+  std::map<std::string, std::string> inputByOutput;
+  for (const std::string& input : inputs) {
+    const std::string output = outputFilepath(input, options);
+    const auto inserted = inputByOutput.emplace(output, input);
+    if (!inserted.second) {
+      Cr::Utility::Error{} << "replaytool:" << inserted.first->second << "and"
+                           << input << "would both be written to" << output;
+      return 1;
+    }
+  }
+  if (!Cr::Utility::Directory::mkpath(options.outputDir)) {
+    Cr::Utility::Error{} << "replaytool: can't create" << options.outputDir;
+    return 1;
+  }
+
+  std::vector<FileResult> results(inputs.size());
+  esp::core::TaskScheduler scheduler{args.value<int>("threads")};
+  scheduler.parallelFor(inputs.size(), [&](std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin; i != end; ++i) {
+      results[i] = processFile(inputs[i], options);
+    }
+  });
+
+  FileResult total;
+  int numFailed = 0;
+  for (std::size_t i = 0; i != inputs.size(); ++i) {
+    const FileResult& result = results[i];
+    if (!result.success) {
+      Cr::Utility::Error{} << inputs[i] << "failed";
+      ++numFailed;
+      continue;
+    }
+    Cr::Utility::Debug{} << inputs[i] << "->"
+                         << outputFilepath(inputs[i], options)
+                         << Cr::Utility::Debug::nospace << ":"
+                         << result.numKeyframes << "keyframes,"
+                         << result.inputSize << "->" << result.outputSize
+                         << "bytes, removed" << result.removed.numStateUpdates
+                         << "state updates and" << result.removed.numLoads
+                         << "loads";
+    total.inputSize += result.inputSize;
+    total.outputSize += result.outputSize;
+  }
+  Cr::Utility::Debug{} << inputs.size() - numFailed << "of" << inputs.size()
+                       << "files written," << total.inputSize << "->"
+                       << total.outputSize << "bytes";
+  return numFailed ? 1 : 0;
+}
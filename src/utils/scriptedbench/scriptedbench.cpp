@@ -0,0 +1,84 @@
+// Copyright (c) Facebook, Inc. and its affiliates.
+// This source code is licensed under the MIT license found in the
+// LICENSE file in the root directory of this source tree.
+
+// Steps a scripted kitchen world headlessly at a fixed timestep and reports
+// throughput, e.g.
+//
+//   scriptedbench --ovens 8 --cookables 32 --vessels 40 --steps 2000
+
+#include <Corrade/Utility/Arguments.h>
+#include <Corrade/Utility/Debug.h>
+#include <Corrade/Utility/DebugStl.h>
+
+#include "esp/scripted/HeadlessScriptedWorld.h"
+
+namespace Cr = Corrade;
+
+using esp::scripted::HeadlessScriptedWorld;
+
+int main(int argc, char** argv) {
+  HeadlessScriptedWorld::Config defaults;
+
+  Cr::Utility::Arguments args;
+  args.addOption("scene-description", defaults.sceneDescriptionFilepath)
+      .setHelp("scene-description", "scripted scene description to load")
+      .addOption("scene", defaults.activeSceneName)
+      .setHelp("scene", "scene/stage file to load")
+      .addOption("dataset", defaults.sceneDatasetConfigFile)
+      .setHelp("dataset", "dataset configuration file to use")
+      .addOption("physics-config", defaults.physicsConfigFile)
+      .setHelp("physics-config",
+               "Provide a non-default PhysicsManager config file.")
+      .addOption("ovens", "-1")
+      .setHelp("ovens", "number of ovens, or -1 for the described count")
+      .addOption("cookables", "-1")
+      .setHelp("cookables",
+               "number of cookables, or -1 for the described count")
+      .addOption("vessels", "-1")
+      .setHelp("vessels",
+               "number of fluid vessels, or -1 for the described count")
+      .addOption("dt", std::to_string(defaults.dt))
+      .setHelp("dt", "fixed timestep in seconds")
+      .addOption("steps", "1000")
+      .setHelp("steps", "number of timed steps")
+      .addOption("warmup-steps", "60")
+      .setHelp("warmup-steps", "number of untimed steps before measuring")
+      .addOption("threads", "0")
+      .setHelp("threads",
+               "worker threads for entity systems, or -1 for one less than "
+               "the hardware concurrency")
+      .addOption("gpu-device-id", "0")
+      .setHelp("gpu-device-id", "GPU used to upload assets; nothing is drawn")
+      .setGlobalHelp(
+          "Steps physics and scripted entities at a fixed timestep without "
+          "rendering and reports steps per second.")
+      .parse(argc, argv);
+
+  HeadlessScriptedWorld::Config config;
+  config.sceneDescriptionFilepath = args.value("scene-description");
+  config.activeSceneName = args.value("scene");
+  config.sceneDatasetConfigFile = args.value("dataset");
+  config.physicsConfigFile = args.value("physics-config");
+  config.numOvens = args.value<int>("ovens");
+  config.numCookables = args.value<int>("cookables");
+  config.numFluidVessels = args.value<int>("vessels");
+  config.dt = args.value<float>("dt");
+  config.numWorkerThreads = args.value<int>("threads");
+  config.gpuDeviceId = args.value<int>("gpu-device-id");
+
+  HeadlessScriptedWorld world(config);
+  auto& entities = world.getEntities();
+
+  world.run(args.value<int>("warmup-steps"));
+  const auto stats = world.run(args.value<int>("steps"));
+
+  Cr::Utility::Debug{} << "ovens:" << entities.getOvens().size()
+                       << "cookables:" << entities.getCookables().size()
+                       << "fluid vessels:" << entities.getFluidVessels().size();
+  Cr::Utility::Debug{} << stats.numSteps << "steps of" << config.dt << "s in"
+                       << stats.seconds << "s:" << stats.getStepsPerSecond()
+                       << "steps/s," << stats.getStepsPerSecond() * config.dt
+                       << "x real time";
+  return 0;
+}
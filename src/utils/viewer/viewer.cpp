@@ -1129,6 +1129,9 @@ Key Commands:
 
   std::unique_ptr<SpawnerGrabber> spawnerGrabber_;
 
+  // scripted entities (ovens, cookables, fluid vessels) for simulator_
+  esp::scripted::EntityManagerHelper scriptedEntities_;
+
   // Keys for moving/looking are recorded according to whether they are
   // currently being pressed
   std::map<KeyEvent::Key, bool> keysPressed_ = {
@@ -1462,7 +1465,8 @@ Viewer::Viewer(const Arguments& arguments)
   // Per frame profiler will average measurements taken over previous 50 frames
   profiler_.setup(profilerValues, 50);
 
-  esp::scripted::KitchenSetup kitchenSetup(simulator_.get());
+  esp::scripted::KitchenSetup kitchenSetup(simulator_.get(),
+                                           scriptedEntities_);
   spawnerGrabber_ = std::make_unique<SpawnerGrabber>(simulator_.get());
 
   printHelpText();
@@ -1958,7 +1962,7 @@ void Viewer::drawEvent() {
         aliengoController->cycleUpdate(1.0 / 60.0);
       }
       simulator_->stepWorld(1.0 / 60.0);
-      esp::scripted::EntityManagerHelper::update(1.0 / 60.0);
+      scriptedEntities_.update(1.0 / 60.0);
       simulateSingleStep_ = false;
       const auto recorder = simulator_->getGfxReplayManager()->getRecorder();
       if (recorder) {
@@ -1987,7 +1991,7 @@ void Viewer::drawEvent() {
   }
 #endif
 
-  esp::scripted::EntityManagerHelper::debugRender(debug3dText_, debugRender_);
+  scriptedEntities_.debugRender(debug3dText_, debugRender_);
   spawnerGrabber_->debugRender(debug3dText_, debugRender_);
 
   uint32_t visibles = renderCamera_->getPreviousNumVisibleDrawables();
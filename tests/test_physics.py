@@ -128,6 +128,22 @@ def test_kinematics():
         assert np.allclose(objectRigidState.translation, targetRigidState.translation)
         assert objectRigidState.rotation == targetRigidState.rotation
 
+        # test bulk get/set of RigidStates and transformations
+        object_ids = [object_id] + [
+            sim.add_object_by_handle(obj_handle_list[0]) for _ in range(3)
+        ]
+        Q = quat_to_magnum(quat_from_angle_axis(np.pi / 2, np.array([0, 1.0, 0])))
+        rigid_states = np.zeros((len(object_ids), 7), dtype=np.float32)
+        rigid_states[:, 0:3] = np.array(Q.vector)
+        rigid_states[:, 3] = Q.scalar
+        rigid_states[:, 4:7] = np.random.rand(len(object_ids), 3)
+        sim.set_rigid_states(np.array(object_ids), rigid_states)
+        assert np.allclose(sim.get_rigid_states(object_ids), rigid_states, atol=1e-5)
+        transforms = sim.get_transformations(object_ids)
+        assert transforms.shape == (len(object_ids), 4, 4)
+        for i, obj_id in enumerate(object_ids):
+            assert np.allclose(transforms[i], sim.get_transformation(obj_id))
+
 
 @pytest.mark.skipif(
     not osp.exists("data/scene_datasets/habitat-test-scenes/skokloster-castle.glb")